@@ -0,0 +1,110 @@
+#include "auto_exposure.h"
+
+#include <glm.hpp>
+#include <macros.h>
+#include <utility.h>
+#include <logger.h>
+#include <stdint.h>
+#include <vector>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AutoExposure::AutoExposure()
+{
+	m_histogram_t = nullptr;
+	m_adapted_luminance_t = nullptr;
+	m_histogram_cs = nullptr;
+	m_adaptation_cs = nullptr;
+	m_histogram_program = nullptr;
+	m_adaptation_program = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AutoExposure::~AutoExposure()
+{
+	DW_SAFE_DELETE(m_histogram_program);
+	DW_SAFE_DELETE(m_adaptation_program);
+	DW_SAFE_DELETE(m_histogram_cs);
+	DW_SAFE_DELETE(m_adaptation_cs);
+	DW_SAFE_DELETE(m_histogram_t);
+	DW_SAFE_DELETE(m_adapted_luminance_t);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool AutoExposure::initialize()
+{
+	if (!dw::utility::create_compute_program("shader/luminance_histogram_cs.glsl", &m_histogram_cs, &m_histogram_program) ||
+		!dw::utility::create_compute_program("shader/exposure_adaptation_cs.glsl", &m_adaptation_cs, &m_adaptation_program))
+	{
+		DW_LOG_ERROR("Failed to load shaders");
+		return false;
+	}
+
+	// The adaptation pass clears the histogram after reading it, so it only has to start out empty.
+	m_histogram_t = new dw::Texture2D(NUM_BINS, 1, 1, 1, 1, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT);
+
+	std::vector<uint32_t> zeros(NUM_BINS, 0);
+	m_histogram_t->set_data(0, 0, zeros.data());
+
+	m_adapted_luminance_t = new dw::Texture2D(1, 1, 1, 1, 1, GL_R32F, GL_RED, GL_FLOAT);
+	m_adapted_luminance_t->set_min_filter(GL_NEAREST);
+
+	reset();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AutoExposure::update(dw::Texture2D* color, int width, int height, float delta_seconds)
+{
+	float log_luminance_range = m_max_log_luminance - m_min_log_luminance;
+
+	// 1. Bin the frame.
+	m_histogram_program->use();
+
+	m_histogram_program->set_uniform("u_Size", glm::vec2(float(width), float(height)));
+	m_histogram_program->set_uniform("u_MinLogLuminance", m_min_log_luminance);
+	m_histogram_program->set_uniform("u_InvLogLuminanceRange", 1.0f / log_luminance_range);
+
+	if (m_histogram_program->set_uniform("s_Color", 0))
+		color->bind(0);
+
+	m_histogram_t->bind_image(0, 0, 0, GL_READ_WRITE, m_histogram_t->internal_format());
+
+	int groups_x = (width + GROUP_SIZE * DOWNSAMPLE - 1) / (GROUP_SIZE * DOWNSAMPLE);
+	int groups_y = (height + GROUP_SIZE * DOWNSAMPLE - 1) / (GROUP_SIZE * DOWNSAMPLE);
+
+	GL_CHECK_ERROR(glDispatchCompute(groups_x, groups_y, 1));
+	GL_CHECK_ERROR(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
+
+	// 2. Average it and adapt, one work group of NUM_BINS invocations.
+	m_adaptation_program->use();
+
+	m_adaptation_program->set_uniform("u_MinLogLuminance", m_min_log_luminance);
+	m_adaptation_program->set_uniform("u_LogLuminanceRange", log_luminance_range);
+	m_adaptation_program->set_uniform("u_DeltaTime", delta_seconds);
+	m_adaptation_program->set_uniform("u_SpeedUp", m_speed_up);
+	m_adaptation_program->set_uniform("u_SpeedDown", m_speed_down);
+
+	m_histogram_t->bind_image(0, 0, 0, GL_READ_WRITE, m_histogram_t->internal_format());
+	m_adapted_luminance_t->bind_image(1, 0, 0, GL_READ_WRITE, m_adapted_luminance_t->internal_format());
+
+	GL_CHECK_ERROR(glDispatchCompute(1, 1, 1));
+
+	// The histogram is read again by the next frame's first pass, the adapted luminance sampled by the tonemapper.
+	GL_CHECK_ERROR(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AutoExposure::reset()
+{
+	// Zero makes the adaptation pass take the frame's average as it is.
+	float zero = 0.0f;
+	m_adapted_luminance_t->set_data(0, 0, &zero);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
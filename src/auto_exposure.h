@@ -0,0 +1,63 @@
+#pragma once
+
+#include <ogl.h>
+
+// Automatic exposure from a log luminance histogram of the HDR color buffer, entirely on the GPU: one compute pass
+// bins the frame, a second one averages the histogram, moves the adapted luminance towards the average over the
+// frame time (faster towards brighter, like the eye) and clears the histogram for the next frame. Nothing is read
+// back, fullscreen_fs.glsl samples the adapted luminance from adapted_luminance().
+//
+// The histogram takes one bilinear tap per 4x4 block of texels, the average of its central 2x2, which is what the
+// first mip would hold without building a mip chain every frame. A 4K frame is binned from half a million taps.
+class AutoExposure
+{
+public:
+	AutoExposure();
+	~AutoExposure();
+
+	bool initialize();
+
+	// Bins color (width x height texels) and adapts over delta_seconds. Call after the frame is rendered into color
+	// and before it is tonemapped.
+	void update(dw::Texture2D* color, int width, int height, float delta_seconds);
+
+	// Jumps to the average of the next frame instead of adapting to it, e.g. after switching to a sky model with
+	// different units.
+	void reset();
+
+	// 1x1 R32F, the average scene luminance the exposure follows.
+	inline dw::Texture2D* adapted_luminance() { return m_adapted_luminance_t; }
+
+	// Range of the histogram in log2 luminance. Luminance outside of it lands in the first or last bin.
+	inline void set_log_luminance_range(float min, float max)
+	{
+		m_min_log_luminance = min;
+		m_max_log_luminance = max;
+	}
+
+	// Rates of the exponential adaptation per second, towards brighter and darker scenes.
+	inline void set_adaptation_speed(float up, float down)
+	{
+		m_speed_up = up;
+		m_speed_down = down;
+	}
+
+private:
+	const int NUM_BINS = 256;
+	const int GROUP_SIZE = 16;
+	const int DOWNSAMPLE = 4;
+
+	// Every sky model fits, from the darkest Preetham twilight to the sun disc of the 2017 model in cd/m^2.
+	float m_min_log_luminance = -10.0f;
+	float m_max_log_luminance = 20.0f;
+	float m_speed_up = 3.0f;
+	float m_speed_down = 1.0f;
+
+	dw::Texture2D* m_histogram_t;
+	dw::Texture2D* m_adapted_luminance_t;
+
+	dw::Shader* m_histogram_cs;
+	dw::Shader* m_adaptation_cs;
+	dw::Program* m_histogram_program;
+	dw::Program* m_adaptation_program;
+};
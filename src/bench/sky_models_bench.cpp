@@ -0,0 +1,758 @@
+// Throughput benchmarks for the GL-free sky model code. Every benchmark runs a warmup, then times a number of samples
+// (each one a batch of iterations long enough to be well above the timer resolution) and reports min, median, mean,
+// standard deviation and 95th percentile per iteration, plus items per second. Results go to stdout as JSON (default)
+// or CSV so release pipelines can diff them against a baseline.
+//
+// Usage: sky_models_bench [--format json|csv] [--filter <substring>] [--samples <n>] [--min-sample-ms <ms>]
+//                         [--bruneton-cache <dir>] [--bruneton-2017-precompute]
+
+#include "preetham_sky_model.h"
+#include "hosek_wilkie_sky_model.h"
+#include "bruneton_sky_model.h"
+#include "bruneton_lookup.h"
+#include "bruneton_2017_sky_model.h"
+#include "irradiance_sh.h"
+#include "solar_position.h"
+#include "table_codec.h"
+#include "tonemap.h"
+#include "image_writer.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct BenchOptions
+{
+	bool        csv = false;
+	std::string filter;
+	int         samples = 30;
+	double      min_sample_ms = 2.0;
+	double      warmup_ms = 100.0;
+	std::string bruneton_cache = ".";
+	bool        bruneton_2017_precompute = false;
+};
+
+struct BenchResult
+{
+	std::string name;
+	bool        skipped = false;
+	std::string note;
+	double      items_per_iteration = 1.0;
+	int         samples = 0;
+	size_t      iterations_per_sample = 0;
+
+	// Nanoseconds per iteration.
+	double min = 0.0;
+	double median = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+	double p95 = 0.0;
+
+	double items_per_second = 0.0;
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+// Sink for benchmark results so the compiler can't drop the work being timed.
+static volatile float g_sink;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double elapsed_ns(BenchClock::time_point start)
+{
+	return double(std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - start).count());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	double index = p * double(sorted.size() - 1);
+	size_t lo = size_t(floor(index));
+	size_t hi = std::min(lo + 1, sorted.size() - 1);
+
+	return sorted[lo] + (sorted[hi] - sorted[lo]) * (index - double(lo));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+class Bench
+{
+public:
+	Bench(const BenchOptions& options) : m_options(options) {}
+
+	inline const std::vector<BenchResult>& results() { return m_results; }
+
+	bool enabled(const char* name)
+	{
+		return m_options.filter.empty() || strstr(name, m_options.filter.c_str()) != nullptr;
+	}
+
+	void skip(const char* name, const char* note)
+	{
+		if (!enabled(name))
+			return;
+
+		BenchResult result;
+
+		result.name = name;
+		result.skipped = true;
+		result.note = note;
+
+		m_results.push_back(result);
+	}
+
+	// Times fn(), which processes items_per_iteration items per call.
+	template <typename Fn>
+	void run(const char* name, double items_per_iteration, Fn fn)
+	{
+		if (!enabled(name))
+			return;
+
+		// Warmup, which also measures a rough cost per iteration to size the samples with.
+		size_t warmup_iterations = 0;
+		BenchClock::time_point start = BenchClock::now();
+
+		do
+		{
+			fn();
+			warmup_iterations++;
+		} while (elapsed_ns(start) < m_options.warmup_ms * 1e6);
+
+		double estimate = elapsed_ns(start) / double(warmup_iterations);
+		size_t iterations = std::max(size_t(ceil(m_options.min_sample_ms * 1e6 / std::max(estimate, 1.0))), size_t(1));
+
+		std::vector<double> samples(m_options.samples);
+
+		for (int i = 0; i < m_options.samples; i++)
+		{
+			start = BenchClock::now();
+
+			for (size_t j = 0; j < iterations; j++)
+				fn();
+
+			samples[i] = elapsed_ns(start) / double(iterations);
+		}
+
+		add_result(name, items_per_iteration, iterations, samples);
+	}
+
+	// Times a single call of fn(), for expensive one-off work like loading the caches. Each sample is one call.
+	template <typename Fn>
+	void run_once(const char* name, int samples, Fn fn)
+	{
+		BenchOptions options = m_options;
+
+		options.samples = samples;
+		options.min_sample_ms = 0.0;
+		options.warmup_ms = 0.0;
+
+		Bench bench(options);
+		bench.run(name, 1.0, fn);
+
+		m_results.insert(m_results.end(), bench.m_results.begin(), bench.m_results.end());
+	}
+
+	// Reports times measured elsewhere, e.g. the stages of a run that can't be repeated per stage. One sample per
+	// entry of samples_ns.
+	void record(const char* name, std::vector<double> samples_ns)
+	{
+		if (!enabled(name) || samples_ns.empty())
+			return;
+
+		add_result(name, 1.0, 1, samples_ns);
+	}
+
+private:
+	void add_result(const char* name, double items_per_iteration, size_t iterations, std::vector<double> samples)
+	{
+		std::sort(samples.begin(), samples.end());
+
+		BenchResult result;
+
+		result.name = name;
+		result.items_per_iteration = items_per_iteration;
+		result.samples = int(samples.size());
+		result.iterations_per_sample = iterations;
+		result.min = samples.front();
+		result.median = percentile(samples, 0.5);
+		result.p95 = percentile(samples, 0.95);
+
+		for (double sample : samples)
+			result.mean += sample;
+
+		result.mean /= double(samples.size());
+
+		for (double sample : samples)
+			result.stddev += (sample - result.mean) * (sample - result.mean);
+
+		result.stddev = sqrt(result.stddev / double(std::max(samples.size() - 1, size_t(1))));
+		result.items_per_second = items_per_iteration * 1e9 / result.median;
+
+		m_results.push_back(result);
+	}
+
+private:
+	BenchOptions             m_options;
+	std::vector<BenchResult> m_results;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Sun directions sweeping from the horizon to the zenith, so the updates don't see a constant state.
+static std::vector<glm::vec3> sun_directions(int count)
+{
+	std::vector<glm::vec3> dirs(count);
+
+	for (int i = 0; i < count; i++)
+	{
+		float elevation = (float(i) + 0.5f) / float(count) * 1.5f;
+		float azimuth = float(i) * 2.39996f;
+
+		// set_direction() takes the direction the light travels in.
+		dirs[i] = -glm::vec3(cosf(elevation) * cosf(azimuth), sinf(elevation), cosf(elevation) * sinf(azimuth));
+	}
+
+	return dirs;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct ViewDirections
+{
+	std::vector<float> x, y, z;
+	std::vector<float> r, g, b;
+
+	// Fibonacci lattice over the upper hemisphere.
+	ViewDirections(size_t count) : x(count), y(count), z(count), r(count), g(count), b(count)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			float v = 1.0f - (float(i) + 0.5f) / float(count);
+			float radius = sqrtf(1.0f - v * v);
+			float phi = float(i) * 2.39996f;
+
+			x[i] = radius * cosf(phi);
+			y[i] = v;
+			z[i] = radius * sinf(phi);
+		}
+	}
+
+	inline size_t size() const { return x.size(); }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bench_update(Bench& bench, const char* name, SkyModel& model)
+{
+	std::vector<glm::vec3> dirs = sun_directions(256);
+	size_t index = 0;
+
+	// update() skips clean models, so every iteration moves the sun.
+	bench.run(name, 1.0, [&]() {
+		model.set_direction(dirs[index++ % dirs.size()]);
+		model.update();
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bench_radiance(Bench& bench, const std::string& prefix, SkyModel& model)
+{
+	ViewDirections view(4096);
+
+	model.set_direction(-glm::normalize(glm::vec3(0.3f, 0.4f, 0.2f)));
+	model.update();
+
+	bench.run((prefix + "/radiance_scalar").c_str(), double(view.size()), [&]() {
+		float sum = 0.0f;
+
+		for (size_t i = 0; i < view.size(); i++)
+			sum += model.radiance(glm::vec3(view.x[i], view.y[i], view.z[i])).g;
+
+		g_sink = sum;
+	});
+
+	bench.run((prefix + "/radiance_simd").c_str(), double(view.size()), [&]() {
+		model.radiance(view.size(), view.x.data(), view.y.data(), view.z.data(), view.r.data(), view.g.data(), view.b.data());
+		g_sink = view.g[0];
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename Model>
+static void bench_batch_coefficients(Bench& bench, const std::string& prefix, const Model& model)
+{
+	const size_t count = 4096;
+
+	std::vector<float> sun_y(count), turbidity(count), albedo(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		sun_y[i] = (float(i) + 0.5f) / float(count);
+		turbidity[i] = 2.0f + 8.0f * float(i % 64) / 64.0f;
+		albedo[i] = float(i % 16) / 16.0f;
+	}
+
+	std::vector<std::vector<float>> storage(Model::NUM_BATCH_COEFFICIENTS, std::vector<float>(count));
+	std::vector<float*> coefficients(Model::NUM_BATCH_COEFFICIENTS);
+
+	for (int i = 0; i < Model::NUM_BATCH_COEFFICIENTS; i++)
+		coefficients[i] = storage[i].data();
+
+	SkyStateBatch states = { count, sun_y.data(), turbidity.data(), albedo.data() };
+
+	bench.run((prefix + "/batch_coefficients_1t").c_str(), double(count), [&]() {
+		model.compute_coefficients(states, coefficients.data(), 1);
+		g_sink = coefficients[0][0];
+	});
+
+	bench.run((prefix + "/batch_coefficients_mt").c_str(), double(count), [&]() {
+		model.compute_coefficients(states, coefficients.data(), 0);
+		g_sink = coefficients[0][0];
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bench_hosek_dataset(Bench& bench)
+{
+	const HosekDataset* dataset = HosekDataset::rgb();
+
+	float  params[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	float  radiance[HosekDataset::MAX_BANDS];
+	double params_double[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	double radiance_double[HosekDataset::MAX_BANDS];
+
+	int index = 0;
+
+	bench.run("hosek/dataset_evaluate_float", 1.0, [&]() {
+		dataset->evaluate(4.0f, 0.1f, float(index++ & 255) / 256.0f * 1.5f, params, radiance);
+		g_sink = params[0];
+	});
+
+	bench.run("hosek/dataset_evaluate_double", 1.0, [&]() {
+		dataset->evaluate(4.0f, 0.1f, float(index++ & 255) / 256.0f * 1.5f, params_double, radiance_double);
+		g_sink = float(params_double[0]);
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bench_bruneton(Bench& bench, const BenchOptions& options)
+{
+	// Raw and compressed caches of the default atmosphere, whichever exist.
+	const BrunetonAtmosphere atmosphere;
+	const char* extensions[] = { ".raw", ".rawz" };
+	const char* names[] = { "bruneton/cache_load", "bruneton/cache_load_compressed" };
+
+	BrunetonLookup probe;
+
+	for (int i = 0; i < 2; i++)
+	{
+		BrunetonLookup lookup;
+
+		if (!BrunetonSkyModel::load_cache(lookup, atmosphere, BrunetonSkyModel::QUALITY_LOW, options.bruneton_cache, extensions[i]))
+		{
+			bench.skip(names[i], "no cache in this format");
+			continue;
+		}
+
+		probe = lookup;
+
+		if (bench.enabled(names[i]))
+		{
+			bench.run_once(names[i], 10, [&]() {
+				BrunetonLookup lookup;
+				BrunetonSkyModel::load_cache(lookup, atmosphere, BrunetonSkyModel::QUALITY_LOW, options.bruneton_cache, extensions[i]);
+				g_sink = lookup.transmittance_data()[0];
+			});
+		}
+	}
+
+	if (!probe.is_loaded())
+	{
+		// SkyModels writes the cache to its working directory after precomputing, named after the atmosphere hash.
+		std::string text = "no " + atmosphere.cache_path("*") + " tables for the default atmosphere, run SkyModels once or pass --bruneton-cache";
+		const char* note = text.c_str();
+
+		bench.skip("bruneton/inscatter_decode", note);
+		bench.skip("bruneton/radiance_scalar", note);
+		bench.skip("bruneton/radiance_simd", note);
+		return;
+	}
+
+	// Decompression alone, without the file read.
+	if (bench.enabled("bruneton/inscatter_decode"))
+	{
+		const size_t count = size_t(BrunetonLookup::INSCATTER_MU_S) * BrunetonLookup::INSCATTER_NU * BrunetonLookup::INSCATTER_MU * BrunetonLookup::INSCATTER_R * 4;
+		const size_t layer = count / BrunetonLookup::INSCATTER_R;
+
+		std::vector<uint8_t> encoded;
+		table_encode(probe.inscatter_data(), count, 4, layer, encoded);
+
+		std::vector<float> decoded(count);
+
+		bench.run("bruneton/inscatter_decode", double(count), [&]() {
+			table_decode(encoded.data(), encoded.size(), decoded.data(), count);
+			g_sink = decoded[count / 2];
+		});
+	}
+
+	// BrunetonSkyModel::initialize() reads from the working directory, so the lookup is filled directly.
+	class CachedBrunetonSkyModel : public BrunetonSkyModel
+	{
+	public:
+		CachedBrunetonSkyModel(const BrunetonLookup& lookup)
+		{
+			m_lookup.set_transmittance(lookup.transmittance_data());
+			m_lookup.set_irradiance(lookup.irradiance_data());
+			m_lookup.set_inscatter(lookup.inscatter_data());
+		}
+	};
+
+	CachedBrunetonSkyModel model(probe);
+	bench_radiance(bench, "bruneton", model);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The CPU precomputation of the 2017 model with the default atmosphere, per stage. It takes a minute or two on a single
+// core, so it only runs when asked for, with --bruneton-2017-precompute or a filter naming a stage. The radiance
+// benchmarks use the cache in --bruneton-cache, or the precomputed tables if there is none.
+static void bench_bruneton_2017(Bench& bench, const BenchOptions& options)
+{
+	const char* stages[] = { "bruneton2017/precompute/transmittance", "bruneton2017/precompute/direct_irradiance",
+							 "bruneton2017/precompute/single_scattering", "bruneton2017/precompute/scattering_density",
+							 "bruneton2017/precompute/indirect_irradiance", "bruneton2017/precompute/multiple_scattering",
+							 "bruneton2017/precompute/total" };
+	const char* radiance[] = { "bruneton2017/radiance_scalar", "bruneton2017/radiance_simd" };
+
+	bool precompute_requested = options.bruneton_2017_precompute;
+
+	for (const char* name : stages)
+		precompute_requested |= !options.filter.empty() && bench.enabled(name);
+
+	bool radiance_enabled = false;
+
+	for (const char* name : radiance)
+		radiance_enabled |= bench.enabled(name);
+
+	Bruneton2017Atmosphere atmosphere;
+	auto tables = std::make_shared<Bruneton2017Tables>();
+	bool loaded = false;
+
+	if (precompute_requested)
+	{
+		Bruneton2017Precompute precompute(atmosphere);
+		precompute.run(*tables);
+
+		const Bruneton2017Precompute::Timings& timings = precompute.timings();
+		const double stage_ms[] = { timings.transmittance_ms, timings.direct_irradiance_ms, timings.single_scattering_ms, timings.scattering_density_ms,
+									timings.indirect_irradiance_ms, timings.multiple_scattering_ms, timings.total_ms };
+
+		for (int i = 0; i < 7; i++)
+			bench.record(stages[i], { stage_ms[i] * 1e6 });
+
+		loaded = true;
+	}
+	else
+	{
+		for (const char* name : stages)
+			bench.skip(name, "opt-in, pass --bruneton-2017-precompute");
+	}
+
+	if (!radiance_enabled)
+		return;
+
+	if (!loaded)
+		loaded = tables->load(atmosphere, options.bruneton_cache);
+
+	if (!loaded)
+	{
+		for (const char* name : radiance)
+			bench.skip(name, "no cache for the default atmosphere, run SkyModels once, pass --bruneton-cache or --bruneton-2017-precompute");
+		return;
+	}
+
+	// Bruneton2017SkyModel::initialize() reads or writes the cache in the working directory, so the lookup is filled
+	// directly.
+	class PrecomputedBruneton2017SkyModel : public Bruneton2017SkyModel
+	{
+	public:
+		PrecomputedBruneton2017SkyModel(std::shared_ptr<const Bruneton2017Tables> tables)
+		{
+			m_lookup.set_tables(std::move(tables));
+			m_lookup.set_atmosphere(m_atmosphere);
+		}
+	};
+
+	PrecomputedBruneton2017SkyModel model(tables);
+	bench_radiance(bench, "bruneton2017", model);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void bench_irradiance_sh(Bench& bench, SkyModel& model)
+{
+	IrradianceSH sh(1024);
+
+	bench.run("irradiance_sh/project_1024", 1.0, [&]() {
+		sh.project(&model);
+		g_sink = sh.coefficients()[0].g;
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// One day at minute resolution, the unit of the solar exposure analytics.
+static void bench_solar_position(Bench& bench)
+{
+	const size_t count = 1440;
+	const double latitude = 47.37;
+	const double longitude = 8.54;
+
+	std::vector<double> times(count);
+	std::vector<float> elevation(count), azimuth(count), sun_y(count);
+
+	for (size_t i = 0; i < count; i++)
+		times[i] = utc_time(2019, 6, 21) + 60.0 * double(i);
+
+	bench.run("solar/position_scalar", double(count), [&]() {
+		for (size_t i = 0; i < count; i++)
+			elevation[i] = solar_position(latitude, longitude, times[i]).elevation;
+		g_sink = elevation[count / 2];
+	});
+
+	bench.run("solar/position_batch_1t", double(count), [&]() {
+		solar_positions(latitude, longitude, count, times.data(), elevation.data(), azimuth.data(), sun_y.data(), 1);
+		g_sink = elevation[count / 2];
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// A 256x256 upper hemisphere fisheye thumbnail: the per-pixel scalar pow() the post-processing stage replaces, the
+// vectorized operators and the PNG encode, all on one thread.
+static void bench_thumbnail(Bench& bench, SkyModel& model)
+{
+	const int size = 256;
+	const size_t count = size_t(size) * size;
+
+	std::vector<float> x(count), y(count), z(count), r(count), g(count), b(count);
+	std::vector<uint8_t> rgb(count * 3);
+	std::vector<uint8_t> png;
+
+	for (int j = 0; j < size; j++)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			float u = 2.0f * (float(i) + 0.5f) / float(size) - 1.0f;
+			float v = 2.0f * (float(j) + 0.5f) / float(size) - 1.0f;
+			float radius = std::min(sqrtf(u * u + v * v), 1.0f);
+			float s = radius > 0.0f ? sinf(radius * 1.5707963f) / radius : 0.0f;
+			size_t p = size_t(j) * size + i;
+
+			x[p] = u * s;
+			y[p] = cosf(radius * 1.5707963f);
+			z[p] = v * s;
+		}
+	}
+
+	model.set_direction(-glm::normalize(glm::vec3(0.3f, 0.4f, 0.2f)));
+	model.update();
+	model.radiance(count, x.data(), y.data(), z.data(), r.data(), g.data(), b.data());
+
+	const float exposure = 0.18f / log_average_luminance(count, r.data(), g.data(), b.data(), 1);
+
+	bench.run("tonemap/reinhard_scalar", double(count), [&]() {
+		for (size_t i = 0; i < count; i++)
+		{
+			float c[3] = { r[i] * exposure, g[i] * exposure, b[i] * exposure };
+
+			for (int k = 0; k < 3; k++)
+				rgb[i * 3 + k] = uint8_t(powf(c[k] / (1.0f + c[k]), 1.0f / 2.2f) * 255.0f + 0.5f);
+		}
+		g_sink = rgb[count / 2];
+	});
+
+	const char* names[] = { "tonemap/reinhard_simd_1t", "tonemap/aces_simd_1t", "tonemap/agx_simd_1t" };
+	const Tonemapper tonemappers[] = { TONEMAPPER_REINHARD, TONEMAPPER_ACES, TONEMAPPER_AGX };
+
+	for (int t = 0; t < 3; t++)
+	{
+		TonemapSettings settings;
+		settings.tonemapper = tonemappers[t];
+		settings.exposure = exposure;
+
+		bench.run(names[t], double(count), [&]() {
+			tonemap(settings, count, r.data(), g.data(), b.data(), rgb.data(), 1);
+			g_sink = rgb[count / 2];
+		});
+	}
+
+	bench.run("image/png_encode_256_1t", 1.0, [&]() {
+		encode_png(size, size, rgb.data(), png, 1);
+		g_sink = float(png.size());
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void write_json(const std::vector<BenchResult>& results)
+{
+	printf("{\n");
+	printf("  \"benchmark\": \"sky_models_bench\",\n");
+	printf("  \"schema_version\": 1,\n");
+#if defined(SKY_MODELS_AVX2)
+	printf("  \"simd\": \"avx2\",\n");
+#else
+	printf("  \"simd\": \"scalar\",\n");
+#endif
+	printf("  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+	printf("  \"time_unit\": \"ns\",\n");
+	printf("  \"results\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult& r = results[i];
+		const char* separator = i + 1 < results.size() ? "," : "";
+
+		if (r.skipped)
+		{
+			printf("    { \"name\": \"%s\", \"skipped\": true, \"note\": \"%s\" }%s\n", r.name.c_str(), r.note.c_str(), separator);
+			continue;
+		}
+
+		printf("    { \"name\": \"%s\", \"skipped\": false, \"items_per_iteration\": %.0f, \"samples\": %d, \"iterations_per_sample\": %zu, "
+		       "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"p95\": %.3f, \"items_per_second\": %.1f }%s\n",
+		       r.name.c_str(), r.items_per_iteration, r.samples, r.iterations_per_sample,
+		       r.min, r.median, r.mean, r.stddev, r.p95, r.items_per_second, separator);
+	}
+
+	printf("  ]\n");
+	printf("}\n");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void write_csv(const std::vector<BenchResult>& results)
+{
+	printf("name,skipped,items_per_iteration,samples,iterations_per_sample,min_ns,median_ns,mean_ns,stddev_ns,p95_ns,items_per_second\n");
+
+	for (const BenchResult& r : results)
+	{
+		if (r.skipped)
+		{
+			printf("%s,1,,,,,,,,,\n", r.name.c_str());
+			continue;
+		}
+
+		printf("%s,0,%.0f,%d,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+		       r.name.c_str(), r.items_per_iteration, r.samples, r.iterations_per_sample,
+		       r.min, r.median, r.mean, r.stddev, r.p95, r.items_per_second);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool parse_options(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--format" && value)
+		{
+			options.csv = strcmp(value, "csv") == 0;
+			i++;
+		}
+		else if (arg == "--filter" && value)
+		{
+			options.filter = value;
+			i++;
+		}
+		else if (arg == "--samples" && value)
+		{
+			options.samples = std::max(atoi(value), 1);
+			i++;
+		}
+		else if (arg == "--min-sample-ms" && value)
+		{
+			options.min_sample_ms = atof(value);
+			i++;
+		}
+		else if (arg == "--bruneton-cache" && value)
+		{
+			options.bruneton_cache = value;
+			i++;
+		}
+		else if (arg == "--bruneton-2017-precompute")
+			options.bruneton_2017_precompute = true;
+		else
+		{
+			fprintf(stderr, "usage: %s [--format json|csv] [--filter <substring>] [--samples <n>] [--min-sample-ms <ms>] [--bruneton-cache <dir>] [--bruneton-2017-precompute]\n", argv[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+
+	if (!parse_options(argc, argv, options))
+		return 1;
+
+	Bench bench(options);
+
+	PreethamSkyModel preetham;
+	HosekWilkieSkyModel hosek;
+
+	preetham.initialize();
+	hosek.initialize();
+
+	bench_update(bench, "preetham/update", preetham);
+	bench_update(bench, "hosek/update", hosek);
+
+	bench_batch_coefficients(bench, "preetham", preetham);
+	bench_batch_coefficients(bench, "hosek", hosek);
+
+	bench_hosek_dataset(bench);
+
+	bench_radiance(bench, "preetham", preetham);
+	bench_radiance(bench, "hosek", hosek);
+
+	bench_bruneton(bench, options);
+	bench_bruneton_2017(bench, options);
+
+	bench_irradiance_sh(bench, hosek);
+
+	bench_solar_position(bench);
+
+	bench_thumbnail(bench, hosek);
+
+	if (options.csv)
+		write_csv(bench.results());
+	else
+		write_json(bench.results());
+
+	return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
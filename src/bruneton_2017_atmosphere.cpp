@@ -0,0 +1,185 @@
+#include "bruneton_2017_atmosphere.h"
+
+// Spectra of the reference implementation, LAMBDA_MIN to LAMBDA_MAX in 10 nm steps.
+static const int LAMBDA_MIN = int(Bruneton2017Atmosphere::LAMBDA_MIN);
+static const int LAMBDA_MAX = int(Bruneton2017Atmosphere::LAMBDA_MAX);
+static const int NUM_SPECTRUM_SAMPLES = 48;
+
+// http://rredc.nrel.gov/solar/spectra/am1.5/ASTMG173/ASTMG173.html
+static const double SOLAR_IRRADIANCE[NUM_SPECTRUM_SAMPLES] = {
+	1.11776, 1.14259, 1.01249, 1.14716, 1.72765, 1.73054, 1.6887, 1.61253, 1.91198, 2.03474, 2.02042, 2.02212,
+	1.93377, 1.95809, 1.91686, 1.8298, 1.8685, 1.8931, 1.85149, 1.8504, 1.8341, 1.8345, 1.8147, 1.78158,
+	1.7533, 1.6965, 1.68194, 1.64654, 1.6048, 1.52143, 1.55622, 1.5113, 1.474, 1.4482, 1.41018, 1.36775,
+	1.34188, 1.31429, 1.28303, 1.26758, 1.2367, 1.2082, 1.18737, 1.14683, 1.12362, 1.1058, 1.07124, 1.04992
+};
+
+// Ozone absorption cross section in m^2, https://www.iup.uni-bremen.de/gruppen/molspec/databases/referencespectra/o3spectra2011/
+static const double OZONE_CROSS_SECTION[NUM_SPECTRUM_SAMPLES] = {
+	1.18e-27, 2.182e-28, 2.818e-28, 6.636e-28, 1.527e-27, 2.763e-27, 5.52e-27, 8.451e-27, 1.582e-26, 2.316e-26, 3.669e-26, 4.924e-26,
+	7.752e-26, 9.016e-26, 1.48e-25, 1.602e-25, 2.139e-25, 2.755e-25, 3.091e-25, 3.5e-25, 4.266e-25, 4.672e-25, 4.398e-25, 4.701e-25,
+	5.019e-25, 4.305e-25, 3.74e-25, 3.215e-25, 2.662e-25, 2.238e-25, 1.852e-25, 1.473e-25, 1.209e-25, 9.423e-26, 7.455e-26, 6.566e-26,
+	5.105e-26, 4.15e-26, 4.228e-26, 3.237e-26, 2.451e-26, 2.801e-26, 2.534e-26, 1.624e-26, 1.465e-26, 2.078e-26, 1.383e-26, 7.105e-27
+};
+
+// Molecules per m^2 in a column of one Dobson unit.
+static const double DOBSON_UNIT = 2.687e20;
+
+// The ozone profile peaks at 1 and spans 30 km at half of that, so the peak number density per m^3 is the column
+// over 15 km.
+static const double OZONE_PEAK_HEIGHT_M = 15000.0;
+
+static const double MAX_LUMINOUS_EFFICACY = 683.0;
+
+// sRGB (linear) from CIE XYZ.
+static const double XYZ_TO_SRGB[9] = {
+	3.2406, -1.5372, -0.4986,
+	-0.9689, 1.8758, 0.0415,
+	0.0557, -0.2040, 1.0570
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double interpolate(const double* spectrum, double lambda)
+{
+	double x = (lambda - LAMBDA_MIN) / 10.0;
+
+	if (x <= 0.0)
+		return spectrum[0];
+
+	if (x >= NUM_SPECTRUM_SAMPLES - 1)
+		return spectrum[NUM_SPECTRUM_SAMPLES - 1];
+
+	int i = int(x);
+	double t = x - i;
+
+	return spectrum[i] * (1.0 - t) + spectrum[i + 1] * t;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double piecewise_gaussian(double x, double mu, double sigma_low, double sigma_high)
+{
+	double t = (x - mu) / (x < mu ? sigma_low : sigma_high);
+	return exp(-0.5 * t * t);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// CIE 1931 2 degree color matching functions, as the multi-lobe fit of Wyman, Sloan and Shirley ("Simple Analytic
+// Approximations to the CIE XYZ Color Matching Functions", JCGT 2013) instead of the tabulated ones.
+static glm::dvec3 cie_color_matching(double lambda)
+{
+	double x = 1.056 * piecewise_gaussian(lambda, 599.8, 37.9, 31.0) + 0.362 * piecewise_gaussian(lambda, 442.0, 16.0, 26.7) -
+			   0.065 * piecewise_gaussian(lambda, 501.1, 20.4, 26.2);
+	double y = 0.821 * piecewise_gaussian(lambda, 568.8, 46.9, 40.5) + 0.286 * piecewise_gaussian(lambda, 530.9, 16.3, 31.1);
+	double z = 1.217 * piecewise_gaussian(lambda, 437.0, 11.8, 36.0) + 0.681 * piecewise_gaussian(lambda, 459.0, 26.0, 13.8);
+
+	return glm::dvec3(x, y, z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Factors that turn the radiance at the R, G and B wavelengths into luminance, integrating the color matching
+// functions over the solar spectrum scaled by lambda^lambda_power (radiance at other wavelengths is assumed to
+// follow the solar spectrum times that power law).
+static glm::dvec3 radiance_to_luminance(double lambda_power)
+{
+	const double lambdas[3] = { Bruneton2017Atmosphere::LAMBDA_R, Bruneton2017Atmosphere::LAMBDA_G, Bruneton2017Atmosphere::LAMBDA_B };
+
+	glm::dvec3 k(0.0);
+	glm::dvec3 solar(interpolate(SOLAR_IRRADIANCE, lambdas[0]), interpolate(SOLAR_IRRADIANCE, lambdas[1]), interpolate(SOLAR_IRRADIANCE, lambdas[2]));
+
+	for (int lambda = LAMBDA_MIN; lambda < LAMBDA_MAX; lambda++)
+	{
+		glm::dvec3 rgb = Bruneton2017Atmosphere::srgb_color_matching(lambda);
+		double irradiance = interpolate(SOLAR_IRRADIANCE, lambda);
+
+		for (int c = 0; c < 3; c++)
+			k[c] += rgb[c] * irradiance / solar[c] * pow(lambda / lambdas[c], lambda_power);
+	}
+
+	return k * MAX_LUMINOUS_EFFICACY;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::rayleigh_scattering(const glm::dvec3& lambda) const
+{
+	glm::dvec3 um = lambda * 1e-3;
+	return double(rayleigh) / (um * um * um * um);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::mie_scattering(const glm::dvec3& lambda) const
+{
+	return mie_extinction(lambda) * double(mie_single_scattering_albedo);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::mie_extinction(const glm::dvec3& lambda) const
+{
+	glm::dvec3 result;
+
+	for (int c = 0; c < 3; c++)
+		result[c] = mie_angstrom_beta / mie_scale_height * pow(lambda[c] * 1e-3, -double(mie_angstrom_alpha));
+
+	return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::absorption_extinction(const glm::dvec3& lambda) const
+{
+	// Peak number density per m^3 times the cross section gives per m.
+	double density = ozone_column * DOBSON_UNIT / OZONE_PEAK_HEIGHT_M;
+	glm::dvec3 result;
+
+	for (int c = 0; c < 3; c++)
+		result[c] = density * interpolate(OZONE_CROSS_SECTION, lambda[c]) * 1000.0;
+
+	return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::solar_irradiance(const glm::dvec3& lambda) const
+{
+	return glm::dvec3(interpolate(SOLAR_IRRADIANCE, lambda.x), interpolate(SOLAR_IRRADIANCE, lambda.y), interpolate(SOLAR_IRRADIANCE, lambda.z));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Atmosphere::sky_radiance_to_luminance() const
+{
+	// With more than 3 wavelengths the tables are precomputed in luminance, minus the luminous efficacy which would
+	// push the values out of half float range. With 3 the rest of the sky spectrum is extrapolated as the solar
+	// spectrum times lambda^-3, like the reference implementation does.
+	if (num_wavelengths > 3)
+		return glm::vec3(MAX_LUMINOUS_EFFICACY * LUMINANCE_SCALE);
+
+	return glm::vec3(radiance_to_luminance(-3.0) * LUMINANCE_SCALE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Atmosphere::sun_radiance_to_luminance() const
+{
+	return glm::vec3(radiance_to_luminance(0.0) * LUMINANCE_SCALE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec3 Bruneton2017Atmosphere::srgb_color_matching(double lambda)
+{
+	glm::dvec3 xyz = cie_color_matching(lambda);
+	glm::dvec3 rgb;
+
+	for (int c = 0; c < 3; c++)
+		rgb[c] = XYZ_TO_SRGB[c * 3] * xyz.x + XYZ_TO_SRGB[c * 3 + 1] * xyz.y + XYZ_TO_SRGB[c * 3 + 2] * xyz.z;
+
+	return rgb;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
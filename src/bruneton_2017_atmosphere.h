@@ -0,0 +1,176 @@
+#pragma once
+
+#include <glm.hpp>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// One layer of a density profile: exp_term * exp(exp_scale * h) + linear_term * h + constant_term, clamped to [0, 1],
+// where h is the altitude in km.
+struct DensityProfileLayer
+{
+	float width = 0.0f;
+	float exp_term = 0.0f;
+	float exp_scale = 0.0f;
+	float linear_term = 0.0f;
+	float constant_term = 0.0f;
+
+	inline double density(double altitude) const
+	{
+		double d = exp_term * exp(exp_scale * altitude) + linear_term * altitude + constant_term;
+		return d < 0.0 ? 0.0 : (d > 1.0 ? 1.0 : d);
+	}
+
+	bool operator==(const DensityProfileLayer& other) const
+	{
+		return width == other.width && exp_term == other.exp_term && exp_scale == other.exp_scale && linear_term == other.linear_term &&
+			   constant_term == other.constant_term;
+	}
+};
+
+// Relative density of one atmosphere component, the first layer below its width and the second one above.
+struct DensityProfile
+{
+	DensityProfileLayer layers[2];
+
+	inline double density(double altitude) const { return altitude < layers[0].width ? layers[0].density(altitude) : layers[1].density(altitude); }
+
+	bool operator==(const DensityProfile& other) const { return layers[0] == other.layers[0] && layers[1] == other.layers[1]; }
+};
+
+// Parameters of the 2017 model (Eric Bruneton, "Precomputed Atmospheric Scattering: a New Implementation"). Unlike
+// BrunetonAtmosphere the air, aerosol and ozone densities are arbitrary layered profiles and the coefficients are
+// spectral, the tables are integrated over num_wavelengths wavelengths and stored as luminance. Lengths are in km.
+// The defaults are the Earth of the reference implementation. The planet radii and the lowest sun the tables cover
+// are fixed by the table parametrization, see Bruneton2017Lookup.
+struct Bruneton2017Atmosphere
+{
+	// exp(-h / 8 km) air.
+	DensityProfile rayleigh_density = { { {}, { 0.0f, 1.0f, -1.0f / 8.0f, 0.0f, 0.0f } } };
+
+	// exp(-h / 1.2 km) aerosols.
+	DensityProfile mie_density = { { {}, { 0.0f, 1.0f, -1.0f / 1.2f, 0.0f, 0.0f } } };
+
+	// Ozone, a tent from 10 km up to the 25 km peak and back down to 40 km.
+	DensityProfile absorption_density = { { { 25.0f, 0.0f, 0.0f, 1.0f / 15.0f, -2.0f / 3.0f }, { 0.0f, 0.0f, 0.0f, -1.0f / 15.0f, 8.0f / 3.0f } } };
+
+	// Rayleigh scattering at the ground is rayleigh * lambda^-4, lambda in um, per km.
+	float rayleigh = 1.24062e-3f;
+
+	// Mie extinction at the ground is mie_angstrom_beta / mie_scale_height * lambda^-mie_angstrom_alpha (Angstrom's
+	// turbidity formula), mie_single_scattering_albedo of it scatters.
+	float mie_angstrom_beta = 5.328e-3f;
+	float mie_angstrom_alpha = 0.0f;
+	float mie_scale_height = 1.2f;
+	float mie_single_scattering_albedo = 0.9f;
+	float mie_g = 0.8f;
+
+	// Total ozone column in Dobson units, 0 disables the absorption.
+	float ozone_column = 300.0f;
+
+	float ground_albedo = 0.1f;
+	float sun_angular_radius = 0.00935f / 2.0f;
+
+	// Wavelengths the scattering is computed at, in groups of 3. 3 uses the R, G and B wavelengths and approximates
+	// the luminance from them, more integrate the color matching functions properly at a proportional precompute cost.
+	int num_wavelengths = 15;
+	int scattering_orders = 4;
+
+	// Bump when the tables change for the same parameters, so old caches are ignored.
+	static const uint32_t TABLE_VERSION = 1;
+
+	// Visible range the wavelengths are spread over, in nm.
+	static constexpr double LAMBDA_MIN = 360.0;
+	static constexpr double LAMBDA_MAX = 830.0;
+
+	// Wavelengths the transmittance table and the sun color are given at, in nm.
+	static constexpr double LAMBDA_R = 680.0;
+	static constexpr double LAMBDA_G = 550.0;
+	static constexpr double LAMBDA_B = 440.0;
+
+	// Per wavelength (nm) coefficients, per km.
+	glm::dvec3 rayleigh_scattering(const glm::dvec3& lambda) const;
+	glm::dvec3 mie_scattering(const glm::dvec3& lambda) const;
+	glm::dvec3 mie_extinction(const glm::dvec3& lambda) const;
+	glm::dvec3 absorption_extinction(const glm::dvec3& lambda) const;
+
+	// Solar irradiance at the top of the atmosphere in W / m^2 / nm.
+	glm::dvec3 solar_irradiance(const glm::dvec3& lambda) const;
+
+	// CIE 1931 color matching functions at lambda (nm), transformed to linear sRGB.
+	static glm::dvec3 srgb_color_matching(double lambda);
+
+	// Luminance is rendered in kcd / m^2, which keeps the sky in the range of the other models.
+	static constexpr double LUMINANCE_SCALE = 1e-3;
+
+	// Convert what the tables store, and the solar radiance at the R, G and B wavelengths, into sRGB luminance
+	// (times LUMINANCE_SCALE).
+	glm::vec3 sky_radiance_to_luminance() const;
+	glm::vec3 sun_radiance_to_luminance() const;
+
+	// FNV-1a over the parameter bits, names the cache files.
+	uint64_t hash() const
+	{
+		const float values[] = { rayleigh, mie_angstrom_beta, mie_angstrom_alpha, mie_scale_height, mie_single_scattering_albedo, mie_g, ozone_column,
+								 ground_albedo, sun_angular_radius, float(num_wavelengths), float(scattering_orders) };
+
+		uint64_t h = 14695981039346656037ull;
+
+		auto mix = [&h](uint32_t v) {
+			for (int i = 0; i < 4; i++)
+			{
+				h ^= (v >> (i * 8)) & 0xff;
+				h *= 1099511628211ull;
+			}
+		};
+
+		auto mix_float = [&mix](float value) {
+			// -0 and 0 hash the same.
+			uint32_t bits;
+			value += 0.0f;
+			memcpy(&bits, &value, sizeof(bits));
+			mix(bits);
+		};
+
+		mix(TABLE_VERSION);
+
+		for (float value : values)
+			mix_float(value);
+
+		for (const DensityProfile* profile : { &rayleigh_density, &mie_density, &absorption_density })
+		{
+			for (const DensityProfileLayer& layer : profile->layers)
+			{
+				mix_float(layer.width);
+				mix_float(layer.exp_term);
+				mix_float(layer.exp_scale);
+				mix_float(layer.linear_term);
+				mix_float(layer.constant_term);
+			}
+		}
+
+		return h;
+	}
+
+	// Cache file of one table, e.g. bruneton2017_0123456789abcdef_scattering.rawz.
+	std::string cache_path(const char* table, const char* extension = ".rawz") const
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "bruneton2017_%016llx_", (unsigned long long)hash());
+
+		return std::string(name) + table + extension;
+	}
+
+	bool operator==(const Bruneton2017Atmosphere& other) const
+	{
+		return rayleigh_density == other.rayleigh_density && mie_density == other.mie_density && absorption_density == other.absorption_density &&
+			   rayleigh == other.rayleigh && mie_angstrom_beta == other.mie_angstrom_beta && mie_angstrom_alpha == other.mie_angstrom_alpha &&
+			   mie_scale_height == other.mie_scale_height && mie_single_scattering_albedo == other.mie_single_scattering_albedo && mie_g == other.mie_g &&
+			   ozone_column == other.ozone_column && ground_albedo == other.ground_albedo && sun_angular_radius == other.sun_angular_radius &&
+			   num_wavelengths == other.num_wavelengths && scattering_orders == other.scattering_orders;
+	}
+
+	bool operator!=(const Bruneton2017Atmosphere& other) const { return !(*this == other); }
+};
@@ -0,0 +1,482 @@
+#include "bruneton_2017_lookup.h"
+#include "table_codec.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Must match the defines in shader/sky_models/bruneton_2017/atmosphere.glsl
+constexpr double Bruneton2017Lookup::BOTTOM_RADIUS;
+constexpr double Bruneton2017Lookup::TOP_RADIUS;
+constexpr double Bruneton2017Lookup::MU_S_MIN;
+
+static const double PI = 3.14159265358979323846;
+
+typedef Bruneton2017Tables Tables;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline double clamp_cosine(double mu) { return std::min(std::max(mu, -1.0), 1.0); }
+static inline double clamp_distance(double d) { return std::max(d, 0.0); }
+static inline double clamp_radius(double r) { return std::min(std::max(r, Bruneton2017Lookup::BOTTOM_RADIUS), Bruneton2017Lookup::TOP_RADIUS); }
+static inline double safe_sqrt(double a) { return sqrt(std::max(a, 0.0)); }
+
+// Texel centers map to the ends of the unit range, so the extremes are sampled exactly.
+static inline double texture_coord_from_unit_range(double x, int size) { return 0.5 / size + x * (1.0 - 1.0 / size); }
+static inline double unit_range_from_texture_coord(double u, int size) { return (u - 0.5 / size) / (1.0 - 1.0 / size); }
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Emulates GL_LINEAR + GL_CLAMP_TO_EDGE.
+static inline void texel_coords(double u, int size, int& i0, int& i1, float& t)
+{
+	double x = u * size - 0.5;
+	double fx = floor(x);
+
+	t = float(x - fx);
+	i0 = std::min(std::max(int(fx), 0), size - 1);
+	i1 = std::min(std::max(int(fx) + 1, 0), size - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline glm::vec3 fetch(const float* table, size_t idx)
+{
+	const float* p = table + idx * 3;
+	return glm::vec3(p[0], p[1], p[2]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 sample_2d(const float* table, int w, int h, double u, double v)
+{
+	int x0, x1, y0, y1;
+	float tx, ty;
+
+	texel_coords(u, w, x0, x1, tx);
+	texel_coords(v, h, y0, y1, ty);
+
+	glm::vec3 a = glm::mix(fetch(table, y0 * w + x0), fetch(table, y0 * w + x1), tx);
+	glm::vec3 b = glm::mix(fetch(table, y1 * w + x0), fetch(table, y1 * w + x1), tx);
+
+	return glm::mix(a, b, ty);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec3 sample_3d(const float* table, int w, int h, int d, double u, double v, double s)
+{
+	int x0, x1, y0, y1, z0, z1;
+	float tx, ty, tz;
+
+	texel_coords(u, w, x0, x1, tx);
+	texel_coords(v, h, y0, y1, ty);
+	texel_coords(s, d, z0, z1, tz);
+
+	size_t slice0 = size_t(z0) * w * h;
+	size_t slice1 = size_t(z1) * w * h;
+
+	glm::vec3 a = glm::mix(glm::mix(fetch(table, slice0 + y0 * w + x0), fetch(table, slice0 + y0 * w + x1), tx),
+						   glm::mix(fetch(table, slice0 + y1 * w + x0), fetch(table, slice0 + y1 * w + x1), tx),
+						   ty);
+	glm::vec3 b = glm::mix(glm::mix(fetch(table, slice1 + y0 * w + x0), fetch(table, slice1 + y0 * w + x1), tx),
+						   glm::mix(fetch(table, slice1 + y1 * w + x0), fetch(table, slice1 + y1 * w + x1), tx),
+						   ty);
+
+	return glm::mix(a, b, tz);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Tables::allocate()
+{
+	transmittance.assign(TRANSMITTANCE_SIZE, 0.0f);
+	irradiance.assign(IRRADIANCE_SIZE, 0.0f);
+	scattering.assign(SCATTERING_SIZE, 0.0f);
+	single_mie_scattering.assign(SCATTERING_SIZE, 0.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017Tables::load(const Bruneton2017Atmosphere& atmosphere, const std::string& directory)
+{
+	std::string prefix = directory.empty() ? std::string() : directory + "/";
+
+	transmittance.resize(TRANSMITTANCE_SIZE);
+	irradiance.resize(IRRADIANCE_SIZE);
+	scattering.resize(SCATTERING_SIZE);
+	single_mie_scattering.resize(SCATTERING_SIZE);
+
+	// The compressed cache is what gets written, raw ones are read too in case the files were converted.
+	for (const char* extension : { ".rawz", ".raw" })
+	{
+		if (table_read_file(prefix + atmosphere.cache_path("transmittance", extension), transmittance.data(), TRANSMITTANCE_SIZE) &&
+			table_read_file(prefix + atmosphere.cache_path("irradiance", extension), irradiance.data(), IRRADIANCE_SIZE) &&
+			table_read_file(prefix + atmosphere.cache_path("scattering", extension), scattering.data(), SCATTERING_SIZE) &&
+			table_read_file(prefix + atmosphere.cache_path("single_mie_scattering", extension), single_mie_scattering.data(), SCATTERING_SIZE))
+			return true;
+	}
+
+	return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017Tables::save(const Bruneton2017Atmosphere& atmosphere, bool compressed, const std::string& directory) const
+{
+	std::string prefix = directory.empty() ? std::string() : directory + "/";
+	const char* extension = compressed ? ".rawz" : ".raw";
+
+	// One chunk per 16 rows of the 2D tables and per r layer of the 3D ones, the unit of parallel decoding.
+	const size_t layer = size_t(SCATTERING_NU) * SCATTERING_MU_S * SCATTERING_MU * 3;
+
+	return table_write_file(prefix + atmosphere.cache_path("transmittance", extension), transmittance.data(), TRANSMITTANCE_SIZE, 3, TRANSMITTANCE_W * 16 * 3, compressed) &&
+		   table_write_file(prefix + atmosphere.cache_path("irradiance", extension), irradiance.data(), IRRADIANCE_SIZE, 3, IRRADIANCE_W * 16 * 3, compressed) &&
+		   table_write_file(prefix + atmosphere.cache_path("scattering", extension), scattering.data(), SCATTERING_SIZE, 3, layer, compressed) &&
+		   table_write_file(prefix + atmosphere.cache_path("single_mie_scattering", extension), single_mie_scattering.data(), SCATTERING_SIZE, 3, layer, compressed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017Lookup::Bruneton2017Lookup()
+{
+	set_atmosphere(Bruneton2017Atmosphere());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Lookup::set_tables(std::shared_ptr<const Bruneton2017Tables> tables)
+{
+	m_tables = std::move(tables);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Lookup::set_atmosphere(const Bruneton2017Atmosphere& atmosphere)
+{
+	glm::dvec3 solar_irradiance = atmosphere.solar_irradiance(glm::dvec3(Bruneton2017Atmosphere::LAMBDA_R, Bruneton2017Atmosphere::LAMBDA_G, Bruneton2017Atmosphere::LAMBDA_B));
+	double sun_solid_angle = PI * double(atmosphere.sun_angular_radius) * double(atmosphere.sun_angular_radius);
+
+	m_mie_g = atmosphere.mie_g;
+	m_sun_angular_radius = atmosphere.sun_angular_radius;
+	m_sky_radiance_to_luminance = atmosphere.sky_radiance_to_luminance();
+	m_solar_luminance = glm::vec3(solar_irradiance / sun_solid_angle) * atmosphere.sun_radiance_to_luminance();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::sky_luminance(glm::vec3 camera_in, const glm::vec3& view_dir, glm::vec3& transmittance) const
+{
+	glm::dvec3 camera = glm::dvec3(camera_in) + glm::dvec3(m_earth_pos);
+	glm::dvec3 view = glm::dvec3(view_dir);
+	glm::dvec3 sun = glm::dvec3(m_sun_dir);
+
+	// Move the camera to the top of the atmosphere if it's in space.
+	double r = glm::length(camera);
+	double rmu = glm::dot(camera, view);
+	double distance_to_top_atmosphere_boundary = -rmu - sqrt(rmu * rmu - r * r + TOP_RADIUS * TOP_RADIUS);
+
+	if (distance_to_top_atmosphere_boundary > 0.0)
+	{
+		camera = camera + view * distance_to_top_atmosphere_boundary;
+		r = TOP_RADIUS;
+		rmu += distance_to_top_atmosphere_boundary;
+	}
+	else if (r > TOP_RADIUS)
+	{
+		// The ray doesn't hit the atmosphere.
+		transmittance = glm::vec3(1.0f);
+		return glm::vec3(0.0f);
+	}
+
+	double mu = rmu / r;
+	double mu_s = glm::dot(camera, sun) / r;
+	double nu = glm::dot(view, sun);
+	bool ray_r_mu_intersects_ground = intersects_ground(r, mu);
+
+	transmittance = ray_r_mu_intersects_ground ? glm::vec3(0.0f) : sample_transmittance(m_tables->transmittance.data(), r, mu);
+
+	glm::dvec4 uvwz = scattering_uvwz(r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+
+	glm::vec3 scattering = sample_scattering(m_tables->scattering.data(), uvwz);
+	glm::vec3 single_mie_scattering = sample_scattering(m_tables->single_mie_scattering.data(), uvwz);
+
+	return (scattering * float(rayleigh_phase(nu)) + single_mie_scattering * float(mie_phase(m_mie_g, nu))) * m_sky_radiance_to_luminance;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::transmittance(double r, double mu) const
+{
+	return sample_transmittance(m_tables->transmittance.data(), r, mu);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Distance to the top boundary between its minimum (straight up) and maximum (along the horizon) for the ray, and
+// the distance to the horizon for the radius, both normalized.
+glm::dvec2 Bruneton2017Lookup::transmittance_uv(double r, double mu)
+{
+	double H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+	double rho = safe_sqrt(r * r - BOTTOM_RADIUS * BOTTOM_RADIUS);
+
+	double d = distance_to_top(r, mu);
+	double d_min = TOP_RADIUS - r;
+	double d_max = rho + H;
+
+	double x_mu = (d - d_min) / (d_max - d_min);
+	double x_r = rho / H;
+
+	return glm::dvec2(texture_coord_from_unit_range(x_mu, Tables::TRANSMITTANCE_W), texture_coord_from_unit_range(x_r, Tables::TRANSMITTANCE_H));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Lookup::transmittance_r_mu(const glm::dvec2& uv, double& r, double& mu)
+{
+	double x_mu = unit_range_from_texture_coord(uv.x, Tables::TRANSMITTANCE_W);
+	double x_r = unit_range_from_texture_coord(uv.y, Tables::TRANSMITTANCE_H);
+
+	double H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+	double rho = H * x_r;
+
+	r = sqrt(rho * rho + BOTTOM_RADIUS * BOTTOM_RADIUS);
+
+	double d_min = TOP_RADIUS - r;
+	double d_max = rho + H;
+	double d = d_min + x_mu * (d_max - d_min);
+
+	mu = d == 0.0 ? 1.0 : clamp_cosine((H * H - rho * rho - d * d) / (2.0 * r * d));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::dvec2 Bruneton2017Lookup::irradiance_uv(double r, double mu_s)
+{
+	double x_r = (r - BOTTOM_RADIUS) / (TOP_RADIUS - BOTTOM_RADIUS);
+	double x_mu_s = mu_s * 0.5 + 0.5;
+
+	return glm::dvec2(texture_coord_from_unit_range(x_mu_s, Tables::IRRADIANCE_W), texture_coord_from_unit_range(x_r, Tables::IRRADIANCE_H));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Lookup::irradiance_r_mu_s(const glm::dvec2& uv, double& r, double& mu_s)
+{
+	double x_mu_s = unit_range_from_texture_coord(uv.x, Tables::IRRADIANCE_W);
+	double x_r = unit_range_from_texture_coord(uv.y, Tables::IRRADIANCE_H);
+
+	r = BOTTOM_RADIUS + x_r * (TOP_RADIUS - BOTTOM_RADIUS);
+	mu_s = clamp_cosine(2.0 * x_mu_s - 1.0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Rays hitting the ground use the lower half of the mu range, the others the upper half, so the discontinuity at the
+// horizon falls between texels.
+glm::dvec4 Bruneton2017Lookup::scattering_uvwz(double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground)
+{
+	double H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+	double rho = safe_sqrt(r * r - BOTTOM_RADIUS * BOTTOM_RADIUS);
+	double u_r = texture_coord_from_unit_range(rho / H, Tables::SCATTERING_R);
+
+	double r_mu = r * mu;
+	double discriminant = r_mu * r_mu - r * r + BOTTOM_RADIUS * BOTTOM_RADIUS;
+	double u_mu;
+
+	if (ray_r_mu_intersects_ground)
+	{
+		double d = -r_mu - safe_sqrt(discriminant);
+		double d_min = r - BOTTOM_RADIUS;
+		double d_max = rho;
+
+		u_mu = 0.5 - 0.5 * texture_coord_from_unit_range(d_max == d_min ? 0.0 : (d - d_min) / (d_max - d_min), Tables::SCATTERING_MU / 2);
+	}
+	else
+	{
+		double d = -r_mu + safe_sqrt(discriminant + H * H);
+		double d_min = TOP_RADIUS - r;
+		double d_max = rho + H;
+
+		u_mu = 0.5 + 0.5 * texture_coord_from_unit_range((d - d_min) / (d_max - d_min), Tables::SCATTERING_MU / 2);
+	}
+
+	return glm::dvec4((nu + 1.0) / 2.0, scattering_u_mu_s(mu_s), u_mu, u_r);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Non-linear in the distance to the top boundary from the ground towards the sun, with more resolution near the
+// horizon and nothing below MU_S_MIN.
+double Bruneton2017Lookup::scattering_u_mu_s(double mu_s)
+{
+	double H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+
+	double d = distance_to_top(BOTTOM_RADIUS, mu_s);
+	double d_min = TOP_RADIUS - BOTTOM_RADIUS;
+	double d_max = H;
+	double a = (d - d_min) / (d_max - d_min);
+
+	double D = distance_to_top(BOTTOM_RADIUS, MU_S_MIN);
+	double A = (D - d_min) / (d_max - d_min);
+
+	return texture_coord_from_unit_range(std::max(1.0 - a / A, 0.0) / (1.0 + a), Tables::SCATTERING_MU_S);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Lookup::scattering_r_mu_mu_s_nu(int x, int y, int z, double& r, double& mu, double& mu_s, double& nu, bool& ray_r_mu_intersects_ground)
+{
+	// Texel centers, with nu spanning [-1, 1] over its NU slices.
+	double frag_nu = double(x / Tables::SCATTERING_MU_S);
+	double frag_mu_s = double(x % Tables::SCATTERING_MU_S) + 0.5;
+
+	glm::dvec4 uvwz(frag_nu / (Tables::SCATTERING_NU - 1), frag_mu_s / Tables::SCATTERING_MU_S, (y + 0.5) / Tables::SCATTERING_MU, (z + 0.5) / Tables::SCATTERING_R);
+
+	double H = sqrt(TOP_RADIUS * TOP_RADIUS - BOTTOM_RADIUS * BOTTOM_RADIUS);
+	double rho = H * unit_range_from_texture_coord(uvwz.w, Tables::SCATTERING_R);
+
+	r = sqrt(rho * rho + BOTTOM_RADIUS * BOTTOM_RADIUS);
+
+	if (uvwz.z < 0.5)
+	{
+		double d_min = r - BOTTOM_RADIUS;
+		double d_max = rho;
+		double d = d_min + (d_max - d_min) * unit_range_from_texture_coord(1.0 - 2.0 * uvwz.z, Tables::SCATTERING_MU / 2);
+
+		mu = d == 0.0 ? -1.0 : clamp_cosine(-(rho * rho + d * d) / (2.0 * r * d));
+		ray_r_mu_intersects_ground = true;
+	}
+	else
+	{
+		double d_min = TOP_RADIUS - r;
+		double d_max = rho + H;
+		double d = d_min + (d_max - d_min) * unit_range_from_texture_coord(2.0 * uvwz.z - 1.0, Tables::SCATTERING_MU / 2);
+
+		mu = d == 0.0 ? 1.0 : clamp_cosine((H * H - rho * rho - d * d) / (2.0 * r * d));
+		ray_r_mu_intersects_ground = false;
+	}
+
+	double x_mu_s = unit_range_from_texture_coord(uvwz.y, Tables::SCATTERING_MU_S);
+	double d_min = TOP_RADIUS - BOTTOM_RADIUS;
+	double d_max = H;
+	double D = distance_to_top(BOTTOM_RADIUS, MU_S_MIN);
+	double A = (D - d_min) / (d_max - d_min);
+	double a = (A - x_mu_s * A) / (1.0 + x_mu_s * A);
+	double d = d_min + std::min(a, A) * (d_max - d_min);
+
+	mu_s = d == 0.0 ? 1.0 : clamp_cosine((H * H - d * d) / (2.0 * BOTTOM_RADIUS * d));
+
+	// Only the nu possible for this view and sun zenith angle.
+	nu = clamp_cosine(uvwz.x * 2.0 - 1.0);
+
+	double spread = sqrt((1.0 - mu * mu) * (1.0 - mu_s * mu_s));
+	nu = std::min(std::max(nu, mu * mu_s - spread), mu * mu_s + spread);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::sample_transmittance(const float* table, double r, double mu)
+{
+	glm::dvec2 uv = transmittance_uv(r, mu);
+	return sample_2d(table, Tables::TRANSMITTANCE_W, Tables::TRANSMITTANCE_H, uv.x, uv.y);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::sample_irradiance(const float* table, double r, double mu_s)
+{
+	glm::dvec2 uv = irradiance_uv(r, mu_s);
+	return sample_2d(table, Tables::IRRADIANCE_W, Tables::IRRADIANCE_H, uv.x, uv.y);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The 4D table is two trilinear fetches from the neighbouring nu slices.
+glm::vec3 Bruneton2017Lookup::sample_scattering(const float* table, const glm::dvec4& uvwz)
+{
+	double tex_coord_x = uvwz.x * (Tables::SCATTERING_NU - 1);
+	double tex_x = floor(tex_coord_x);
+	float lerp = float(tex_coord_x - tex_x);
+
+	const int w = Tables::SCATTERING_NU * Tables::SCATTERING_MU_S;
+
+	glm::vec3 a = sample_3d(table, w, Tables::SCATTERING_MU, Tables::SCATTERING_R, (tex_x + uvwz.y) / Tables::SCATTERING_NU, uvwz.z, uvwz.w);
+	glm::vec3 b = sample_3d(table, w, Tables::SCATTERING_MU, Tables::SCATTERING_R, (tex_x + 1.0 + uvwz.y) / Tables::SCATTERING_NU, uvwz.z, uvwz.w);
+
+	return a * (1.0f - lerp) + b * lerp;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::sample_scattering(const float* table, double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground)
+{
+	return sample_scattering(table, scattering_uvwz(r, mu, mu_s, nu, ray_r_mu_intersects_ground));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::transmittance(const float* table, double r, double mu, double d, bool ray_r_mu_intersects_ground)
+{
+	double r_d = clamp_radius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+	double mu_d = clamp_cosine((r * mu + d) / r_d);
+
+	// Ratio of the transmittances to the top boundary, looking away from the ground if the ray hits it.
+	if (ray_r_mu_intersects_ground)
+		return glm::min(sample_transmittance(table, r_d, -mu_d) / sample_transmittance(table, r, -mu), glm::vec3(1.0f));
+	else
+		return glm::min(sample_transmittance(table, r, mu) / sample_transmittance(table, r_d, mu_d), glm::vec3(1.0f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Lookup::transmittance_to_sun(const float* table, double r, double mu_s, double sun_angular_radius)
+{
+	double sin_theta_h = BOTTOM_RADIUS / r;
+	double cos_theta_h = -sqrt(std::max(1.0 - sin_theta_h * sin_theta_h, 0.0));
+
+	double edge = sin_theta_h * sun_angular_radius;
+	double t = glm::clamp((mu_s - cos_theta_h + edge) / (2.0 * edge), 0.0, 1.0);
+
+	return sample_transmittance(table, r, mu_s) * float(t * t * (3.0 - 2.0 * t));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double Bruneton2017Lookup::distance_to_top(double r, double mu)
+{
+	double discriminant = r * r * (mu * mu - 1.0) + TOP_RADIUS * TOP_RADIUS;
+	return clamp_distance(-r * mu + safe_sqrt(discriminant));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double Bruneton2017Lookup::distance_to_bottom(double r, double mu)
+{
+	double discriminant = r * r * (mu * mu - 1.0) + BOTTOM_RADIUS * BOTTOM_RADIUS;
+	return clamp_distance(-r * mu - safe_sqrt(discriminant));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017Lookup::intersects_ground(double r, double mu)
+{
+	return mu < 0.0 && r * r * (mu * mu - 1.0) + BOTTOM_RADIUS * BOTTOM_RADIUS >= 0.0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double Bruneton2017Lookup::rayleigh_phase(double nu)
+{
+	return 3.0 / (16.0 * PI) * (1.0 + nu * nu);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Cornette-Shanks.
+double Bruneton2017Lookup::mie_phase(double g, double nu)
+{
+	double k = 3.0 / (8.0 * PI) * (1.0 - g * g) / (2.0 + g * g);
+	return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
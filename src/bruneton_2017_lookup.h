@@ -0,0 +1,130 @@
+#pragma once
+
+#include <glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bruneton_2017_atmosphere.h"
+
+// Precomputed tables of the 2017 model, RGB floats. The scattering tables are 3D with nu and mu_s packed along x
+// like the 2008 inscatter table. Everything is already luminance (see Bruneton2017Atmosphere::num_wavelengths), so
+// rendering needs no spectral conversion and the single Mie scattering has its own table instead of being
+// reconstructed from the Rayleigh one.
+struct Bruneton2017Tables
+{
+	static const int TRANSMITTANCE_W = 256;
+	static const int TRANSMITTANCE_H = 64;
+
+	static const int IRRADIANCE_W = 64;
+	static const int IRRADIANCE_H = 16;
+
+	static const int SCATTERING_R = 32;
+	static const int SCATTERING_MU = 128;
+	static const int SCATTERING_MU_S = 32;
+	static const int SCATTERING_NU = 8;
+
+	static const size_t TRANSMITTANCE_SIZE = size_t(TRANSMITTANCE_W) * TRANSMITTANCE_H * 3;
+	static const size_t IRRADIANCE_SIZE = size_t(IRRADIANCE_W) * IRRADIANCE_H * 3;
+	static const size_t SCATTERING_SIZE = size_t(SCATTERING_NU) * SCATTERING_MU_S * SCATTERING_MU * SCATTERING_R * 3;
+
+	// At the R, G and B wavelengths, to the top of the atmosphere.
+	std::vector<float> transmittance;
+
+	// Indirect ground irradiance, the direct part is computed from the transmittance when rendering.
+	std::vector<float> irradiance;
+
+	// Rayleigh single scattering plus all orders of multiple scattering, divided by the Rayleigh phase function.
+	std::vector<float> scattering;
+
+	// Mie single scattering without the phase function.
+	std::vector<float> single_mie_scattering;
+
+	// Sizes the tables and clears them to 0.
+	void allocate();
+
+	// Reads the cache of the atmosphere from directory (the working directory if empty), raw or compressed.
+	bool load(const Bruneton2017Atmosphere& atmosphere, const std::string& directory = std::string());
+	bool save(const Bruneton2017Atmosphere& atmosphere, bool compressed, const std::string& directory = std::string()) const;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// CPU version of shader/sky_models/bruneton_2017/atmosphere.glsl, plus the table parametrization and filtered
+// fetches the precompute shares. Lengths are in km. Copies share the tables, like BrunetonLookup.
+class Bruneton2017Lookup
+{
+public:
+	static constexpr double BOTTOM_RADIUS = 6360.0;
+	static constexpr double TOP_RADIUS = 6420.0;
+
+	// Cosine of the lowest sun the scattering table covers, 102 degrees from the zenith.
+	static constexpr double MU_S_MIN = -0.20791169081775934;
+
+	Bruneton2017Lookup();
+
+	void set_tables(std::shared_ptr<const Bruneton2017Tables> tables);
+
+	// Takes the parameters needed at runtime: Mie asymmetry, sun size and color, luminance conversion.
+	void set_atmosphere(const Bruneton2017Atmosphere& atmosphere);
+
+	inline bool is_loaded() const { return m_tables != nullptr; }
+	inline const Bruneton2017Tables* tables() const { return m_tables.get(); }
+
+	// Direction towards the sun.
+	inline void set_sun_direction(const glm::vec3& dir) { m_sun_dir = dir; }
+	inline void set_earth_position(const glm::vec3& pos) { m_earth_pos = pos; }
+
+	inline glm::vec3 sun_direction() const { return m_sun_dir; }
+	inline glm::vec3 earth_position() const { return m_earth_pos; }
+	inline float mie_g() const { return m_mie_g; }
+	inline float sun_angular_radius() const { return m_sun_angular_radius; }
+	inline glm::vec3 sky_radiance_to_luminance() const { return m_sky_radiance_to_luminance; }
+
+	// Luminance of the sun disc outside the atmosphere.
+	inline glm::vec3 solar_luminance() const { return m_solar_luminance; }
+
+	// Sky luminance seen from camera (relative to the earth position) along view_dir, without the sun disc, and the
+	// transmittance to the top of the atmosphere along the ray (0 if it hits the ground).
+	glm::vec3 sky_luminance(glm::vec3 camera, const glm::vec3& view_dir, glm::vec3& transmittance) const;
+
+	// Transmittance from radius r to the top of the atmosphere, ignoring the ground.
+	glm::vec3 transmittance(double r, double mu) const;
+
+	// Table parametrization, the inverse mappings give the parameters at the texel centers.
+	static glm::dvec2 transmittance_uv(double r, double mu);
+	static void transmittance_r_mu(const glm::dvec2& uv, double& r, double& mu);
+	static glm::dvec2 irradiance_uv(double r, double mu_s);
+	static void irradiance_r_mu_s(const glm::dvec2& uv, double& r, double& mu_s);
+	static glm::dvec4 scattering_uvwz(double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground);
+	static double scattering_u_mu_s(double mu_s);
+	static void scattering_r_mu_mu_s_nu(int x, int y, int z, double& r, double& mu, double& mu_s, double& nu, bool& ray_r_mu_intersects_ground);
+
+	// Linearly filtered fetches from tables of the sizes above.
+	static glm::vec3 sample_transmittance(const float* table, double r, double mu);
+	static glm::vec3 sample_irradiance(const float* table, double r, double mu_s);
+	static glm::vec3 sample_scattering(const float* table, const glm::dvec4& uvwz);
+	static glm::vec3 sample_scattering(const float* table, double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground);
+
+	// Transmittance between the point at r along mu and the one d further, and from r to the sun with the fraction of
+	// the sun disc above the horizon.
+	static glm::vec3 transmittance(const float* table, double r, double mu, double d, bool ray_r_mu_intersects_ground);
+	static glm::vec3 transmittance_to_sun(const float* table, double r, double mu_s, double sun_angular_radius);
+
+	static double distance_to_top(double r, double mu);
+	static double distance_to_bottom(double r, double mu);
+	static bool intersects_ground(double r, double mu);
+
+	static double rayleigh_phase(double nu);
+	static double mie_phase(double g, double nu);
+
+private:
+	std::shared_ptr<const Bruneton2017Tables> m_tables;
+
+	glm::vec3 m_sun_dir = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 m_earth_pos = glm::vec3(0.0f, 6360.01f, 0.0f);
+	float m_mie_g = 0.8f;
+	float m_sun_angular_radius = 0.004675f;
+	glm::vec3 m_sky_radiance_to_luminance = glm::vec3(0.683f);
+	glm::vec3 m_solar_luminance = glm::vec3(0.0f);
+};
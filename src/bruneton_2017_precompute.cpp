@@ -0,0 +1,706 @@
+#include "bruneton_2017_precompute.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+typedef Bruneton2017Lookup Lookup;
+typedef Bruneton2017Tables Tables;
+
+static const double PI = 3.14159265358979323846;
+
+// Integration steps of the reference implementation.
+static const int TRANSMITTANCE_SAMPLES = 500;
+static const int SINGLE_SCATTERING_SAMPLES = 50;
+static const int MULTIPLE_SCATTERING_SAMPLES = 50;
+static const int SCATTERING_DENSITY_SAMPLES = 16;
+static const int INDIRECT_IRRADIANCE_SAMPLES = 32;
+
+// Incident directions of the scattering density integral, 16 zenith by 32 azimuth angles.
+static const int NUM_DENSITY_DIRECTIONS = SCATTERING_DENSITY_SAMPLES * SCATTERING_DENSITY_SAMPLES * 2;
+
+static const int SCATTERING_W = Tables::SCATTERING_NU * Tables::SCATTERING_MU_S;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline size_t texel_index(int x, int y, int w) { return (size_t(y) * w + x) * 3; }
+
+static inline size_t scattering_index(int x, int y, int z)
+{
+	return ((size_t(z) * Tables::SCATTERING_MU + y) * SCATTERING_W + x) * 3;
+}
+
+static inline glm::vec3 load3(const float* table, size_t idx) { return glm::vec3(table[idx], table[idx + 1], table[idx + 2]); }
+
+static inline void store3(float* table, size_t idx, const glm::dvec3& v)
+{
+	table[idx] = float(v.x);
+	table[idx + 1] = float(v.y);
+	table[idx + 2] = float(v.z);
+}
+
+static inline void accumulate3(float* table, size_t idx, const glm::dvec3& v)
+{
+	table[idx] += float(v.x);
+	table[idx + 1] += float(v.y);
+	table[idx + 2] += float(v.z);
+}
+
+static inline double texture_coord_from_unit_range(double x, int size) { return 0.5 / size + x * (1.0 - 1.0 / size); }
+
+static inline double clamp_cosine(double mu) { return std::min(std::max(mu, -1.0), 1.0); }
+static inline double clamp_radius(double r) { return std::min(std::max(r, Lookup::BOTTOM_RADIUS), Lookup::TOP_RADIUS); }
+
+static inline double distance_to_nearest_boundary(double r, double mu, bool ray_r_mu_intersects_ground)
+{
+	return ray_r_mu_intersects_ground ? Lookup::distance_to_bottom(r, mu) : Lookup::distance_to_top(r, mu);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The 4 texel rows around a mu and r coordinate of the scattering table, with their bilinear weights. Same filtering as
+// Bruneton2017Lookup::sample_scattering, split so a whole row of texels can share it.
+struct ScatteringRows
+{
+	size_t offset[4];
+	float weight[4];
+};
+
+static inline void texel_coords(double u, int size, int& i0, int& i1, float& t)
+{
+	double x = u * size - 0.5;
+	double fx = floor(x);
+
+	t = float(x - fx);
+	i0 = std::min(std::max(int(fx), 0), size - 1);
+	i1 = std::min(std::max(int(fx) + 1, 0), size - 1);
+}
+
+// Bruneton2017Lookup::scattering_u_mu_s() with the constants folded, it runs for every texel and sample of the
+// multiple scattering.
+static inline double scattering_u_mu_s(double mu_s)
+{
+	static const double H = sqrt(Lookup::TOP_RADIUS * Lookup::TOP_RADIUS - Lookup::BOTTOM_RADIUS * Lookup::BOTTOM_RADIUS);
+	static const double D_MIN = Lookup::TOP_RADIUS - Lookup::BOTTOM_RADIUS;
+	static const double A = (Lookup::distance_to_top(Lookup::BOTTOM_RADIUS, Lookup::MU_S_MIN) - D_MIN) / (H - D_MIN);
+
+	double r_mu_s = Lookup::BOTTOM_RADIUS * mu_s;
+	double d = -r_mu_s + sqrt(std::max(r_mu_s * r_mu_s - Lookup::BOTTOM_RADIUS * Lookup::BOTTOM_RADIUS + Lookup::TOP_RADIUS * Lookup::TOP_RADIUS, 0.0));
+	double a = (d - D_MIN) / (H - D_MIN);
+
+	return texture_coord_from_unit_range(std::max(1.0 - a / A, 0.0) / (1.0 + a), Tables::SCATTERING_MU_S);
+}
+
+static ScatteringRows scattering_rows(double u_mu, double u_r)
+{
+	int y0, y1, z0, z1;
+	float ty, tz;
+
+	texel_coords(u_mu, Tables::SCATTERING_MU, y0, y1, ty);
+	texel_coords(u_r, Tables::SCATTERING_R, z0, z1, tz);
+
+	ScatteringRows rows = { { scattering_index(0, y0, z0), scattering_index(0, y1, z0), scattering_index(0, y0, z1), scattering_index(0, y1, z1) },
+							{ (1.0f - ty) * (1.0f - tz), ty * (1.0f - tz), (1.0f - ty) * tz, ty * tz } };
+
+	return rows;
+}
+
+static glm::vec3 sample_scattering_rows(const float* table, const ScatteringRows& rows, int nu_slice, float nu_lerp, double u_mu_s)
+{
+	int x[4];
+	float w[4];
+	float tx;
+
+	texel_coords((nu_slice + u_mu_s) / Tables::SCATTERING_NU, SCATTERING_W, x[0], x[1], tx);
+	w[0] = (1.0f - tx) * (1.0f - nu_lerp);
+	w[1] = tx * (1.0f - nu_lerp);
+
+	texel_coords((nu_slice + 1.0 + u_mu_s) / Tables::SCATTERING_NU, SCATTERING_W, x[2], x[3], tx);
+	w[2] = (1.0f - tx) * nu_lerp;
+	w[3] = tx * nu_lerp;
+
+	// Plain floats, this runs for every texel and sample of the multiple scattering.
+	float result[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (int j = 0; j < 4; j++)
+	{
+		const float* p = table + rows.offset[j];
+
+		for (int k = 0; k < 4; k++)
+		{
+			const float* texel = p + size_t(x[k]) * 3;
+			float weight = rows.weight[j] * w[k];
+
+			result[0] += texel[0] * weight;
+			result[1] += texel[1] * weight;
+			result[2] += texel[2] * weight;
+		}
+	}
+
+	return glm::vec3(result[0], result[1], result[2]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Integral of the density along the ray to the top boundary, with the trapezoidal rule.
+static double optical_length_to_top(const DensityProfile& profile, double r, double mu)
+{
+	double dx = Lookup::distance_to_top(r, mu) / TRANSMITTANCE_SAMPLES;
+	double result = 0.0;
+
+	for (int i = 0; i <= TRANSMITTANCE_SAMPLES; i++)
+	{
+		double d_i = i * dx;
+		double r_i = sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r);
+		double y_i = profile.density(r_i - Lookup::BOTTOM_RADIUS);
+		double weight_i = i == 0 || i == TRANSMITTANCE_SAMPLES ? 0.5 : 1.0;
+
+		result += y_i * weight_i * dx;
+	}
+
+	return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017Precompute::Bruneton2017Precompute(const Bruneton2017Atmosphere& atmosphere, int num_threads) :
+	m_atmosphere(atmosphere), m_num_threads(num_threads)
+{
+	m_atmosphere.num_wavelengths = std::max(m_atmosphere.num_wavelengths, 3);
+	m_atmosphere.scattering_orders = std::max(m_atmosphere.scattering_orders, 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Precompute::run(Bruneton2017Tables& tables)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_timings = Timings();
+
+	tables.allocate();
+
+	m_transmittance.assign(Tables::TRANSMITTANCE_SIZE, 0.0f);
+	m_delta_irradiance.assign(Tables::IRRADIANCE_SIZE, 0.0f);
+	m_delta_rayleigh_scattering.assign(Tables::SCATTERING_SIZE, 0.0f);
+	m_delta_mie_scattering.assign(Tables::SCATTERING_SIZE, 0.0f);
+	m_delta_scattering_density.assign(Tables::SCATTERING_SIZE, 0.0f);
+
+	const glm::dvec3 rgb_lambda(Bruneton2017Atmosphere::LAMBDA_R, Bruneton2017Atmosphere::LAMBDA_G, Bruneton2017Atmosphere::LAMBDA_B);
+
+	if (m_atmosphere.num_wavelengths <= 3)
+	{
+		// The tables keep the radiance at R, G and B, Bruneton2017Atmosphere::sky_radiance_to_luminance() converts it.
+		precompute(spectrum(rgb_lambda, glm::dmat3(1.0)), tables);
+	}
+	else
+	{
+		// Groups of 3 wavelengths spread evenly over the visible range, each weighted by the color matching functions
+		// at its wavelengths times its share of the range.
+		int num_iterations = (m_atmosphere.num_wavelengths + 2) / 3;
+		double dlambda = (Bruneton2017Atmosphere::LAMBDA_MAX - Bruneton2017Atmosphere::LAMBDA_MIN) / (3.0 * num_iterations);
+
+		for (int i = 0; i < num_iterations; i++)
+		{
+			glm::dvec3 lambda = Bruneton2017Atmosphere::LAMBDA_MIN + (3.0 * i + glm::dvec3(0.5, 1.5, 2.5)) * dlambda;
+			glm::dmat3 luminance_from_radiance;
+
+			for (int j = 0; j < 3; j++)
+				luminance_from_radiance[j] = Bruneton2017Atmosphere::srgb_color_matching(lambda[j]) * dlambda;
+
+			precompute(spectrum(lambda, luminance_from_radiance), tables);
+		}
+	}
+
+	// The transmittance tables above were for the wavelengths of the group, the final one is at R, G and B.
+	Spectrum rgb = spectrum(rgb_lambda, glm::dmat3(1.0));
+	m_timings.transmittance_ms += timed([&]() { compute_transmittance(rgb, tables.transmittance); });
+
+	// Only the final tables are needed from here on.
+	std::vector<float>().swap(m_transmittance);
+	std::vector<float>().swap(m_delta_irradiance);
+	std::vector<float>().swap(m_delta_rayleigh_scattering);
+	std::vector<float>().swap(m_delta_mie_scattering);
+	std::vector<float>().swap(m_delta_scattering_density);
+
+	m_timings.total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017Precompute::Spectrum Bruneton2017Precompute::spectrum(const glm::dvec3& lambda, const glm::dmat3& luminance_from_radiance) const
+{
+	Spectrum s;
+
+	s.lambda = lambda;
+	s.solar_irradiance = m_atmosphere.solar_irradiance(lambda);
+	s.rayleigh_scattering = m_atmosphere.rayleigh_scattering(lambda);
+	s.mie_scattering = m_atmosphere.mie_scattering(lambda);
+	s.mie_extinction = m_atmosphere.mie_extinction(lambda);
+	s.absorption_extinction = m_atmosphere.absorption_extinction(lambda);
+	s.luminance_from_radiance = luminance_from_radiance;
+
+	return s;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename Fn>
+double Bruneton2017Precompute::timed(Fn fn)
+{
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Precompute::precompute(const Spectrum& spectrum, Bruneton2017Tables& tables)
+{
+	m_timings.transmittance_ms += timed([&]() { compute_transmittance(spectrum, m_transmittance); });
+	m_timings.direct_irradiance_ms += timed([&]() { compute_direct_irradiance(spectrum); });
+	m_timings.single_scattering_ms += timed([&]() { compute_single_scattering(spectrum, tables); });
+
+	for (int scattering_order = 2; scattering_order <= m_atmosphere.scattering_orders; scattering_order++)
+	{
+		m_timings.scattering_density_ms += timed([&]() { compute_scattering_density(spectrum, scattering_order); });
+		m_timings.indirect_irradiance_ms += timed([&]() { compute_indirect_irradiance(spectrum, scattering_order - 1, tables); });
+		m_timings.multiple_scattering_ms += timed([&]() { compute_multiple_scattering(spectrum, tables); });
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Precompute::compute_transmittance(const Spectrum& spectrum, std::vector<float>& transmittance)
+{
+	parallel_for(Tables::TRANSMITTANCE_H, 1, m_num_threads, [&](size_t begin, size_t end) {
+		for (int y = int(begin); y < int(end); y++)
+		{
+			for (int x = 0; x < Tables::TRANSMITTANCE_W; x++)
+			{
+				double r, mu;
+				Lookup::transmittance_r_mu(glm::dvec2((x + 0.5) / Tables::TRANSMITTANCE_W, (y + 0.5) / Tables::TRANSMITTANCE_H), r, mu);
+
+				glm::dvec3 optical_depth = spectrum.rayleigh_scattering * optical_length_to_top(m_atmosphere.rayleigh_density, r, mu) +
+										   spectrum.mie_extinction * optical_length_to_top(m_atmosphere.mie_density, r, mu) +
+										   spectrum.absorption_extinction * optical_length_to_top(m_atmosphere.absorption_density, r, mu);
+
+				store3(transmittance.data(), texel_index(x, y, Tables::TRANSMITTANCE_W), glm::exp(-optical_depth));
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Only into the delta table, the final irradiance table leaves out the direct part.
+void Bruneton2017Precompute::compute_direct_irradiance(const Spectrum& spectrum)
+{
+	const double alpha_s = m_atmosphere.sun_angular_radius;
+
+	for (int y = 0; y < Tables::IRRADIANCE_H; y++)
+	{
+		for (int x = 0; x < Tables::IRRADIANCE_W; x++)
+		{
+			double r, mu_s;
+			Lookup::irradiance_r_mu_s(glm::dvec2((x + 0.5) / Tables::IRRADIANCE_W, (y + 0.5) / Tables::IRRADIANCE_H), r, mu_s);
+
+			// Approximate average of the cosine factor mu_s over the visible fraction of the sun disc.
+			double average_cosine_factor = mu_s < -alpha_s ? 0.0 : (mu_s > alpha_s ? mu_s : (mu_s + alpha_s) * (mu_s + alpha_s) / (4.0 * alpha_s));
+
+			glm::dvec3 transmittance = Lookup::sample_transmittance(m_transmittance.data(), r, mu_s);
+
+			store3(m_delta_irradiance.data(), texel_index(x, y, Tables::IRRADIANCE_W), spectrum.solar_irradiance * transmittance * average_cosine_factor);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Samples along the view ray outside, texels of the row inside: the radius of each sample selects the transmittance
+// table rows, only the sun zenith angle changes per texel.
+void Bruneton2017Precompute::compute_single_scattering(const Spectrum& spectrum, Bruneton2017Tables& tables)
+{
+	const float* transmittance = m_transmittance.data();
+	const double sun_angular_radius = m_atmosphere.sun_angular_radius;
+	const double H = sqrt(Lookup::TOP_RADIUS * Lookup::TOP_RADIUS - Lookup::BOTTOM_RADIUS * Lookup::BOTTOM_RADIUS);
+
+	parallel_for(size_t(Tables::SCATTERING_R) * Tables::SCATTERING_MU, 8, m_num_threads, [&](size_t begin, size_t end) {
+		double mu_s[SCATTERING_W];
+		double nu[SCATTERING_W];
+		float rayleigh[SCATTERING_W][3];
+		float mie[SCATTERING_W][3];
+
+		for (size_t row = begin; row < end; row++)
+		{
+			int y = int(row % Tables::SCATTERING_MU);
+			int z = int(row / Tables::SCATTERING_MU);
+
+			double r, mu;
+			bool ray_r_mu_intersects_ground;
+
+			for (int x = 0; x < SCATTERING_W; x++)
+				Lookup::scattering_r_mu_mu_s_nu(x, y, z, r, mu, mu_s[x], nu[x], ray_r_mu_intersects_ground);
+
+			memset(rayleigh, 0, sizeof(rayleigh));
+			memset(mie, 0, sizeof(mie));
+
+			double dx = distance_to_nearest_boundary(r, mu, ray_r_mu_intersects_ground) / SINGLE_SCATTERING_SAMPLES;
+
+			for (int i = 0; i <= SINGLE_SCATTERING_SAMPLES; i++)
+			{
+				double d = i * dx;
+				double r_d = clamp_radius(sqrt(d * d + 2.0 * r * mu * d + r * r));
+
+				glm::dvec3 view_transmittance = Lookup::transmittance(transmittance, r, mu, d, ray_r_mu_intersects_ground);
+				double weight = (i == 0 || i == SINGLE_SCATTERING_SAMPLES ? 0.5 : 1.0) * dx;
+
+				glm::vec3 rayleigh_weight = view_transmittance * (m_atmosphere.rayleigh_density.density(r_d - Lookup::BOTTOM_RADIUS) * weight);
+				glm::vec3 mie_weight = view_transmittance * (m_atmosphere.mie_density.density(r_d - Lookup::BOTTOM_RADIUS) * weight);
+
+				// Transmittance table rows of r_d, see Bruneton2017Lookup::transmittance_uv().
+				double rho = sqrt(std::max(r_d * r_d - Lookup::BOTTOM_RADIUS * Lookup::BOTTOM_RADIUS, 0.0));
+				double d_min = Lookup::TOP_RADIUS - r_d;
+				double d_max = rho + H;
+
+				int v0, v1, u0, u1;
+				float tv, tu;
+				texel_coords(texture_coord_from_unit_range(rho / H, Tables::TRANSMITTANCE_H), Tables::TRANSMITTANCE_H, v0, v1, tv);
+
+				const float* row0 = transmittance + texel_index(0, v0, Tables::TRANSMITTANCE_W);
+				const float* row1 = transmittance + texel_index(0, v1, Tables::TRANSMITTANCE_W);
+
+				// Fraction of the sun disc above the horizon, see Bruneton2017Lookup::transmittance_to_sun().
+				double sin_theta_h = Lookup::BOTTOM_RADIUS / r_d;
+				double cos_theta_h = -sqrt(std::max(1.0 - sin_theta_h * sin_theta_h, 0.0));
+				double edge = sin_theta_h * sun_angular_radius;
+
+				for (int x = 0; x < SCATTERING_W; x++)
+				{
+					double mu_s_d = clamp_cosine((r * mu_s[x] + d * nu[x]) / r_d);
+					double t = std::min(std::max((mu_s_d - cos_theta_h + edge) / (2.0 * edge), 0.0), 1.0);
+
+					if (t == 0.0)
+						continue;
+
+					double x_mu = (Lookup::distance_to_top(r_d, mu_s_d) - d_min) / (d_max - d_min);
+					texel_coords(texture_coord_from_unit_range(x_mu, Tables::TRANSMITTANCE_W), Tables::TRANSMITTANCE_W, u0, u1, tu);
+
+					float visible = float(t * t * (3.0 - 2.0 * t));
+					float w00 = (1.0f - tu) * (1.0f - tv) * visible;
+					float w10 = tu * (1.0f - tv) * visible;
+					float w01 = (1.0f - tu) * tv * visible;
+					float w11 = tu * tv * visible;
+
+					for (int c = 0; c < 3; c++)
+					{
+						float sun_transmittance = row0[u0 * 3 + c] * w00 + row0[u1 * 3 + c] * w10 + row1[u0 * 3 + c] * w01 + row1[u1 * 3 + c] * w11;
+
+						rayleigh[x][c] += rayleigh_weight[c] * sun_transmittance;
+						mie[x][c] += mie_weight[c] * sun_transmittance;
+					}
+				}
+			}
+
+			for (int x = 0; x < SCATTERING_W; x++)
+			{
+				glm::dvec3 rayleigh_x = glm::dvec3(rayleigh[x][0], rayleigh[x][1], rayleigh[x][2]) * spectrum.solar_irradiance * spectrum.rayleigh_scattering;
+				glm::dvec3 mie_x = glm::dvec3(mie[x][0], mie[x][1], mie[x][2]) * spectrum.solar_irradiance * spectrum.mie_scattering;
+
+				size_t idx = scattering_index(x, y, z);
+
+				store3(m_delta_rayleigh_scattering.data(), idx, rayleigh_x);
+				store3(m_delta_mie_scattering.data(), idx, mie_x);
+
+				accumulate3(tables.scattering.data(), idx, spectrum.luminance_from_radiance * rayleigh_x);
+				accumulate3(tables.single_mie_scattering.data(), idx, spectrum.luminance_from_radiance * mie_x);
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017Precompute::scattering(double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground, int scattering_order) const
+{
+	glm::dvec4 uvwz = Lookup::scattering_uvwz(r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+
+	if (scattering_order == 1)
+	{
+		glm::vec3 rayleigh = Lookup::sample_scattering(m_delta_rayleigh_scattering.data(), uvwz);
+		glm::vec3 mie = Lookup::sample_scattering(m_delta_mie_scattering.data(), uvwz);
+
+		return rayleigh * float(Lookup::rayleigh_phase(nu)) + mie * float(Lookup::mie_phase(m_atmosphere.mie_g, nu));
+	}
+
+	// Holds the multiple scattering of the previous order by now.
+	return Lookup::sample_scattering(m_delta_rayleigh_scattering.data(), uvwz);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The density only depends on the direction to the sun through the phase functions, so the incident radiance is
+// gathered once per r and mu_s, in a frame with the sun in the xz plane, and every view direction and nu of that
+// r and mu_s convolves it with the phase functions, 8 directions at a time.
+void Bruneton2017Precompute::compute_scattering_density(const Spectrum& spectrum, int scattering_order)
+{
+	const double g = m_atmosphere.mie_g;
+	const double dphi = PI / SCATTERING_DENSITY_SAMPLES;
+	const double dtheta = PI / SCATTERING_DENSITY_SAMPLES;
+
+	const float rayleigh_k = float(3.0 / (16.0 * PI));
+	const float mie_k = float(3.0 / (8.0 * PI) * (1.0 - g * g) / (2.0 + g * g));
+
+	parallel_for(size_t(Tables::SCATTERING_R) * Tables::SCATTERING_MU_S, 1, m_num_threads, [&](size_t begin, size_t end) {
+		// Incident radiance times the solid angle, and the incident directions, as structure of arrays.
+		std::vector<float> incident(NUM_DENSITY_DIRECTIONS * 6);
+
+		float* radiance[3] = { &incident[0], &incident[NUM_DENSITY_DIRECTIONS], &incident[NUM_DENSITY_DIRECTIONS * 2] };
+		float* direction[3] = { &incident[NUM_DENSITY_DIRECTIONS * 3], &incident[NUM_DENSITY_DIRECTIONS * 4], &incident[NUM_DENSITY_DIRECTIONS * 5] };
+
+		for (size_t group = begin; group < end; group++)
+		{
+			int s = int(group % Tables::SCATTERING_MU_S);
+			int z = int(group / Tables::SCATTERING_MU_S);
+
+			double r, mu, mu_s, nu;
+			bool ray_r_mu_intersects_ground;
+			Lookup::scattering_r_mu_mu_s_nu(s, Tables::SCATTERING_MU - 1, z, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+
+			glm::dvec3 omega_s(sqrt(std::max(1.0 - mu_s * mu_s, 0.0)), 0.0, mu_s);
+
+			for (int l = 0; l < SCATTERING_DENSITY_SAMPLES; l++)
+			{
+				double theta = (l + 0.5) * dtheta;
+				double cos_theta = cos(theta);
+				double sin_theta = sin(theta);
+				bool ray_r_theta_intersects_ground = Lookup::intersects_ground(r, cos_theta);
+
+				// Light reflected by the ground, if the direction hits it.
+				double distance_to_ground = 0.0;
+				glm::dvec3 transmittance_to_ground(0.0);
+				double ground_albedo = 0.0;
+
+				if (ray_r_theta_intersects_ground)
+				{
+					distance_to_ground = Lookup::distance_to_bottom(r, cos_theta);
+					transmittance_to_ground = Lookup::transmittance(m_transmittance.data(), r, cos_theta, distance_to_ground, true);
+					ground_albedo = m_atmosphere.ground_albedo;
+				}
+
+				for (int m = 0; m < 2 * SCATTERING_DENSITY_SAMPLES; m++)
+				{
+					double phi = (m + 0.5) * dphi;
+					glm::dvec3 omega_i(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta);
+					double domega_i = dtheta * dphi * sin_theta;
+
+					glm::dvec3 incident_radiance = scattering(r, omega_i.z, mu_s, glm::dot(omega_s, omega_i), ray_r_theta_intersects_ground, scattering_order - 1);
+
+					if (ray_r_theta_intersects_ground)
+					{
+						glm::dvec3 ground_normal = glm::normalize(glm::dvec3(0.0, 0.0, r) + omega_i * distance_to_ground);
+						glm::dvec3 ground_irradiance = Lookup::sample_irradiance(m_delta_irradiance.data(), Lookup::BOTTOM_RADIUS, glm::dot(ground_normal, omega_s));
+
+						incident_radiance += transmittance_to_ground * ground_albedo * (1.0 / PI) * ground_irradiance;
+					}
+
+					int i = l * 2 * SCATTERING_DENSITY_SAMPLES + m;
+
+					for (int c = 0; c < 3; c++)
+					{
+						radiance[c][i] = float(incident_radiance[c] * domega_i);
+						direction[c][i] = float(omega_i[c]);
+					}
+				}
+			}
+
+			glm::dvec3 rayleigh_scattering = spectrum.rayleigh_scattering * m_atmosphere.rayleigh_density.density(r - Lookup::BOTTOM_RADIUS);
+			glm::dvec3 mie_scattering = spectrum.mie_scattering * m_atmosphere.mie_density.density(r - Lookup::BOTTOM_RADIUS);
+
+			for (int y = 0; y < Tables::SCATTERING_MU; y++)
+			{
+				for (int k = 0; k < Tables::SCATTERING_NU; k++)
+				{
+					int x = k * Tables::SCATTERING_MU_S + s;
+
+					Lookup::scattering_r_mu_mu_s_nu(x, y, z, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+
+					// View direction with the azimuth that gives nu.
+					double sin_view = sqrt(std::max(1.0 - mu * mu, 0.0));
+					double sin_sun = omega_s.x;
+					double cos_phi = sin_view * sin_sun > 0.0 ? clamp_cosine((nu - mu * mu_s) / (sin_view * sin_sun)) : 1.0;
+
+					vec8f omega[3] = { float(sin_view * cos_phi), float(sin_view * sqrt(1.0 - cos_phi * cos_phi)), float(mu) };
+					vec8f rayleigh[3] = { 0.0f, 0.0f, 0.0f };
+					vec8f mie[3] = { 0.0f, 0.0f, 0.0f };
+
+					for (int i = 0; i < NUM_DENSITY_DIRECTIONS; i += 8)
+					{
+						vec8f nu2 = omega[0] * load8(direction[0] + i) + omega[1] * load8(direction[1] + i) + omega[2] * load8(direction[2] + i);
+						vec8f angular = fmadd(nu2, nu2, 1.0f);
+						vec8f base = float(1.0 + g * g) - float(2.0 * g) * nu2;
+
+						vec8f rayleigh_phase = angular * rayleigh_k;
+						vec8f mie_phase = angular * mie_k / (base * sqrt(base));
+
+						for (int c = 0; c < 3; c++)
+						{
+							vec8f L = load8(radiance[c] + i);
+
+							rayleigh[c] = fmadd(L, rayleigh_phase, rayleigh[c]);
+							mie[c] = fmadd(L, mie_phase, mie[c]);
+						}
+					}
+
+					glm::dvec3 density;
+
+					for (int c = 0; c < 3; c++)
+					{
+						float rayleigh_sum[8], mie_sum[8];
+						store8(rayleigh_sum, rayleigh[c]);
+						store8(mie_sum, mie[c]);
+
+						double sum_r = 0.0, sum_m = 0.0;
+
+						for (int j = 0; j < 8; j++)
+						{
+							sum_r += rayleigh_sum[j];
+							sum_m += mie_sum[j];
+						}
+
+						density[c] = rayleigh_scattering[c] * sum_r + mie_scattering[c] * sum_m;
+					}
+
+					store3(m_delta_scattering_density.data(), scattering_index(x, y, z), density);
+				}
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017Precompute::compute_indirect_irradiance(const Spectrum& spectrum, int scattering_order, Bruneton2017Tables& tables)
+{
+	const double dphi = PI / INDIRECT_IRRADIANCE_SAMPLES;
+	const double dtheta = PI / INDIRECT_IRRADIANCE_SAMPLES;
+
+	parallel_for(Tables::IRRADIANCE_H, 1, m_num_threads, [&](size_t begin, size_t end) {
+		for (int y = int(begin); y < int(end); y++)
+		{
+			for (int x = 0; x < Tables::IRRADIANCE_W; x++)
+			{
+				double r, mu_s;
+				Lookup::irradiance_r_mu_s(glm::dvec2((x + 0.5) / Tables::IRRADIANCE_W, (y + 0.5) / Tables::IRRADIANCE_H), r, mu_s);
+
+				glm::dvec3 omega_s(sqrt(std::max(1.0 - mu_s * mu_s, 0.0)), 0.0, mu_s);
+				glm::dvec3 result(0.0);
+
+				// Upper hemisphere only.
+				for (int j = 0; j < INDIRECT_IRRADIANCE_SAMPLES / 2; j++)
+				{
+					double theta = (j + 0.5) * dtheta;
+
+					for (int i = 0; i < 2 * INDIRECT_IRRADIANCE_SAMPLES; i++)
+					{
+						double phi = (i + 0.5) * dphi;
+						glm::dvec3 omega(cos(phi) * sin(theta), sin(phi) * sin(theta), cos(theta));
+						double domega = dtheta * dphi * sin(theta);
+
+						glm::dvec3 L = scattering(r, omega.z, mu_s, glm::dot(omega, omega_s), false, scattering_order);
+
+						result += L * omega.z * domega;
+					}
+				}
+
+				size_t idx = texel_index(x, y, Tables::IRRADIANCE_W);
+
+				store3(m_delta_irradiance.data(), idx, result);
+				accumulate3(tables.irradiance.data(), idx, spectrum.luminance_from_radiance * result);
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Like the single scattering, the samples along the view ray are shared by the whole row. The mu and r half of the
+// density lookups only depends on the sample, so the loop runs over the samples and then the texels of the row, which
+// keeps the 4 table rows of each sample in cache.
+void Bruneton2017Precompute::compute_multiple_scattering(const Spectrum& spectrum, Bruneton2017Tables& tables)
+{
+	const float* transmittance = m_transmittance.data();
+	const float* density = m_delta_scattering_density.data();
+
+	parallel_for(size_t(Tables::SCATTERING_R) * Tables::SCATTERING_MU, 8, m_num_threads, [&](size_t begin, size_t end) {
+		double mu_s[SCATTERING_W];
+		double nu[SCATTERING_W];
+		int nu_slice[SCATTERING_W];
+		float nu_lerp[SCATTERING_W];
+		float result[SCATTERING_W][3];
+
+		for (size_t row = begin; row < end; row++)
+		{
+			int y = int(row % Tables::SCATTERING_MU);
+			int z = int(row / Tables::SCATTERING_MU);
+
+			double r, mu;
+			bool ray_r_mu_intersects_ground;
+
+			for (int x = 0; x < SCATTERING_W; x++)
+			{
+				Lookup::scattering_r_mu_mu_s_nu(x, y, z, r, mu, mu_s[x], nu[x], ray_r_mu_intersects_ground);
+
+				double tex_coord_x = (nu[x] + 1.0) / 2.0 * (Tables::SCATTERING_NU - 1);
+				double tex_x = floor(tex_coord_x);
+
+				nu_slice[x] = int(tex_x);
+				nu_lerp[x] = float(tex_coord_x - tex_x);
+			}
+
+			memset(result, 0, sizeof(result));
+
+			double dx = distance_to_nearest_boundary(r, mu, ray_r_mu_intersects_ground) / MULTIPLE_SCATTERING_SAMPLES;
+
+			for (int i = 0; i <= MULTIPLE_SCATTERING_SAMPLES; i++)
+			{
+				double d_i = i * dx;
+				double r_i = clamp_radius(sqrt(d_i * d_i + 2.0 * r * mu * d_i + r * r));
+				double mu_i = clamp_cosine((r * mu + d_i) / r_i);
+
+				double weight = (i == 0 || i == MULTIPLE_SCATTERING_SAMPLES ? 0.5 : 1.0) * dx;
+				glm::vec3 weight_i = Lookup::transmittance(transmittance, r, mu, d_i, ray_r_mu_intersects_ground) * float(weight);
+
+				// The mu_s and nu of the lookup are filled in per texel.
+				glm::dvec4 uvwz = Lookup::scattering_uvwz(r_i, mu_i, 1.0, 0.0, ray_r_mu_intersects_ground);
+				ScatteringRows rows = scattering_rows(uvwz.z, uvwz.w);
+
+				for (int x = 0; x < SCATTERING_W; x++)
+				{
+					double mu_s_i = clamp_cosine((r * mu_s[x] + d_i * nu[x]) / r_i);
+					glm::vec3 J = sample_scattering_rows(density, rows, nu_slice[x], nu_lerp[x], scattering_u_mu_s(mu_s_i));
+
+					for (int c = 0; c < 3; c++)
+						result[x][c] += J[c] * weight_i[c];
+				}
+			}
+
+			for (int x = 0; x < SCATTERING_W; x++)
+			{
+				size_t idx = scattering_index(x, y, z);
+
+				// The delta is the input of the next order, the accumulated table stores it without the Rayleigh phase
+				// function like the single Rayleigh scattering, so rendering can apply that to both.
+				glm::dvec3 multiple_scattering(result[x][0], result[x][1], result[x][2]);
+
+				store3(m_delta_rayleigh_scattering.data(), idx, multiple_scattering);
+				accumulate3(tables.scattering.data(), idx, spectrum.luminance_from_radiance * multiple_scattering / Lookup::rayleigh_phase(nu[x]));
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bruneton_2017_atmosphere.h"
+#include "bruneton_2017_lookup.h"
+
+#include <glm.hpp>
+#include <vector>
+
+// CPU precomputation of the 2017 model tables, a port of the reference implementation's precompute passes. Needs no
+// GL context, so services and tools can produce (and validate) the tables headless, and the GL model runs it on a
+// worker thread when there's no cache.
+//
+// For each group of 3 wavelengths: transmittance, direct irradiance, single scattering, then per scattering order
+// the scattering density, indirect irradiance and multiple scattering. Each group is converted to luminance with
+// the color matching functions and accumulated into the final tables, which are then only sampled at render time.
+// Every pass adds its delta into the final tables as it stores it, there are no copy passes or second copies of the
+// tables to accumulate into (BrunetonSkyModelGL::precompute() does the same on the GPU).
+class Bruneton2017Precompute
+{
+public:
+	// Wall clock time spent in each pass, summed over the wavelength groups and scattering orders.
+	struct Timings
+	{
+		double transmittance_ms = 0.0;
+		double direct_irradiance_ms = 0.0;
+		double single_scattering_ms = 0.0;
+		double scattering_density_ms = 0.0;
+		double indirect_irradiance_ms = 0.0;
+		double multiple_scattering_ms = 0.0;
+		double total_ms = 0.0;
+	};
+
+	// num_threads = 0 uses the hardware concurrency.
+	Bruneton2017Precompute(const Bruneton2017Atmosphere& atmosphere, int num_threads = 0);
+
+	void run(Bruneton2017Tables& tables);
+
+	inline const Timings& timings() const { return m_timings; }
+
+private:
+	// Coefficients of the 3 wavelengths being computed, per km.
+	struct Spectrum
+	{
+		glm::dvec3 lambda;
+		glm::dvec3 solar_irradiance;
+		glm::dvec3 rayleigh_scattering;
+		glm::dvec3 mie_scattering;
+		glm::dvec3 mie_extinction;
+		glm::dvec3 absorption_extinction;
+
+		// Rows are the output R, G and B, columns the 3 wavelengths.
+		glm::dmat3 luminance_from_radiance;
+	};
+
+	Spectrum spectrum(const glm::dvec3& lambda, const glm::dmat3& luminance_from_radiance) const;
+
+	void precompute(const Spectrum& spectrum, Bruneton2017Tables& tables);
+
+	void compute_transmittance(const Spectrum& spectrum, std::vector<float>& transmittance);
+	void compute_direct_irradiance(const Spectrum& spectrum);
+	void compute_single_scattering(const Spectrum& spectrum, Bruneton2017Tables& tables);
+	void compute_scattering_density(const Spectrum& spectrum, int scattering_order);
+	void compute_indirect_irradiance(const Spectrum& spectrum, int scattering_order, Bruneton2017Tables& tables);
+	void compute_multiple_scattering(const Spectrum& spectrum, Bruneton2017Tables& tables);
+
+	// Radiance arriving at r from direction mu (and nu to the sun) after scattering_order bounces.
+	glm::vec3 scattering(double r, double mu, double mu_s, double nu, bool ray_r_mu_intersects_ground, int scattering_order) const;
+
+	template <typename Fn>
+	double timed(Fn fn);
+
+private:
+	Bruneton2017Atmosphere m_atmosphere;
+	int m_num_threads;
+	Timings m_timings;
+
+	// Per wavelength group, RGB like the final tables. delta_multiple_scattering shares the storage of
+	// delta_rayleigh_scattering, which is only needed up to the second order.
+	std::vector<float> m_transmittance;
+	std::vector<float> m_delta_irradiance;
+	std::vector<float> m_delta_rayleigh_scattering;
+	std::vector<float> m_delta_mie_scattering;
+	std::vector<float> m_delta_scattering_density;
+};
@@ -0,0 +1,152 @@
+#include "bruneton_2017_sky_model.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::shared_ptr<const Bruneton2017Tables> load_or_precompute(const Bruneton2017Atmosphere& atmosphere, bool compress_cache, Bruneton2017Precompute::Timings& timings)
+{
+	auto tables = std::make_shared<Bruneton2017Tables>();
+
+	timings = Bruneton2017Precompute::Timings();
+
+	if (tables->load(atmosphere))
+		return tables;
+
+	Bruneton2017Precompute precompute(atmosphere);
+	precompute.run(*tables);
+	timings = precompute.timings();
+
+	// Not being able to write the cache only costs the next start another precomputation.
+	tables->save(atmosphere, compress_cache);
+
+	return tables;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyModel::Bruneton2017SkyModel() : m_load_finished(false)
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyModel::~Bruneton2017SkyModel()
+{
+	if (m_load_thread.joinable())
+		m_load_thread.join();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017SkyModel::initialize()
+{
+	m_lookup.set_tables(load_or_precompute(m_atmosphere, COMPRESS_CACHE, m_precompute_timings));
+	m_lookup.set_atmosphere(m_atmosphere);
+	m_load_status = LOAD_COMPLETE;
+
+	// States published before the tables were loaded evaluate to black.
+	mark_dirty();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017SkyModel::begin_load()
+{
+	if (m_load_status == LOAD_PENDING)
+		return;
+
+	m_load_status = LOAD_PENDING;
+	m_load_finished = false;
+
+	m_load_thread = std::thread([this, atmosphere = m_atmosphere, compress_cache = COMPRESS_CACHE]() {
+		m_pending_tables = load_or_precompute(atmosphere, compress_cache, m_pending_timings);
+		m_load_finished.store(true, std::memory_order_release);
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyModel::LoadStatus Bruneton2017SkyModel::poll_load()
+{
+	if (m_load_status != LOAD_PENDING || !m_load_finished.load(std::memory_order_acquire))
+		return m_load_status;
+
+	m_load_thread.join();
+
+	m_lookup.set_tables(std::move(m_pending_tables));
+	m_lookup.set_atmosphere(m_atmosphere);
+	m_precompute_timings = m_pending_timings;
+	m_load_status = LOAD_COMPLETE;
+	mark_dirty();
+
+	return m_load_status;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017SkyModel::update_parameters()
+{
+	m_lookup.set_sun_direction(m_direction);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Names are prefixed so they don't clash with the 2008 model's in the same shaders.
+void Bruneton2017SkyModel::write_uniforms(SkyUniforms& uniforms)
+{
+	uniforms.set("b17_sun_direction", m_lookup.sun_direction());
+	uniforms.set("b17_earth_position", m_lookup.earth_position());
+	uniforms.set("b17_mie_g", m_lookup.mie_g());
+	uniforms.set("b17_sun_angular_radius", m_lookup.sun_angular_radius());
+	uniforms.set("b17_solar_luminance", m_lookup.solar_luminance());
+	uniforms.set("b17_sky_radiance_to_luminance", m_lookup.sky_radiance_to_luminance());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017SkyModel::sun_radiance(float altitude) const
+{
+	if (!m_lookup.is_loaded())
+		return glm::vec3(0.0f);
+
+	// Straight above the earth position, the radii are in kilometers. The disc has a uniform luminance, the horizon
+	// cuts off part of it while the sun sets.
+	double r = double(m_lookup.earth_position().y) + double(altitude) / 1000.0;
+	double radius = double(m_lookup.sun_angular_radius());
+	float solid_angle = float(M_PI * radius * radius);
+
+	return m_lookup.solar_luminance() * solid_angle * Bruneton2017Lookup::transmittance_to_sun(m_lookup.tables()->transmittance.data(), r, double(m_direction.y), radius);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const SkyState::Evaluator> Bruneton2017SkyModel::create_evaluator() const
+{
+	// The copy shares the tables.
+	return std::make_shared<Bruneton2017SkyState>(m_lookup);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyState::Bruneton2017SkyState(const Bruneton2017Lookup& lookup) : m_lookup(lookup)
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 Bruneton2017SkyState::radiance(const glm::vec3& dir) const
+{
+	if (!m_lookup.is_loaded())
+		return glm::vec3(0.0f);
+
+	glm::vec3 transmittance;
+	return m_lookup.sky_luminance(glm::vec3(0.0f), dir, transmittance);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "sky_model.h"
+#include "bruneton_2017_lookup.h"
+#include "bruneton_2017_precompute.h"
+
+#include <atomic>
+#include <thread>
+
+// Precomputed Atmospheric Scattering, the 2017 revision (Eric Bruneton): layered density profiles, ozone absorption
+// and tables precomputed directly in luminance, so rendering is one lookup per table instead of the Rayleigh plus
+// approximate Mie reconstruction of the 2008 model. The tables come from the cache on disk or from
+// Bruneton2017Precompute on the CPU, so this part needs no GL context. Bruneton2017SkyModelGL uploads them.
+class Bruneton2017SkyModel : public SkyModel
+{
+public:
+	enum LoadStatus
+	{
+		LOAD_IDLE,
+		LOAD_PENDING,
+		LOAD_COMPLETE
+	};
+
+protected:
+	// Writes the table cache compressed (.rawz) instead of as raw floats (.raw). Both are read back.
+	const bool COMPRESS_CACHE = true;
+
+	Bruneton2017Lookup m_lookup;
+
+	// What the tables were (or will be) precomputed for.
+	Bruneton2017Atmosphere m_atmosphere;
+
+	// Of the last precomputation, all zero if the tables came from the cache.
+	Bruneton2017Precompute::Timings m_precompute_timings;
+
+private:
+	// Written by the load thread, read by the owner once m_load_finished is set.
+	std::shared_ptr<const Bruneton2017Tables> m_pending_tables;
+	Bruneton2017Precompute::Timings m_pending_timings;
+	std::atomic<bool> m_load_finished;
+	std::thread m_load_thread;
+	LoadStatus m_load_status = LOAD_IDLE;
+
+public:
+	Bruneton2017SkyModel();
+	virtual ~Bruneton2017SkyModel();
+
+	// Loads the cached tables, or precomputes them on the CPU and writes the cache if there are none. The
+	// precomputation takes a while (see Bruneton2017Precompute), begin_load() does it in the background.
+	bool initialize() override;
+
+	// Loads or precomputes the tables on a worker thread instead.
+	void begin_load();
+
+	// Never blocks. Once the worker is done, the tables are installed into the lookup on the calling thread and the
+	// model marked dirty, so the next update() publishes them. Until then the model evaluates to black.
+	LoadStatus poll_load();
+
+	inline LoadStatus load_status() const { return m_load_status; }
+
+	// Selects the precomputed tables, call before initialize(). Each atmosphere has its own cache files, named after
+	// the parameter hash.
+	inline void set_atmosphere(const Bruneton2017Atmosphere& atmosphere) { m_atmosphere = atmosphere; }
+	inline const Bruneton2017Atmosphere& atmosphere() const { return m_atmosphere; }
+	inline const Bruneton2017Precompute::Timings& precompute_timings() const { return m_precompute_timings; }
+
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// Solar illuminance through the transmittance table, in the luminance units of the sky. Black until the tables
+	// are loaded.
+	glm::vec3 sun_radiance(float altitude) const override;
+
+	inline const Bruneton2017Lookup& lookup() { return m_lookup; }
+
+protected:
+	void update_parameters() override;
+	std::shared_ptr<const SkyState::Evaluator> create_evaluator() const override;
+};
+
+// Const evaluation of one 2017 model state, see SkyState. Evaluates to black if the tables weren't loaded.
+class Bruneton2017SkyState : public SkyState::Evaluator
+{
+public:
+	Bruneton2017SkyState(const Bruneton2017Lookup& lookup);
+
+	glm::vec3 radiance(const glm::vec3& dir) const override;
+
+private:
+	Bruneton2017Lookup m_lookup;
+};
@@ -0,0 +1,159 @@
+#include "bruneton_2017_sky_model_gl.h"
+#include "sky_model_gl.h"
+#include <macros.h>
+#include <chrono>
+
+typedef Bruneton2017Tables Tables;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyModelGL::Bruneton2017SkyModelGL()
+{
+	m_transmittance_t = nullptr;
+	m_irradiance_t = nullptr;
+	m_scattering_t = nullptr;
+	m_single_mie_scattering_t = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+Bruneton2017SkyModelGL::~Bruneton2017SkyModelGL()
+{
+	DW_SAFE_DELETE(m_transmittance_t);
+	DW_SAFE_DELETE(m_irradiance_t);
+	DW_SAFE_DELETE(m_scattering_t);
+	DW_SAFE_DELETE(m_single_mie_scattering_t);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017SkyModelGL::initialize()
+{
+	if (!Bruneton2017SkyModel::initialize())
+		return false;
+
+	create_textures();
+
+	const Tables* tables = m_lookup.tables();
+
+	m_transmittance_t->set_data(0, 0, (void*)tables->transmittance.data());
+	m_irradiance_t->set_data(0, 0, (void*)tables->irradiance.data());
+	m_scattering_t->set_data(0, (void*)tables->scattering.data());
+	m_single_mie_scattering_t->set_data(0, (void*)tables->single_mie_scattering.data());
+
+	m_uploaded_layers = 2 * Tables::SCATTERING_R;
+	m_ready = true;
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017SkyModelGL::initialize_async()
+{
+	create_textures();
+
+	m_uploaded_layers = 0;
+	m_ready = false;
+
+	begin_load();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Bruneton2017SkyModelGL::update_loading(float budget_ms)
+{
+	if (m_ready)
+		return true;
+
+	if (poll_load() != LOAD_COMPLETE)
+		return false;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const Tables* tables = m_lookup.tables();
+
+	if (m_uploaded_layers == 0)
+	{
+		m_transmittance_t->set_data(0, 0, (void*)tables->transmittance.data());
+		m_irradiance_t->set_data(0, 0, (void*)tables->irradiance.data());
+	}
+
+	// One depth slice is one layer of r, the scattering texture first, then the single Mie one.
+	const int width = Tables::SCATTERING_MU_S * Tables::SCATTERING_NU;
+	const size_t layer_size = size_t(width) * Tables::SCATTERING_MU * 3;
+
+	while (m_uploaded_layers < 2 * Tables::SCATTERING_R)
+	{
+		bool mie = m_uploaded_layers >= Tables::SCATTERING_R;
+		int z = m_uploaded_layers % Tables::SCATTERING_R;
+
+		const float* layer = (mie ? tables->single_mie_scattering.data() : tables->scattering.data()) + layer_size * z;
+
+		(mie ? m_single_mie_scattering_t : m_scattering_t)->bind(0);
+		GL_CHECK_ERROR(glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, width, Tables::SCATTERING_MU, 1, GL_RGB, GL_FLOAT, layer));
+		m_uploaded_layers++;
+
+		if (std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() > budget_ms)
+			break;
+	}
+
+	m_ready = m_uploaded_layers == 2 * Tables::SCATTERING_R;
+
+	return m_ready;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017SkyModelGL::write_uniforms(SkyUniforms& uniforms)
+{
+	Bruneton2017SkyModel::write_uniforms(uniforms);
+
+	if (!m_ready)
+		return;
+
+	// The samplers are on fixed units, see set_sky_sampler_units().
+	m_transmittance_t->bind(SKY_UNIT_B17_TRANSMITTANCE);
+	m_irradiance_t->bind(SKY_UNIT_B17_IRRADIANCE);
+	m_scattering_t->bind(SKY_UNIT_B17_SCATTERING);
+	m_single_mie_scattering_t->bind(SKY_UNIT_B17_SINGLE_MIE_SCATTERING);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Bruneton2017SkyModelGL::create_textures()
+{
+	if (m_transmittance_t)
+		return;
+
+	m_transmittance_t = new_texture_2d(Tables::TRANSMITTANCE_W, Tables::TRANSMITTANCE_H);
+	m_irradiance_t = new_texture_2d(Tables::IRRADIANCE_W, Tables::IRRADIANCE_H);
+	m_scattering_t = new_texture_3d(Tables::SCATTERING_MU_S * Tables::SCATTERING_NU, Tables::SCATTERING_MU, Tables::SCATTERING_R);
+	m_single_mie_scattering_t = new_texture_3d(Tables::SCATTERING_MU_S * Tables::SCATTERING_NU, Tables::SCATTERING_MU, Tables::SCATTERING_R);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture2D* Bruneton2017SkyModelGL::new_texture_2d(int width, int height)
+{
+	dw::Texture2D* texture = new dw::Texture2D(width, height, 1, 1, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
+	texture->set_min_filter(GL_LINEAR);
+	texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+	return texture;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture3D* Bruneton2017SkyModelGL::new_texture_3d(int width, int height, int depth)
+{
+	dw::Texture3D* texture = new dw::Texture3D(width, height, depth, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
+	texture->set_min_filter(GL_LINEAR);
+	texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+	return texture;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ogl.h>
+#include "bruneton_2017_sky_model.h"
+
+// GPU side of the 2017 model: uploads the tables to textures and binds them for the sky shaders. There are no
+// precompute shaders, when there's no cache the tables come from the CPU precomputation (see Bruneton2017SkyModel).
+//
+// initialize() does all of that before returning. initialize_async() instead loads or precomputes the tables on a
+// worker thread and update_loading() uploads them over several frames, so the application can show another sky in
+// the meantime.
+class Bruneton2017SkyModelGL : public Bruneton2017SkyModel
+{
+private:
+	dw::Texture2D* m_transmittance_t;
+	dw::Texture2D* m_irradiance_t;
+	dw::Texture3D* m_scattering_t;
+	dw::Texture3D* m_single_mie_scattering_t;
+
+	// Depth slices of both 3D textures uploaded so far by update_loading(), 2 * SCATTERING_R once they are complete.
+	int m_uploaded_layers = 0;
+	bool m_ready = false;
+
+public:
+	Bruneton2017SkyModelGL();
+	~Bruneton2017SkyModelGL();
+
+	bool initialize() override;
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// Creates the textures and starts loading (or precomputing) the tables in the background.
+	bool initialize_async();
+
+	// Call once per frame on the GL thread after initialize_async(). Uploads the loaded tables, stopping after the
+	// first 3D texture layer that exceeds budget_ms (the small 2D tables always go in one piece). Returns true when
+	// the model is ready to render.
+	bool update_loading(float budget_ms);
+
+	inline bool is_ready() const { return m_ready; }
+
+private:
+	void create_textures();
+	dw::Texture2D* new_texture_2d(int width, int height);
+	dw::Texture3D* new_texture_3d(int width, int height, int depth);
+};
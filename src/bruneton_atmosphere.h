@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Parameters the Bruneton tables are precomputed for. Scattering coefficients are per km like the precompute shaders.
+// The planet and atmosphere radii are still fixed by the defines in the runtime shader and BrunetonLookup, so they
+// aren't part of the atmosphere.
+struct BrunetonAtmosphere
+{
+	glm::vec3 beta_r = glm::vec3(5.8e-3f, 1.35e-2f, 3.31e-2f);
+	glm::vec3 beta_m_sca = glm::vec3(4e-3f);
+	glm::vec3 beta_m_ex = glm::vec3(4.44e-3f);
+
+	// Asymmetry factor of the Mie phase function, clamped to 0.99 when precomputing.
+	float mie_g = 0.8f;
+
+	// Scale heights of the air (HR) and particle (HM) densities in km.
+	float hr = 8.0f;
+	float hm = 1.2f;
+
+	float ground_reflectance = 0.1f;
+
+	// Bump when the tables change for the same parameters (dimensions, precompute fixes), so old caches are ignored.
+	static const uint32_t TABLE_VERSION = 2;
+
+	// FNV-1a over the parameter bits. Stable across runs and platforms, it names the cache files.
+	uint64_t hash() const
+	{
+		const float values[] = { beta_r.x, beta_r.y, beta_r.z, beta_m_sca.x, beta_m_sca.y, beta_m_sca.z, beta_m_ex.x, beta_m_ex.y, beta_m_ex.z, mie_g, hr, hm, ground_reflectance };
+
+		uint64_t h = 14695981039346656037ull;
+
+		auto mix = [&h](uint32_t v) {
+			for (int i = 0; i < 4; i++)
+			{
+				h ^= (v >> (i * 8)) & 0xff;
+				h *= 1099511628211ull;
+			}
+		};
+
+		mix(TABLE_VERSION);
+
+		for (float value : values)
+		{
+			// -0 and 0 hash the same.
+			uint32_t bits;
+			value += 0.0f;
+			memcpy(&bits, &value, sizeof(bits));
+			mix(bits);
+		}
+
+		return h;
+	}
+
+	// Cache file of one table, e.g. bruneton_0123456789abcdef_inscatter.rawz.
+	std::string cache_path(const char* table, const char* extension = ".rawz") const
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "bruneton_%016llx_", (unsigned long long)hash());
+
+		return std::string(name) + table + extension;
+	}
+
+	bool operator==(const BrunetonAtmosphere& other) const
+	{
+		return beta_r == other.beta_r && beta_m_sca == other.beta_m_sca && beta_m_ex == other.beta_m_ex && mie_g == other.mie_g &&
+			   hr == other.hr && hm == other.hm && ground_reflectance == other.ground_reflectance;
+	}
+
+	bool operator!=(const BrunetonAtmosphere& other) const { return !(*this == other); }
+};
@@ -0,0 +1,642 @@
+#include "bruneton_lookup.h"
+#include "table_codec.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// Must match the defines in shader/sky_models/bruneton/atmosphere.glsl
+static const float M_PI_F = 3.141592f;
+static const float Rg = 6360000.0f;
+static const float Rt = 6420000.0f;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static const size_t TRANSMITTANCE_SIZE = BrunetonLookup::TRANSMITTANCE_W * BrunetonLookup::TRANSMITTANCE_H * 4;
+static const size_t IRRADIANCE_SIZE = BrunetonLookup::IRRADIANCE_W * BrunetonLookup::IRRADIANCE_H * 4;
+static const size_t INSCATTER_SIZE = BrunetonLookup::INSCATTER_MU_S * BrunetonLookup::INSCATTER_NU * BrunetonLookup::INSCATTER_MU * BrunetonLookup::INSCATTER_R * 4;
+static const size_t SINGLE_MIE_SIZE = INSCATTER_SIZE / 4 * 3;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_table(const std::string& path, std::shared_ptr<const std::vector<float>>& table, size_t count)
+{
+	table.reset();
+
+	auto data = std::make_shared<std::vector<float>>(count);
+
+	if (!table_read_file(path, data->data(), count))
+		return false;
+
+	table = data;
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool write_table(const std::string& path, const std::vector<float>& table, int channels, size_t chunk_size, bool compressed)
+{
+	return table_write_file(path, table.data(), table.size(), channels, chunk_size, compressed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Nearest value of an unsigned float with a 5 bit exponent (bias 15) and mantissa_bits, including the denormals.
+static float quantize_small_float(float x, int mantissa_bits)
+{
+	if (!(x > 0.0f))
+		return 0.0f;
+
+	const float max_value = (2.0f - ldexpf(1.0f, -mantissa_bits)) * 32768.0f;
+
+	if (x >= max_value)
+		return max_value;
+
+	int e;
+	frexpf(x, &e);
+
+	// Below the smallest normal (2^-14) the step stays that of the denormals.
+	float step = ldexpf(1.0f, std::max(e, -13) - 1 - mantissa_bits);
+
+	return roundf(x / step) * step;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Emulates GL_LINEAR + GL_CLAMP_TO_EDGE on a float texture.
+static void texel_coords(float u, int size, int& i0, int& i1, float& t)
+{
+	float x = u * float(size) - 0.5f;
+	float fx = floorf(x);
+
+	t = x - fx;
+	i0 = std::min(std::max(int(fx), 0), size - 1);
+	i1 = std::min(std::max(int(fx) + 1, 0), size - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// RGBA texel, or RGB with w = 0 when channels is 3.
+static inline glm::vec4 fetch(const float* table, size_t idx, int channels)
+{
+	const float* p = table + idx * channels;
+	return glm::vec4(p[0], p[1], p[2], channels == 4 ? p[3] : 0.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec4 sample_2d(const float* table, int w, int h, float u, float v)
+{
+	int x0, x1, y0, y1;
+	float tx, ty;
+
+	texel_coords(u, w, x0, x1, tx);
+	texel_coords(v, h, y0, y1, ty);
+
+	glm::vec4 a = glm::mix(fetch(table, y0 * w + x0, 4), fetch(table, y0 * w + x1, 4), tx);
+	glm::vec4 b = glm::mix(fetch(table, y1 * w + x0, 4), fetch(table, y1 * w + x1, 4), tx);
+
+	return glm::mix(a, b, ty);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static glm::vec4 sample_3d(const float* table, int channels, int w, int h, int d, float u, float v, float s)
+{
+	int x0, x1, y0, y1, z0, z1;
+	float tx, ty, tz;
+
+	texel_coords(u, w, x0, x1, tx);
+	texel_coords(v, h, y0, y1, ty);
+	texel_coords(s, d, z0, z1, tz);
+
+	size_t slice0 = size_t(z0) * w * h;
+	size_t slice1 = size_t(z1) * w * h;
+
+	glm::vec4 a = glm::mix(glm::mix(fetch(table, slice0 + y0 * w + x0, channels), fetch(table, slice0 + y0 * w + x1, channels), tx),
+						   glm::mix(fetch(table, slice0 + y1 * w + x0, channels), fetch(table, slice0 + y1 * w + x1, channels), tx),
+						   ty);
+	glm::vec4 b = glm::mix(glm::mix(fetch(table, slice1 + y0 * w + x0, channels), fetch(table, slice1 + y0 * w + x1, channels), tx),
+						   glm::mix(fetch(table, slice1 + y1 * w + x0, channels), fetch(table, slice1 + y1 * w + x1, channels), tx),
+						   ty);
+
+	return glm::mix(a, b, tz);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void texel_coords_8(const vec8f& u, int size, vec8i& i0, vec8i& i1, vec8f& t)
+{
+	vec8f x = u * float(size) - 0.5f;
+	vec8f fx = floor(x);
+
+	t = x - fx;
+
+	vec8i i = to_int(fx);
+
+	i0 = min(max(i, vec8i(0)), vec8i(size - 1));
+	i1 = min(max(i + vec8i(1), vec8i(0)), vec8i(size - 1));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Accumulates weight * texel into result[0..channels) for 8 texel indices at once. Texels are 4 floats apart, or
+// 3 for the RGB single Mie table.
+static inline void gather_texel(const float* table, const vec8i& idx, const vec8f& weight, int channels, vec8f* result)
+{
+	vec8i base = channels == 3 ? idx * vec8i(3) : shift_left(idx, 2);
+
+	for (int c = 0; c < channels; c++)
+		result[c] = fmadd(gather(table, base + vec8i(c)), weight, result[c]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void sample_2d_8(const float* table, int w, int h, const vec8f& u, const vec8f& v, int channels, vec8f* result)
+{
+	vec8i x0, x1, y0, y1;
+	vec8f tx, ty;
+
+	texel_coords_8(u, w, x0, x1, tx);
+	texel_coords_8(v, h, y0, y1, ty);
+
+	for (int c = 0; c < channels; c++)
+		result[c] = 0.0f;
+
+	vec8i row0 = y0 * vec8i(w);
+	vec8i row1 = y1 * vec8i(w);
+
+	gather_texel(table, row0 + x0, (1.0f - tx) * (1.0f - ty), channels, result);
+	gather_texel(table, row0 + x1, tx * (1.0f - ty), channels, result);
+	gather_texel(table, row1 + x0, (1.0f - tx) * ty, channels, result);
+	gather_texel(table, row1 + x1, tx * ty, channels, result);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Adds weight * trilinear sample into result[0..channels).
+static void sample_3d_8(const float* table, int channels, int w, int h, int d, const vec8f& u, const vec8f& v, const vec8f& s, const vec8f& weight, vec8f* result)
+{
+	vec8i x0, x1, y0, y1, z0, z1;
+	vec8f tx, ty, tz;
+
+	texel_coords_8(u, w, x0, x1, tx);
+	texel_coords_8(v, h, y0, y1, ty);
+	texel_coords_8(s, d, z0, z1, tz);
+
+	vec8i rows[4] = { (z0 * vec8i(h) + y0) * vec8i(w),
+					  (z0 * vec8i(h) + y1) * vec8i(w),
+					  (z1 * vec8i(h) + y0) * vec8i(w),
+					  (z1 * vec8i(h) + y1) * vec8i(w) };
+
+	vec8f wy[2] = { 1.0f - ty, ty };
+	vec8f wz[2] = { (1.0f - tz) * weight, tz * weight };
+
+	for (int i = 0; i < 4; i++)
+	{
+		vec8f wyz = wy[i & 1] * wz[i >> 1];
+
+		gather_texel(table, rows[i] + x0, (1.0f - tx) * wyz, channels, result);
+		gather_texel(table, rows[i] + x1, tx * wyz, channels, result);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonLookup::BrunetonLookup()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonLookup::~BrunetonLookup()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonLookup::load(const std::string& transmittance, const std::string& irradiance, const std::string& inscatter)
+{
+	return read_table(transmittance, m_transmittance, TRANSMITTANCE_SIZE) &&
+		   read_table(irradiance, m_irradiance, IRRADIANCE_SIZE) &&
+		   read_table(inscatter, m_inscatter, INSCATTER_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonLookup::save(const std::string& transmittance, const std::string& irradiance, const std::string& inscatter, bool compressed) const
+{
+	if (!is_loaded())
+		return false;
+
+	// One chunk per 16 rows of the 2D tables and per r layer of inscatter, the unit of parallel decoding.
+	return write_table(transmittance, *m_transmittance, 4, TRANSMITTANCE_W * 16 * 4, compressed) &&
+		   write_table(irradiance, *m_irradiance, 4, IRRADIANCE_W * 16 * 4, compressed) &&
+		   write_table(inscatter, *m_inscatter, 4, size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * 4, compressed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonLookup::load_single_mie(const std::string& single_mie)
+{
+	m_single_mie.reset();
+
+	auto data = std::make_shared<std::vector<float>>(SINGLE_MIE_SIZE);
+
+	if (!table_read_file(single_mie, data->data(), SINGLE_MIE_SIZE))
+		return false;
+
+	quantize_r11g11b10(data->data(), SINGLE_MIE_SIZE / 3);
+	m_single_mie = data;
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonLookup::save_single_mie(const std::string& single_mie, bool compressed) const
+{
+	if (!m_single_mie)
+		return false;
+
+	return write_table(single_mie, *m_single_mie, 3, size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * 3, compressed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::set_single_mie(const float* data)
+{
+	if (data)
+		m_single_mie = std::make_shared<const std::vector<float>>(data, data + SINGLE_MIE_SIZE);
+	else
+		m_single_mie.reset();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::quantize_r11g11b10(float* rgb, size_t texels)
+{
+	for (size_t i = 0; i < texels; i++)
+	{
+		rgb[i * 3 + 0] = quantize_small_float(rgb[i * 3 + 0], 6);
+		rgb[i * 3 + 1] = quantize_small_float(rgb[i * 3 + 1], 6);
+		rgb[i * 3 + 2] = quantize_small_float(rgb[i * 3 + 2], 5);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::set_transmittance(const float* data)
+{
+	m_transmittance = std::make_shared<const std::vector<float>>(data, data + TRANSMITTANCE_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::set_irradiance(const float* data)
+{
+	m_irradiance = std::make_shared<const std::vector<float>>(data, data + IRRADIANCE_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::set_inscatter(const float* data)
+{
+	m_inscatter = std::make_shared<const std::vector<float>>(data, data + INSCATTER_SIZE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec4 BrunetonLookup::texture_4d(float r, float mu, float mu_s, float nu, glm::vec3* single_mie) const
+{
+	const float RES_R = float(INSCATTER_R);
+	const float RES_MU = float(INSCATTER_MU);
+	const float RES_MU_S = float(INSCATTER_MU_S);
+	const float RES_NU = float(INSCATTER_NU);
+
+	float H = sqrtf(Rt * Rt - Rg * Rg);
+	// r^2 - Rg^2 factored to avoid the catastrophic cancellation of the GLSL form in single precision.
+	float rho2 = std::max((r - Rg) * (r + Rg), 0.0f);
+	float rho = sqrtf(rho2);
+
+	float rmu = r * mu;
+	float delta = rmu * rmu - rho2;
+	glm::vec4 cst = rmu < 0.0f && delta > 0.0f ? glm::vec4(1.0f, 0.0f, 0.0f, 0.5f - 0.5f / RES_MU) : glm::vec4(-1.0f, H * H, H, 0.5f + 0.5f / RES_MU);
+	float u_r = 0.5f / RES_R + rho / H * (1.0f - 1.0f / RES_R);
+	float u_mu = cst.w + (rmu * cst.x + sqrtf(std::max(delta + cst.y, 0.0f))) / (rho + cst.z) * (0.5f - 1.0f / RES_MU);
+	float u_mu_s = 0.5f / RES_MU_S + (atanf(std::max(mu_s, -0.1975f) * tanf(1.26f * 1.1f)) / 1.1f + (1.0f - 0.26f)) * 0.5f * (1.0f - 1.0f / RES_MU_S);
+
+	float lep = (nu + 1.0f) / 2.0f * (RES_NU - 1.0f);
+	float u_nu = floorf(lep);
+	lep = lep - u_nu;
+
+	const int w = INSCATTER_MU_S * INSCATTER_NU;
+
+	if (single_mie && m_single_mie)
+	{
+		*single_mie = glm::vec3(sample_3d(m_single_mie->data(), 3, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s) / RES_NU, u_mu, u_r) * (1.0f - lep) +
+								sample_3d(m_single_mie->data(), 3, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s + 1.0f) / RES_NU, u_mu, u_r) * lep);
+	}
+
+	return sample_3d(m_inscatter->data(), 4, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s) / RES_NU, u_mu, u_r) * (1.0f - lep) +
+		   sample_3d(m_inscatter->data(), 4, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s + 1.0f) / RES_NU, u_mu, u_r) * lep;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::get_mie(const glm::vec4& ray_mie) const
+{
+	// approximated single Mie scattering (cf. approximate Cm in paragraph "Angular precision")
+	// rayMie.rgb=C*, rayMie.w=Cm,r
+	return glm::vec3(ray_mie) * ray_mie.w / std::max(ray_mie.r, 1e-4f) * (m_beta_r.r / m_beta_r);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float BrunetonLookup::phase_function_r(float mu) const
+{
+	return (3.0f / (16.0f * M_PI_F)) * (1.0f + mu * mu);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float BrunetonLookup::phase_function_m(float mu) const
+{
+	float g2 = m_mie_g * m_mie_g;
+	return 1.5f * 1.0f / (4.0f * M_PI_F) * (1.0f - g2) * powf(1.0f + g2 - 2.0f * m_mie_g * mu, -3.0f / 2.0f) * (1.0f + mu * mu) / (2.0f + g2);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::transmittance(float r, float mu) const
+{
+	// transmittance(=transparency) of atmosphere for infinite ray (r,mu)
+	// (mu=cos(view zenith angle)), intersections with ground ignored
+	float u_r = sqrtf(std::max((r - Rg) / (Rt - Rg), 0.0f));
+	float u_mu = atanf((mu + 0.15f) / (1.0f + 0.15f) * tanf(1.5f)) / 1.5f;
+
+	return glm::vec3(sample_2d(m_transmittance->data(), TRANSMITTANCE_W, TRANSMITTANCE_H, u_mu, u_r));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::transmittance_with_shadow(float r, float mu) const
+{
+	// transmittance(=transparency) of atmosphere for infinite ray (r,mu)
+	// (mu=cos(view zenith angle)), or zero if ray intersects ground
+	return mu < -sqrtf(1.0f - (Rg / r) * (Rg / r)) ? glm::vec3(0.0f) : transmittance(r, mu);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::irradiance(float r, float mu_s) const
+{
+	float u_r = (r - Rg) / (Rt - Rg);
+	float u_mu_s = (mu_s + 0.2f) / (1.0f + 0.2f);
+
+	return glm::vec3(sample_2d(m_irradiance->data(), IRRADIANCE_W, IRRADIANCE_H, u_mu_s, u_r));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::sun_radiance(const glm::vec3& world_pos) const
+{
+	glm::vec3 world_v = glm::normalize(world_pos + m_earth_pos); // vertical vector
+	float r = glm::length(world_pos + m_earth_pos);
+	float mu_s = glm::dot(world_v, m_sun_dir);
+
+	return transmittance_with_shadow(r, mu_s) * m_sun_intensity;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::sky_irradiance(float r, float mu_s) const
+{
+	return irradiance(r, mu_s) * m_sun_intensity;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::sky_irradiance(const glm::vec3& world_pos) const
+{
+	glm::vec3 world_v = glm::normalize(world_pos + m_earth_pos); // vertical vector
+	float r = glm::length(world_pos + m_earth_pos);
+	float mu_s = glm::dot(world_v, m_sun_dir);
+
+	return irradiance(r, mu_s) * m_sun_intensity;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 BrunetonLookup::sky_radiance(glm::vec3 camera, const glm::vec3& view_dir, glm::vec3& extinction) const
+{
+	// scattered sunlight between two points
+	// camera=observer
+	// viewdir=unit vector towards observed point
+	// sundir=unit vector towards the sun
+	// return scattered light
+
+	camera += m_earth_pos;
+
+	glm::vec3 result = glm::vec3(0.0f);
+	float r = glm::length(camera);
+	float r_mu = glm::dot(camera, view_dir);
+	float mu = r_mu / r;
+
+	float delta_sq = sqrtf(std::max(r_mu * r_mu - r * r + Rt * Rt, 0.0f));
+	float din = std::max(-r_mu - delta_sq, 0.0f);
+
+	if (din > 0.0f)
+	{
+		camera += din * view_dir;
+		r_mu += din;
+		mu = r_mu / Rt;
+		r = Rt;
+	}
+
+	float nu = glm::dot(view_dir, m_sun_dir);
+	float mu_s = glm::dot(camera, m_sun_dir) / r;
+
+	glm::vec3 single_mie;
+	glm::vec4 in_scatter = texture_4d(r, r_mu / r, mu_s, nu, &single_mie);
+	extinction = transmittance(r, mu);
+
+	if (r <= Rt)
+	{
+		glm::vec3 in_scatter_m = m_single_mie ? single_mie : get_mie(in_scatter);
+		float phase = phase_function_r(nu);
+		float phase_m = phase_function_m(nu);
+		result = glm::vec3(in_scatter) * phase + in_scatter_m * phase_m;
+	}
+	else
+	{
+		result = glm::vec3(0.0f);
+		extinction = glm::vec3(1.0f);
+	}
+
+	return result * m_sun_intensity;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::texture_4d_8(const vec8f& r, const vec8f& mu, const vec8f& mu_s, const vec8f& nu, vec8f* result, vec8f* single_mie) const
+{
+	const float RES_R = float(INSCATTER_R);
+	const float RES_MU = float(INSCATTER_MU);
+	const float RES_MU_S = float(INSCATTER_MU_S);
+	const float RES_NU = float(INSCATTER_NU);
+
+	const float H = sqrtf(Rt * Rt - Rg * Rg);
+	vec8f rho2 = max((r - Rg) * (r + Rg), 0.0f);
+	vec8f rho = sqrt(rho2);
+
+	vec8f rmu = r * mu;
+	vec8f delta = rmu * rmu - rho2;
+	vec8b below = (rmu < 0.0f) & (delta > 0.0f);
+
+	vec8f cst_x = select(below, vec8f(1.0f), vec8f(-1.0f));
+	vec8f cst_y = select(below, vec8f(0.0f), vec8f(H * H));
+	vec8f cst_z = select(below, vec8f(0.0f), vec8f(H));
+	vec8f cst_w = select(below, vec8f(0.5f - 0.5f / RES_MU), vec8f(0.5f + 0.5f / RES_MU));
+
+	vec8f u_r = 0.5f / RES_R + rho / H * (1.0f - 1.0f / RES_R);
+	vec8f u_mu = cst_w + (rmu * cst_x + sqrt(max(delta + cst_y, 0.0f))) / (rho + cst_z) * (0.5f - 1.0f / RES_MU);
+	vec8f u_mu_s = 0.5f / RES_MU_S + (atan(max(mu_s, -0.1975f) * tanf(1.26f * 1.1f)) / 1.1f + (1.0f - 0.26f)) * 0.5f * (1.0f - 1.0f / RES_MU_S);
+
+	vec8f lep = (nu + 1.0f) / 2.0f * (RES_NU - 1.0f);
+	vec8f u_nu = floor(lep);
+	lep = lep - u_nu;
+
+	const int w = INSCATTER_MU_S * INSCATTER_NU;
+
+	for (int c = 0; c < 4; c++)
+		result[c] = 0.0f;
+
+	sample_3d_8(m_inscatter->data(), 4, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s) / RES_NU, u_mu, u_r, 1.0f - lep, result);
+	sample_3d_8(m_inscatter->data(), 4, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s + 1.0f) / RES_NU, u_mu, u_r, lep, result);
+
+	if (single_mie && m_single_mie)
+	{
+		for (int c = 0; c < 3; c++)
+			single_mie[c] = 0.0f;
+
+		sample_3d_8(m_single_mie->data(), 3, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s) / RES_NU, u_mu, u_r, 1.0f - lep, single_mie);
+		sample_3d_8(m_single_mie->data(), 3, w, INSCATTER_MU, INSCATTER_R, (u_nu + u_mu_s + 1.0f) / RES_NU, u_mu, u_r, lep, single_mie);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::transmittance_8(const vec8f& r, const vec8f& mu, vec8f* result) const
+{
+	vec8f u_r = sqrt(max((r - Rg) / (Rt - Rg), 0.0f));
+	vec8f u_mu = atan((mu + 0.15f) / (1.0f + 0.15f) * tanf(1.5f)) / 1.5f;
+
+	sample_2d_8(m_transmittance->data(), TRANSMITTANCE_W, TRANSMITTANCE_H, u_mu, u_r, 3, result);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::sky_radiance_8(const vec8f* camera_in, const vec8f* view_dir, vec8f* radiance, vec8f* extinction) const
+{
+	vec8f camera[3] = { camera_in[0] + m_earth_pos.x, camera_in[1] + m_earth_pos.y, camera_in[2] + m_earth_pos.z };
+
+	vec8f r = sqrt(camera[0] * camera[0] + camera[1] * camera[1] + camera[2] * camera[2]);
+	vec8f r_mu = camera[0] * view_dir[0] + camera[1] * view_dir[1] + camera[2] * view_dir[2];
+	vec8f mu = r_mu / r;
+
+	vec8f delta_sq = sqrt(max(r_mu * r_mu - r * r + Rt * Rt, 0.0f));
+	vec8f din = max(-r_mu - delta_sq, 0.0f);
+	vec8b outside = din > 0.0f;
+
+	for (int i = 0; i < 3; i++)
+		camera[i] = camera[i] + din * view_dir[i];
+
+	r_mu = r_mu + din;
+	mu = select(outside, r_mu / Rt, mu);
+	r = select(outside, vec8f(Rt), r);
+
+	vec8f nu = view_dir[0] * m_sun_dir.x + view_dir[1] * m_sun_dir.y + view_dir[2] * m_sun_dir.z;
+	vec8f mu_s = (camera[0] * m_sun_dir.x + camera[1] * m_sun_dir.y + camera[2] * m_sun_dir.z) / r;
+
+	vec8f in_scatter[4];
+	vec8f single_mie[3];
+	texture_4d_8(r, r_mu / r, mu_s, nu, in_scatter, single_mie);
+	transmittance_8(r, mu, extinction);
+
+	vec8f phase = (3.0f / (16.0f * M_PI_F)) * (1.0f + nu * nu);
+
+	const float g = m_mie_g;
+	const float g2 = g * g;
+	vec8f phase_m = 1.5f * 1.0f / (4.0f * M_PI_F) * (1.0f - g2) * pow(1.0f + g2 - 2.0f * g * nu, -3.0f / 2.0f) * (1.0f + nu * nu) / (2.0f + g2);
+
+	// GetMie(): rayMie.rgb * rayMie.w / max(rayMie.r, 1e-4) * (betaR.r / betaR)
+	vec8f mie_scale = in_scatter[3] / max(in_scatter[0], 1e-4f) * phase_m;
+	vec8b inside = r <= Rt;
+
+	for (int i = 0; i < 3; i++)
+	{
+		vec8f mie = m_single_mie ? single_mie[i] * phase_m : in_scatter[i] * mie_scale * (m_beta_r.r / m_beta_r[i]);
+		vec8f result = in_scatter[i] * phase + mie;
+
+		radiance[i] = select(inside, result * m_sun_intensity, vec8f(0.0f));
+		extinction[i] = select(inside, extinction[i], vec8f(1.0f));
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonLookup::sky_radiance(size_t count, const glm::vec3* camera, const glm::vec3* view_dir, glm::vec3* radiance, glm::vec3* extinction) const
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		float soa[6][8];
+
+		for (int j = 0; j < 8; j++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				soa[c][j] = camera[i + j][c];
+				soa[3 + c][j] = view_dir[i + j][c];
+			}
+		}
+
+		vec8f c8[3] = { load8(soa[0]), load8(soa[1]), load8(soa[2]) };
+		vec8f v8[3] = { load8(soa[3]), load8(soa[4]), load8(soa[5]) };
+		vec8f l8[3];
+		vec8f e8[3];
+
+		sky_radiance_8(c8, v8, l8, e8);
+
+		for (int c = 0; c < 3; c++)
+		{
+			store8(soa[c], l8[c]);
+			store8(soa[3 + c], e8[c]);
+		}
+
+		for (int j = 0; j < 8; j++)
+		{
+			radiance[i + j] = glm::vec3(soa[0][j], soa[1][j], soa[2][j]);
+
+			if (extinction)
+				extinction[i + j] = glm::vec3(soa[3][j], soa[4][j], soa[5][j]);
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		glm::vec3 e;
+		radiance[i] = sky_radiance(camera[i], view_dir[i], e);
+
+		if (extinction)
+			extinction[i] = e;
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glm.hpp>
+#include <memory>
+#include <vector>
+#include <string>
+#include <stddef.h>
+
+#include "simd.h"
+
+// CPU port of the runtime lookups in shader/sky_models/bruneton/atmosphere.glsl. Holds the precomputed
+// transmittance, irradiance and inscatter tables in memory and samples them with the same bilinear/trilinear
+// filtering the GPU applies, so path tracers, probe bakers and validation tools get the same sky as the shader.
+// The tables are immutable once set and shared between copies, so copying a lookup to change its sun or scattering
+// parameters is cheap.
+class BrunetonLookup
+{
+public:
+	// Table dimensions, these have to match the ones used to precompute the tables.
+	static const int TRANSMITTANCE_W = 256;
+	static const int TRANSMITTANCE_H = 64;
+
+	static const int IRRADIANCE_W = 64;
+	static const int IRRADIANCE_H = 16;
+
+	static const int INSCATTER_R = 32;
+	static const int INSCATTER_MU = 128;
+	static const int INSCATTER_MU_S = 32;
+	static const int INSCATTER_NU = 8;
+
+	BrunetonLookup();
+	~BrunetonLookup();
+
+	// Reads the RGBA32F tables written by BrunetonSkyModel, raw or compressed with table_codec.h (detected per file).
+	bool load(const std::string& transmittance, const std::string& irradiance, const std::string& inscatter);
+
+	// Writes the tables raw or compressed. Compressed files are a fraction of the size and decode in parallel, so
+	// loading them is faster than reading the raw floats unless the files are already in the page cache.
+	bool save(const std::string& transmittance, const std::string& irradiance, const std::string& inscatter, bool compressed) const;
+
+	// Optional RGB single Mie scattering table (INSCATTER dimensions, 3 floats per texel). With it sky_radiance()
+	// samples Mie scattering directly instead of reconstructing it from the red channel in the inscatter alpha
+	// (GetMie()), which gets the color wrong where Mie scattering dominates, around the sun. load_single_mie()
+	// quantizes to R11F_G11F_B10F like the GPU texture, set_single_mie() takes the data as is (nullptr drops it).
+	bool load_single_mie(const std::string& single_mie);
+	bool save_single_mie(const std::string& single_mie, bool compressed) const;
+	void set_single_mie(const float* data);
+
+	// Rounds RGB floats to the precision of R11F_G11F_B10F (6, 6 and 5 bit mantissas, no sign).
+	static void quantize_r11g11b10(float* rgb, size_t texels);
+
+	void set_transmittance(const float* data);
+	void set_irradiance(const float* data);
+	void set_inscatter(const float* data);
+
+	inline bool is_loaded() const { return m_transmittance && m_irradiance && m_inscatter; }
+	inline bool has_single_mie() const { return m_single_mie != nullptr; }
+
+	// Direction towards the sun.
+	inline void set_sun_direction(const glm::vec3& dir) { m_sun_dir = dir; }
+	inline void set_sun_intensity(float intensity) { m_sun_intensity = intensity; }
+	inline void set_earth_position(const glm::vec3& pos) { m_earth_pos = pos; }
+	inline void set_beta_r(const glm::vec3& beta_r) { m_beta_r = beta_r; }
+	inline void set_mie_g(float g) { m_mie_g = g; }
+
+	inline glm::vec3 sun_direction() const { return m_sun_dir; }
+	inline float sun_intensity() const { return m_sun_intensity; }
+
+	glm::vec3 transmittance(float r, float mu) const;
+	glm::vec3 transmittance_with_shadow(float r, float mu) const;
+	glm::vec3 irradiance(float r, float mu_s) const;
+	glm::vec3 sun_radiance(const glm::vec3& world_pos) const;
+	glm::vec3 sky_irradiance(float r, float mu_s) const;
+	glm::vec3 sky_irradiance(const glm::vec3& world_pos) const;
+	glm::vec3 sky_radiance(glm::vec3 camera, const glm::vec3& view_dir, glm::vec3& extinction) const;
+
+	// Batched SkyRadiance. Full groups of 8 rays go through sky_radiance_8, the remainder through the scalar path.
+	// extinction may be null.
+	void sky_radiance(size_t count, const glm::vec3* camera, const glm::vec3* view_dir, glm::vec3* radiance, glm::vec3* extinction) const;
+
+	// SkyRadiance for 8 rays at once, in structure-of-arrays form (x, y, z).
+	void sky_radiance_8(const vec8f* camera, const vec8f* view_dir, vec8f* radiance, vec8f* extinction) const;
+
+	inline const float* transmittance_data() const { return m_transmittance->data(); }
+	inline const float* irradiance_data() const { return m_irradiance->data(); }
+	inline const float* inscatter_data() const { return m_inscatter->data(); }
+	inline const float* single_mie_data() const { return m_single_mie->data(); }
+
+private:
+	// Samples inscatter, and the single Mie table into single_mie if there is one.
+	glm::vec4 texture_4d(float r, float mu, float mu_s, float nu, glm::vec3* single_mie) const;
+	glm::vec3 get_mie(const glm::vec4& ray_mie) const;
+	float phase_function_r(float mu) const;
+	float phase_function_m(float mu) const;
+
+	void texture_4d_8(const vec8f& r, const vec8f& mu, const vec8f& mu_s, const vec8f& nu, vec8f* result, vec8f* single_mie) const;
+	void transmittance_8(const vec8f& r, const vec8f& mu, vec8f* result) const;
+
+private:
+	std::shared_ptr<const std::vector<float>> m_transmittance;
+	std::shared_ptr<const std::vector<float>> m_irradiance;
+	std::shared_ptr<const std::vector<float>> m_inscatter;
+	std::shared_ptr<const std::vector<float>> m_single_mie;
+
+	glm::vec3 m_sun_dir = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 m_earth_pos = glm::vec3(0.0f, 6360010.0f, 0.0f);
+	glm::vec3 m_beta_r = glm::vec3(0.0058f, 0.0135f, 0.0331f) / 1000.0f;
+	float m_sun_intensity = 100.0f;
+	float m_mie_g = 0.75f;
+};
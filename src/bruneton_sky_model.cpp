@@ -1,528 +1,180 @@
 #include "bruneton_sky_model.h"
-#include <macros.h>
-#include <utility.h>
-#include <logger.h>
-#include <stdio.h>
+#include "simd.h"
+#include <string.h>
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-BrunetonSkyModel::BrunetonSkyModel()
+// Only the cache of the current TABLE_VERSION. The fixed names earlier builds wrote the default atmosphere to aren't
+// read any more, those tables summed the scattering orders wrongly (see BrunetonSkyModelGL::precompute()).
+bool BrunetonSkyModel::load_cache(BrunetonLookup& lookup, const BrunetonAtmosphere& atmosphere, Quality quality, const std::string& directory, const char* extension)
 {
-	m_transmittance_t = nullptr;
-    m_irradiance_t[0] = nullptr;
-    m_irradiance_t[1] = nullptr;
-    m_inscatter_t[0] = nullptr;
-    m_inscatter_t[1] = nullptr;
-    m_delta_et = nullptr;
-    m_delta_srt = nullptr;
-    m_delta_smt = nullptr;
-    m_delta_jt = nullptr;
-}
+	std::string prefix = directory.empty() ? std::string() : directory + "/";
 
-// -----------------------------------------------------------------------------------------------------------------------------------
+	lookup.set_single_mie(nullptr);
 
-BrunetonSkyModel::~BrunetonSkyModel()
-{
-	DW_SAFE_DELETE(m_copy_inscatter_1_program);
-	DW_SAFE_DELETE(m_copy_inscatter_n_program);
-	DW_SAFE_DELETE(m_copy_irradiance_program);
-	DW_SAFE_DELETE(m_inscatter_1_program);
-	DW_SAFE_DELETE(m_inscatter_n_program);
-	DW_SAFE_DELETE(m_inscatter_s_program);
-	DW_SAFE_DELETE(m_irradiance_1_program);
-	DW_SAFE_DELETE(m_irradiance_n_program);
-	DW_SAFE_DELETE(m_transmittance_program);
-
-	DW_SAFE_DELETE(m_copy_inscatter_1_cs);
-	DW_SAFE_DELETE(m_copy_inscatter_n_cs);
-	DW_SAFE_DELETE(m_copy_irradiance_cs);
-	DW_SAFE_DELETE(m_inscatter_1_cs);
-	DW_SAFE_DELETE(m_inscatter_n_cs);
-	DW_SAFE_DELETE(m_inscatter_s_cs);
-	DW_SAFE_DELETE(m_irradiance_1_cs);
-	DW_SAFE_DELETE(m_irradiance_n_cs);
-	DW_SAFE_DELETE(m_transmittance_cs);
-
-	DW_SAFE_DELETE(m_transmittance_t);
-    DW_SAFE_DELETE(m_delta_et);
-    DW_SAFE_DELETE(m_delta_srt);
-    DW_SAFE_DELETE(m_delta_smt);
-    DW_SAFE_DELETE(m_delta_jt);
-    DW_SAFE_DELETE(m_irradiance_t[0]);
-    DW_SAFE_DELETE(m_irradiance_t[0]);
-    DW_SAFE_DELETE(m_inscatter_t[0]);
-    DW_SAFE_DELETE(m_inscatter_t[1]);
+	if (!lookup.load(prefix + atmosphere.cache_path("transmittance", extension), prefix + atmosphere.cache_path("irradiance", extension),
+					 prefix + atmosphere.cache_path("inscatter", extension)))
+		return false;
+
+	return quality == QUALITY_LOW || lookup.load_single_mie(prefix + atmosphere.cache_path("single_mie", extension));
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-bool BrunetonSkyModel::initialize()
+BrunetonSkyModel::BrunetonSkyModel() : m_load_finished(false)
 {
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/copy_inscatter_1_cs.glsl", &m_copy_inscatter_1_cs, &m_copy_inscatter_1_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/copy_inscatter_n_cs.glsl", &m_copy_inscatter_n_cs, &m_copy_inscatter_n_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/copy_irradiance_cs.glsl", &m_copy_irradiance_cs, &m_copy_irradiance_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/inscatter_1_cs.glsl", &m_inscatter_1_cs, &m_inscatter_1_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/inscatter_n_cs.glsl", &m_inscatter_n_cs, &m_inscatter_n_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/inscatter_s_cs.glsl", &m_inscatter_s_cs, &m_inscatter_s_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/irradiance_1_cs.glsl", &m_irradiance_1_cs, &m_irradiance_1_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/irradiance_n_cs.glsl", &m_irradiance_n_cs, &m_irradiance_n_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	if (!dw::utility::create_compute_program("shader/sky_models/bruneton/transmittance_cs.glsl", &m_transmittance_cs, &m_transmittance_program))
-		DW_LOG_ERROR("Failed to load shaders");
-
-	m_transmittance_t = new_texture_2d(TRANSMITTANCE_W, TRANSMITTANCE_H);
-
-    m_irradiance_t[0] = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
-    m_irradiance_t[1] = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
-
-    m_inscatter_t[0] = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
-    m_inscatter_t[1] = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
 
-    m_delta_et = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
-    m_delta_srt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
-    m_delta_smt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
-    m_delta_jt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
-
-    if (!load_cached_textures())
-        precompute();
-
-    return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::update()
+BrunetonSkyModel::~BrunetonSkyModel()
 {
-
+	if (m_load_thread.joinable())
+		m_load_thread.join();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::set_render_uniforms(dw::Program* program)
+bool BrunetonSkyModel::initialize()
 {
-	program->set_uniform("betaR", m_beta_r / SCALE);
-    program->set_uniform("mieG", m_mie_g);
-	program->set_uniform("SUN_INTENSITY", m_sun_intensity);
-	program->set_uniform("EARTH_POS", glm::vec3(0.0f, 6360010.0f, 0.0f));
-	program->set_uniform("SUN_DIR", m_direction * 1.0f);
-
-	if (program->set_uniform("s_Transmittance", 0))
-		m_transmittance_t->bind(0);
+	if (!load_cache(m_lookup, m_atmosphere, m_quality))
+		return false;
 
-	if (program->set_uniform("s_Irradiance", 1))
-		m_irradiance_t[READ]->bind(1);
+	// States published before the tables were loaded evaluate to black.
+	mark_dirty();
 
-	if (program->set_uniform("s_Inscatter", 2))
-		m_inscatter_t[READ]->bind(2);
+	return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::set_uniforms(dw::Program* program)
+void BrunetonSkyModel::begin_load()
 {
-	program->set_uniform("Rg", Rg);
-	program->set_uniform("Rt", Rt);
-	program->set_uniform("RL", RL);
-	program->set_uniform("TRANSMITTANCE_W", TRANSMITTANCE_W);
-	program->set_uniform("TRANSMITTANCE_H", TRANSMITTANCE_H);
-	program->set_uniform("SKY_W", IRRADIANCE_W);
-	program->set_uniform("SKY_H", IRRADIANCE_H);
-	program->set_uniform("RES_R", INSCATTER_R);
-	program->set_uniform("RES_MU", INSCATTER_MU);
-	program->set_uniform("RES_MU_S", INSCATTER_MU_S);
-	program->set_uniform("RES_NU", INSCATTER_NU);
-	program->set_uniform("AVERAGE_GROUND_REFLECTANCE", AVERAGE_GROUND_REFLECTANCE);
-	program->set_uniform("HR", HR);
-	program->set_uniform("HM", HM);
-	program->set_uniform("betaR", BETA_R);
-	program->set_uniform("betaMSca", BETA_MSca);
-	program->set_uniform("betaMEx", BETA_MEx);
-	program->set_uniform("mieG", glm::clamp(MIE_G, 0.0f, 0.99f));
+	if (m_load_status == LOAD_PENDING)
+		return;
+
+	m_load_status = LOAD_PENDING;
+	m_load_finished = false;
+
+	m_load_thread = std::thread([this, atmosphere = m_atmosphere, quality = m_quality]() {
+		m_pending_loaded = load_cache(m_pending_lookup, atmosphere, quality);
+		m_load_finished.store(true, std::memory_order_release);
+	});
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-bool BrunetonSkyModel::load_cached_textures()
+BrunetonSkyModel::LoadStatus BrunetonSkyModel::poll_load()
 {
-	FILE* transmittance = fopen("transmittance.raw", "r");
+	if (m_load_status != LOAD_PENDING || !m_load_finished.load(std::memory_order_acquire))
+		return m_load_status;
 
-	if (transmittance)
-	{
-		size_t n = sizeof(float) * TRANSMITTANCE_W * TRANSMITTANCE_H * 4;
-
-		void* data = malloc(n);
-		fread(data, n, 1, transmittance);
-
-		m_transmittance_t->set_data(0, 0, data);
+	m_load_thread.join();
 
-		fclose(transmittance);
-		free(data);
+	if (m_pending_loaded)
+	{
+		// Only the tables are taken over, update_parameters() sets the rest on the next update.
+		m_lookup = m_pending_lookup;
+		m_load_status = LOAD_COMPLETE;
+		mark_dirty();
 	}
 	else
-		return false;
+		m_load_status = LOAD_FAILED;
 
-    FILE* irradiance = fopen("irradiance.raw", "r");
+	m_pending_lookup = BrunetonLookup();
 
-    if (irradiance)
-    {
-        size_t n = sizeof(float) * IRRADIANCE_W * IRRADIANCE_H * 4;
-
-        void* data = malloc(n);
-		fread(data, n, 1, irradiance);
-
-        m_irradiance_t[READ]->set_data(0, 0, data);
-
-        fclose(irradiance);
-        free(data);
-    }
-	else
-		return false;
-
-    FILE* inscatter = fopen("inscatter.raw", "r");
-
-    if (inscatter)
-    {
-        size_t n = sizeof(float) * INSCATTER_MU_S * INSCATTER_NU * INSCATTER_MU * INSCATTER_R * 4;
-
-        void* data = malloc(n);
-		fread(data, n, 1, inscatter);
-
-        m_inscatter_t[READ]->set_data(0, data);
-
-        fclose(inscatter);
-        free(data);
-    }
-	else
-		return false;
-
-    return true;
+	return m_load_status;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::write_textures()
+void BrunetonSkyModel::update_parameters()
 {
-	{
-		FILE* transmittance = fopen("transmittance.raw", "wb");
-	
-		size_t n = sizeof(float) * TRANSMITTANCE_W * TRANSMITTANCE_H * 4;
-		void* data = malloc(n);
-
-		m_transmittance_t->data(0, 0, data);
-
-		fwrite(data, n, 1, transmittance);
-
-		fclose(transmittance);
-		free(data);
-	}
-
-	{
-		FILE* irradiance = fopen("irradiance.raw", "wb");
-	
-		size_t n = sizeof(float) * IRRADIANCE_W * IRRADIANCE_H * 4;
-		void* data = malloc(n);
-
-		m_irradiance_t[READ]->data(0, 0, data);
-
-		fwrite(data, n, 1, irradiance);
-
-		fclose(irradiance);
-		free(data);
-	}
-
-	{
-		FILE* inscatter = fopen("inscatter.raw", "wb");
-	
-		size_t n = sizeof(float) * INSCATTER_MU_S * INSCATTER_NU * INSCATTER_MU * INSCATTER_R * 4;
-		void* data = malloc(n);
-
-		m_inscatter_t[READ]->data(0, data);
-
-		fwrite(data, n, 1, inscatter);
-
-		fclose(inscatter);
-		free(data);
-	}
+	m_lookup.set_sun_direction(m_direction);
+	m_lookup.set_sun_intensity(m_sun_intensity);
+	m_lookup.set_beta_r(m_atmosphere.beta_r / SCALE);
+	m_lookup.set_mie_g(mie_g());
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::precompute()
+void BrunetonSkyModel::write_uniforms(SkyUniforms& uniforms)
 {
-	// -----------------------------------------------------------------------------
-    // 1. Compute Transmittance Texture T
-    // -----------------------------------------------------------------------------
-
-    m_transmittance_program->use();
-    set_uniforms(m_transmittance_program);
-
-    m_transmittance_t->bind_image(0, 0, 0, GL_READ_WRITE, m_transmittance_t->internal_format());
-
-    GL_CHECK_ERROR(glDispatchCompute(TRANSMITTANCE_W/NUM_THREADS, TRANSMITTANCE_H/NUM_THREADS, 1));
-	GL_CHECK_ERROR(glFinish());
-
-    // -----------------------------------------------------------------------------
-    // 2. Compute Irradiance Texture deltaE
-    // -----------------------------------------------------------------------------
-
-    m_irradiance_1_program->use();
-    set_uniforms(m_irradiance_1_program);
-
-	m_delta_et->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_et->internal_format());
-
-	if (m_irradiance_1_program->set_uniform("s_TransmittanceRead", 0))
-		m_transmittance_t->bind(0);
-
-    GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
-	GL_CHECK_ERROR(glFinish());
-
-    // -----------------------------------------------------------------------------
-    // 3. Compute Single Scattering Texture
-    // -----------------------------------------------------------------------------
-
-    m_inscatter_1_program->use();
-    set_uniforms(m_inscatter_1_program);
-
-	m_delta_srt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_srt->internal_format());
-    m_delta_smt->bind_image(1, 0, 0, GL_READ_WRITE, m_delta_smt->internal_format());
-
-	if (m_inscatter_1_program->set_uniform("s_TransmittanceRead", 0))
-		m_transmittance_t->bind(0);
-
-    for (int i = 0; i < INSCATTER_R; i++) 
-    {
-	    m_inscatter_1_program->set_uniform("u_Layer", i);
-		GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
-        GL_CHECK_ERROR(glFinish());
-	}
-
-    // -----------------------------------------------------------------------------
-    // 4. Copy deltaE into Irradiance Texture E 
-    // -----------------------------------------------------------------------------
-
-    m_copy_irradiance_program->use();
-    set_uniforms(m_copy_irradiance_program);
-
-    m_copy_irradiance_program->set_uniform("u_K", 0.0f);
-
-    m_irradiance_t[WRITE]->bind_image(0, 0, 0, GL_READ_WRITE, m_irradiance_t[WRITE]->internal_format());
-
-	if (m_copy_irradiance_program->set_uniform("s_DeltaERead", 0))
-		m_delta_et->bind(0);
-
-	if (m_copy_irradiance_program->set_uniform("s_IrradianceRead", 1))
-		m_irradiance_t[READ]->bind(1);
-
-    GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
-	GL_CHECK_ERROR(glFinish());
-
-    for (int order = 2; order < 4; order++)
-    {
-        // -----------------------------------------------------------------------------
-        // 5. Copy deltaS into Inscatter Texture S 
-        // -----------------------------------------------------------------------------
-
-        m_copy_inscatter_1_program->use();
-        set_uniforms(m_copy_inscatter_1_program);
-
-        m_inscatter_t[WRITE]->bind_image(0, 0, 0, GL_READ_WRITE, m_inscatter_t[WRITE]->internal_format());
-
-		if (m_copy_inscatter_1_program->set_uniform("s_DeltaSRRead", 0))
-			m_delta_srt->bind(0);
-
-		if (m_copy_inscatter_1_program->set_uniform("s_DeltaSMRead", 1))
-			m_delta_smt->bind(1);
-
-        for (int i = 0; i < INSCATTER_R; i++) 
-        {
-            m_copy_inscatter_1_program->set_uniform("u_Layer", i);
-            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
-            GL_CHECK_ERROR(glFinish());
-        }
-
-        swap(m_inscatter_t);
-
-        // -----------------------------------------------------------------------------
-        // 6. Compute deltaJ
-        // -----------------------------------------------------------------------------
-
-        m_inscatter_s_program->use();
-        set_uniforms(m_inscatter_s_program);
-
-        m_inscatter_s_program->set_uniform("first", (order == 2) ? 1 : 0);
-
-		m_delta_jt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_jt->internal_format());
-
-		if (m_inscatter_s_program->set_uniform("s_TransmittanceRead", 0))
-			m_transmittance_t->bind(0);
-
-		if (m_inscatter_s_program->set_uniform("s_DeltaERead", 1))
-			m_delta_et->bind(1);
-
-		if (m_inscatter_s_program->set_uniform("s_DeltaSRRead", 2))
-			m_delta_srt->bind(2);
-
-		if (m_inscatter_s_program->set_uniform("s_DeltaSMRead", 3))
-			m_delta_smt->bind(3);
-        
-        for (int i = 0; i < INSCATTER_R; i++) 
-        {
-            m_inscatter_s_program->set_uniform("u_Layer", i);
-            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
-            GL_CHECK_ERROR(glFinish());
-        }
-
-        // -----------------------------------------------------------------------------
-        // 7. Compute deltaE
-        // -----------------------------------------------------------------------------
-
-        m_irradiance_n_program->use();
-        set_uniforms(m_irradiance_n_program);
-
-        m_irradiance_n_program->set_uniform("first", (order == 2) ? 1 : 0);
-
-		m_delta_et->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_et->internal_format());
-
-		if (m_irradiance_n_program->set_uniform("s_DeltaSRRead", 0))
-			m_delta_srt->bind(0);
-
-		if (m_irradiance_n_program->set_uniform("s_DeltaSMRead", 1))
-			m_delta_smt->bind(1);
-
-        GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
-        GL_CHECK_ERROR(glFinish());
-
-        // -----------------------------------------------------------------------------
-        // 8. Compute deltaS
-        // -----------------------------------------------------------------------------
-
-        m_inscatter_n_program->use();
-        set_uniforms(m_inscatter_n_program);
-
-        m_inscatter_n_program->set_uniform("first", (order == 2) ? 1 : 0);
-
-		m_delta_srt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_srt->internal_format());
-
-		if (m_inscatter_n_program->set_uniform("s_TransmittanceRead", 0))
-			m_transmittance_t->bind(0);
-
-		if (m_inscatter_n_program->set_uniform("s_DeltaJRead", 1))
-			m_delta_jt->bind(1);
-
-        for (int i = 0; i < INSCATTER_R; i++) 
-        {
-            m_inscatter_n_program->set_uniform("u_Layer", i);
-            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
-            GL_CHECK_ERROR(glFinish());
-        }
-
-        // -----------------------------------------------------------------------------
-        // 9. Adds deltaE into Irradiance Texture E
-        // -----------------------------------------------------------------------------
-
-        m_copy_irradiance_program->use();
-        set_uniforms(m_copy_irradiance_program);
-
-        m_copy_irradiance_program->set_uniform("u_K", 1.0f);
-
-		m_irradiance_t[WRITE]->bind_image(0, 0, 0, GL_READ_WRITE, m_irradiance_t[WRITE]->internal_format());
-
-		if (m_copy_irradiance_program->set_uniform("s_DeltaERead", 0))
-			m_delta_et->bind(0);
-
-		if (m_copy_irradiance_program->set_uniform("s_IrradianceRead", 1))
-			m_irradiance_t[READ]->bind(1);
-
-        GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
-        GL_CHECK_ERROR(glFinish());
-
-        swap(m_irradiance_t);
-
-        // -----------------------------------------------------------------------------
-        // 10. Adds deltaS into Inscatter Texture S
-        // -----------------------------------------------------------------------------
-
-        m_copy_inscatter_n_program->use();
-        set_uniforms(m_copy_inscatter_n_program);
-
-		m_inscatter_t[WRITE]->bind_image(0, 0, 0, GL_READ_WRITE, m_inscatter_t[WRITE]->internal_format());
-
-		if (m_copy_inscatter_n_program->set_uniform("s_InscatterRead", 0))
-			m_inscatter_t[READ]->bind(0);
-
-		if (m_copy_inscatter_n_program->set_uniform("s_DeltaSRead", 1))
-			m_delta_srt->bind(1);
-
-        for (int i = 0; i < INSCATTER_R; i++) 
-        {
-            m_copy_inscatter_n_program->set_uniform("u_Layer", i);
-            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
-            GL_CHECK_ERROR(glFinish());
-        }
+	uniforms.set("betaR", m_atmosphere.beta_r / SCALE);
+	uniforms.set("mieG", mie_g());
+	uniforms.set("SUN_INTENSITY", m_sun_intensity);
+	uniforms.set("EARTH_POS", glm::vec3(0.0f, 6360010.0f, 0.0f));
+	uniforms.set("SUN_DIR", m_direction * 1.0f);
+}
 
-        swap(m_inscatter_t);
-    }
+// -----------------------------------------------------------------------------------------------------------------------------------
 
-    // -----------------------------------------------------------------------------
-    // 11. Save to disk
-    // -----------------------------------------------------------------------------
+glm::vec3 BrunetonSkyModel::sun_radiance(float altitude) const
+{
+	if (!m_lookup.is_loaded())
+		return glm::vec3(0.0f);
 
-	write_textures();
+	// SunRadiance() of atmosphere.glsl straight above EARTH_POS, from the CPU copy of the transmittance table.
+	return m_lookup.transmittance_with_shadow(6360010.0f + altitude, m_direction.y) * m_sun_intensity;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-dw::Texture2D* BrunetonSkyModel::new_texture_2d(int width, int height)
+std::shared_ptr<const SkyState::Evaluator> BrunetonSkyModel::create_evaluator() const
 {
-	dw::Texture2D* texture = new dw::Texture2D(width, height, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-    texture->set_min_filter(GL_LINEAR);
-	texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
-
-	return texture;
+	// The copy shares the tables, only the scattering parameters are duplicated.
+	return std::make_shared<BrunetonSkyState>(m_lookup);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-dw::Texture3D* BrunetonSkyModel::new_texture_3d(int width, int height, int depth)
+BrunetonSkyState::BrunetonSkyState(const BrunetonLookup& lookup) : m_lookup(lookup)
 {
-	dw::Texture3D* texture = new dw::Texture3D(width, height, depth, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-    texture->set_min_filter(GL_LINEAR);
-    texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
-    return texture;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::swap(dw::Texture2D** arr)
+glm::vec3 BrunetonSkyState::radiance(const glm::vec3& dir) const
 {
-	dw::Texture2D* tmp = arr[READ];
-    arr[READ] = arr[WRITE];
-    arr[WRITE] = tmp;
+	if (!m_lookup.is_loaded())
+		return glm::vec3(0.0f);
+
+	glm::vec3 extinction;
+	return m_lookup.sky_radiance(glm::vec3(0.0f), dir, extinction);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void BrunetonSkyModel::swap(dw::Texture3D** arr)
+void BrunetonSkyState::radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const
 {
-	dw::Texture3D* tmp = arr[READ];
-    arr[READ] = arr[WRITE];
-    arr[WRITE] = tmp;
+	float* out[3] = { r, g, b };
+	size_t i = 0;
+
+	if (!m_lookup.is_loaded())
+	{
+		for (int c = 0; c < 3; c++)
+			memset(out[c], 0, sizeof(float) * count);
+
+		return;
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		vec8f camera[3] = { 0.0f, 0.0f, 0.0f };
+		vec8f dir[3] = { load8(x + i), load8(y + i), load8(z + i) };
+		vec8f L[3];
+		vec8f extinction[3];
+
+		m_lookup.sky_radiance_8(camera, dir, L, extinction);
+
+		for (int c = 0; c < 3; c++)
+			store8(out[c] + i, L[c]);
+	}
+
+	if (i < count)
+		SkyState::Evaluator::radiance(count - i, x + i, y + i, z + i, r + i, g + i, b + i);
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------
\ No newline at end of file
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -1,101 +1,116 @@
 #pragma once
 
 #include "sky_model.h"
-#include <memory>
+#include "bruneton_lookup.h"
+#include "bruneton_atmosphere.h"
 
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Precomputed Atmospheric Scattering (Eric Bruneton, Fabrice Neyret). This is the GL-free part: the scattering
+// tables are read from the cache on disk into a BrunetonLookup for CPU evaluation. BrunetonSkyModelGL adds the
+// GPU precomputation and textures on top.
 class BrunetonSkyModel : public SkyModel
 {
-private:
-	//Dont change these
-	const int NUM_THREADS = 8;
-	const int READ = 0;
-	const int WRITE = 1;
+public:
+	enum LoadStatus
+	{
+		LOAD_IDLE,
+		LOAD_PENDING,
+		LOAD_COMPLETE,
+		// There's no cache on disk (or it is truncated), the tables have to be precomputed.
+		LOAD_FAILED
+	};
+
+	// How single Mie scattering is obtained. The inscatter table only keeps its red channel (in alpha), at QUALITY_LOW
+	// the other two are reconstructed from the Rayleigh ratios (GetMie() in atmosphere.glsl), which shifts the color
+	// of the sun's aureole. QUALITY_HIGH adds an RGB single Mie table, R11F_G11F_B10F on the GPU: +4 MB of video
+	// memory next to the 16 MB inscatter texture, +12 MB for the float CPU copy and +4 MB of cache on disk.
+	enum Quality
+	{
+		QUALITY_LOW,
+		QUALITY_HIGH
+	};
+
+protected:
+	// The atmosphere is per km, the runtime shader and BrunetonLookup per m.
 	const float SCALE = 1000.0f;
 
-	//Will save the tables as 8 bit png files so they can be
-	//viewed in photoshop. Used for debugging.
-	const bool WRITE_DEBUG_TEX = false;
-
-	//You can change these
-	//The radius of the planet (Rg), radius of the atmosphere (Rt)
-	const float Rg = 6360.0f;
-	const float Rt = 6420.0f;
-	const float RL = 6421.0f;
-
-	//Dimensions of the tables
-	const int TRANSMITTANCE_W = 256;
-	const int TRANSMITTANCE_H = 64;
-
-	const int IRRADIANCE_W = 64;
-	const int IRRADIANCE_H = 16;
-
-	const int INSCATTER_R = 32;
-	const int INSCATTER_MU = 128;
-	const int INSCATTER_MU_S = 32;
-	const int INSCATTER_NU = 8;
-
-	//Physical settings, Mie and Rayliegh values
-	const float AVERAGE_GROUND_REFLECTANCE = 0.1f;
-	const glm::vec4 BETA_R = glm::vec4(5.8e-3f, 1.35e-2f, 3.31e-2f, 0.0f);
-	const glm::vec4 BETA_MSca = glm::vec4(4e-3f, 4e-3f, 4e-3f, 0.0f);
-	const glm::vec4 BETA_MEx = glm::vec4(4.44e-3f, 4.44e-3f, 4.44e-3f, 0.0f);
-
-	//Asymmetry factor for the mie phase function
-	//A higher number meands more light is scattered in the forward direction
-	const float MIE_G = 0.8f;
-
-	//Half heights for the atmosphere air density (HR) and particle density (HM)
-	//This is the height in km that half the particles are found below
-	const float HR = 8.0f;
-	const float HM = 1.2f;
-
-	glm::vec3 m_beta_r = glm::vec3(0.0058f, 0.0135f, 0.0331f);
-    float m_mie_g = 0.75f;
     float m_sun_intensity = 100.0f;
 
-	dw::Texture2D* m_transmittance_t;
-	dw::Texture2D* m_delta_et;
-	dw::Texture3D* m_delta_srt;
-	dw::Texture3D* m_delta_smt;
-	dw::Texture3D* m_delta_jt;
-	dw::Texture2D* m_irradiance_t[2];
-	dw::Texture3D* m_inscatter_t[2];
-
-	dw::Shader* m_copy_inscatter_1_cs;
-	dw::Shader* m_copy_inscatter_n_cs;
-	dw::Shader* m_copy_irradiance_cs;
-	dw::Shader* m_inscatter_1_cs;
-	dw::Shader* m_inscatter_n_cs;
-	dw::Shader* m_inscatter_s_cs;
-	dw::Shader* m_irradiance_1_cs;
-	dw::Shader* m_irradiance_n_cs;
-	dw::Shader* m_transmittance_cs;
-
-	dw::Program* m_copy_inscatter_1_program;
-	dw::Program* m_copy_inscatter_n_program;
-	dw::Program* m_copy_irradiance_program;
-	dw::Program* m_inscatter_1_program;
-	dw::Program* m_inscatter_n_program;
-	dw::Program* m_inscatter_s_program;
-	dw::Program* m_irradiance_1_program;
-	dw::Program* m_irradiance_n_program;
-	dw::Program* m_transmittance_program;
+	// CPU copy of the tables for consumers that can't sample the GPU textures.
+	BrunetonLookup m_lookup;
+
+	// What the tables were (or will be) precomputed for.
+	BrunetonAtmosphere m_atmosphere;
+	Quality m_quality = QUALITY_HIGH;
+
+private:
+	// Written by the load thread, read by the owner once m_load_finished is set.
+	BrunetonLookup m_pending_lookup;
+	bool m_pending_loaded = false;
+	std::atomic<bool> m_load_finished;
+	std::thread m_load_thread;
+	LoadStatus m_load_status = LOAD_IDLE;
 
 public:
 	BrunetonSkyModel();
-	~BrunetonSkyModel();
+	virtual ~BrunetonSkyModel();
 
+	// Loads the cached tables. Returns false if they haven't been precomputed yet.
 	bool initialize() override;
-	void update() override;
-	void set_render_uniforms(dw::Program* program) override;
-	
+
+	// Reads the cached tables on a worker thread instead, so startup doesn't block on the file reads.
+	void begin_load();
+
+	// Never blocks. Once the worker is done, the tables are installed into the lookup on the calling thread and the
+	// model marked dirty, so the next update() publishes them. Until then the model evaluates to black.
+	LoadStatus poll_load();
+
+	inline LoadStatus load_status() const { return m_load_status; }
+
+	// Selects the precomputed tables, call before initialize(). Each atmosphere has its own cache files, named after
+	// the parameter hash.
+	inline void set_atmosphere(const BrunetonAtmosphere& atmosphere) { m_atmosphere = atmosphere; }
+	inline const BrunetonAtmosphere& atmosphere() const { return m_atmosphere; }
+
+	// Call before initialize() as well. A cache written without the single Mie table counts as missing at
+	// QUALITY_HIGH, the tables are precomputed again.
+	inline void set_quality(Quality quality) { m_quality = quality; }
+	inline Quality quality() const { return m_quality; }
+
+	// Reads the cache of atmosphere from directory (the working directory if empty) into lookup, with the single Mie
+	// table at QUALITY_HIGH. Returns false if any table is missing or truncated. For tools that work on a cache
+	// without a model, initialize() goes through this as well.
+	static bool load_cache(BrunetonLookup& lookup, const BrunetonAtmosphere& atmosphere, Quality quality, const std::string& directory = std::string(),
+						   const char* extension = ".rawz");
+
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// Black until the tables are loaded.
+	glm::vec3 sun_radiance(float altitude) const override;
+
+	inline const BrunetonLookup& lookup() { return m_lookup; }
+
+protected:
+	void update_parameters() override;
+	std::shared_ptr<const SkyState::Evaluator> create_evaluator() const override;
+
+	// The render time betaR and mieG come from the atmosphere the tables were precomputed for, mieG clamped like
+	// BrunetonSkyModelGL::set_uniforms() does for the precompute.
+	inline float mie_g() const { return glm::clamp(m_atmosphere.mie_g, 0.0f, 0.99f); }
+};
+
+// Const evaluation of one Bruneton state, see SkyState. Evaluates to black if the tables weren't loaded.
+class BrunetonSkyState : public SkyState::Evaluator
+{
+public:
+	BrunetonSkyState(const BrunetonLookup& lookup);
+
+	glm::vec3 radiance(const glm::vec3& dir) const override;
+	void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const override;
+
 private:
-	void set_uniforms(dw::Program* program);
-	bool load_cached_textures();
-	void write_textures();
-	void precompute();
-	dw::Texture2D* new_texture_2d(int width, int height);
-	dw::Texture3D* new_texture_3d(int width, int height, int depth);
-	void swap(dw::Texture2D** arr);
-	void swap(dw::Texture3D** arr);
+	BrunetonLookup m_lookup;
 };
\ No newline at end of file
@@ -0,0 +1,623 @@
+#include "bruneton_sky_model_gl.h"
+#include "bruneton_table_cache.h"
+#include "sky_model_gl.h"
+#include <macros.h>
+#include <utility.h>
+#include <logger.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonSkyModelGL::BrunetonSkyModelGL()
+{
+	m_transmittance_t = nullptr;
+    m_irradiance_t = nullptr;
+    m_inscatter_t = nullptr;
+    m_single_mie_t = nullptr;
+    m_delta_et = nullptr;
+    m_delta_srt = nullptr;
+    m_delta_smt = nullptr;
+    m_delta_jt = nullptr;
+
+	m_copy_inscatter_1_cs = nullptr;
+	m_inscatter_1_cs = nullptr;
+	m_inscatter_n_cs = nullptr;
+	m_inscatter_s_cs = nullptr;
+	m_irradiance_1_cs = nullptr;
+	m_irradiance_n_cs = nullptr;
+	m_transmittance_cs = nullptr;
+
+	m_copy_inscatter_1_program = nullptr;
+	m_inscatter_1_program = nullptr;
+	m_inscatter_n_program = nullptr;
+	m_inscatter_s_program = nullptr;
+	m_irradiance_1_program = nullptr;
+	m_irradiance_n_program = nullptr;
+	m_transmittance_program = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonSkyModelGL::~BrunetonSkyModelGL()
+{
+	DW_SAFE_DELETE(m_copy_inscatter_1_program);
+	DW_SAFE_DELETE(m_inscatter_1_program);
+	DW_SAFE_DELETE(m_inscatter_n_program);
+	DW_SAFE_DELETE(m_inscatter_s_program);
+	DW_SAFE_DELETE(m_irradiance_1_program);
+	DW_SAFE_DELETE(m_irradiance_n_program);
+	DW_SAFE_DELETE(m_transmittance_program);
+
+	DW_SAFE_DELETE(m_copy_inscatter_1_cs);
+	DW_SAFE_DELETE(m_inscatter_1_cs);
+	DW_SAFE_DELETE(m_inscatter_n_cs);
+	DW_SAFE_DELETE(m_inscatter_s_cs);
+	DW_SAFE_DELETE(m_irradiance_1_cs);
+	DW_SAFE_DELETE(m_irradiance_n_cs);
+	DW_SAFE_DELETE(m_transmittance_cs);
+
+	DW_SAFE_DELETE(m_transmittance_t);
+    DW_SAFE_DELETE(m_delta_et);
+    DW_SAFE_DELETE(m_delta_srt);
+    DW_SAFE_DELETE(m_delta_smt);
+    DW_SAFE_DELETE(m_delta_jt);
+    DW_SAFE_DELETE(m_irradiance_t);
+    DW_SAFE_DELETE(m_inscatter_t);
+    DW_SAFE_DELETE(m_single_mie_t);
+
+    // Unused tables only go once the cache is over budget.
+    m_tables.reset();
+    BrunetonTableCache::instance().trim();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonSkyModelGL::initialize()
+{
+	if (acquire_cached_tables())
+		return true;
+
+	create_textures();
+
+    if (!load_cached_textures())
+    {
+        if (!create_precompute_resources())
+            return false;
+
+        precompute();
+    }
+
+    publish_tables();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonSkyModelGL::initialize_async()
+{
+	if (acquire_cached_tables())
+		return true;
+
+	create_textures();
+
+	m_uploaded_layers = 0;
+	m_ready = false;
+	m_load_error = false;
+
+	begin_load();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonSkyModelGL::update_loading(float budget_ms)
+{
+	if (m_ready || m_load_error)
+		return m_ready;
+
+	LoadStatus status = poll_load();
+
+	if (status == LOAD_IDLE || status == LOAD_PENDING)
+		return false;
+
+	if (status == LOAD_FAILED)
+	{
+		DW_LOG_INFO("No Bruneton table cache, precomputing");
+
+		if (!create_precompute_resources())
+		{
+			m_load_error = true;
+			return false;
+		}
+
+		// Also fills the CPU lookup and writes the cache.
+		precompute();
+		publish_tables();
+
+		return true;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (m_uploaded_layers == 0)
+	{
+		m_transmittance_t->set_data(0, 0, (void*)m_lookup.transmittance_data());
+		m_irradiance_t->set_data(0, 0, (void*)m_lookup.irradiance_data());
+	}
+
+	// One depth slice is one layer of r, the inscatter texture first, then the single Mie one.
+	const int width = INSCATTER_MU_S * INSCATTER_NU;
+	const size_t layer_texels = size_t(width) * INSCATTER_MU;
+
+	while (m_uploaded_layers < num_layers())
+	{
+		bool mie = m_uploaded_layers >= INSCATTER_R;
+		int z = m_uploaded_layers % INSCATTER_R;
+
+		if (mie)
+		{
+			m_single_mie_t->bind(0);
+			GL_CHECK_ERROR(glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, width, INSCATTER_MU, 1, GL_RGB, GL_FLOAT, m_lookup.single_mie_data() + layer_texels * 3 * z));
+		}
+		else
+		{
+			m_inscatter_t->bind(0);
+			GL_CHECK_ERROR(glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, z, width, INSCATTER_MU, 1, GL_RGBA, GL_FLOAT, m_lookup.inscatter_data() + layer_texels * 4 * z));
+		}
+
+		m_uploaded_layers++;
+
+		if (std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() > budget_ms)
+			break;
+	}
+
+	if (m_uploaded_layers == num_layers())
+		publish_tables();
+
+	return m_ready;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Another model may already have the tables of this atmosphere on the GPU.
+bool BrunetonSkyModelGL::acquire_cached_tables()
+{
+	m_tables = BrunetonTableCache::instance().acquire(m_atmosphere, m_quality == QUALITY_HIGH);
+
+	if (!m_tables)
+		return false;
+
+	m_lookup = m_tables->lookup;
+	m_uploaded_layers = num_layers();
+	m_ready = true;
+
+	mark_dirty();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Hands the final tables over to the cache and frees everything else the loading or precompute needed.
+void BrunetonSkyModelGL::publish_tables()
+{
+	std::unique_ptr<BrunetonTables> tables(new BrunetonTables());
+
+	tables->atmosphere = m_atmosphere;
+	tables->transmittance = m_transmittance_t;
+	tables->irradiance = m_irradiance_t;
+	tables->inscatter = m_inscatter_t;
+	tables->single_mie = m_single_mie_t;
+	tables->lookup = m_lookup;
+	tables->gpu_bytes = (size_t(TRANSMITTANCE_W) * TRANSMITTANCE_H + size_t(IRRADIANCE_W) * IRRADIANCE_H +
+						 size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * INSCATTER_R) * 4 * sizeof(float);
+
+	// R11F_G11F_B10F packs a texel into 4 bytes.
+	if (m_single_mie_t)
+		tables->gpu_bytes += size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * INSCATTER_R * 4;
+
+	m_transmittance_t = nullptr;
+	m_irradiance_t = nullptr;
+	m_inscatter_t = nullptr;
+	m_single_mie_t = nullptr;
+
+	DW_SAFE_DELETE(m_delta_et);
+	DW_SAFE_DELETE(m_delta_srt);
+	DW_SAFE_DELETE(m_delta_smt);
+	DW_SAFE_DELETE(m_delta_jt);
+
+	// If another model published the same atmosphere in the meantime, its tables win and ours are deleted.
+	m_tables = BrunetonTableCache::instance().insert(std::move(tables));
+
+	m_uploaded_layers = num_layers();
+	m_ready = true;
+
+	mark_dirty();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonSkyModelGL::create_textures()
+{
+	if (m_transmittance_t)
+		return;
+
+	m_transmittance_t = new_texture_2d(TRANSMITTANCE_W, TRANSMITTANCE_H);
+
+    m_irradiance_t = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
+    m_inscatter_t = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
+
+    if (m_quality == QUALITY_HIGH)
+        m_single_mie_t = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R, GL_R11F_G11F_B10F, GL_RGB);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int BrunetonSkyModelGL::num_layers() const
+{
+	return m_quality == QUALITY_HIGH ? 2 * INSCATTER_R : INSCATTER_R;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The compute shaders and intermediate textures are only needed to fill a missing cache.
+bool BrunetonSkyModelGL::create_precompute_resources()
+{
+	struct ComputeProgram
+	{
+		const char* path;
+		dw::Shader** shader;
+		dw::Program** program;
+	};
+
+	ComputeProgram programs[] = {
+		{ "shader/sky_models/bruneton/copy_inscatter_1_cs.glsl", &m_copy_inscatter_1_cs, &m_copy_inscatter_1_program },
+		{ "shader/sky_models/bruneton/inscatter_1_cs.glsl", &m_inscatter_1_cs, &m_inscatter_1_program },
+		{ "shader/sky_models/bruneton/inscatter_n_cs.glsl", &m_inscatter_n_cs, &m_inscatter_n_program },
+		{ "shader/sky_models/bruneton/inscatter_s_cs.glsl", &m_inscatter_s_cs, &m_inscatter_s_program },
+		{ "shader/sky_models/bruneton/irradiance_1_cs.glsl", &m_irradiance_1_cs, &m_irradiance_1_program },
+		{ "shader/sky_models/bruneton/irradiance_n_cs.glsl", &m_irradiance_n_cs, &m_irradiance_n_program },
+		{ "shader/sky_models/bruneton/transmittance_cs.glsl", &m_transmittance_cs, &m_transmittance_program }
+	};
+
+	for (auto& p : programs)
+	{
+		if (*p.program)
+			continue;
+
+		if (!dw::utility::create_compute_program(p.path, p.shader, p.program))
+		{
+			DW_LOG_ERROR("Failed to load shaders");
+			return false;
+		}
+	}
+
+	if (!m_delta_et)
+	{
+		m_delta_et = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
+		m_delta_srt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
+		m_delta_smt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
+		m_delta_jt = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonSkyModelGL::write_uniforms(SkyUniforms& uniforms)
+{
+	BrunetonSkyModel::write_uniforms(uniforms);
+
+	if (!m_tables)
+		return;
+
+	// The samplers are on fixed units, see set_sky_sampler_units().
+	m_tables->transmittance->bind(SKY_UNIT_TRANSMITTANCE);
+	m_tables->irradiance->bind(SKY_UNIT_IRRADIANCE);
+	m_tables->inscatter->bind(SKY_UNIT_INSCATTER);
+
+	uniforms.set("SINGLE_MIE_TABLE", m_tables->single_mie ? 1 : 0);
+
+	if (m_tables->single_mie)
+		m_tables->single_mie->bind(SKY_UNIT_SINGLE_MIE);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonSkyModelGL::set_uniforms(dw::Program* program)
+{
+	program->set_uniform("Rg", Rg);
+	program->set_uniform("Rt", Rt);
+	program->set_uniform("RL", RL);
+	program->set_uniform("TRANSMITTANCE_W", TRANSMITTANCE_W);
+	program->set_uniform("TRANSMITTANCE_H", TRANSMITTANCE_H);
+	program->set_uniform("SKY_W", IRRADIANCE_W);
+	program->set_uniform("SKY_H", IRRADIANCE_H);
+	program->set_uniform("RES_R", INSCATTER_R);
+	program->set_uniform("RES_MU", INSCATTER_MU);
+	program->set_uniform("RES_MU_S", INSCATTER_MU_S);
+	program->set_uniform("RES_NU", INSCATTER_NU);
+	program->set_uniform("AVERAGE_GROUND_REFLECTANCE", m_atmosphere.ground_reflectance);
+	program->set_uniform("HR", m_atmosphere.hr);
+	program->set_uniform("HM", m_atmosphere.hm);
+	program->set_uniform("betaR", glm::vec4(m_atmosphere.beta_r, 0.0f));
+	program->set_uniform("betaMSca", glm::vec4(m_atmosphere.beta_m_sca, 0.0f));
+	program->set_uniform("betaMEx", glm::vec4(m_atmosphere.beta_m_ex, 0.0f));
+	program->set_uniform("mieG", glm::clamp(m_atmosphere.mie_g, 0.0f, 0.99f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool BrunetonSkyModelGL::load_cached_textures()
+{
+	if (!BrunetonSkyModel::initialize())
+		return false;
+
+	m_transmittance_t->set_data(0, 0, (void*)m_lookup.transmittance_data());
+	m_irradiance_t->set_data(0, 0, (void*)m_lookup.irradiance_data());
+	m_inscatter_t->set_data(0, (void*)m_lookup.inscatter_data());
+
+	if (m_single_mie_t)
+		m_single_mie_t->set_data(0, (void*)m_lookup.single_mie_data());
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonSkyModelGL::write_textures()
+{
+	{
+		std::vector<float> data(size_t(TRANSMITTANCE_W) * TRANSMITTANCE_H * 4);
+		m_transmittance_t->data(0, 0, data.data());
+		m_lookup.set_transmittance(data.data());
+	}
+
+	{
+		std::vector<float> data(size_t(IRRADIANCE_W) * IRRADIANCE_H * 4);
+		m_irradiance_t->data(0, 0, data.data());
+		m_lookup.set_irradiance(data.data());
+	}
+
+	{
+		std::vector<float> data(size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * INSCATTER_R * 4);
+		m_inscatter_t->data(0, data.data());
+		m_lookup.set_inscatter(data.data());
+	}
+
+	const char* extension = COMPRESS_CACHE ? ".rawz" : ".raw";
+
+	bool saved = m_lookup.save(m_atmosphere.cache_path("transmittance", extension), m_atmosphere.cache_path("irradiance", extension),
+							   m_atmosphere.cache_path("inscatter", extension), COMPRESS_CACHE);
+
+	// deltaSM still holds the single Mie scattering of step 3. It is cached at full precision whatever the quality,
+	// so switching to QUALITY_HIGH later doesn't precompute again.
+	{
+		const size_t texels = size_t(INSCATTER_MU_S) * INSCATTER_NU * INSCATTER_MU * INSCATTER_R;
+
+		std::vector<float> data(texels * 4);
+		m_delta_smt->data(0, data.data());
+
+		std::vector<float> rgb(texels * 3);
+
+		for (size_t i = 0; i < texels; i++)
+			memcpy(&rgb[i * 3], &data[i * 4], sizeof(float) * 3);
+
+		m_lookup.set_single_mie(rgb.data());
+		saved = m_lookup.save_single_mie(m_atmosphere.cache_path("single_mie", extension), COMPRESS_CACHE) && saved;
+
+		if (m_single_mie_t)
+		{
+			// What the texture holds after the upload converts it.
+			BrunetonLookup::quantize_r11g11b10(rgb.data(), texels);
+
+			m_lookup.set_single_mie(rgb.data());
+			m_single_mie_t->set_data(0, rgb.data());
+		}
+		else
+			m_lookup.set_single_mie(nullptr);
+	}
+
+	if (!saved)
+		DW_LOG_ERROR("Failed to write the Bruneton table cache");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonSkyModelGL::precompute()
+{
+	// -----------------------------------------------------------------------------
+    // 1. Compute Transmittance Texture T
+    // -----------------------------------------------------------------------------
+
+    m_transmittance_program->use();
+    set_uniforms(m_transmittance_program);
+
+    m_transmittance_t->bind_image(0, 0, 0, GL_READ_WRITE, m_transmittance_t->internal_format());
+
+    GL_CHECK_ERROR(glDispatchCompute(TRANSMITTANCE_W/NUM_THREADS, TRANSMITTANCE_H/NUM_THREADS, 1));
+	GL_CHECK_ERROR(glFinish());
+
+    // -----------------------------------------------------------------------------
+    // 2. Compute Irradiance Texture deltaE
+    // -----------------------------------------------------------------------------
+
+    m_irradiance_1_program->use();
+    set_uniforms(m_irradiance_1_program);
+
+	m_delta_et->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_et->internal_format());
+
+	if (m_irradiance_1_program->set_uniform("s_TransmittanceRead", 0))
+		m_transmittance_t->bind(0);
+
+    GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
+	GL_CHECK_ERROR(glFinish());
+
+    // -----------------------------------------------------------------------------
+    // 3. Compute Single Scattering Texture
+    // -----------------------------------------------------------------------------
+
+    m_inscatter_1_program->use();
+    set_uniforms(m_inscatter_1_program);
+
+	m_delta_srt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_srt->internal_format());
+    m_delta_smt->bind_image(1, 0, 0, GL_READ_WRITE, m_delta_smt->internal_format());
+
+	if (m_inscatter_1_program->set_uniform("s_TransmittanceRead", 0))
+		m_transmittance_t->bind(0);
+
+    for (int i = 0; i < INSCATTER_R; i++) 
+    {
+	    m_inscatter_1_program->set_uniform("u_Layer", i);
+		GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
+        GL_CHECK_ERROR(glFinish());
+	}
+
+    // -----------------------------------------------------------------------------
+    // 4. Clear Irradiance Texture E, it only accumulates the indirect orders
+    // -----------------------------------------------------------------------------
+
+    {
+        std::vector<float> zero(size_t(IRRADIANCE_W) * IRRADIANCE_H * 4, 0.0f);
+        m_irradiance_t->set_data(0, 0, zero.data());
+    }
+
+    // -----------------------------------------------------------------------------
+    // 5. Copy deltaS into Inscatter Texture S
+    // -----------------------------------------------------------------------------
+
+    m_copy_inscatter_1_program->use();
+    set_uniforms(m_copy_inscatter_1_program);
+
+    m_inscatter_t->bind_image(0, 0, 0, GL_READ_WRITE, m_inscatter_t->internal_format());
+
+	if (m_copy_inscatter_1_program->set_uniform("s_DeltaSRRead", 0))
+		m_delta_srt->bind(0);
+
+	if (m_copy_inscatter_1_program->set_uniform("s_DeltaSMRead", 1))
+		m_delta_smt->bind(1);
+
+    for (int i = 0; i < INSCATTER_R; i++) 
+    {
+        m_copy_inscatter_1_program->set_uniform("u_Layer", i);
+        GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
+        GL_CHECK_ERROR(glFinish());
+    }
+
+    // E and S are accumulated in place from here on: irradiance_n and inscatter_n add each deltaE and deltaS into
+    // them with image load/store as they compute it, instead of copy passes into a second texture.
+    for (int order = 2; order < 4; order++)
+    {
+        // -----------------------------------------------------------------------------
+        // 6. Compute deltaJ
+        // -----------------------------------------------------------------------------
+
+        m_inscatter_s_program->use();
+        set_uniforms(m_inscatter_s_program);
+
+        m_inscatter_s_program->set_uniform("first", (order == 2) ? 1 : 0);
+
+		m_delta_jt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_jt->internal_format());
+
+		if (m_inscatter_s_program->set_uniform("s_TransmittanceRead", 0))
+			m_transmittance_t->bind(0);
+
+		if (m_inscatter_s_program->set_uniform("s_DeltaERead", 1))
+			m_delta_et->bind(1);
+
+		if (m_inscatter_s_program->set_uniform("s_DeltaSRRead", 2))
+			m_delta_srt->bind(2);
+
+		if (m_inscatter_s_program->set_uniform("s_DeltaSMRead", 3))
+			m_delta_smt->bind(3);
+        
+        for (int i = 0; i < INSCATTER_R; i++) 
+        {
+            m_inscatter_s_program->set_uniform("u_Layer", i);
+            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
+            GL_CHECK_ERROR(glFinish());
+        }
+
+        // -----------------------------------------------------------------------------
+        // 7. Compute deltaE and add it into Irradiance Texture E
+        // -----------------------------------------------------------------------------
+
+        m_irradiance_n_program->use();
+        set_uniforms(m_irradiance_n_program);
+
+        m_irradiance_n_program->set_uniform("first", (order == 2) ? 1 : 0);
+
+		m_delta_et->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_et->internal_format());
+		m_irradiance_t->bind_image(1, 0, 0, GL_READ_WRITE, m_irradiance_t->internal_format());
+
+		if (m_irradiance_n_program->set_uniform("s_DeltaSRRead", 0))
+			m_delta_srt->bind(0);
+
+		if (m_irradiance_n_program->set_uniform("s_DeltaSMRead", 1))
+			m_delta_smt->bind(1);
+
+        GL_CHECK_ERROR(glDispatchCompute(IRRADIANCE_W/NUM_THREADS, IRRADIANCE_H/NUM_THREADS, 1));
+        GL_CHECK_ERROR(glFinish());
+
+        // -----------------------------------------------------------------------------
+        // 8. Compute deltaS and add it into Inscatter Texture S
+        // -----------------------------------------------------------------------------
+
+        m_inscatter_n_program->use();
+        set_uniforms(m_inscatter_n_program);
+
+        m_inscatter_n_program->set_uniform("first", (order == 2) ? 1 : 0);
+
+		m_delta_srt->bind_image(0, 0, 0, GL_READ_WRITE, m_delta_srt->internal_format());
+		m_inscatter_t->bind_image(1, 0, 0, GL_READ_WRITE, m_inscatter_t->internal_format());
+
+		if (m_inscatter_n_program->set_uniform("s_TransmittanceRead", 0))
+			m_transmittance_t->bind(0);
+
+		if (m_inscatter_n_program->set_uniform("s_DeltaJRead", 1))
+			m_delta_jt->bind(1);
+
+        for (int i = 0; i < INSCATTER_R; i++) 
+        {
+            m_inscatter_n_program->set_uniform("u_Layer", i);
+            GL_CHECK_ERROR(glDispatchCompute((INSCATTER_MU_S*INSCATTER_NU)/NUM_THREADS, INSCATTER_MU/NUM_THREADS, 1));
+            GL_CHECK_ERROR(glFinish());
+        }
+    }
+
+    // -----------------------------------------------------------------------------
+    // 9. Save to disk
+    // -----------------------------------------------------------------------------
+
+	write_textures();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture2D* BrunetonSkyModelGL::new_texture_2d(int width, int height)
+{
+	dw::Texture2D* texture = new dw::Texture2D(width, height, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    texture->set_min_filter(GL_LINEAR);
+	texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+	return texture;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture3D* BrunetonSkyModelGL::new_texture_3d(int width, int height, int depth, GLenum internal_format, GLenum format)
+{
+	dw::Texture3D* texture = new dw::Texture3D(width, height, depth, 1, internal_format, format, GL_FLOAT);
+    texture->set_min_filter(GL_LINEAR);
+    texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+    return texture;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <ogl.h>
+#include "bruneton_sky_model.h"
+
+struct BrunetonTables;
+
+// GPU side of the Bruneton model: uploads the scattering tables to textures, precomputes them with compute shaders
+// when there's no cache on disk and binds them for the sky shaders. The CPU state lives in BrunetonSkyModel. The
+// finished textures go to the process-wide BrunetonTableCache, so models with the same atmosphere share them.
+//
+// initialize() does all of that before returning. initialize_async() instead reads the cache on a worker thread and
+// update_loading() uploads it over several frames, so the application can show another sky in the meantime. The
+// compute shaders are only compiled if the cache turns out to be missing.
+class BrunetonSkyModelGL : public BrunetonSkyModel
+{
+private:
+	//Dont change these
+	const int NUM_THREADS = 8;
+
+	//Will save the tables as 8 bit png files so they can be
+	//viewed in photoshop. Used for debugging.
+	const bool WRITE_DEBUG_TEX = false;
+
+	//Writes the table cache compressed (.rawz) instead of as raw floats (.raw).
+	//Both are read back.
+	const bool COMPRESS_CACHE = true;
+
+	//You can change these
+	//The radius of the planet (Rg), radius of the atmosphere (Rt)
+	const float Rg = 6360.0f;
+	const float Rt = 6420.0f;
+	const float RL = 6421.0f;
+
+	//Dimensions of the tables
+	const int TRANSMITTANCE_W = 256;
+	const int TRANSMITTANCE_H = 64;
+
+	const int IRRADIANCE_W = 64;
+	const int IRRADIANCE_H = 16;
+
+	const int INSCATTER_R = 32;
+	const int INSCATTER_MU = 128;
+	const int INSCATTER_MU_S = 32;
+	const int INSCATTER_NU = 8;
+
+	//The physical settings (Rayleigh and Mie scattering, scale heights, ground reflectance) are in m_atmosphere
+
+	dw::Texture2D* m_transmittance_t;
+	dw::Texture2D* m_delta_et;
+	dw::Texture3D* m_delta_srt;
+	dw::Texture3D* m_delta_smt;
+	dw::Texture3D* m_delta_jt;
+	// Accumulated in place during the precompute, see precompute().
+	dw::Texture2D* m_irradiance_t;
+	dw::Texture3D* m_inscatter_t;
+	dw::Texture3D* m_single_mie_t;
+
+	dw::Shader* m_copy_inscatter_1_cs;
+	dw::Shader* m_inscatter_1_cs;
+	dw::Shader* m_inscatter_n_cs;
+	dw::Shader* m_inscatter_s_cs;
+	dw::Shader* m_irradiance_1_cs;
+	dw::Shader* m_irradiance_n_cs;
+	dw::Shader* m_transmittance_cs;
+
+	dw::Program* m_copy_inscatter_1_program;
+	dw::Program* m_inscatter_1_program;
+	dw::Program* m_inscatter_n_program;
+	dw::Program* m_inscatter_s_program;
+	dw::Program* m_irradiance_1_program;
+	dw::Program* m_irradiance_n_program;
+	dw::Program* m_transmittance_program;
+
+	// Final tables, shared with every other model rendering the same atmosphere. The texture members above are only
+	// used while loading or precomputing.
+	std::shared_ptr<BrunetonTables> m_tables;
+
+	// Inscatter (then single Mie) layers uploaded so far by update_loading(), num_layers() once the textures are
+	// complete.
+	int m_uploaded_layers = 0;
+	bool m_ready = false;
+	bool m_load_error = false;
+
+public:
+	BrunetonSkyModelGL();
+	~BrunetonSkyModelGL();
+
+	bool initialize() override;
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// Creates the textures and starts reading the cache in the background. Returns false if the textures couldn't be
+	// created.
+	bool initialize_async();
+
+	// Call once per frame on the GL thread after initialize_async(). Uploads the loaded tables, stopping after the
+	// first 3D texture layer that exceeds budget_ms (the small 2D tables always go in one piece). If there's no cache
+	// the tables are precomputed in this call instead, which takes as long as it takes. Returns true when the model
+	// is ready to render.
+	bool update_loading(float budget_ms);
+
+	inline bool is_ready() const { return m_ready; }
+	
+private:
+	void create_textures();
+	int num_layers() const;
+	bool acquire_cached_tables();
+	void publish_tables();
+	bool create_precompute_resources();
+	void set_uniforms(dw::Program* program);
+	bool load_cached_textures();
+	void write_textures();
+	void precompute();
+	dw::Texture2D* new_texture_2d(int width, int height);
+	dw::Texture3D* new_texture_3d(int width, int height, int depth, GLenum internal_format = GL_RGBA32F, GLenum format = GL_RGBA);
+};
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "bruneton_table_cache.h"
+#include <macros.h>
+#include <logger.h>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonTables::~BrunetonTables()
+{
+	DW_SAFE_DELETE(transmittance);
+	DW_SAFE_DELETE(irradiance);
+	DW_SAFE_DELETE(inscatter);
+	DW_SAFE_DELETE(single_mie);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+BrunetonTableCache& BrunetonTableCache::instance()
+{
+	static BrunetonTableCache cache;
+	return cache;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<BrunetonTables> BrunetonTableCache::acquire(const BrunetonAtmosphere& atmosphere, bool single_mie)
+{
+	uint64_t key = atmosphere.hash();
+
+	for (auto it = m_entries.begin(); it != m_entries.end(); it++)
+	{
+		// The hash only picks the candidates, the parameters have to match exactly.
+		if ((*it)->key == key && (*it)->atmosphere == atmosphere && ((*it)->single_mie != nullptr) == single_mie)
+		{
+			m_entries.splice(m_entries.begin(), m_entries, it);
+			return m_entries.front();
+		}
+	}
+
+	return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<BrunetonTables> BrunetonTableCache::insert(std::unique_ptr<BrunetonTables> tables)
+{
+	std::shared_ptr<BrunetonTables> existing = acquire(tables->atmosphere, tables->single_mie != nullptr);
+
+	if (existing)
+		return existing;
+
+	tables->key = tables->atmosphere.hash();
+
+	m_gpu_bytes += tables->gpu_bytes;
+	m_entries.push_front(std::shared_ptr<BrunetonTables>(tables.release()));
+
+	std::shared_ptr<BrunetonTables> entry = m_entries.front();
+
+	trim();
+
+	return entry;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonTableCache::trim()
+{
+	for (auto it = m_entries.end(); it != m_entries.begin() && m_gpu_bytes > m_gpu_budget;)
+	{
+		it--;
+
+		// Only the cache holds it.
+		if (it->use_count() == 1)
+		{
+			m_gpu_bytes -= (*it)->gpu_bytes;
+			it = m_entries.erase(it);
+		}
+	}
+
+	if (m_gpu_bytes > m_gpu_budget)
+		DW_LOG_WARNING("Bruneton tables in use exceed the GPU budget");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonTableCache::clear()
+{
+	m_entries.clear();
+	m_gpu_bytes = 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void BrunetonTableCache::set_gpu_budget(size_t bytes)
+{
+	m_gpu_budget = bytes;
+	trim();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ogl.h>
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include "bruneton_atmosphere.h"
+#include "bruneton_lookup.h"
+
+// Final scattering tables of one atmosphere, on the GPU and (shared, see BrunetonLookup) on the CPU. Owned by
+// BrunetonTableCache and handed out to every model rendering that atmosphere.
+struct BrunetonTables
+{
+	BrunetonAtmosphere atmosphere;
+	uint64_t key = 0;
+
+	dw::Texture2D* transmittance = nullptr;
+	dw::Texture2D* irradiance = nullptr;
+	dw::Texture3D* inscatter = nullptr;
+
+	// RGB single Mie scattering (R11F_G11F_B10F), only at BrunetonSkyModel::QUALITY_HIGH.
+	dw::Texture3D* single_mie = nullptr;
+
+	BrunetonLookup lookup;
+
+	size_t gpu_bytes = 0;
+
+	~BrunetonTables();
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Process-wide cache of the Bruneton tables, keyed by the atmosphere hash, so models with the same parameters share
+// one set of textures instead of each loading or precomputing their own. A model holds its entry through the
+// shared_ptr it got from acquire() or insert(), which keeps the entry alive. Entries nobody holds any more stay
+// resident for a later acquire() until the GPU budget is exceeded, then the least recently used ones are dropped.
+// Entries in use are never evicted, so the budget can be overshot by what is actually rendered. GL thread only.
+class BrunetonTableCache
+{
+public:
+	static BrunetonTableCache& instance();
+
+	// Resident tables of the atmosphere, with or without the single Mie table, or null if they have to be loaded or
+	// precomputed.
+	std::shared_ptr<BrunetonTables> acquire(const BrunetonAtmosphere& atmosphere, bool single_mie);
+
+	// Takes over tables a model just loaded or precomputed. If another model got there first its entry is returned
+	// and tables is released, so the caller should always use the result.
+	std::shared_ptr<BrunetonTables> insert(std::unique_ptr<BrunetonTables> tables);
+
+	// Evicts unused entries (least recently used first) until the resident tables fit the budget.
+	void trim();
+
+	// Drops the cache's references, e.g. before the GL context goes away. Tables still in use live until their last
+	// model releases them.
+	void clear();
+
+	void set_gpu_budget(size_t bytes);
+
+	inline size_t gpu_budget() const { return m_gpu_budget; }
+	inline size_t gpu_bytes() const { return m_gpu_bytes; }
+	inline size_t size() const { return m_entries.size(); }
+
+private:
+	BrunetonTableCache() {}
+
+	// Most recently used first.
+	std::list<std::shared_ptr<BrunetonTables>> m_entries;
+
+	size_t m_gpu_budget = 256 * 1024 * 1024;
+	size_t m_gpu_bytes = 0;
+};
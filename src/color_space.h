@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm.hpp>
+
+// Linear RGB working spaces the CPU evaluators and shaders can output.
+enum ColorSpace
+{
+	COLOR_SPACE_SRGB,
+	COLOR_SPACE_REC2020,
+	COLOR_SPACE_ACESCG
+};
+
+// CIE XYZ (D65 white) to linear RGB in the given working space. ACEScg has a D60 white point, so its matrix includes
+// the Bradford adaptation from D65. Matrices are column major like everything else in glm.
+inline glm::mat3 xyz_to_rgb_matrix(ColorSpace space)
+{
+	switch (space)
+	{
+	case COLOR_SPACE_REC2020:
+		return glm::transpose(glm::mat3( 1.7166512f, -0.3556708f, -0.2533663f,
+		                                -0.6666844f,  1.6164812f,  0.0157685f,
+		                                 0.0176399f, -0.0427706f,  0.9421031f));
+	case COLOR_SPACE_ACESCG:
+	{
+		glm::mat3 xyz_to_ap1 = glm::transpose(glm::mat3( 1.6410234f, -0.3248033f, -0.2364247f,
+		                                                -0.6636629f,  1.6153316f,  0.0167563f,
+		                                                 0.0117219f, -0.0082844f,  0.9883949f));
+		glm::mat3 d65_to_d60 = glm::transpose(glm::mat3( 1.0130349f,  0.0061053f, -0.0149710f,
+		                                                 0.0076982f,  0.9981648f, -0.0050320f,
+		                                                -0.0028413f,  0.0046852f,  0.9245070f));
+		return xyz_to_ap1 * d65_to_d60;
+	}
+	default:
+		return glm::transpose(glm::mat3( 3.240479f, -1.537150f, -0.498535f,
+		                                -0.969256f,  1.875992f,  0.041556f,
+		                                 0.055648f, -0.204043f,  1.057311f));
+	}
+}
+
+// Linear sRGB to the given working space, for models whose native output is sRGB.
+inline glm::mat3 srgb_to_rgb_matrix(ColorSpace space)
+{
+	if (space == COLOR_SPACE_SRGB)
+		return glm::mat3(1.0f);
+
+	glm::mat3 srgb_to_xyz = glm::transpose(glm::mat3(0.4124564f, 0.3575761f, 0.1804375f,
+	                                                 0.2126729f, 0.7151522f, 0.0721750f,
+	                                                 0.0193339f, 0.1191920f, 0.9503041f));
+
+	return xyz_to_rgb_matrix(space) * srgb_to_xyz;
+}
@@ -0,0 +1,146 @@
+// Converts the CIE XYZ and spectral datasets of the Hosek-Wilkie reference implementation (ArHosekSkyModelData_CIEXYZ.h,
+// ArHosekSkyModelData_Spectral.h, from the authors' site) into the raw files HosekDataset::load() reads, named after
+// HosekDataset::file_name(). The dataset of every header is told apart by its array names. The written files are
+// read back and compared against the parsed header before the tool reports success.
+//
+// Usage: sky_models_hosek_convert [--output <dir>] <header> [<header> ...]
+//
+// SkyModels and sky_models_golden look for the files in their working directory (--hosek-data for the golden check).
+
+#include "hosek_dataset.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ConvertOptions
+{
+	std::string              output = ".";
+	std::vector<std::string> headers;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool parse_options(int argc, char** argv, ConvertOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--output" && value)
+		{
+			options.output = value;
+			i++;
+		}
+		else if (arg.compare(0, 2, "--") != 0)
+			options.headers.push_back(arg);
+		else
+		{
+			options.headers.clear();
+			break;
+		}
+	}
+
+	if (options.headers.empty())
+	{
+		fprintf(stderr, "usage: %s [--output <dir>] <ArHosekSkyModelData_CIEXYZ.h | ArHosekSkyModelData_Spectral.h> ...\n", argv[0]);
+		return false;
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The double evaluation of both datasets has to match exactly over the whole parameter range.
+static bool same_dataset(const HosekDataset& a, const HosekDataset& b)
+{
+	if (a.type() != b.type() || a.num_bands() != b.num_bands())
+		return false;
+
+	double params_a[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	double params_b[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	double radiance_a[HosekDataset::MAX_BANDS];
+	double radiance_b[HosekDataset::MAX_BANDS];
+
+	const int steps = 8;
+
+	for (int t = 0; t < steps; t++)
+	{
+		for (int al = 0; al < steps; al++)
+		{
+			for (int e = 0; e < steps; e++)
+			{
+				float turbidity = 1.0f + 9.0f * float(t) / float(steps - 1);
+				float albedo = float(al) / float(steps - 1);
+				float sun_theta = 1.5707963f * float(e) / float(steps - 1);
+
+				a.evaluate(turbidity, albedo, sun_theta, params_a, radiance_a);
+				b.evaluate(turbidity, albedo, sun_theta, params_b, radiance_b);
+
+				if (memcmp(params_a, params_b, sizeof(double) * HosekDataset::NUM_PARAMS * a.padded_bands()) != 0 ||
+					memcmp(radiance_a, radiance_b, sizeof(double) * a.padded_bands()) != 0)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	ConvertOptions options;
+
+	if (!parse_options(argc, argv, options))
+		return 2;
+
+	const char* type_names[] = { "RGB", "CIE XYZ", "spectral" };
+
+	for (const std::string& header : options.headers)
+	{
+		HosekDatasetType type = HOSEK_DATASET_XYZ;
+		std::unique_ptr<HosekDataset> dataset(HosekDataset::load_reference(type, header));
+
+		if (!dataset)
+		{
+			type = HOSEK_DATASET_SPECTRAL;
+			dataset.reset(HosekDataset::load_reference(type, header));
+		}
+
+		if (!dataset)
+		{
+			fprintf(stderr, "%s: no CIE XYZ or spectral dataset found\n", header.c_str());
+			return 1;
+		}
+
+		std::string prefix = options.output.empty() ? std::string() : options.output + "/";
+		std::string config_path = prefix + HosekDataset::file_name(type, "config");
+		std::string radiance_path = prefix + HosekDataset::file_name(type, "radiance");
+
+		if (!dataset->save(config_path, radiance_path))
+		{
+			fprintf(stderr, "failed to write %s and %s\n", config_path.c_str(), radiance_path.c_str());
+			return 1;
+		}
+
+		std::unique_ptr<HosekDataset> written(HosekDataset::load(type, options.output));
+
+		if (!written || !same_dataset(*dataset, *written))
+		{
+			fprintf(stderr, "%s: the written %s dataset doesn't read back the same\n", header.c_str(), type_names[type]);
+			return 1;
+		}
+
+		printf("%s: %s dataset, %d bands, written to %s and %s\n", header.c_str(), type_names[type], dataset->num_bands(), config_path.c_str(), radiance_path.c_str());
+	}
+
+	return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
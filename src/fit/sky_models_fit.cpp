@@ -0,0 +1,250 @@
+// Offline fit of Hosek-Wilkie coefficients to one of the Bruneton models (see HosekFit), for targets that can't afford
+// the precomputed tables. Writes the coefficient table as a binary file for HosekFit::load() and optionally as a C++
+// header to compile in, and prints the relative fitting error at every fitted sun elevation and at the midpoints in
+// between (what SkyTimeOfDay interpolates to).
+//
+// Usage: sky_models_fit [--model bruneton|bruneton2017] [--bruneton-cache <dir>] [--elevations <n>] [--threads <n>]
+//                       [--output <file>] [--header <file>] [--name <identifier>] [--format text|csv]
+//
+// The 2008 model needs the tables precomputed by the application in --bruneton-cache. The 2017 model reads its cache
+// from the same directory or precomputes the tables on the CPU, which takes a few minutes.
+
+#include "hosek_fit.h"
+#include "bruneton_sky_model.h"
+#include "bruneton_lookup.h"
+#include "bruneton_2017_sky_model.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+
+struct FitOptions
+{
+	std::string model = "bruneton2017";
+	std::string bruneton_cache = ".";
+	std::string output = "hosek_fit.bin";
+	std::string header;
+	std::string name = "HOSEK_FIT";
+	int         elevations = 16;
+	int         threads = 0;
+	bool        csv = false;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool parse_options(int argc, char** argv, FitOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--model" && value && (strcmp(value, "bruneton") == 0 || strcmp(value, "bruneton2017") == 0))
+		{
+			options.model = value;
+			i++;
+		}
+		else if (arg == "--bruneton-cache" && value)
+		{
+			options.bruneton_cache = value;
+			i++;
+		}
+		else if (arg == "--elevations" && value)
+		{
+			options.elevations = std::max(atoi(value), 2);
+			i++;
+		}
+		else if (arg == "--threads" && value)
+		{
+			options.threads = std::max(atoi(value), 0);
+			i++;
+		}
+		else if (arg == "--output" && value)
+		{
+			options.output = value;
+			i++;
+		}
+		else if (arg == "--header" && value)
+		{
+			options.header = value;
+			i++;
+		}
+		else if (arg == "--name" && value)
+		{
+			options.name = value;
+			i++;
+		}
+		else if (arg == "--format" && value)
+		{
+			options.csv = strcmp(value, "csv") == 0;
+			i++;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--model bruneton|bruneton2017] [--bruneton-cache <dir>] [--elevations <n>] [--threads <n>] [--output <file>] [--header <file>] [--name <identifier>] [--format text|csv]\n", argv[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The reference model with its tables, or nullptr if there are none.
+static std::unique_ptr<SkyModel> create_reference(const FitOptions& options)
+{
+	if (options.model == "bruneton")
+	{
+		class CachedBrunetonSkyModel : public BrunetonSkyModel
+		{
+		public:
+			// The cache SkyModels writes for the default atmosphere, compressed or not. The single Mie table is used
+			// when the cache has it, like the application does at QUALITY_HIGH.
+			bool load(const std::string& dir)
+			{
+				const char*   extensions[] = { ".rawz", ".raw" };
+				const Quality qualities[] = { QUALITY_HIGH, QUALITY_LOW };
+
+				for (const char* extension : extensions)
+				{
+					for (Quality quality : qualities)
+					{
+						if (load_cache(m_lookup, m_atmosphere, quality, dir, extension))
+						{
+							m_quality = quality;
+							return true;
+						}
+					}
+				}
+
+				return false;
+			}
+		};
+
+		std::unique_ptr<CachedBrunetonSkyModel> model(new CachedBrunetonSkyModel());
+
+		if (!model->load(options.bruneton_cache))
+		{
+			fprintf(stderr, "no %s tables for the default atmosphere in %s, run SkyModels once to create them\n",
+					model->atmosphere().cache_path("*").c_str(), options.bruneton_cache.c_str());
+			return nullptr;
+		}
+
+		return model;
+	}
+
+	class PrecomputedBruneton2017SkyModel : public Bruneton2017SkyModel
+	{
+	public:
+		void load(const std::string& dir)
+		{
+			auto tables = std::make_shared<Bruneton2017Tables>();
+
+			if (!tables->load(m_atmosphere, dir))
+			{
+				fprintf(stderr, "no cached Bruneton 2017 tables in %s, precomputing them\n", dir.c_str());
+
+				Bruneton2017Precompute precompute(m_atmosphere);
+				precompute.run(*tables);
+			}
+
+			m_lookup.set_tables(std::move(tables));
+			m_lookup.set_atmosphere(m_atmosphere);
+		}
+	};
+
+	std::unique_ptr<PrecomputedBruneton2017SkyModel> model(new PrecomputedBruneton2017SkyModel());
+	model->load(options.bruneton_cache);
+
+	return model;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void print_report(const HosekFit& fit, const FitOptions& options)
+{
+	const std::vector<HosekFit::Error>& errors = fit.errors();
+	const std::vector<HosekFit::Error>& interpolated = fit.interpolated_errors();
+
+	if (options.csv)
+	{
+		printf("elevation_deg,interpolated,rms_relative,max_relative\n");
+
+		for (size_t i = 0; i < errors.size(); i++)
+		{
+			printf("%.4f,0,%.6f,%.6f\n", errors[i].sun_elevation, errors[i].rms, errors[i].max);
+
+			if (i < interpolated.size())
+				printf("%.4f,1,%.6f,%.6f\n", interpolated[i].sun_elevation, interpolated[i].rms, interpolated[i].max);
+		}
+
+		return;
+	}
+
+	printf("%s fitted at %d sun elevations, %zu bytes of coefficients\n\n", options.model.c_str(), fit.num_elevations(), fit.table().size() * sizeof(float));
+	printf("  elevation     rms error   max error\n");
+
+	float worst_rms = 0.0f;
+	float worst_max = 0.0f;
+
+	for (size_t i = 0; i < errors.size(); i++)
+	{
+		printf("  %7.3f deg   %8.3f %%  %8.3f %%\n", errors[i].sun_elevation, errors[i].rms * 100.0f, errors[i].max * 100.0f);
+
+		// Midpoints are indented, they are interpolated rather than fitted.
+		if (i < interpolated.size())
+			printf("    %7.3f deg %8.3f %%  %8.3f %%\n", interpolated[i].sun_elevation, interpolated[i].rms * 100.0f, interpolated[i].max * 100.0f);
+	}
+
+	for (const HosekFit::Error& e : errors)
+	{
+		worst_rms = std::max(worst_rms, e.rms);
+		worst_max = std::max(worst_max, e.max);
+	}
+
+	for (const HosekFit::Error& e : interpolated)
+	{
+		worst_rms = std::max(worst_rms, e.rms);
+		worst_max = std::max(worst_max, e.max);
+	}
+
+	printf("\n  worst        %8.3f %%  %8.3f %%\n", worst_rms * 100.0f, worst_max * 100.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	FitOptions options;
+
+	if (!parse_options(argc, argv, options))
+		return 2;
+
+	std::unique_ptr<SkyModel> reference = create_reference(options);
+
+	if (!reference)
+		return 2;
+
+	HosekFit fit;
+	fit.fit(*reference, options.elevations, options.threads);
+
+	print_report(fit, options);
+
+	if (!fit.save(options.output))
+	{
+		fprintf(stderr, "failed to write %s\n", options.output.c_str());
+		return 1;
+	}
+
+	if (!options.header.empty() && !fit.write_header(options.header, options.name.c_str()))
+	{
+		fprintf(stderr, "failed to write %s\n", options.header.c_str());
+		return 1;
+	}
+
+	return 0;
+}
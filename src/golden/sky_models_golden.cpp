@@ -0,0 +1,733 @@
+// Golden image accuracy check for the CPU sky evaluators. Renders a fixed grid of sun elevations and turbidities for
+// every model into a small HDR atlas (one upper hemisphere lat-long cell per state) and compares it against the
+// references in data/golden. The batched (SIMD) and the scalar evaluators are both compared, so a fast path that
+// drifts from the other one is caught as well. Prints the per-pixel relative error and PSNR of every cell and exits
+// with a non-zero status if any cell exceeds the thresholds.
+//
+// Usage: sky_models_golden [--golden-dir <dir>] [--update] [--max-relative-error <e>] [--min-psnr <db>]
+//                          [--bruneton-cache <dir>] [--hosek-data <dir>]
+//
+// --update rewrites the references from the current evaluators. Only do that for intended changes of the output.
+//
+// The Hosek-Wilkie XYZ and spectral datasets aren't redistributed, they are checked when sky_models_hosek_convert has
+// written them to --hosek-data. The reference header parser the converter uses is always checked, against the
+// compiled in RGB dataset. Every dataset that is loaded also has its single precision coefficients checked against
+// the double evaluation.
+//
+// When the Bruneton cache also has the single Mie table, the memory and accuracy of both BrunetonSkyModel qualities
+// are reported as well. That report never fails the run.
+
+#include "preetham_sky_model.h"
+#include "hosek_wilkie_sky_model.h"
+#include "hosek_dataset.h"
+#include "color_space.h"
+#include "bruneton_sky_model.h"
+#include "bruneton_lookup.h"
+#include "bruneton_atmosphere.h"
+#include "table_codec.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef SKY_MODELS_GOLDEN_DIR
+#define SKY_MODELS_GOLDEN_DIR "data/golden"
+#endif
+
+// The RGB dataset in the layout of the reference implementation's headers.
+#ifndef SKY_MODELS_HOSEK_RGB_HEADER
+#define SKY_MODELS_HOSEK_RGB_HEADER "src/hosek_data_rgb.inl"
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static const int   CELL_WIDTH = 32;
+static const int   CELL_HEIGHT = 16;
+static const float SUN_ELEVATIONS[] = { 2.0f, 10.0f, 30.0f, 60.0f };
+static const float TURBIDITIES[] = { 2.0f, 4.0f, 7.0f };
+static const float ALBEDO = 0.1f;
+
+// HosekDataset evaluates the coefficients in single precision, the largest relative error against the double
+// reference a dataset may have (HosekDataset::max_relative_error()).
+static const double HOSEK_FLOAT_ERROR = 1e-3;
+
+static const int NUM_ELEVATIONS = sizeof(SUN_ELEVATIONS) / sizeof(SUN_ELEVATIONS[0]);
+static const int NUM_TURBIDITIES = sizeof(TURBIDITIES) / sizeof(TURBIDITIES[0]);
+
+// Columns are sun elevations, rows are turbidities.
+static const int ATLAS_WIDTH = CELL_WIDTH * NUM_ELEVATIONS;
+static const int ATLAS_HEIGHT = CELL_HEIGHT * NUM_TURBIDITIES;
+
+struct GoldenOptions
+{
+	std::string golden_dir = SKY_MODELS_GOLDEN_DIR;
+	std::string bruneton_cache = ".";
+	std::string hosek_data = ".";
+	bool        update = false;
+	double      max_relative_error = 1e-3;
+	double      min_psnr = 60.0;
+};
+
+// RGB float image, rows top to bottom.
+struct Image
+{
+	int                width = 0;
+	int                height = 0;
+	std::vector<float> pixels;
+
+	Image() {}
+	Image(int w, int h) : width(w), height(h), pixels(size_t(w) * size_t(h) * 3) {}
+
+	inline float* pixel(int x, int y) { return &pixels[(size_t(y) * size_t(width) + size_t(x)) * 3]; }
+	inline const float* pixel(int x, int y) const { return &pixels[(size_t(y) * size_t(width) + size_t(x)) * 3]; }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Portable float map, little-endian and stored bottom to top.
+static bool write_pfm(const std::string& path, const Image& image)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	fprintf(f, "PF\n%d %d\n-1.0\n", image.width, image.height);
+
+	for (int y = image.height - 1; y >= 0; y--)
+		fwrite(image.pixel(0, y), sizeof(float), size_t(image.width) * 3, f);
+
+	bool ok = ferror(f) == 0;
+	fclose(f);
+
+	return ok;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_pfm(const std::string& path, Image& image)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	char  magic[3] = {};
+	int   width = 0;
+	int   height = 0;
+	float scale = 0.0f;
+
+	if (fscanf(f, "%2s %d %d %f", magic, &width, &height, &scale) != 4 || strcmp(magic, "PF") != 0 || width <= 0 || height <= 0 || scale >= 0.0f)
+	{
+		fclose(f);
+		return false;
+	}
+
+	// Single whitespace character between the header and the data.
+	fgetc(f);
+
+	image = Image(width, height);
+
+	bool ok = true;
+
+	for (int y = height - 1; y >= 0 && ok; y--)
+		ok = fread(image.pixel(0, y), sizeof(float), size_t(width) * 3, f) == size_t(width) * 3;
+
+	fclose(f);
+
+	return ok;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// View directions of one cell: azimuth across, elevation from the zenith (top) to the horizon (bottom).
+static void cell_directions(std::vector<float>& x, std::vector<float>& y, std::vector<float>& z)
+{
+	x.resize(CELL_WIDTH * CELL_HEIGHT);
+	y.resize(CELL_WIDTH * CELL_HEIGHT);
+	z.resize(CELL_WIDTH * CELL_HEIGHT);
+
+	for (int j = 0; j < CELL_HEIGHT; j++)
+	{
+		float elevation = (1.0f - (float(j) + 0.5f) / float(CELL_HEIGHT)) * float(M_PI) * 0.5f;
+
+		for (int i = 0; i < CELL_WIDTH; i++)
+		{
+			float azimuth = (float(i) + 0.5f) / float(CELL_WIDTH) * 2.0f * float(M_PI);
+			int   index = j * CELL_WIDTH + i;
+
+			x[index] = cosf(elevation) * cosf(azimuth);
+			y[index] = sinf(elevation);
+			z[index] = cosf(elevation) * sinf(azimuth);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Renders the grid with the batched evaluator into batched and with the per-direction one into scalar.
+static void render(SkyModel& model, Image& batched, Image& scalar)
+{
+	const int count = CELL_WIDTH * CELL_HEIGHT;
+
+	std::vector<float> x, y, z;
+	std::vector<float> r(count), g(count), b(count);
+
+	cell_directions(x, y, z);
+
+	batched = Image(ATLAS_WIDTH, ATLAS_HEIGHT);
+	scalar = Image(ATLAS_WIDTH, ATLAS_HEIGHT);
+
+	for (int t = 0; t < NUM_TURBIDITIES; t++)
+	{
+		for (int e = 0; e < NUM_ELEVATIONS; e++)
+		{
+			float elevation = glm::radians(SUN_ELEVATIONS[e]);
+
+			// set_direction() takes the direction the light travels in.
+			model.set_direction(-glm::vec3(cosf(elevation), sinf(elevation), 0.0f));
+			model.set_turbidity(TURBIDITIES[t]);
+			model.set_albedo(ALBEDO);
+			model.update();
+
+			model.radiance(count, x.data(), y.data(), z.data(), r.data(), g.data(), b.data());
+
+			for (int j = 0; j < CELL_HEIGHT; j++)
+			{
+				for (int i = 0; i < CELL_WIDTH; i++)
+				{
+					int index = j * CELL_WIDTH + i;
+
+					float* dst = batched.pixel(e * CELL_WIDTH + i, t * CELL_HEIGHT + j);
+
+					dst[0] = r[index];
+					dst[1] = g[index];
+					dst[2] = b[index];
+
+					glm::vec3 L = model.radiance(glm::vec3(x[index], y[index], z[index]));
+
+					dst = scalar.pixel(e * CELL_WIDTH + i, t * CELL_HEIGHT + j);
+
+					dst[0] = L.r;
+					dst[1] = L.g;
+					dst[2] = L.b;
+				}
+			}
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct CellError
+{
+	double max_relative_error = 0.0;
+	double mean_relative_error = 0.0;
+	double psnr = INFINITY;
+};
+
+// Relative error per channel against the golden value, with values below 1e-4 of the cell's peak compared in absolute
+// terms so dark pixels near the horizon don't dominate. PSNR uses the golden peak of the cell as the signal range.
+static CellError compare_cell(const Image& image, const Image& golden, int cell_x, int cell_y)
+{
+	CellError error;
+
+	float peak = 0.0f;
+
+	for (int j = 0; j < CELL_HEIGHT; j++)
+	{
+		for (int i = 0; i < CELL_WIDTH; i++)
+		{
+			const float* ref = golden.pixel(cell_x * CELL_WIDTH + i, cell_y * CELL_HEIGHT + j);
+			peak = std::max(peak, std::max(ref[0], std::max(ref[1], ref[2])));
+		}
+	}
+
+	const double floor = std::max(double(peak) * 1e-4, 1e-12);
+
+	double squared_error = 0.0;
+	int    count = 0;
+
+	for (int j = 0; j < CELL_HEIGHT; j++)
+	{
+		for (int i = 0; i < CELL_WIDTH; i++)
+		{
+			const float* ref = golden.pixel(cell_x * CELL_WIDTH + i, cell_y * CELL_HEIGHT + j);
+			const float* value = image.pixel(cell_x * CELL_WIDTH + i, cell_y * CELL_HEIGHT + j);
+
+			for (int c = 0; c < 3; c++)
+			{
+				double diff = double(value[c]) - double(ref[c]);
+				double relative = fabs(diff) / std::max(fabs(double(ref[c])), floor);
+
+				// NaNs fail the check rather than vanishing in the max.
+				if (relative != relative)
+					relative = INFINITY;
+
+				error.max_relative_error = std::max(error.max_relative_error, relative);
+				error.mean_relative_error += relative;
+				squared_error += diff * diff;
+				count++;
+			}
+		}
+	}
+
+	error.mean_relative_error /= double(count);
+
+	double mse = squared_error / double(count);
+
+	if (mse > 0.0)
+		error.psnr = 10.0 * log10(double(peak) * double(peak) / mse);
+	else if (mse != mse)
+		error.psnr = -INFINITY;
+
+	return error;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the number of failed cells.
+static int compare(const char* model, const char* evaluator, const Image& image, const Image& golden, const GoldenOptions& options)
+{
+	int failures = 0;
+
+	for (int t = 0; t < NUM_TURBIDITIES; t++)
+	{
+		for (int e = 0; e < NUM_ELEVATIONS; e++)
+		{
+			CellError error = compare_cell(image, golden, e, t);
+
+			bool failed = !(error.max_relative_error <= options.max_relative_error) || !(error.psnr >= options.min_psnr);
+
+			printf("%-9s %-8s elevation %5.1f turbidity %4.1f  max rel %.3e  mean rel %.3e  psnr %7.2f dB  %s\n",
+			       model, evaluator, SUN_ELEVATIONS[e], TURBIDITIES[t],
+			       error.max_relative_error, error.mean_relative_error, error.psnr, failed ? "FAIL" : "ok");
+
+			if (failed)
+				failures++;
+		}
+	}
+
+	return failures;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Returns the number of failures, -1 if the golden couldn't be read or written.
+static int check_model(const char* name, SkyModel& model, const GoldenOptions& options)
+{
+	std::string path = options.golden_dir + "/" + name + ".pfm";
+
+	Image batched, scalar;
+	render(model, batched, scalar);
+
+	if (options.update)
+	{
+		if (!write_pfm(path, batched))
+		{
+			fprintf(stderr, "failed to write %s\n", path.c_str());
+			return -1;
+		}
+
+		printf("%-9s wrote %s\n", name, path.c_str());
+
+		// The scalar path is still held to the new reference.
+		return compare(name, "scalar", scalar, batched, options);
+	}
+
+	Image golden;
+
+	if (!read_pfm(path, golden) || golden.width != ATLAS_WIDTH || golden.height != ATLAS_HEIGHT)
+	{
+		fprintf(stderr, "missing or mismatched golden image %s, run with --update to create it\n", path.c_str());
+		return -1;
+	}
+
+	return compare(name, "batched", batched, golden, options) + compare(name, "scalar", scalar, golden, options);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Renders the grid from HosekWilkieSkyModel::spectral_radiance(), the per band path, with the bands converted to
+// linear sRGB by to_rgb. Three band datasets only. Returns false if any band is negative or not finite.
+static bool render_bands(HosekWilkieSkyModel& model, const glm::mat3& to_rgb, Image& image)
+{
+	std::vector<float> x, y, z;
+	cell_directions(x, y, z);
+
+	image = Image(ATLAS_WIDTH, ATLAS_HEIGHT);
+
+	float bands[HosekDataset::MAX_BANDS];
+	bool  valid = true;
+
+	for (int t = 0; t < NUM_TURBIDITIES; t++)
+	{
+		for (int e = 0; e < NUM_ELEVATIONS; e++)
+		{
+			float elevation = glm::radians(SUN_ELEVATIONS[e]);
+
+			model.set_direction(-glm::vec3(cosf(elevation), sinf(elevation), 0.0f));
+			model.set_turbidity(TURBIDITIES[t]);
+			model.set_albedo(ALBEDO);
+			model.update();
+
+			for (int j = 0; j < CELL_HEIGHT; j++)
+			{
+				for (int i = 0; i < CELL_WIDTH; i++)
+				{
+					int index = j * CELL_WIDTH + i;
+
+					model.spectral_radiance(glm::vec3(x[index], y[index], z[index]), bands);
+
+					for (int band = 0; band < model.dataset()->num_bands(); band++)
+						valid &= std::isfinite(bands[band]) && bands[band] >= 0.0f;
+
+					if (model.dataset()->num_bands() != 3)
+						continue;
+
+					glm::vec3 L = to_rgb * glm::vec3(bands[0], bands[1], bands[2]);
+					float*    dst = image.pixel(e * CELL_WIDTH + i, t * CELL_HEIGHT + j);
+
+					dst[0] = L.r;
+					dst[1] = L.g;
+					dst[2] = L.b;
+				}
+			}
+		}
+	}
+
+	return valid;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// True if both datasets evaluate to exactly the same double coefficients over the whole parameter range.
+static bool same_hosek_dataset(const HosekDataset& a, const HosekDataset& b)
+{
+	if (a.num_bands() != b.num_bands())
+		return false;
+
+	double params_a[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	double params_b[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	double radiance_a[HosekDataset::MAX_BANDS];
+	double radiance_b[HosekDataset::MAX_BANDS];
+
+	const int steps = 8;
+
+	for (int t = 0; t < steps; t++)
+	{
+		for (int al = 0; al < steps; al++)
+		{
+			for (int e = 0; e < steps; e++)
+			{
+				float turbidity = 1.0f + 9.0f * float(t) / float(steps - 1);
+				float albedo = float(al) / float(steps - 1);
+				float sun_theta = float(M_PI / 2.0) * float(e) / float(steps - 1);
+
+				a.evaluate(turbidity, albedo, sun_theta, params_a, radiance_a);
+				b.evaluate(turbidity, albedo, sun_theta, params_b, radiance_b);
+
+				if (memcmp(params_a, params_b, sizeof(double) * HosekDataset::NUM_PARAMS * a.padded_bands()) != 0 ||
+					memcmp(radiance_a, radiance_b, sizeof(double) * a.padded_bands()) != 0)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The Hosek-Wilkie datasets: the reference header parser against the compiled in RGB dataset, then every dataset
+// (RGB and whichever of XYZ and spectral are in --hosek-data) through both the three channel and the per band
+// evaluation, which have to agree. Returns the number of failures, -1 if the RGB header can't be read.
+static int check_hosek_datasets(const GoldenOptions& options)
+{
+	std::unique_ptr<HosekDataset> parsed(HosekDataset::load_reference(HOSEK_DATASET_RGB, SKY_MODELS_HOSEK_RGB_HEADER));
+
+	if (!parsed)
+	{
+		fprintf(stderr, "failed to parse %s\n", SKY_MODELS_HOSEK_RGB_HEADER);
+		return -1;
+	}
+
+	int failures = 0;
+	bool same = same_hosek_dataset(*parsed, *HosekDataset::rgb());
+
+	printf("hosek     reference header parser against the built-in RGB dataset  %s\n", same ? "ok" : "FAIL");
+	failures += same ? 0 : 1;
+
+	const HosekDatasetType types[] = { HOSEK_DATASET_RGB, HOSEK_DATASET_XYZ, HOSEK_DATASET_SPECTRAL };
+	const char* names[] = { "hosek_rgb", "hosek_xyz", "hosek_spec" };
+
+	for (int i = 0; i < 3; i++)
+	{
+		std::unique_ptr<HosekDataset> loaded;
+
+		if (types[i] != HOSEK_DATASET_RGB)
+		{
+			loaded.reset(HosekDataset::load(types[i], options.hosek_data));
+
+			if (!loaded)
+			{
+				printf("%-9s skipped, no %s in %s, convert the reference header with sky_models_hosek_convert\n", names[i],
+					   HosekDataset::file_name(types[i], "*").c_str(), options.hosek_data.c_str());
+				continue;
+			}
+		}
+
+		HosekWilkieSkyModel model;
+		model.set_dataset(loaded.get());
+
+		double float_error = model.dataset()->max_relative_error();
+		bool   accurate = float_error < HOSEK_FLOAT_ERROR;
+
+		printf("%-9s float coefficients against double  max rel %.3e  %s\n", names[i], float_error, accurate ? "ok" : "FAIL");
+		failures += accurate ? 0 : 1;
+
+		Image batched, scalar, bands;
+		render(model, batched, scalar);
+
+		failures += compare(names[i], "scalar", scalar, batched, options);
+
+		// The spectral dataset renders RGB through the three channel interface, only its bands are checked for sanity.
+		bool valid = render_bands(model, types[i] == HOSEK_DATASET_XYZ ? xyz_to_rgb_matrix(COLOR_SPACE_SRGB) : glm::mat3(1.0f), bands);
+
+		if (model.dataset()->num_bands() == 3)
+			failures += compare(names[i], "bands", bands, batched, options);
+
+		printf("%-9s %d bands finite and non-negative  %s\n", names[i], model.dataset()->num_bands(), valid ? "ok" : "FAIL");
+		failures += valid ? 0 : 1;
+	}
+
+	return failures;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Error of image against reference over the whole grid and over the directions within 10 degrees of the sun, where
+// single Mie scattering dominates.
+static void print_quality_error(const char* quality, double gpu_mb, double cpu_mb, const Image& image, const Image& reference)
+{
+	std::vector<float> x, y, z;
+	cell_directions(x, y, z);
+
+	const float near_sun = cosf(glm::radians(10.0f));
+
+	double mean = 0.0, max = 0.0, sun_mean = 0.0, sun_max = 0.0;
+	int    count = 0, sun_count = 0;
+
+	for (int t = 0; t < NUM_TURBIDITIES; t++)
+	{
+		for (int e = 0; e < NUM_ELEVATIONS; e++)
+		{
+			float elevation = glm::radians(SUN_ELEVATIONS[e]);
+
+			for (int j = 0; j < CELL_HEIGHT; j++)
+			{
+				for (int i = 0; i < CELL_WIDTH; i++)
+				{
+					int  index = j * CELL_WIDTH + i;
+					bool sun = x[index] * cosf(elevation) + y[index] * sinf(elevation) > near_sun;
+
+					const float* ref = reference.pixel(e * CELL_WIDTH + i, t * CELL_HEIGHT + j);
+					const float* value = image.pixel(e * CELL_WIDTH + i, t * CELL_HEIGHT + j);
+
+					for (int c = 0; c < 3; c++)
+					{
+						double relative = fabs(double(value[c]) - double(ref[c])) / std::max(fabs(double(ref[c])), 1e-12);
+
+						mean += relative;
+						max = std::max(max, relative);
+						count++;
+
+						if (sun)
+						{
+							sun_mean += relative;
+							sun_max = std::max(sun_max, relative);
+							sun_count++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	printf("bruneton  quality %-4s  gpu %6.2f MB  cpu %6.2f MB  mean rel %.3e  max rel %.3e  near sun mean rel %.3e  max rel %.3e\n",
+		   quality, gpu_mb, cpu_mb, mean / std::max(count, 1), max, sun_mean / std::max(sun_count, 1), sun_max);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Both BrunetonSkyModel qualities against the single Mie table at full precision: QUALITY_LOW reconstructs single Mie
+// scattering from the inscatter alpha (GetMie()), QUALITY_HIGH samples the table at R11F_G11F_B10F precision.
+static void report_bruneton_quality(const BrunetonLookup& tables, const std::vector<float>& single_mie)
+{
+	class CachedBrunetonSkyModel : public BrunetonSkyModel
+	{
+	public:
+		CachedBrunetonSkyModel(const BrunetonLookup& lookup, const float* single_mie)
+		{
+			m_lookup.set_transmittance(lookup.transmittance_data());
+			m_lookup.set_irradiance(lookup.irradiance_data());
+			m_lookup.set_inscatter(lookup.inscatter_data());
+			m_lookup.set_single_mie(single_mie);
+		}
+	};
+
+	std::vector<float> quantized = single_mie;
+	BrunetonLookup::quantize_r11g11b10(quantized.data(), quantized.size() / 3);
+
+	CachedBrunetonSkyModel reference_model(tables, single_mie.data());
+	CachedBrunetonSkyModel low_model(tables, nullptr);
+	CachedBrunetonSkyModel high_model(tables, quantized.data());
+
+	Image reference, low, high, scalar;
+	render(reference_model, reference, scalar);
+	render(low_model, low, scalar);
+	render(high_model, high, scalar);
+
+	const double MB = 1024.0 * 1024.0;
+	const double texels = double(BrunetonLookup::INSCATTER_MU_S) * BrunetonLookup::INSCATTER_NU * BrunetonLookup::INSCATTER_MU * BrunetonLookup::INSCATTER_R;
+	const double tables_mb = (double(BrunetonLookup::TRANSMITTANCE_W) * BrunetonLookup::TRANSMITTANCE_H +
+							  double(BrunetonLookup::IRRADIANCE_W) * BrunetonLookup::IRRADIANCE_H + texels) * 4 * sizeof(float) / MB;
+
+	// R11F_G11F_B10F on the GPU, RGB floats on the CPU.
+	print_quality_error("low", tables_mb, tables_mb, low, reference);
+	print_quality_error("high", tables_mb + texels * 4 / MB, tables_mb + texels * 3 * sizeof(float) / MB, high, reference);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool parse_options(int argc, char** argv, GoldenOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (arg == "--update")
+			options.update = true;
+		else if (arg == "--golden-dir" && value)
+		{
+			options.golden_dir = value;
+			i++;
+		}
+		else if (arg == "--bruneton-cache" && value)
+		{
+			options.bruneton_cache = value;
+			i++;
+		}
+		else if (arg == "--hosek-data" && value)
+		{
+			options.hosek_data = value;
+			i++;
+		}
+		else if (arg == "--max-relative-error" && value)
+		{
+			options.max_relative_error = atof(value);
+			i++;
+		}
+		else if (arg == "--min-psnr" && value)
+		{
+			options.min_psnr = atof(value);
+			i++;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--golden-dir <dir>] [--update] [--max-relative-error <e>] [--min-psnr <db>] [--bruneton-cache <dir>] [--hosek-data <dir>]\n", argv[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	GoldenOptions options;
+
+	if (!parse_options(argc, argv, options))
+		return 2;
+
+	int failures = 0;
+	bool error = false;
+
+	PreethamSkyModel preetham;
+	HosekWilkieSkyModel hosek;
+
+	preetham.initialize();
+	hosek.initialize();
+
+	int result = check_model("preetham", preetham, options);
+	error |= result < 0;
+	failures += std::max(result, 0);
+
+	result = check_model("hosek", hosek, options);
+	error |= result < 0;
+	failures += std::max(result, 0);
+
+	result = check_hosek_datasets(options);
+	error |= result < 0;
+	failures += std::max(result, 0);
+
+	// The Bruneton tables are produced by the GPU precomputation and aren't checked in, so that model is only
+	// checked against a cache of the default atmosphere given on the command line (or found in the working directory).
+	const BrunetonAtmosphere atmosphere;
+	BrunetonLookup tables;
+
+	if (BrunetonSkyModel::load_cache(tables, atmosphere, BrunetonSkyModel::QUALITY_LOW, options.bruneton_cache))
+	{
+		class CachedBrunetonSkyModel : public BrunetonSkyModel
+		{
+		public:
+			CachedBrunetonSkyModel(const BrunetonLookup& lookup)
+			{
+				m_lookup.set_transmittance(lookup.transmittance_data());
+				m_lookup.set_irradiance(lookup.irradiance_data());
+				m_lookup.set_inscatter(lookup.inscatter_data());
+			}
+		};
+
+		CachedBrunetonSkyModel bruneton(tables);
+
+		result = check_model("bruneton", bruneton, options);
+		error |= result < 0;
+		failures += std::max(result, 0);
+
+		std::vector<float> single_mie(size_t(BrunetonLookup::INSCATTER_MU_S) * BrunetonLookup::INSCATTER_NU * BrunetonLookup::INSCATTER_MU * BrunetonLookup::INSCATTER_R * 3);
+
+		// Read as is, load_single_mie() would quantize it like the texture.
+		if (table_read_file(options.bruneton_cache + "/" + atmosphere.cache_path("single_mie"), single_mie.data(), single_mie.size()))
+			report_bruneton_quality(tables, single_mie);
+		else
+			printf("bruneton  quality report skipped, no single Mie table in %s\n", options.bruneton_cache.c_str());
+	}
+	else
+		printf("bruneton  skipped, no %s tables for the default atmosphere in %s, run SkyModels once or pass --bruneton-cache\n",
+			   atmosphere.cache_path("*").c_str(), options.bruneton_cache.c_str());
+
+	if (error)
+		return 2;
+
+	if (failures > 0)
+	{
+		printf("%d cell(s) exceeded max relative error %.3e or min PSNR %.2f dB\n", failures, options.max_relative_error, options.min_psnr);
+		return 1;
+	}
+
+	printf("all cells within max relative error %.3e and min PSNR %.2f dB\n", options.max_relative_error, options.min_psnr);
+
+	return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
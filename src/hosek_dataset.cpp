@@ -0,0 +1,481 @@
+#include "hosek_dataset.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "hosek_data_rgb.inl"
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const float HosekDataset::SPECTRAL_WAVELENGTHS[NUM_SPECTRAL_BANDS] = { 320.0f, 360.0f, 400.0f, 440.0f, 480.0f, 520.0f, 560.0f, 600.0f, 640.0f, 680.0f, 720.0f };
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Floats evaluate 8 bands per vec8f, doubles one band at a time.
+template <typename T>
+struct HosekLanes;
+
+template <>
+struct HosekLanes<float>
+{
+	typedef vec8f type;
+	static const int WIDTH = 8;
+
+	static inline vec8f load(const float* p) { return load8(p); }
+	static inline void  store(float* p, const vec8f& v) { store8(p, v); }
+	static inline vec8f fmadd(const vec8f& a, const vec8f& b, const vec8f& c) { return ::fmadd(a, b, c); }
+};
+
+template <>
+struct HosekLanes<double>
+{
+	typedef double type;
+	static const int WIDTH = 1;
+
+	static inline double load(const double* p) { return *p; }
+	static inline void   store(double* p, double v) { *p = v; }
+	static inline double fmadd(double a, double b, double c) { return a * b + c; }
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_doubles(const std::string& path, std::vector<double>& values)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+
+	if (!file)
+		return false;
+
+	size_t read = fread(values.data(), sizeof(double), values.size(), file);
+	fclose(file);
+
+	return read == values.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool write_doubles(const std::string& path, const std::vector<double>& values)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	size_t written = fwrite(values.data(), sizeof(double), values.size(), file);
+
+	return fclose(file) == 0 && written == values.size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Reads the initializer of "double name[] = { ... };" from the text of a reference header, skipping comments.
+static bool parse_array(const std::string& text, const std::string& name, std::vector<double>& values)
+{
+	values.clear();
+
+	for (size_t pos = text.find(name); pos != std::string::npos; pos = text.find(name, pos + 1))
+	{
+		// The definition only: a whole identifier followed by [, not its use in the datasets[] pointer arrays.
+		if (pos > 0 && (isalnum((unsigned char)text[pos - 1]) || text[pos - 1] == '_'))
+			continue;
+
+		size_t i = text.find_first_not_of(" \t", pos + name.size());
+
+		if (i == std::string::npos || text[i] != '[')
+			continue;
+
+		i = text.find('{', i);
+
+		if (i == std::string::npos)
+			return false;
+
+		for (i++; i < text.size() && text[i] != '}';)
+		{
+			if (text.compare(i, 2, "//") == 0)
+				i = text.find('\n', i);
+			else if (text.compare(i, 2, "/*") == 0)
+			{
+				i = text.find("*/", i);
+				i = i == std::string::npos ? i : i + 2;
+			}
+			else if (isdigit((unsigned char)text[i]) || text[i] == '-' || text[i] == '+' || text[i] == '.')
+			{
+				char* end = nullptr;
+				values.push_back(strtod(text.c_str() + i, &end));
+
+				if (end == text.c_str() + i)
+					return false;
+
+				i = size_t(end - text.c_str());
+			}
+			else
+				i++;
+		}
+
+		return i < text.size();
+	}
+
+	return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const HosekDataset* HosekDataset::rgb()
+{
+	static HosekDataset dataset(HOSEK_DATASET_RGB, 3, datasetsRGB, datasetsRGBRad);
+	return &dataset;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekDataset* HosekDataset::load(HosekDatasetType type, const std::string& config_path, const std::string& radiance_path)
+{
+	if (type == HOSEK_DATASET_RGB)
+		return nullptr;
+
+	int num_bands = type == HOSEK_DATASET_XYZ ? 3 : NUM_SPECTRAL_BANDS;
+
+	std::vector<double> config(num_bands * CONFIG_SIZE);
+	std::vector<double> radiance(num_bands * RADIANCE_SIZE);
+
+	if (!read_doubles(config_path, config) || !read_doubles(radiance_path, radiance))
+		return nullptr;
+
+	const double* config_bands[MAX_BANDS];
+	const double* radiance_bands[MAX_BANDS];
+
+	for (int i = 0; i < num_bands; i++)
+	{
+		config_bands[i] = &config[i * CONFIG_SIZE];
+		radiance_bands[i] = &radiance[i * RADIANCE_SIZE];
+	}
+
+	return new HosekDataset(type, num_bands, config_bands, radiance_bands);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekDataset* HosekDataset::load(HosekDatasetType type, const std::string& directory)
+{
+	std::string prefix = directory.empty() ? std::string() : directory + "/";
+
+	return load(type, prefix + file_name(type, "config"), prefix + file_name(type, "radiance"));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string HosekDataset::file_name(HosekDatasetType type, const char* table)
+{
+	const char* names[] = { "rgb", "xyz", "spectral" };
+
+	return std::string("hosek_") + names[type] + "_" + table + ".raw";
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekDataset* HosekDataset::load_reference(HosekDatasetType type, const std::string& header_path)
+{
+	FILE* file = fopen(header_path.c_str(), "rb");
+
+	if (!file)
+		return nullptr;
+
+	std::string text;
+	char buffer[65536];
+	size_t read;
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+
+	fclose(file);
+
+	int num_bands = type == HOSEK_DATASET_SPECTRAL ? NUM_SPECTRAL_BANDS : 3;
+
+	std::vector<double> config[MAX_BANDS];
+	std::vector<double> radiance[MAX_BANDS];
+	const double* config_bands[MAX_BANDS];
+	const double* radiance_bands[MAX_BANDS];
+
+	for (int band = 0; band < num_bands; band++)
+	{
+		// datasetRGB1/datasetRGBRad1, datasetXYZ1/datasetXYZRad1 and dataset320/datasetRad320.
+		char config_name[32];
+		char radiance_name[32];
+
+		if (type == HOSEK_DATASET_SPECTRAL)
+		{
+			snprintf(config_name, sizeof(config_name), "dataset%d", int(SPECTRAL_WAVELENGTHS[band]));
+			snprintf(radiance_name, sizeof(radiance_name), "datasetRad%d", int(SPECTRAL_WAVELENGTHS[band]));
+		}
+		else
+		{
+			const char* space = type == HOSEK_DATASET_XYZ ? "XYZ" : "RGB";
+
+			snprintf(config_name, sizeof(config_name), "dataset%s%d", space, band + 1);
+			snprintf(radiance_name, sizeof(radiance_name), "dataset%sRad%d", space, band + 1);
+		}
+
+		if (!parse_array(text, config_name, config[band]) || config[band].size() != CONFIG_SIZE ||
+			!parse_array(text, radiance_name, radiance[band]) || radiance[band].size() != RADIANCE_SIZE)
+			return nullptr;
+
+		config_bands[band] = config[band].data();
+		radiance_bands[band] = radiance[band].data();
+	}
+
+	return new HosekDataset(type, num_bands, config_bands, radiance_bands);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool HosekDataset::save(const std::string& config_path, const std::string& radiance_path) const
+{
+	std::vector<double> config(m_num_bands * CONFIG_SIZE);
+	std::vector<double> radiance(m_num_bands * RADIANCE_SIZE);
+
+	// The constructor in reverse, H and I swapped back to the order of the source datasets.
+	const int param_map[] = { 0, 1, 2, 3, 4, 5, 6, 8, 7 };
+
+	for (int band = 0; band < m_num_bands; band++)
+	{
+		for (int i = 0; i < RADIANCE_SIZE; i++)
+		{
+			radiance[band * RADIANCE_SIZE + i] = m_radiance_double[i * m_padded_bands + band];
+
+			for (int p = 0; p < NUM_PARAMS; p++)
+				config[band * CONFIG_SIZE + i * NUM_PARAMS + param_map[p]] = m_config_double[(i * NUM_PARAMS + p) * m_padded_bands + band];
+		}
+	}
+
+	return write_doubles(config_path, config) && write_doubles(radiance_path, radiance);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekDataset::HosekDataset(HosekDatasetType type, int num_bands, const double* const* config, const double* const* radiance) : m_type(type), m_num_bands(num_bands)
+{
+	m_padded_bands = ((num_bands + 7) / 8) * 8;
+
+	m_config.resize(CONFIG_SIZE * m_padded_bands, 0.0f);
+	m_config_double.resize(CONFIG_SIZE * m_padded_bands, 0.0);
+	m_radiance.resize(RADIANCE_SIZE * m_padded_bands, 0.0f);
+	m_radiance_double.resize(RADIANCE_SIZE * m_padded_bands, 0.0);
+
+	// H and I are swapped in the source datasets.
+	const int param_map[] = { 0, 1, 2, 3, 4, 5, 6, 8, 7 };
+
+	for (int band = 0; band < num_bands; band++)
+	{
+		for (int i = 0; i < RADIANCE_SIZE; i++)
+		{
+			m_radiance_double[i * m_padded_bands + band] = radiance[band][i];
+			m_radiance[i * m_padded_bands + band] = float(radiance[band][i]);
+
+			for (int p = 0; p < NUM_PARAMS; p++)
+			{
+				int idx = (i * NUM_PARAMS + p) * m_padded_bands + band;
+
+				m_config_double[idx] = config[band][i * NUM_PARAMS + param_map[p]];
+				m_config[idx] = float(m_config_double[idx]);
+			}
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekDataset::~HosekDataset()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekDataset::evaluate(float turbidity, float albedo, float sun_theta, float* params, float* radiance) const
+{
+	evaluate<float>(m_config.data(), m_radiance.data(), turbidity, albedo, sun_theta, params, radiance);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekDataset::evaluate(float turbidity, float albedo, float sun_theta, double* params, double* radiance) const
+{
+	evaluate<double>(m_config_double.data(), m_radiance_double.data(), turbidity, albedo, sun_theta, params, radiance);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekDataset::evaluate_8(const vec8f& turbidity, const vec8f& albedo, const vec8f& sun_theta, vec8f* params, vec8f* radiance) const
+{
+	// Same as evaluate(), with every weight and table row varying per lane.
+	vec8f elevation_k = pow(max(1.0f - sun_theta * float(2.0 / M_PI), 0.0f), 1.0f / 3.0f);
+
+	vec8i turbidity0 = min(max(to_int(turbidity), vec8i(1)), vec8i(10));
+	vec8i turbidity1 = min(turbidity0 + vec8i(1), vec8i(10));
+	vec8f turbidity_k = clamp(turbidity - to_float(turbidity0), 0.0f, 1.0f);
+
+	vec8f one_minus_k = 1.0f - elevation_k;
+	vec8f bernstein[NUM_CONTROL_POINTS];
+
+	bernstein[0] = one_minus_k * one_minus_k * one_minus_k * one_minus_k * one_minus_k;
+	bernstein[1] = 5.0f * one_minus_k * one_minus_k * one_minus_k * one_minus_k * elevation_k;
+	bernstein[2] = 10.0f * one_minus_k * one_minus_k * one_minus_k * elevation_k * elevation_k;
+	bernstein[3] = 10.0f * one_minus_k * one_minus_k * elevation_k * elevation_k * elevation_k;
+	bernstein[4] = 5.0f * one_minus_k * elevation_k * elevation_k * elevation_k * elevation_k;
+	bernstein[5] = elevation_k * elevation_k * elevation_k * elevation_k * elevation_k;
+
+	for (int i = 0; i < NUM_PARAMS * m_num_bands; i++)
+		params[i] = 0.0f;
+
+	for (int band = 0; band < m_num_bands; band++)
+		radiance[band] = 0.0f;
+
+	for (int a = 0; a < NUM_ALBEDOS; a++)
+	{
+		vec8f wa = a == 0 ? 1.0f - albedo : albedo;
+
+		for (int t = 0; t < 2; t++)
+		{
+			vec8f wt = t == 0 ? 1.0f - turbidity_k : turbidity_k;
+			vec8i turbidity_idx = (t == 0 ? turbidity0 : turbidity1) - vec8i(1);
+
+			for (int k = 0; k < NUM_CONTROL_POINTS; k++)
+			{
+				vec8f w = wa * wt * bernstein[k];
+				vec8i row = (vec8i(a * NUM_TURBIDITIES) + turbidity_idx) * vec8i(NUM_CONTROL_POINTS) + vec8i(k);
+				vec8i radiance_idx = row * vec8i(m_padded_bands);
+				vec8i config_idx = radiance_idx * vec8i(NUM_PARAMS);
+
+				for (int band = 0; band < m_num_bands; band++)
+				{
+					for (int p = 0; p < NUM_PARAMS; p++)
+						params[p * m_num_bands + band] = fmadd(w, gather(m_config.data(), config_idx + vec8i(p * m_padded_bands + band)), params[p * m_num_bands + band]);
+
+					radiance[band] = fmadd(w, gather(m_radiance.data(), radiance_idx + vec8i(band)), radiance[band]);
+				}
+			}
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double HosekDataset::max_relative_error(int steps) const
+{
+	float  params[NUM_PARAMS * MAX_BANDS];
+	float  radiance[MAX_BANDS];
+	double params_double[NUM_PARAMS * MAX_BANDS];
+	double radiance_double[MAX_BANDS];
+
+	double max_error = 0.0;
+
+	for (int t = 0; t < steps; t++)
+	{
+		float turbidity = 1.0f + 9.0f * float(t) / float(steps - 1);
+
+		for (int a = 0; a < steps; a++)
+		{
+			float albedo = float(a) / float(steps - 1);
+
+			for (int e = 0; e < steps; e++)
+			{
+				float sun_theta = float(M_PI / 2.0) * (1.0f - float(e) / float(steps - 1));
+
+				evaluate(turbidity, albedo, sun_theta, params, radiance);
+				evaluate(turbidity, albedo, sun_theta, params_double, radiance_double);
+
+				for (int band = 0; band < m_num_bands; band++)
+				{
+					for (int p = 0; p <= NUM_PARAMS; p++)
+					{
+						double reference = p < NUM_PARAMS ? params_double[p * m_padded_bands + band] : radiance_double[band];
+						double value = p < NUM_PARAMS ? params[p * m_padded_bands + band] : radiance[band];
+
+						max_error = std::max(max_error, fabs(value - reference) / std::max(fabs(reference), 1e-3));
+					}
+				}
+			}
+		}
+	}
+
+	return max_error;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+void HosekDataset::evaluate(const T* config, const T* radiance, float turbidity, float albedo, float sun_theta, T* params, T* out_radiance) const
+{
+	typedef typename HosekLanes<T>::type lanes;
+
+	// Splines are functions of elevation^1/3.
+	T elevation_k = std::pow(std::max(T(0), T(1) - T(sun_theta) / T(M_PI / 2.0)), T(1) / T(3));
+
+	// Table has values for turbidity 1..10.
+	int turbidity0 = std::min(std::max(int(turbidity), 1), 10);
+	int turbidity1 = std::min(turbidity0 + 1, 10);
+	T   turbidity_k = std::min(std::max(T(turbidity) - T(turbidity0), T(0)), T(1));
+
+	// Fold the quintic Bezier basis and the bilinear turbidity/albedo interpolation into one weight per table row.
+	const T binomial[] = { 1, 5, 10, 10, 5, 1 };
+	T       bernstein[NUM_CONTROL_POINTS];
+
+	for (int k = 0; k < NUM_CONTROL_POINTS; k++)
+		bernstein[k] = binomial[k] * std::pow(T(1) - elevation_k, T(5 - k)) * std::pow(elevation_k, T(k));
+
+	const int num_rows = NUM_ALBEDOS * 2 * NUM_CONTROL_POINTS;
+	int       rows[num_rows];
+	T         weights[num_rows];
+
+	for (int a = 0; a < NUM_ALBEDOS; a++)
+	{
+		T wa = a == 0 ? T(1) - T(albedo) : T(albedo);
+
+		for (int t = 0; t < 2; t++)
+		{
+			T   wt = t == 0 ? T(1) - turbidity_k : turbidity_k;
+			int turbidity_idx = (t == 0 ? turbidity0 : turbidity1) - 1;
+
+			for (int k = 0; k < NUM_CONTROL_POINTS; k++)
+			{
+				int idx = (a * 2 + t) * NUM_CONTROL_POINTS + k;
+
+				rows[idx] = (a * NUM_TURBIDITIES + turbidity_idx) * NUM_CONTROL_POINTS + k;
+				weights[idx] = wa * wt * bernstein[k];
+			}
+		}
+	}
+
+	for (int band = 0; band < m_padded_bands; band += HosekLanes<T>::WIDTH)
+	{
+		lanes sum[NUM_PARAMS];
+		lanes sum_radiance = T(0);
+
+		for (int p = 0; p < NUM_PARAMS; p++)
+			sum[p] = T(0);
+
+		for (int i = 0; i < num_rows; i++)
+		{
+			lanes    w = weights[i];
+			const T* row = &config[rows[i] * NUM_PARAMS * m_padded_bands + band];
+
+			for (int p = 0; p < NUM_PARAMS; p++)
+				sum[p] = HosekLanes<T>::fmadd(w, HosekLanes<T>::load(row + p * m_padded_bands), sum[p]);
+
+			sum_radiance = HosekLanes<T>::fmadd(w, HosekLanes<T>::load(&radiance[rows[i] * m_padded_bands + band]), sum_radiance);
+		}
+
+		for (int p = 0; p < NUM_PARAMS; p++)
+			HosekLanes<T>::store(params + p * m_padded_bands + band, sum[p]);
+
+		HosekLanes<T>::store(out_radiance + band, sum_radiance);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "simd.h"
+
+#include <string>
+#include <vector>
+
+enum HosekDatasetType
+{
+	HOSEK_DATASET_RGB,
+	HOSEK_DATASET_XYZ,
+	HOSEK_DATASET_SPECTRAL
+};
+
+// Fitted coefficients of the Hosek-Wilkie model for a set of bands (RGB, CIE XYZ or the 11 spectral bands from 320nm
+// to 720nm). The tables are stored transposed with the band as the innermost dimension, padded to a multiple of the
+// SIMD width, so a coefficient update evaluates the splines of 8 bands per instruction and costs the same for 3 or
+// 11 bands. The evaluation is templated on the scalar type: float runs in SIMD lanes and is what the models use,
+// double is kept as the reference the float path is validated against.
+//
+// The RGB dataset is compiled in. The XYZ and spectral datasets of the reference implementation
+// (ArHosekSkyModelData_CIEXYZ.h, ArHosekSkyModelData_Spectral.h) aren't redistributed here: sky_models_hosek_convert
+// reads those headers and writes them as raw little-endian double files, concatenated band after band:
+// NUM_BANDS * CONFIG_SIZE values for the configuration and NUM_BANDS * RADIANCE_SIZE values for the radiance.
+class HosekDataset
+{
+public:
+	static const int NUM_PARAMS = 9;
+	static const int NUM_CONTROL_POINTS = 6;
+	static const int NUM_TURBIDITIES = 10;
+	static const int NUM_ALBEDOS = 2;
+	static const int CONFIG_SIZE = NUM_PARAMS * NUM_CONTROL_POINTS * NUM_TURBIDITIES * NUM_ALBEDOS;
+	static const int RADIANCE_SIZE = NUM_CONTROL_POINTS * NUM_TURBIDITIES * NUM_ALBEDOS;
+	static const int NUM_SPECTRAL_BANDS = 11;
+	static const int MAX_BANDS = 16;
+
+	// Center wavelengths of the spectral bands in nanometers.
+	static const float SPECTRAL_WAVELENGTHS[NUM_SPECTRAL_BANDS];
+
+	static const HosekDataset* rgb();
+	static HosekDataset* load(HosekDatasetType type, const std::string& config_path, const std::string& radiance_path);
+
+	// Loads the files sky_models_hosek_convert writes, file_name(type, "config") and file_name(type, "radiance"), from
+	// directory (the working directory if empty).
+	static HosekDataset* load(HosekDatasetType type, const std::string& directory);
+	static std::string file_name(HosekDatasetType type, const char* table);
+
+	// Parses the dataset straight out of a header of the reference implementation (ArHosekSkyModelData_RGB.h,
+	// ArHosekSkyModelData_CIEXYZ.h or ArHosekSkyModelData_Spectral.h). Returns nullptr if an array is missing or
+	// doesn't hold the expected number of values.
+	static HosekDataset* load_reference(HosekDatasetType type, const std::string& header_path);
+
+	// Writes the raw double files load() reads.
+	bool save(const std::string& config_path, const std::string& radiance_path) const;
+
+	HosekDataset(HosekDatasetType type, int num_bands, const double* const* config, const double* const* radiance);
+	~HosekDataset();
+
+	// Writes the parameters A to I (in that order, with H and I already swapped back) as params[param * padded_bands() + band]
+	// and the radiance scale as radiance[band]. Lanes past num_bands() are written as zero.
+	void evaluate(float turbidity, float albedo, float sun_theta, float* params, float* radiance) const;
+	void evaluate(float turbidity, float albedo, float sun_theta, double* params, double* radiance) const;
+
+	// Evaluates 8 independent states at once, lanes are states rather than bands here. Writes params[param * num_bands() + band]
+	// and radiance[band].
+	void evaluate_8(const vec8f& turbidity, const vec8f& albedo, const vec8f& sun_theta, vec8f* params, vec8f* radiance) const;
+
+	// Sweeps turbidity 1 to 10, albedo 0 to 1 and sun elevation 0 to 90 degrees (steps samples each) and returns the
+	// largest relative error of the float evaluation against the double one over all parameters and bands. Values
+	// smaller than 1e-3 in magnitude are compared in absolute terms.
+	double max_relative_error(int steps = 16) const;
+
+	inline HosekDatasetType type() const { return m_type; }
+	inline int num_bands() const { return m_num_bands; }
+	inline int padded_bands() const { return m_padded_bands; }
+
+private:
+	template <typename T>
+	void evaluate(const T* config, const T* radiance, float turbidity, float albedo, float sun_theta, T* params, T* out_radiance) const;
+
+private:
+	HosekDatasetType m_type;
+	int m_num_bands;
+	int m_padded_bands;
+
+	// [albedo][turbidity][control point][param][band]
+	std::vector<float>  m_config;
+	std::vector<double> m_config_double;
+	// [albedo][turbidity][control point][band]
+	std::vector<float>  m_radiance;
+	std::vector<double> m_radiance_double;
+};
@@ -0,0 +1,680 @@
+#include "hosek_fit.h"
+#include "sky_time_of_day.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <limits>
+
+// Sample grid over the upper hemisphere: zenith angle times azimuth relative to the sun. The sky is symmetric about
+// the sun's vertical plane, so half the azimuths are enough.
+static const int NUM_THETA = 32;
+static const int NUM_PHI = 32;
+static const int NUM_SAMPLES = NUM_THETA * NUM_PHI;
+
+// Starting points of the search, the built-in dataset at these turbidities.
+static const float SEED_TURBIDITIES[] = { 2.0f, 4.0f, 7.0f };
+static const int   NUM_SEEDS = sizeof(SEED_TURBIDITIES) / sizeof(SEED_TURBIDITIES[0]);
+static const float SEED_ALBEDO = 0.1f;
+
+static const int NUM_NONLINEAR = 4;
+static const int NUM_LINEAR = 5;
+static const int MAX_EVALUATIONS = 1500;
+
+// Weight of the penalty on C, D, F, G and I, see fit_linear().
+static const double RIDGE = 1e-3;
+
+static const double HALF_PI = 1.57079632679489661923;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Elevation i of n at the SkyTimeOfDay spacing, as the sun's y. Fractional i give the points in between.
+static float elevation_sun_y(float i, int n)
+{
+	float u = i / float(n - 1);
+	return float(sin(double(u * u * u) * HALF_PI));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Direction towards the sun, at azimuth 0.
+static glm::vec3 sun_direction(float sun_y)
+{
+	return glm::vec3(sqrtf(std::max(1.0f - sun_y * sun_y, 0.0f)), sun_y, 0.0f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+struct SampleDirections
+{
+	std::vector<float> x, y, z;
+
+	// Solid angle of each sample, normalized to sum to one.
+	std::vector<double> weight;
+
+	SampleDirections() : x(NUM_SAMPLES), y(NUM_SAMPLES), z(NUM_SAMPLES), weight(NUM_SAMPLES)
+	{
+		double sum = 0.0;
+
+		for (int i = 0; i < NUM_THETA; i++)
+		{
+			double theta = (i + 0.5) / NUM_THETA * HALF_PI;
+
+			for (int j = 0; j < NUM_PHI; j++)
+			{
+				double phi = (j + 0.5) / NUM_PHI * 2.0 * HALF_PI;
+				int    k = i * NUM_PHI + j;
+
+				x[k] = float(sin(theta) * cos(phi));
+				y[k] = float(cos(theta));
+				z[k] = float(sin(theta) * sin(phi));
+				weight[k] = sin(theta);
+				sum += weight[k];
+			}
+		}
+
+		for (double& w : weight)
+			w /= sum;
+	}
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// The reference's radiance over the sample directions, one array per channel.
+struct ReferenceSamples
+{
+	std::vector<float> rgb[3];
+};
+
+static void sample_reference(SkyModel& reference, float sun_y, const SampleDirections& dirs, ReferenceSamples& samples)
+{
+	for (auto& channel : samples.rgb)
+		channel.resize(NUM_SAMPLES);
+
+	reference.set_direction(-sun_direction(sun_y));
+	reference.update();
+	reference.state().radiance(NUM_SAMPLES, dirs.x.data(), dirs.y.data(), dirs.z.data(), samples.rgb[0].data(), samples.rgb[1].data(), samples.rgb[2].data());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Everything the function needs per sample, clamped the way the evaluators and the shader do.
+struct FitSample
+{
+	double horizon;        // 1 / (cos_theta + 0.01)
+	double gamma;
+	double cos_gamma;
+	double cos_gamma_2;
+	double sqrt_cos_theta;
+	double weight;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void fit_samples(const SampleDirections& dirs, float sun_y, FitSample* samples)
+{
+	glm::vec3 sun = sun_direction(sun_y);
+
+	for (int k = 0; k < NUM_SAMPLES; k++)
+	{
+		double cos_theta = glm::clamp(double(dirs.y[k]), 0.0, 1.0);
+		double cos_gamma = glm::clamp(double(dirs.x[k]) * sun.x + double(dirs.y[k]) * sun.y + double(dirs.z[k]) * sun.z, 0.0, 1.0);
+
+		samples[k].horizon = 1.0 / (cos_theta + 0.01);
+		samples[k].gamma = acos(cos_gamma);
+		samples[k].cos_gamma = cos_gamma;
+		samples[k].cos_gamma_2 = cos_gamma * cos_gamma;
+		samples[k].sqrt_cos_theta = sqrt(cos_theta);
+		samples[k].weight = dirs.weight[k];
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Solves M c = v for the symmetric positive definite M by Cholesky decomposition. Returns false if M isn't.
+static bool solve_normal_equations(double M[NUM_LINEAR][NUM_LINEAR], const double* v, double* c)
+{
+	double L[NUM_LINEAR][NUM_LINEAR] = {};
+
+	for (int i = 0; i < NUM_LINEAR; i++)
+	{
+		for (int j = 0; j <= i; j++)
+		{
+			double sum = M[i][j];
+
+			for (int k = 0; k < j; k++)
+				sum -= L[i][k] * L[j][k];
+
+			if (i == j)
+			{
+				if (!(sum > 0.0))
+					return false;
+
+				L[i][i] = sqrt(sum);
+			}
+			else
+				L[i][j] = sum / L[j][j];
+		}
+	}
+
+	double y[NUM_LINEAR];
+
+	for (int i = 0; i < NUM_LINEAR; i++)
+	{
+		double sum = v[i];
+
+		for (int k = 0; k < i; k++)
+			sum -= L[i][k] * y[k];
+
+		y[i] = sum / L[i][i];
+	}
+
+	for (int i = NUM_LINEAR - 1; i >= 0; i--)
+	{
+		double sum = y[i];
+
+		for (int k = i + 1; k < NUM_LINEAR; k++)
+			sum -= L[k][i] * c[k];
+
+		c[i] = sum / L[i][i];
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// One channel at one elevation.
+struct FitProblem
+{
+	const FitSample* samples;
+
+	// 1 / reference radiance, the error is relative.
+	const double* inv_target;
+
+	// C, D, F, G and I of the row above, nullptr for the first row.
+	const double* prior;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// For fixed A, B, E and H (p) the function is linear in C, D, F, G and I. Solves for those (c) in the weighted relative
+// least squares sense and returns the weighted mean squared relative error plus the penalty below, or infinity outside
+// of the region the function is meant for.
+//
+// The bases are nearly collinear (D exp(E gamma) is a second C for small E, G chi is close to F cos^2 gamma), so
+// there are many almost equally good solutions with large terms cancelling out. A ridge towards the row above picks
+// the one closest to it, otherwise neighbouring rows can't be interpolated.
+static double fit_linear(const FitProblem& problem, const double* p, double* c)
+{
+	const double A = p[0], B = p[1], E = p[2], H = p[3];
+
+	// The ranges of the built-in dataset, loosened a little. A positive B explodes at the horizon, H is the Mie
+	// asymmetry of the aureole and E its falloff.
+	if (B > 0.0 || B < -3.0 || H < 0.0 || H > 0.95 || E > -0.25 || E < -20.0)
+		return std::numeric_limits<double>::infinity();
+
+	const FitSample* samples = problem.samples;
+	const double* inv_target = problem.inv_target;
+
+	double M[NUM_LINEAR][NUM_LINEAR] = {};
+	double v[NUM_LINEAR] = {};
+	double b[NUM_SAMPLES][NUM_LINEAR];
+
+	for (int k = 0; k < NUM_SAMPLES; k++)
+	{
+		const FitSample& s = samples[k];
+
+		double P = (1.0 + A * exp(B * s.horizon)) * inv_target[k];
+		double chi = (1.0 + s.cos_gamma_2) / pow(1.0 + H * H - 2.0 * s.cos_gamma * H, 1.5);
+
+		b[k][0] = P;
+		b[k][1] = P * exp(E * s.gamma);
+		b[k][2] = P * s.cos_gamma_2;
+		b[k][3] = P * chi;
+		b[k][4] = P * s.sqrt_cos_theta;
+
+		for (int i = 0; i < NUM_LINEAR; i++)
+		{
+			v[i] += s.weight * b[k][i];
+
+			for (int j = 0; j <= i; j++)
+				M[i][j] += s.weight * b[k][i] * b[k][j];
+		}
+	}
+
+	// Scaled by the diagonal, so the penalty doesn't depend on the units of the reference.
+	double ridge[NUM_LINEAR];
+
+	for (int i = 0; i < NUM_LINEAR; i++)
+	{
+		ridge[i] = RIDGE * M[i][i];
+
+		M[i][i] += ridge[i];
+		v[i] += ridge[i] * (problem.prior ? problem.prior[i] : 0.0);
+
+		for (int j = i + 1; j < NUM_LINEAR; j++)
+			M[i][j] = M[j][i];
+	}
+
+	if (!solve_normal_equations(M, v, c))
+		return std::numeric_limits<double>::infinity();
+
+	double error = 0.0;
+
+	for (int i = 0; i < NUM_LINEAR; i++)
+	{
+		double d = c[i] - (problem.prior ? problem.prior[i] : 0.0);
+		error += ridge[i] * d * d;
+	}
+
+	for (int k = 0; k < NUM_SAMPLES; k++)
+	{
+		double f = 0.0;
+
+		for (int i = 0; i < NUM_LINEAR; i++)
+			f += b[k][i] * c[i];
+
+		error += samples[k].weight * (f - 1.0) * (f - 1.0);
+	}
+
+	return std::isfinite(error) ? error : std::numeric_limits<double>::infinity();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Nelder-Mead over A, B, E and H from p, which receives the best point found. Returns its error.
+static double minimize(const FitProblem& problem, double* p)
+{
+	// Pointing away from the bounds fit_linear() puts on B, E and H.
+	const double steps[NUM_NONLINEAR] = { 0.2, -0.1, -0.5, p[3] > 0.5 ? -0.1 : 0.1 };
+
+	double simplex[NUM_NONLINEAR + 1][NUM_NONLINEAR];
+	double errors[NUM_NONLINEAR + 1];
+	double c[NUM_LINEAR];
+
+	for (int i = 0; i <= NUM_NONLINEAR; i++)
+	{
+		for (int j = 0; j < NUM_NONLINEAR; j++)
+			simplex[i][j] = p[j];
+
+		if (i > 0)
+			simplex[i][i - 1] += steps[i - 1];
+
+		errors[i] = fit_linear(problem, simplex[i], c);
+	}
+
+	int evaluations = NUM_NONLINEAR + 1;
+
+	while (evaluations < MAX_EVALUATIONS)
+	{
+		int order[NUM_NONLINEAR + 1];
+
+		for (int i = 0; i <= NUM_NONLINEAR; i++)
+			order[i] = i;
+
+		std::sort(order, order + NUM_NONLINEAR + 1, [&](int a, int b) { return errors[a] < errors[b]; });
+
+		int best = order[0];
+		int worst = order[NUM_NONLINEAR];
+		int second_worst = order[NUM_NONLINEAR - 1];
+
+		if (errors[worst] - errors[best] <= 1e-12 * errors[best] + 1e-18)
+			break;
+
+		double centroid[NUM_NONLINEAR] = {};
+
+		for (int i = 0; i <= NUM_NONLINEAR; i++)
+		{
+			if (i == worst)
+				continue;
+
+			for (int j = 0; j < NUM_NONLINEAR; j++)
+				centroid[j] += simplex[i][j] / NUM_NONLINEAR;
+		}
+
+		auto point = [&](double t, double* q) {
+			for (int j = 0; j < NUM_NONLINEAR; j++)
+				q[j] = centroid[j] + t * (simplex[worst][j] - centroid[j]);
+
+			evaluations++;
+			return fit_linear(problem, q, c);
+		};
+
+		double reflected[NUM_NONLINEAR];
+		double reflected_error = point(-1.0, reflected);
+
+		if (reflected_error < errors[best])
+		{
+			double expanded[NUM_NONLINEAR];
+			double expanded_error = point(-2.0, expanded);
+
+			bool expand = expanded_error < reflected_error;
+			std::copy(expand ? expanded : reflected, (expand ? expanded : reflected) + NUM_NONLINEAR, simplex[worst]);
+			errors[worst] = expand ? expanded_error : reflected_error;
+		}
+		else if (reflected_error < errors[second_worst])
+		{
+			std::copy(reflected, reflected + NUM_NONLINEAR, simplex[worst]);
+			errors[worst] = reflected_error;
+		}
+		else
+		{
+			bool outside = reflected_error < errors[worst];
+
+			double contracted[NUM_NONLINEAR];
+			double contracted_error = point(outside ? -0.5 : 0.5, contracted);
+
+			if (contracted_error < std::min(reflected_error, errors[worst]))
+			{
+				std::copy(contracted, contracted + NUM_NONLINEAR, simplex[worst]);
+				errors[worst] = contracted_error;
+			}
+			else
+			{
+				// Shrink towards the best point.
+				for (int i = 0; i <= NUM_NONLINEAR; i++)
+				{
+					if (i == best)
+						continue;
+
+					for (int j = 0; j < NUM_NONLINEAR; j++)
+						simplex[i][j] = simplex[best][j] + 0.5 * (simplex[i][j] - simplex[best][j]);
+
+					errors[i] = fit_linear(problem, simplex[i], c);
+					evaluations++;
+				}
+			}
+		}
+	}
+
+	int best = int(std::min_element(errors, errors + NUM_NONLINEAR + 1) - errors);
+	std::copy(simplex[best], simplex[best] + NUM_NONLINEAR, p);
+
+	return errors[best];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Weights of one channel of the reference, the relative error divides by it.
+static void inverse_target(const std::vector<float>& reference, double* inv_target)
+{
+	// A black reference sample (the tables evaluate to black if they weren't loaded) can't be matched in relative
+	// terms, so it is compared against a floor instead.
+	float max_target = *std::max_element(reference.begin(), reference.end());
+
+	for (int k = 0; k < NUM_SAMPLES; k++)
+		inv_target[k] = 1.0 / std::max(double(reference[k]), 1e-6 * max_target + 1e-30);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Fits one channel of every row, from the zenith down. Only the top row starts from the dataset (seeds holds NUM_SEEDS
+// tables of n rows), every other one from the row above. Independent fits end up in different local minima at
+// neighbouring elevations, which SkyTimeOfDay can't interpolate between.
+static void fit_channel(const std::vector<std::vector<FitSample>>& samples, const std::vector<ReferenceSamples>& reference, const float* seeds, int n, int channel, float* table)
+{
+	const int NUM_COEFFICIENTS = HosekFit::NUM_COEFFICIENTS;
+
+	std::vector<double> inv_target(NUM_SAMPLES);
+	std::vector<double> p(size_t(n) * NUM_NONLINEAR);
+	std::vector<double> c(size_t(n) * NUM_LINEAR);
+
+	// Fits row i starting from start, with the ridge towards prior.
+	auto fit_row = [&](int i, const double* start, const double* prior) {
+		inverse_target(reference[2 * i].rgb[channel], inv_target.data());
+
+		FitProblem problem = { samples[i].data(), inv_target.data(), prior };
+		double*    row_p = &p[size_t(i) * NUM_NONLINEAR];
+
+		std::copy(start, start + NUM_NONLINEAR, row_p);
+
+		// Restarting from the result gets Nelder-Mead out of a collapsed simplex.
+		minimize(problem, row_p);
+		minimize(problem, row_p);
+
+		fit_linear(problem, row_p, &c[size_t(i) * NUM_LINEAR]);
+	};
+
+	// The zenith row from the best of the seeds.
+	{
+		inverse_target(reference[2 * (n - 1)].rgb[channel], inv_target.data());
+
+		FitProblem problem = { samples[n - 1].data(), inv_target.data(), nullptr };
+		double     best[NUM_NONLINEAR] = {};
+		double     best_error = std::numeric_limits<double>::infinity();
+
+		for (int seed = 0; seed < NUM_SEEDS; seed++)
+		{
+			const float* s = &seeds[(size_t(seed) * n + n - 1) * NUM_COEFFICIENTS];
+
+			// A, B, E and H of this channel, moved into the region fit_linear() accepts.
+			double q[NUM_NONLINEAR] = { s[0 * 3 + channel], glm::clamp(double(s[1 * 3 + channel]), -2.9, -1e-3), std::min(double(s[4 * 3 + channel]), -0.3),
+										glm::clamp(double(s[7 * 3 + channel]), 0.01, 0.94) };
+			double error = minimize(problem, q);
+
+			if (error < best_error)
+			{
+				best_error = error;
+				std::copy(q, q + NUM_NONLINEAR, best);
+			}
+		}
+
+		fit_row(n - 1, best, nullptr);
+	}
+
+	for (int i = n - 2; i >= 0; i--)
+		fit_row(i, &p[size_t(i + 1) * NUM_NONLINEAR], &c[size_t(i + 1) * NUM_LINEAR]);
+
+	// With the sun at the zenith gamma is theta and the bases are at their most degenerate, so the first fit is
+	// usually in a different minimum than the rest. Refitting it from the row below keeps the last interval smooth.
+	fit_row(n - 1, &p[size_t(n - 2) * NUM_NONLINEAR], &c[size_t(n - 2) * NUM_LINEAR]);
+
+	for (int i = 0; i < n; i++)
+	{
+		const double* row_p = &p[size_t(i) * NUM_NONLINEAR];
+		const double* row_c = &c[size_t(i) * NUM_LINEAR];
+
+		// compute_coefficients() order: A, B, C, D, E, F, G, H, I, Z.
+		const double values[10] = { row_p[0], row_p[1], row_c[0], row_c[1], row_p[2], row_c[2], row_c[3], row_p[3], row_c[4], 1.0 };
+		float*       row = &table[size_t(i) * NUM_COEFFICIENTS];
+
+		for (int param = 0; param < 10; param++)
+			row[param * 3 + channel] = float(values[param]);
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static HosekFit::Error measure_error(HosekWilkieSkyModel& model, const SampleDirections& dirs, float sun_y, const ReferenceSamples& reference)
+{
+	std::vector<float> fitted[3];
+
+	for (auto& channel : fitted)
+		channel.resize(NUM_SAMPLES);
+
+	model.state().radiance(NUM_SAMPLES, dirs.x.data(), dirs.y.data(), dirs.z.data(), fitted[0].data(), fitted[1].data(), fitted[2].data());
+
+	double sum = 0.0;
+	double max = 0.0;
+
+	for (int k = 0; k < NUM_SAMPLES; k++)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			double target = reference.rgb[channel][k];
+			double relative = fabs(fitted[channel][k] - target) / std::max(target, 1e-30);
+
+			sum += dirs.weight[k] * relative * relative / 3.0;
+			max = std::max(max, relative);
+		}
+	}
+
+	HosekFit::Error error;
+	error.sun_elevation = float(asin(sun_y) * 90.0 / HALF_PI);
+	error.rms = float(sqrt(sum));
+	error.max = float(max);
+
+	return error;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekFit::fit(SkyModel& reference, int num_elevations, int num_threads)
+{
+	const int n = std::max(num_elevations, 2);
+
+	SampleDirections dirs;
+
+	// The rows and the midpoints between them, which are only used for the error report.
+	std::vector<ReferenceSamples> samples(2 * n - 1);
+
+	for (int i = 0; i < 2 * n - 1; i++)
+		sample_reference(reference, elevation_sun_y(0.5f * i, n), dirs, samples[i]);
+
+	reference.set_direction(glm::vec3(0.0f, -1.0f, 0.0f));
+	reference.update();
+
+	// Starting points from the built-in dataset, one table per seed turbidity.
+	HosekWilkieSkyModel hosek;
+	std::vector<float> seeds(size_t(NUM_SEEDS) * n * NUM_COEFFICIENTS);
+
+	{
+		std::vector<float> sun_y(n), albedo(n, SEED_ALBEDO), columns(size_t(NUM_COEFFICIENTS) * n);
+		float* outputs[NUM_COEFFICIENTS];
+
+		for (int i = 0; i < n; i++)
+			sun_y[i] = elevation_sun_y(float(i), n);
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+			outputs[j] = &columns[size_t(j) * n];
+
+		for (int seed = 0; seed < NUM_SEEDS; seed++)
+		{
+			std::vector<float> turbidity(n, SEED_TURBIDITIES[seed]);
+			SkyStateBatch states = { size_t(n), sun_y.data(), turbidity.data(), albedo.data() };
+
+			hosek.compute_coefficients(states, outputs, 1);
+
+			for (int i = 0; i < n; i++)
+			{
+				for (int j = 0; j < NUM_COEFFICIENTS; j++)
+					seeds[(size_t(seed) * n + i) * NUM_COEFFICIENTS + j] = outputs[j][i];
+			}
+		}
+	}
+
+	m_table.assign(size_t(n) * NUM_COEFFICIENTS, 0.0f);
+
+	std::vector<std::vector<FitSample>> fit(n, std::vector<FitSample>(NUM_SAMPLES));
+
+	for (int i = 0; i < n; i++)
+		fit_samples(dirs, elevation_sun_y(float(i), n), fit[i].data());
+
+	// The rows depend on each other, the channels don't.
+	parallel_for(3, 1, num_threads, [&](size_t begin, size_t end) {
+		for (size_t channel = begin; channel < end; channel++)
+			fit_channel(fit, samples, seeds.data(), n, int(channel), m_table.data());
+	});
+
+	// The report goes through the model, both directly and interpolated by SkyTimeOfDay.
+	m_errors.clear();
+	m_interpolated_errors.clear();
+
+	for (int i = 0; i < n; i++)
+	{
+		float sun_y = elevation_sun_y(float(i), n);
+
+		hosek.set_coefficients(-sun_direction(sun_y), &m_table[size_t(i) * NUM_COEFFICIENTS]);
+		m_errors.push_back(measure_error(hosek, dirs, sun_y, samples[2 * i]));
+	}
+
+	SkyTimeOfDay<HosekWilkieSkyModel> time_of_day(&hosek);
+	time_of_day.set_table(m_table);
+
+	for (int i = 0; i < n - 1; i++)
+	{
+		float sun_y = elevation_sun_y(i + 0.5f, n);
+
+		time_of_day.set_sun_direction(sun_direction(sun_y));
+		m_interpolated_errors.push_back(measure_error(hosek, dirs, sun_y, samples[2 * i + 1]));
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool HosekFit::save(const std::string& path) const
+{
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	uint32_t header[3] = { FILE_MAGIC, uint32_t(num_elevations()), uint32_t(NUM_COEFFICIENTS) };
+
+	bool written = fwrite(header, sizeof(uint32_t), 3, f) == 3 && fwrite(m_table.data(), sizeof(float), m_table.size(), f) == m_table.size();
+
+	return fclose(f) == 0 && written;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool HosekFit::load(const std::string& path)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	uint32_t header[3];
+	bool     valid = fread(header, sizeof(uint32_t), 3, f) == 3 && header[0] == FILE_MAGIC && header[1] >= 2 && header[1] <= 4096 && header[2] == uint32_t(NUM_COEFFICIENTS);
+
+	std::vector<float> table;
+
+	if (valid)
+	{
+		table.resize(size_t(header[1]) * NUM_COEFFICIENTS);
+		valid = fread(table.data(), sizeof(float), table.size(), f) == table.size();
+	}
+
+	fclose(f);
+
+	if (!valid)
+		return false;
+
+	m_table = std::move(table);
+	m_errors.clear();
+	m_interpolated_errors.clear();
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool HosekFit::write_header(const std::string& path, const char* name) const
+{
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (!f)
+		return false;
+
+	fprintf(f, "// Generated by sky_models_fit, do not edit. Hosek-Wilkie coefficients fitted to a precomputed sky (see HosekFit),\n");
+	fprintf(f, "// %d sun elevations of %d coefficients for SkyTimeOfDay::set_table().\n\n", num_elevations(), NUM_COEFFICIENTS);
+	fprintf(f, "static const int %s_ELEVATIONS = %d;\n\n", name, num_elevations());
+	fprintf(f, "static const float %s[] = {\n", name);
+
+	for (int i = 0; i < num_elevations(); i++)
+	{
+		fprintf(f, "\t");
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+			fprintf(f, "%.9ef,%s", m_table[size_t(i) * NUM_COEFFICIENTS + j], j + 1 < NUM_COEFFICIENTS ? " " : "\n");
+	}
+
+	fprintf(f, "};\n");
+
+	return fclose(f) == 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sky_model.h"
+#include "hosek_wilkie_sky_model.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Offline fit of the Hosek-Wilkie parametric function to another sky model, usually one of the Bruneton models, so
+// targets that can't afford the 3D tables (mobile, web) still get a sky that follows them. For each sun elevation the
+// reference is sampled over the upper hemisphere and A to I are fitted per channel, minimizing the solid angle
+// weighted relative error. C, D, F, G and I are linear given the others and are solved exactly, the remaining four
+// (A, B, E, H) are searched with Nelder-Mead, from the built-in RGB dataset at the zenith and from the row above for
+// every lower elevation, so the coefficients change smoothly enough to be interpolated. Z is 1, the radiance scale is
+// part of the linear terms.
+//
+// The elevations are the ones of SkyTimeOfDay (uniform in the cube root of the elevation), so table() goes straight
+// into SkyTimeOfDay<HosekWilkieSkyModel>::set_table(), or a row into HosekWilkieSkyModel::set_coefficients(). The
+// coefficients are in the reference's units and primaries (linear sRGB for both Bruneton models), so the consuming
+// model has to keep the default color space.
+class HosekFit
+{
+public:
+	static const int NUM_COEFFICIENTS = HosekWilkieSkyModel::NUM_BATCH_COEFFICIENTS;
+
+	// Layout, little endian: the magic, the number of elevations, NUM_COEFFICIENTS, then the table.
+	static const uint32_t FILE_MAGIC = 0x3146484b; // "KHF1"
+
+	// Relative error of the fitted model against the reference over the sample directions, weighted by solid angle.
+	// Measured through HosekWilkieSkyModel, so it includes everything the consumer does with the coefficients.
+	struct Error
+	{
+		float sun_elevation; // degrees
+		float rms;
+		float max;
+	};
+
+	// Samples reference at num_elevations sun elevations (and the midpoints between them for interpolated_errors())
+	// and fits a row of the table to each. Moves the reference's sun and leaves it at the zenith. The three
+	// channels are fitted on up to num_threads threads (0 = all cores).
+	void fit(SkyModel& reference, int num_elevations = 16, int num_threads = 0);
+
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+
+	// Writes the table as a C++ array definition named name, for targets that compile it in instead of reading a file.
+	bool write_header(const std::string& path, const char* name) const;
+
+	inline int num_elevations() const { return int(m_table.size() / NUM_COEFFICIENTS); }
+
+	// [elevation][coefficient], NUM_COEFFICIENTS floats per row in the HosekWilkieSkyModel::compute_coefficients() order.
+	inline const std::vector<float>& table() const { return m_table; }
+
+	// One per row of the table, empty after load().
+	inline const std::vector<Error>& errors() const { return m_errors; }
+
+	// At the midpoints between the rows, with the coefficients interpolated the way SkyTimeOfDay does. This is what a
+	// day cycle actually shows. One less than there are rows.
+	inline const std::vector<Error>& interpolated_errors() const { return m_interpolated_errors; }
+
+private:
+	std::vector<float> m_table;
+	std::vector<Error> m_errors;
+	std::vector<Error> m_interpolated_errors;
+};
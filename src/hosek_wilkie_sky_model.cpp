@@ -1,50 +1,14 @@
 #include "hosek_wilkie_sky_model.h"
+#include "preetham_coefficients.h"
 
-#include <macros.h>
-#include <logger.h>
-#include <utility.h>
+#include <string.h>
+#include <algorithm>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-#include "hosek_data_rgb.inl"
-
-// -----------------------------------------------------------------------------------------------------------------------------------
-
-
-double evaluate_spline(const double* spline, size_t stride, double value)
-{
-    return
-    1 *  pow(1 - value, 5) *                 spline[0 * stride] +
-    5 *  pow(1 - value, 4) * pow(value, 1) * spline[1 * stride] +
-    10 * pow(1 - value, 3) * pow(value, 2) * spline[2 * stride] +
-    10 * pow(1 - value, 2) * pow(value, 3) * spline[3 * stride] +
-    5 *  pow(1 - value, 1) * pow(value, 4) * spline[4 * stride] +
-    1 *                      pow(value, 5) * spline[5 * stride];
-}
-
-// -----------------------------------------------------------------------------------------------------------------------------------
-
-double evaluate(const double * dataset, size_t stride, float turbidity, float albedo, float sunTheta)
-{
-    // splines are functions of elevation^1/3
-    double elevationK = pow(std::max<float>(0.f, 1.f - sunTheta / (M_PI / 2.f)), 1.f / 3.0f);
-    
-    // table has values for turbidity 1..10
-    int turbidity0 = glm::clamp(static_cast<int>(turbidity), 1, 10);
-    int turbidity1 = std::min(turbidity0 + 1, 10);
-    float turbidityK = glm::clamp(turbidity - turbidity0, 0.f, 1.f);
-    
-    const double * datasetA0 = dataset;
-    const double * datasetA1 = dataset + stride * 6 * 10;
-    
-    double a0t0 = evaluate_spline(datasetA0 + stride * 6 * (turbidity0 - 1), stride, elevationK);
-    double a1t0 = evaluate_spline(datasetA1 + stride * 6 * (turbidity0 - 1), stride, elevationK);
-    double a0t1 = evaluate_spline(datasetA0 + stride * 6 * (turbidity1 - 1), stride, elevationK);
-    double a1t1 = evaluate_spline(datasetA1 + stride * 6 * (turbidity1 - 1), stride, elevationK);
-    
-    return a0t0 * (1 - albedo) * (1 - turbidityK) + a1t0 * albedo * (1 - turbidityK) + a0t1 * (1 - albedo) * turbidityK + a1t1 * albedo * turbidityK;
-}
+#include "simd.h"
+#include "parallel.h"
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
@@ -58,7 +22,7 @@ glm::vec3 hosek_wilkie(float cos_theta, float gamma, float cos_gamma, glm::vec3
 
 HosekWilkieSkyModel::HosekWilkieSkyModel()
 {
-
+    set_dataset(nullptr);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -72,55 +36,325 @@ HosekWilkieSkyModel::~HosekWilkieSkyModel()
 
 bool HosekWilkieSkyModel::initialize()
 {
+    // The single precision coefficients of every dataset are checked against the double reference by sky_models_golden.
     return true;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void HosekWilkieSkyModel::update()
+void HosekWilkieSkyModel::update_parameters()
 {
 	const float sunTheta = std::acos(glm::clamp(m_direction.y, 0.f, 1.f));
 
+    uint64_t key = SkyStateCache<Parameters>::key(sunTheta, m_turbidity, m_albedo);
+
+    if (const Parameters* cached = m_cache.find(key))
+    {
+        A = cached->A; B = cached->B; C = cached->C;
+        D = cached->D; E = cached->E; F = cached->F;
+        G = cached->G; H = cached->H; I = cached->I;
+        Z = cached->Z;
+
+        memcpy(m_params, cached->params, sizeof(m_params));
+        memcpy(m_band_radiance, cached->band_radiance, sizeof(m_band_radiance));
+
+        return;
+    }
+
+    m_dataset->evaluate(m_turbidity, m_albedo, sunTheta, m_params, m_band_radiance);
+
+    // The three channel interface (shaders, radiance()) can't represent the spectral bands, so it falls back to RGB.
+    int stride = m_dataset->padded_bands();
+    const float* params = m_params;
+    const float* band_radiance = m_band_radiance;
+
+    float rgb_params[HosekDataset::NUM_PARAMS * 8];
+    float rgb_radiance[8];
+
+    if (m_dataset->type() == HOSEK_DATASET_SPECTRAL)
+    {
+        HosekDataset::rgb()->evaluate(m_turbidity, m_albedo, sunTheta, rgb_params, rgb_radiance);
+
+        params = rgb_params;
+        band_radiance = rgb_radiance;
+        stride = 8;
+    }
+
+    glm::vec3* coefficients[] = { &A, &B, &C, &D, &E, &F, &G, &H, &I };
+
     for (int i = 0; i < 3; ++i)
     {
-        A[i] = evaluate(datasetsRGB[i] + 0, 9, m_turbidity, m_albedo, sunTheta);
-        B[i] = evaluate(datasetsRGB[i] + 1, 9, m_turbidity, m_albedo, sunTheta);
-        C[i] = evaluate(datasetsRGB[i] + 2, 9, m_turbidity, m_albedo, sunTheta);
-        D[i] = evaluate(datasetsRGB[i] + 3, 9, m_turbidity, m_albedo, sunTheta);
-        E[i] = evaluate(datasetsRGB[i] + 4, 9, m_turbidity, m_albedo, sunTheta);
-        F[i] = evaluate(datasetsRGB[i] + 5, 9, m_turbidity, m_albedo, sunTheta);
-        G[i] = evaluate(datasetsRGB[i] + 6, 9, m_turbidity, m_albedo, sunTheta);
-        
-        // Swapped in the dataset
-        H[i] = evaluate(datasetsRGB[i] + 8, 9, m_turbidity, m_albedo, sunTheta);
-        I[i] = evaluate(datasetsRGB[i] + 7, 9, m_turbidity, m_albedo, sunTheta);
-        
-        Z[i] = evaluate(datasetsRGBRad[i], 1, m_turbidity, m_albedo, sunTheta);
+        for (int p = 0; p < HosekDataset::NUM_PARAMS; p++)
+            (*coefficients[p])[i] = params[p * stride + i];
+
+        Z[i] = band_radiance[i];
     }
     
     if (m_normalized_sun_y)
     {
         glm::vec3 S = hosek_wilkie(std::cos(sunTheta), 0, 1.f, A, B, C, D, E, F, G, H, I) * Z;
-        Z /= glm::dot(S, glm::vec3(0.2126, 0.7152, 0.0722));
-        Z *= m_normalized_sun_y;
+        float scale = m_normalized_sun_y / (m_dataset->type() == HOSEK_DATASET_XYZ ? S.y : glm::dot(S, glm::vec3(0.2126, 0.7152, 0.0722)));
+
+        Z *= scale;
+
+        for (int i = 0; i < m_dataset->num_bands(); i++)
+            m_band_radiance[i] *= scale;
+    }
+
+    if (m_cache.capacity() > 0)
+    {
+        Parameters parameters = { A, B, C, D, E, F, G, H, I, Z, {}, {} };
+
+        memcpy(parameters.params, m_params, sizeof(m_params));
+        memcpy(parameters.band_radiance, m_band_radiance, sizeof(m_band_radiance));
+
+        m_cache.insert(key, parameters);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::compute_coefficients(const SkyStateBatch& states, float* const* coefficients, int num_threads) const
+{
+    const HosekDataset* dataset = m_dataset->num_bands() == 3 ? m_dataset : HosekDataset::rgb();
+    const bool xyz = dataset->type() == HOSEK_DATASET_XYZ;
+    const float normalized_sun_y = m_normalized_sun_y;
+
+    parallel_for(states.count, 8, num_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += 8)
+        {
+            size_t n = std::min<size_t>(end - i, 8);
+
+            vec8f cos_theta = clamp(load_partial(states.sun_y + i, n, 1.0f), 0.f, 1.f);
+            vec8f turbidity = load_partial(states.turbidity + i, n, 2.0f);
+            vec8f albedo = load_partial(states.albedo + i, n, 0.0f);
+
+            // [param * 3 + channel], A to I then Z.
+            vec8f out[NUM_BATCH_COEFFICIENTS];
+            dataset->evaluate_8(turbidity, albedo, acos(cos_theta), out, out + 27);
+
+            if (normalized_sun_y)
+            {
+                // hosek_wilkie() towards the sun itself, i.e. gamma = 0.
+                vec8f sqrt_cos_theta = sqrt(cos_theta);
+                vec8f inv_cos_theta = 1.f / (cos_theta + 0.01f);
+                vec8f S[3];
+
+                for (int c = 0; c < 3; c++)
+                {
+                    const vec8f& A = out[c];
+                    const vec8f& B = out[3 + c];
+                    const vec8f& C = out[6 + c];
+                    const vec8f& D = out[9 + c];
+                    const vec8f& F = out[15 + c];
+                    const vec8f& G = out[18 + c];
+                    const vec8f& H = out[21 + c];
+                    const vec8f& I = out[24 + c];
+
+                    vec8f chi = 2.f / pow(1.f + H * H - 2.f * H, 1.5f);
+                    S[c] = out[27 + c] * (1.f + A * exp(B * inv_cos_theta)) * (C + D + F + G * chi + I * sqrt_cos_theta);
+                }
+
+                vec8f luminance = xyz ? S[1] : 0.2126f * S[0] + 0.7152f * S[1] + 0.0722f * S[2];
+                vec8f scale = normalized_sun_y / luminance;
+
+                for (int c = 0; c < 3; c++)
+                    out[27 + c] = out[27 + c] * scale;
+            }
+
+            for (int j = 0; j < NUM_BATCH_COEFFICIENTS; j++)
+            {
+                if (n == 8)
+                    store8(coefficients[j] + i, out[j]);
+                else
+                    store_partial(coefficients[j] + i, out[j], n);
+            }
+        }
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::set_coefficients(const glm::vec3& dir, const float* coefficients)
+{
+    glm::vec3* parameters[] = { &A, &B, &C, &D, &E, &F, &G, &H, &I, &Z };
+
+    for (int p = 0; p < 10; p++)
+        *parameters[p] = glm::vec3(coefficients[p * 3], coefficients[p * 3 + 1], coefficients[p * 3 + 2]);
+
+    m_direction = -dir;
+
+    publish();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::set_dataset(const HosekDataset* dataset)
+{
+    m_dataset = dataset ? dataset : HosekDataset::rgb();
+
+    // Cached coefficients belong to the previous dataset.
+    m_cache.clear();
+
+    set_color_space(m_color_space);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::set_color_space(ColorSpace space)
+{
+    m_color_space = space;
+
+    // The XYZ dataset converts from CIE XYZ, the RGB one (and the spectral fallback) from linear sRGB.
+    if (m_dataset->type() == HOSEK_DATASET_XYZ)
+        m_color_matrix = xyz_to_rgb_matrix(space);
+    else
+        m_color_matrix = srgb_to_rgb_matrix(space);
+
+    mark_dirty();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::write_uniforms(SkyUniforms& uniforms)
+{
+	uniforms.set("u_Direction", m_direction);
+	uniforms.set("A", A);
+	uniforms.set("B", B);
+	uniforms.set("C", C);
+	uniforms.set("D", D);
+	uniforms.set("E", E);
+	uniforms.set("F", F);
+	uniforms.set("G", G);
+	uniforms.set("H", H);
+	uniforms.set("I", I);
+	uniforms.set("Z", Z);
+	uniforms.set("u_HosekToRGB", m_color_matrix);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 HosekWilkieSkyModel::sun_radiance(float altitude) const
+{
+    glm::vec3 transmittance;
+    preetham_sun_transmittance(std::acos(glm::clamp(m_direction.y, -1.f, 1.f)), m_turbidity, altitude, &transmittance[0]);
+
+    // Sampled near the sRGB primaries, converted like the sky.
+    return srgb_to_rgb_matrix(m_color_space) * transmittance * PREETHAM_SUN_IRRADIANCE;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const SkyState::Evaluator> HosekWilkieSkyModel::create_evaluator() const
+{
+    return std::make_shared<HosekWilkieSkyState>(m_direction, Coefficients{ A, B, C, D, E, F, G, H, I, Z }, m_color_matrix);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyModel::spectral_radiance(const glm::vec3& dir, float* bands)
+{
+    const int stride = m_dataset->padded_bands();
+
+    float cos_theta = glm::clamp(dir.y, 0.f, 1.f);
+    float cos_gamma = glm::clamp(glm::dot(dir, m_direction), 0.f, 1.f);
+    float gamma = std::acos(cos_gamma);
+
+    vec8f cos_gamma2 = cos_gamma * cos_gamma;
+    vec8f inv_cos_theta = 1.f / (cos_theta + 0.01f);
+    vec8f sqrt_cos_theta = sqrtf(cos_theta);
+
+    // Lanes are bands here, the direction dependent terms are shared.
+    for (int band = 0; band < stride; band += 8)
+    {
+        const float* p = m_params + band;
+
+        vec8f a = load8(p), b = load8(p + stride), c = load8(p + 2 * stride), d = load8(p + 3 * stride), e = load8(p + 4 * stride);
+        vec8f f = load8(p + 5 * stride), g = load8(p + 6 * stride), h = load8(p + 7 * stride), i = load8(p + 8 * stride);
+
+        vec8f chi = (1.f + cos_gamma2) / pow(1.f + h * h - 2.f * h * cos_gamma, 1.5f);
+        vec8f L = load8(m_band_radiance + band) * (1.f + a * exp(b * inv_cos_theta)) * (c + d * exp(e * gamma) + f * cos_gamma2 + g * chi + i * sqrt_cos_theta);
+
+        float lanes[8];
+        store8(lanes, L);
+
+        for (int j = 0; j < 8 && band + j < m_dataset->num_bands(); j++)
+            bands[band + j] = lanes[j];
     }
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void HosekWilkieSkyModel::set_render_uniforms(dw::Program* program)
+void HosekWilkieSkyModel::spectral_radiance(size_t count, const float* x, const float* y, const float* z, float* bands)
 {
-	program->set_uniform("u_Direction", m_direction);
-	program->set_uniform("A", A);
-	program->set_uniform("B", B);
-	program->set_uniform("C", C);
-	program->set_uniform("D", D);
-	program->set_uniform("E", E);
-	program->set_uniform("F", F);
-	program->set_uniform("G", G);
-	program->set_uniform("H", H);
-	program->set_uniform("I", I);
-	program->set_uniform("Z", Z);
+    const int num_bands = m_dataset->num_bands();
+
+    for (size_t i = 0; i < count; i++)
+        spectral_radiance(glm::vec3(x[i], y[i], z[i]), bands + i * num_bands);
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------
\ No newline at end of file
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+HosekWilkieSkyState::HosekWilkieSkyState(const glm::vec3& direction, const HosekWilkieSkyModel::Coefficients& coefficients, const glm::mat3& color_matrix) :
+    m_direction(direction), m_coefficients(coefficients), m_color_matrix(color_matrix)
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 HosekWilkieSkyState::radiance(const glm::vec3& dir) const
+{
+    const HosekWilkieSkyModel::Coefficients& p = m_coefficients;
+
+    float cos_theta = glm::clamp(dir.y, 0.f, 1.f);
+    float cos_gamma = glm::clamp(glm::dot(dir, m_direction), 0.f, 1.f);
+    float gamma = std::acos(cos_gamma);
+
+    return m_color_matrix * (p.Z * hosek_wilkie(cos_theta, gamma, cos_gamma, p.A, p.B, p.C, p.D, p.E, p.F, p.G, p.H, p.I));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void HosekWilkieSkyState::radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const
+{
+    const glm::vec3& A = m_coefficients.A;
+    const glm::vec3& B = m_coefficients.B;
+    const glm::vec3& C = m_coefficients.C;
+    const glm::vec3& D = m_coefficients.D;
+    const glm::vec3& E = m_coefficients.E;
+    const glm::vec3& F = m_coefficients.F;
+    const glm::vec3& G = m_coefficients.G;
+    const glm::vec3& H = m_coefficients.H;
+    const glm::vec3& I = m_coefficients.I;
+    const glm::vec3& Z = m_coefficients.Z;
+
+    float* out[3] = { r, g, b };
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        vec8f cos_theta = clamp(load8(y + i), 0.f, 1.f);
+        vec8f cos_gamma = clamp(load8(x + i) * m_direction.x + load8(y + i) * m_direction.y + load8(z + i) * m_direction.z, 0.f, 1.f);
+        vec8f gamma = acos(cos_gamma);
+        vec8f cos_gamma2 = cos_gamma * cos_gamma;
+        vec8f inv_cos_theta = 1.f / (cos_theta + 0.01f);
+        vec8f sqrt_cos_theta = sqrt(cos_theta);
+
+        vec8f L[3];
+
+        for (int c = 0; c < 3; c++)
+        {
+            vec8f chi = (1.f + cos_gamma2) / pow(1.f + H[c] * H[c] - 2.f * H[c] * cos_gamma, 1.5f);
+            L[c] = Z[c] * (1.f + A[c] * exp(B[c] * inv_cos_theta)) * (C[c] + D[c] * exp(E[c] * gamma) + F[c] * cos_gamma2 + G[c] * chi + I[c] * sqrt_cos_theta);
+        }
+
+        for (int c = 0; c < 3; c++)
+            store8(out[c] + i, L[0] * m_color_matrix[0][c] + L[1] * m_color_matrix[1][c] + L[2] * m_color_matrix[2][c]);
+    }
+
+    if (i < count)
+        SkyState::Evaluator::radiance(count - i, x + i, y + i, z + i, r + i, g + i, b + i);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "sky_model.h"
+#include "hosek_dataset.h"
+#include "sky_state_cache.h"
+#include "color_space.h"
 
 // An Analytic Model for Full Spectral Sky-Dome Radiance (Lukas Hosek, Alexander Wilkie)
 class HosekWilkieSkyModel : public SkyModel
@@ -10,10 +13,86 @@ public:
 	~HosekWilkieSkyModel();
 
 	bool initialize() override;
-	void update() override;
-	void set_render_uniforms(dw::Program* program) override;
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// The solar radiance function of the later Hosek-Wilkie paper needs its own spectral dataset, so this is the
+	// Preetham sun (preetham_sun_transmittance()), which uses the same definition of turbidity.
+	glm::vec3 sun_radiance(float altitude) const override;
+
+	// Selects the fitted dataset used by update(). nullptr restores the built-in RGB dataset. The model doesn't take ownership.
+	// With the XYZ dataset the three channel outputs are converted to the working space, with the spectral dataset they use RGB.
+	void set_dataset(const HosekDataset* dataset);
+	inline const HosekDataset* dataset() { return m_dataset; }
+
+	// Working space of radiance() and the shader output (through u_HosekToRGB), linear sRGB by default.
+	void set_color_space(ColorSpace space);
+	inline ColorSpace color_space() { return m_color_space; }
+
+	// Radiance of every band of the current dataset (num_bands() values per direction, in the dataset's units).
+	void spectral_radiance(const glm::vec3& dir, float* bands);
+	void spectral_radiance(size_t count, const float* x, const float* y, const float* z, float* bands);
+
+	// Computes the coefficients of many independent states without touching the model's own state or any GL
+	// resources. coefficients[param * 3 + channel] receives states.count floats for A to I and Z, exactly what
+	// update() would produce. Uses the current dataset when it has three channels and RGB otherwise. Vectorized
+	// across states and split over num_threads (0 = all cores).
+	static const int NUM_BATCH_COEFFICIENTS = 30;
+	void compute_coefficients(const SkyStateBatch& states, float* const* coefficients, int num_threads = 0) const;
+
+	// Takes one set of coefficients, NUM_BATCH_COEFFICIENTS floats in the compute_coefficients() order, instead of
+	// computing them, e.g. interpolated from a precomputed table. dir is the light direction as in set_direction(). Publishes a new state and leaves the model clean; the current turbidity and albedo are
+	// assumed to match the coefficients.
+	// spectral_radiance() isn't covered and keeps the bands of the last update().
+	void set_coefficients(const glm::vec3& dir, const float* coefficients);
+
+	// Optional LRU cache of recent coefficient sets, disabled (zero) by default.
+	inline void set_cache_capacity(size_t capacity) { m_cache.set_capacity(capacity); }
+
+	// RGB (or XYZ) coefficients of one state.
+	struct Coefficients
+	{
+		glm::vec3 A, B, C, D, E, F, G, H, I;
+		glm::vec3 Z;
+	};
+
+protected:
+	void update_parameters() override;
+	std::shared_ptr<const SkyState::Evaluator> create_evaluator() const override;
 
 private:
+	struct Parameters
+	{
+		glm::vec3 A, B, C, D, E, F, G, H, I;
+		glm::vec3 Z;
+		float     params[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+		float     band_radiance[HosekDataset::MAX_BANDS];
+	};
+
 	glm::vec3 A, B, C, D, E, F, G, H, I;
     glm::vec3 Z;
-};
\ No newline at end of file
+
+	const HosekDataset* m_dataset = nullptr;
+	ColorSpace m_color_space = COLOR_SPACE_SRGB;
+	glm::mat3 m_color_matrix;
+
+	// Per band coefficients A to I (padded_bands() apart) and radiance scale of the current dataset.
+	float m_params[HosekDataset::NUM_PARAMS * HosekDataset::MAX_BANDS];
+	float m_band_radiance[HosekDataset::MAX_BANDS];
+
+	SkyStateCache<Parameters> m_cache;
+};
+
+// Const evaluation of one Hosek-Wilkie state, see SkyState.
+class HosekWilkieSkyState : public SkyState::Evaluator
+{
+public:
+	HosekWilkieSkyState(const glm::vec3& direction, const HosekWilkieSkyModel::Coefficients& coefficients, const glm::mat3& color_matrix);
+
+	glm::vec3 radiance(const glm::vec3& dir) const override;
+	void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const override;
+
+private:
+	glm::vec3 m_direction;
+	HosekWilkieSkyModel::Coefficients m_coefficients;
+	glm::mat3 m_color_matrix;
+};
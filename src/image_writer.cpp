@@ -0,0 +1,496 @@
+#include "image_writer.h"
+#include "parallel.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+
+// Deflate parameters. Matches are 3 to 258 bytes long within a 32 KB window.
+static const size_t MIN_MATCH = 3;
+static const size_t MAX_MATCH = 258;
+static const size_t WINDOW_SIZE = 32768;
+static const int HASH_BITS = 15;
+
+// Filtered bytes per independently compressed band of rows, rounded to whole rows.
+static const size_t BAND_SIZE = 256 * 1024;
+
+static const uint32_t ADLER_BASE = 65521;
+
+static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Deflate packs bits from the least significant end, Huffman codes go in most significant bit first.
+class BitWriter
+{
+public:
+	BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+	inline void put(uint32_t value, int count)
+	{
+		m_bits |= uint64_t(value) << m_count;
+		m_count += count;
+
+		while (m_count >= 8)
+		{
+			m_out.push_back(uint8_t(m_bits));
+			m_bits >>= 8;
+			m_count -= 8;
+		}
+	}
+
+	inline void put_code(uint32_t code, int length)
+	{
+		uint32_t reversed = 0;
+
+		for (int i = 0; i < length; i++)
+			reversed |= ((code >> i) & 1) << (length - 1 - i);
+
+		put(reversed, length);
+	}
+
+	inline void align()
+	{
+		if (m_count > 0)
+			put(0, 8 - m_count);
+	}
+
+private:
+	std::vector<uint8_t>& m_out;
+	uint64_t m_bits = 0;
+	int m_count = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6).
+static inline void put_symbol(BitWriter& writer, uint32_t symbol)
+{
+	if (symbol < 144)
+		writer.put_code(0x30 + symbol, 8);
+	else if (symbol < 256)
+		writer.put_code(0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		writer.put_code(symbol - 256, 7);
+	else
+		writer.put_code(0xc0 + symbol - 280, 8);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void put_match(BitWriter& writer, size_t length, size_t distance)
+{
+	int l = 28;
+
+	while (LENGTH_BASE[l] > length)
+		l--;
+
+	put_symbol(writer, 257 + l);
+	writer.put(uint32_t(length - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+
+	int d = 29;
+
+	while (DISTANCE_BASE[d] > distance)
+		d--;
+
+	writer.put_code(d, 5);
+	writer.put(uint32_t(distance - DISTANCE_BASE[d]), DISTANCE_EXTRA[d]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// One fixed Huffman block over src, with a greedy parse and a single entry hash table of the last position each 3
+// byte sequence was seen at. Matches stay within src, so bands compress independently. Ends byte aligned: the last
+// band is the final block, the others are followed by an empty stored block, like a zlib sync flush.
+static void deflate_band(const uint8_t* src, size_t size, bool last, std::vector<uint8_t>& out)
+{
+	std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+
+	BitWriter writer(out);
+	writer.put(last ? 1 : 0, 1);
+	writer.put(1, 2);
+
+	size_t i = 0;
+
+	while (i < size)
+	{
+		if (i + MIN_MATCH <= size)
+		{
+			uint32_t sequence = uint32_t(src[i]) | uint32_t(src[i + 1]) << 8 | uint32_t(src[i + 2]) << 16;
+			uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+
+			// Positions are stored + 1 so that 0 means empty.
+			size_t candidate = table[hash];
+			table[hash] = uint32_t(i + 1);
+
+			if (candidate && i - (candidate - 1) <= WINDOW_SIZE)
+			{
+				size_t ref = candidate - 1;
+				size_t length = 0;
+				size_t max_length = std::min(MAX_MATCH, size - i);
+
+				while (length < max_length && src[ref + length] == src[i + length])
+					length++;
+
+				if (length >= MIN_MATCH)
+				{
+					put_match(writer, length, i - ref);
+					i += length;
+					continue;
+				}
+			}
+		}
+
+		put_symbol(writer, src[i]);
+		i++;
+	}
+
+	put_symbol(writer, 256);
+
+	if (!last)
+	{
+		writer.put(0, 3);
+		writer.align();
+
+		const uint8_t empty_stored[] = { 0x00, 0x00, 0xff, 0xff };
+		out.insert(out.end(), empty_stored, empty_stored + sizeof(empty_stored));
+	}
+	else
+		writer.align();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t adler32(const uint8_t* data, size_t size)
+{
+	uint32_t a = 1;
+	uint32_t b = 0;
+
+	while (size > 0)
+	{
+		// The largest run that can't overflow 32 bits before the modulo.
+		size_t n = std::min(size, size_t(5552));
+
+		for (size_t i = 0; i < n; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+		data += n;
+		size -= n;
+	}
+
+	return b << 16 | a;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Adler-32 of the concatenation, from the checksums of both parts and the size of the second (as in zlib).
+static uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+	uint32_t rem = uint32_t(size2 % ADLER_BASE);
+	uint32_t sum1 = adler1 & 0xffff;
+	uint32_t sum2 = uint32_t((uint64_t(rem) * sum1) % ADLER_BASE);
+
+	sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+
+	if (sum1 >= ADLER_BASE)
+		sum1 -= ADLER_BASE;
+	if (sum1 >= ADLER_BASE)
+		sum1 -= ADLER_BASE;
+	if (sum2 >= (ADLER_BASE << 1))
+		sum2 -= (ADLER_BASE << 1);
+	if (sum2 >= ADLER_BASE)
+		sum2 -= ADLER_BASE;
+
+	return sum1 | (sum2 << 16);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const struct CrcTable
+	{
+		uint32_t entries[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+
+				entries[n] = c;
+			}
+		}
+	} table;
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < size; i++)
+		crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+
+	return uint8_t(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Predictor of PNG filter type 0 to 4 (None, Sub, Up, Average, Paeth) from the bytes left, above and above left.
+static inline int predict(int filter, int a, int b, int c)
+{
+	switch (filter)
+	{
+		case 1: return a;
+		case 2: return b;
+		case 3: return (a + b) >> 1;
+		case 4: return paeth(a, b, c);
+		default: return 0;
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Filters one row into out (filter type byte first) with whichever of the five filters gives the smallest sum of
+// absolute signed bytes, the usual heuristic for the most compressible row. prev is null for the first row.
+static void filter_row(const uint8_t* row, const uint8_t* prev, size_t size, uint8_t* out)
+{
+	uint32_t cost[5] = { 0, 0, 0, 0, 0 };
+
+	// Costs first, without keeping the filtered rows. a is the byte to the left, b above, c above left.
+	for (size_t i = 0; i < size; i++)
+	{
+		int a = i >= 3 ? row[i - 3] : 0;
+		int b = prev ? prev[i] : 0;
+		int c = prev && i >= 3 ? prev[i - 3] : 0;
+
+		for (int f = 0; f < 5; f++)
+			cost[f] += uint32_t(abs(int(int8_t(uint8_t(row[i] - predict(f, a, b, c))))));
+	}
+
+	int best = int(std::min_element(cost, cost + 5) - cost);
+
+	out[0] = uint8_t(best);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		int a = i >= 3 ? row[i - 3] : 0;
+		int b = prev ? prev[i] : 0;
+		int c = prev && i >= 3 ? prev[i - 3] : 0;
+
+		out[1 + i] = uint8_t(row[i] - predict(best, a, b, c));
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline void append_u32_be(std::vector<uint8_t>& out, uint32_t v)
+{
+	for (int i = 3; i >= 0; i--)
+		out.push_back(uint8_t(v >> (i * 8)));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void append_chunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t size)
+{
+	append_u32_be(png, uint32_t(size));
+
+	size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data, data + size);
+
+	append_u32_be(png, crc32(png.data() + start, png.size() - start));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void encode_png(int width, int height, const uint8_t* rgb, std::vector<uint8_t>& png, int num_threads)
+{
+	size_t row_size = size_t(width) * 3;
+	size_t band_rows = std::max(BAND_SIZE / (row_size + 1), size_t(1));
+	size_t num_bands = (size_t(height) + band_rows - 1) / band_rows;
+
+	std::vector<std::vector<uint8_t>> deflated(num_bands);
+	std::vector<uint32_t> adlers(num_bands);
+	std::vector<size_t> sizes(num_bands);
+
+	parallel_for(num_bands, 1, num_threads, [&](size_t begin, size_t end) {
+		std::vector<uint8_t> filtered;
+
+		for (size_t band = begin; band < end; band++)
+		{
+			size_t first = band * band_rows;
+			size_t rows = std::min(band_rows, size_t(height) - first);
+
+			filtered.resize(rows * (row_size + 1));
+
+			for (size_t y = 0; y < rows; y++)
+			{
+				const uint8_t* row = rgb + (first + y) * row_size;
+				filter_row(row, first + y > 0 ? row - row_size : nullptr, row_size, &filtered[y * (row_size + 1)]);
+			}
+
+			deflate_band(filtered.data(), filtered.size(), band == num_bands - 1, deflated[band]);
+
+			adlers[band] = adler32(filtered.data(), filtered.size());
+			sizes[band] = filtered.size();
+		}
+	});
+
+	// zlib stream: deflate with a 32 KB window and no dictionary, the bands, the Adler-32 of the filtered rows.
+	std::vector<uint8_t> idat = { 0x78, 0x01 };
+	uint32_t adler = 1;
+
+	for (size_t band = 0; band < num_bands; band++)
+	{
+		idat.insert(idat.end(), deflated[band].begin(), deflated[band].end());
+		adler = adler32_combine(adler, adlers[band], sizes[band]);
+	}
+
+	append_u32_be(idat, adler);
+
+	// 8 bit truecolor, no interlacing.
+	std::vector<uint8_t> ihdr;
+	append_u32_be(ihdr, uint32_t(width));
+	append_u32_be(ihdr, uint32_t(height));
+	ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });
+
+	const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	png.assign(signature, signature + sizeof(signature));
+	append_chunk(png, "IHDR", ihdr.data(), ihdr.size());
+	append_chunk(png, "IDAT", idat.data(), idat.size());
+	append_chunk(png, "IEND", nullptr, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool write_file(const std::string& path, const void* header, size_t header_size, const void* data, size_t size)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	bool written = fwrite(header, 1, header_size, f) == header_size && (size == 0 || fwrite(data, 1, size, f) == size);
+
+	return fclose(f) == 0 && written;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_png(const std::string& path, int width, int height, const uint8_t* rgb, int num_threads)
+{
+	std::vector<uint8_t> png;
+	encode_png(width, height, rgb, png, num_threads);
+
+	return write_file(path, png.data(), png.size(), nullptr, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_ppm(const std::string& path, int width, int height, const uint8_t* rgb)
+{
+	char header[64];
+	int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+
+	return write_file(path, header, size_t(header_size), rgb, size_t(width) * height * 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_pfm(const std::string& path, int width, int height, const float* r, const float* g, const float* b)
+{
+	char header[64];
+	int header_size = snprintf(header, sizeof(header), "PF\n%d %d\n-1.0\n", width, height);
+
+	// A negative scale means little endian, which is what every target is. PFM rows go bottom to top.
+	std::vector<float> pixels(size_t(width) * height * 3);
+
+	for (int y = 0; y < height; y++)
+	{
+		size_t src = size_t(height - 1 - y) * width;
+		float* dst = &pixels[size_t(y) * width * 3];
+
+		for (int x = 0; x < width; x++)
+		{
+			dst[x * 3 + 0] = r[src + x];
+			dst[x * 3 + 1] = g[src + x];
+			dst[x * 3 + 2] = b[src + x];
+		}
+	}
+
+	return write_file(path, header, size_t(header_size), pixels.data(), pixels.size() * sizeof(float));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool has_extension(const std::string& path, const char* extension)
+{
+	size_t n = strlen(extension);
+
+	if (path.size() < n)
+		return false;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (tolower(path[path.size() - n + i]) != extension[i])
+			return false;
+	}
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t write_images(const std::vector<ImageFile>& images, int num_threads)
+{
+	std::atomic<size_t> failed(0);
+
+	parallel_for(images.size(), 1, num_threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			const ImageFile& image = images[i];
+			bool written;
+
+			if (has_extension(image.path, ".png"))
+				written = write_png(image.path, image.width, image.height, image.rgb, 1);
+			else if (has_extension(image.path, ".ppm"))
+				written = write_ppm(image.path, image.width, image.height, image.rgb);
+			else
+				written = false;
+
+			if (!written)
+				failed++;
+		}
+	});
+
+	return failed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Image files for skies rendered on the CPU: 8 bit previews and thumbnails from tonemap() as PNG or binary PPM, and
+// the HDR radiance itself as PFM. No image library is needed: the PNG deflate stream is produced here with a greedy
+// LZ77 and the fixed Huffman codes. Rows are filtered with the best of the PNG filters per row and compressed in
+// independent bands of rows, which are split over num_threads (0 = all cores). The bands don't depend on the number
+// of threads, neither do the files.
+
+// Interleaved 8 bit RGB, rows top to bottom.
+bool write_png(const std::string& path, int width, int height, const uint8_t* rgb, int num_threads = 0);
+bool write_ppm(const std::string& path, int width, int height, const uint8_t* rgb);
+
+// Structure-of-arrays float radiance, rows top to bottom, as little endian PFM.
+bool write_pfm(const std::string& path, int width, int height, const float* r, const float* g, const float* b);
+
+// The PNG file in memory.
+void encode_png(int width, int height, const uint8_t* rgb, std::vector<uint8_t>& png, int num_threads = 0);
+
+struct ImageFile
+{
+	std::string    path;
+	int            width;
+	int            height;
+	const uint8_t* rgb;
+};
+
+// Writes a batch of images, PNG or PPM by the extension of the path, one image per thread on up to num_threads
+// threads (0 = all cores). For bulk thumbnails, where one image is too small to split. Returns the number of images
+// that couldn't be written.
+size_t write_images(const std::vector<ImageFile>& images, int num_threads = 0);
@@ -0,0 +1,125 @@
+#include "irradiance_sh.h"
+#include "sky_model.h"
+#include "simd.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void evaluate_sh9(const glm::vec3& n, float* Y)
+{
+	Y[0] = 0.282095f;
+
+	Y[1] = 0.488603f * n.y;
+	Y[2] = 0.488603f * n.z;
+	Y[3] = 0.488603f * n.x;
+
+	Y[4] = 1.092548f * n.x * n.y;
+	Y[5] = 1.092548f * n.y * n.z;
+	Y[6] = 0.315392f * (3.0f * n.z * n.z - 1.0f);
+	Y[7] = 1.092548f * n.x * n.z;
+	Y[8] = 0.546274f * (n.x * n.x - n.y * n.y);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+IrradianceSH::IrradianceSH(int num_samples)
+{
+	// Keep the sample count a multiple of the SIMD width.
+	m_num_samples = ((num_samples + 7) / 8) * 8;
+
+	for (int i = 0; i < 3; i++)
+	{
+		m_dir[i].resize(m_num_samples);
+		m_radiance[i].resize(m_num_samples);
+	}
+
+	for (int i = 0; i < NUM_COEFFICIENTS; i++)
+	{
+		m_basis[i].resize(m_num_samples);
+		m_coefficients[i] = glm::vec3(0.0f);
+	}
+
+	// Cosine lobe convolution (Ramamoorthi and Hanrahan, An Efficient Representation for Irradiance Environment Maps)
+	const float band_weights[] = { float(M_PI), 2.0f * float(M_PI) / 3.0f, float(M_PI) / 4.0f };
+	const int   band[] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+	const float solid_angle = 4.0f * float(M_PI) / float(m_num_samples);
+	const float golden_angle = float(M_PI) * (3.0f - sqrtf(5.0f));
+
+	// Fibonacci lattice, which covers the sphere with near uniform sample density.
+	for (int i = 0; i < m_num_samples; i++)
+	{
+		float z = 1.0f - (2.0f * float(i) + 1.0f) / float(m_num_samples);
+		float r = sqrtf(1.0f - z * z);
+		float phi = golden_angle * float(i);
+
+		glm::vec3 n = glm::vec3(r * cosf(phi), z, r * sinf(phi));
+
+		m_dir[0][i] = n.x;
+		m_dir[1][i] = n.y;
+		m_dir[2][i] = n.z;
+
+		float Y[NUM_COEFFICIENTS];
+		evaluate_sh9(n, Y);
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+			m_basis[j][i] = Y[j] * solid_angle * band_weights[band[j]];
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+IrradianceSH::~IrradianceSH()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void IrradianceSH::project(SkyModel* model)
+{
+	project(model->state());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void IrradianceSH::project(const SkyState& state)
+{
+	state.radiance(m_num_samples, m_dir[0].data(), m_dir[1].data(), m_dir[2].data(), m_radiance[0].data(), m_radiance[1].data(), m_radiance[2].data());
+
+	vec8f sum[NUM_COEFFICIENTS][3];
+
+	for (int j = 0; j < NUM_COEFFICIENTS; j++)
+	{
+		for (int c = 0; c < 3; c++)
+			sum[j][c] = 0.0f;
+	}
+
+	for (int i = 0; i < m_num_samples; i += 8)
+	{
+		vec8f L[3] = { load8(&m_radiance[0][i]), load8(&m_radiance[1][i]), load8(&m_radiance[2][i]) };
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+		{
+			vec8f Y = load8(&m_basis[j][i]);
+
+			for (int c = 0; c < 3; c++)
+				sum[j][c] = fmadd(Y, L[c], sum[j][c]);
+		}
+	}
+
+	for (int j = 0; j < NUM_COEFFICIENTS; j++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			float lanes[8];
+			store8(lanes, sum[j][c]);
+
+			m_coefficients[j][c] = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vector>
+
+class SkyModel;
+class SkyState;
+
+// Projects the radiance of a sky model onto L2 (9 coefficient) spherical harmonics and convolves it with the
+// clamped cosine lobe, giving an irradiance environment that shaders evaluate with a handful of MADs:
+// E(n) = sum(c[i] * Y[i](n)). Directions and basis values are precomputed once, so a projection costs one
+// batched sky evaluation plus a SIMD reduction.
+class IrradianceSH
+{
+public:
+	static const int NUM_COEFFICIENTS = 9;
+
+	IrradianceSH(int num_samples = 1024);
+	~IrradianceSH();
+
+	void project(SkyModel* model);
+	void project(const SkyState& state);
+
+	inline const glm::vec3* coefficients() const { return &m_coefficients[0]; }
+
+private:
+	int m_num_samples;
+
+	// Structure-of-arrays sample directions and evaluated radiance.
+	std::vector<float> m_dir[3];
+	std::vector<float> m_radiance[3];
+
+	// Basis functions per sample, premultiplied by the sample solid angle and the cosine lobe convolution weights.
+	std::vector<float> m_basis[NUM_COEFFICIENTS];
+
+	glm::vec3 m_coefficients[NUM_COEFFICIENTS];
+};
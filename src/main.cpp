@@ -7,9 +7,16 @@
 #include <stack>
 #include <random>
 #include <chrono>
-#include "bruneton_sky_model.h"
+#include "bruneton_sky_model_gl.h"
+#include "bruneton_2017_sky_model_gl.h"
+#include "bruneton_table_cache.h"
 #include "preetham_sky_model.h"
 #include "hosek_wilkie_sky_model.h"
+#include "irradiance_sh.h"
+#include "sky_environment_map.h"
+#include "auto_exposure.h"
+#include "sky_model_gl.h"
+#include "sky_time_of_day.h"
 
 // Uniform buffer data structure.
 struct ObjectUniforms
@@ -28,6 +35,9 @@ struct GlobalUniforms
 };
 
 #define CAMERA_FAR_PLANE 10000.0f
+#define BRUNETON_UPLOAD_BUDGET_MS 2.0f
+// QUALITY_LOW saves the 4 MB single Mie texture and gets the color of the sun's aureole wrong, see BrunetonSkyModel.
+#define BRUNETON_QUALITY BrunetonSkyModel::QUALITY_HIGH
 
 class SkyModels : public dw::Application
 {
@@ -58,7 +68,20 @@ protected:
 
 		m_sun_angle = glm::radians(-180.0f);
 
-		return m_bruneton_model.initialize() && m_preetham_model.initialize() && m_hosek_wilkie_model.initialize();
+		if (!m_environment_map.initialize())
+			return false;
+
+		if (!m_auto_exposure.initialize())
+			return false;
+
+		m_bruneton_model.set_quality(BRUNETON_QUALITY);
+
+		// Optional, written to the working directory by sky_models_hosek_convert.
+		m_hosek_datasets[HOSEK_DATASET_XYZ].reset(HosekDataset::load(HOSEK_DATASET_XYZ, std::string()));
+		m_hosek_datasets[HOSEK_DATASET_SPECTRAL].reset(HosekDataset::load(HOSEK_DATASET_SPECTRAL, std::string()));
+
+		// The Bruneton tables load in the background, see update_sky_model().
+		return m_bruneton_model.initialize_async() && m_preetham_model.initialize() && m_hosek_wilkie_model.initialize();
 	}
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
@@ -74,21 +97,39 @@ protected:
 		if (m_show_gui)
 			ui();
 
-		m_bruneton_model.set_direction(m_direction);
-		m_preetham_model.set_direction(m_direction);
-		m_hosek_wilkie_model.set_direction(m_direction);
+		update_sky_model();
 
-		if (m_sky_model == 0)
-			m_bruneton_model.update();
-		else if (m_sky_model == 1)
-			m_preetham_model.update();
-		else if (m_sky_model == 2)
-			m_hosek_wilkie_model.update();
+		if (m_time_of_day)
+			update_time_of_day(delta);
+		else
+		{
+			m_bruneton_model.set_direction(m_direction);
+			m_bruneton_2017_model.set_direction(m_direction);
+			m_preetham_model.set_direction(m_direction);
+			m_hosek_wilkie_model.set_direction(m_direction);
+
+			if (m_render_sky_model == 0)
+				m_bruneton_model.update();
+			else if (m_render_sky_model == 1)
+				m_preetham_model.update();
+			else if (m_render_sky_model == 2)
+				m_hosek_wilkie_model.update();
+			else if (m_render_sky_model == 3)
+				m_bruneton_2017_model.update();
+		}
+
+		update_sky_irradiance();
+
+		// Advances the amortized specular prefilter by one step.
+		m_environment_map.update(active_sky_model(), m_render_sky_model);
 
 		render_meshes();
 
 		render_cubemap();
 
+		if (m_auto_exposure_enabled)
+			m_auto_exposure.update(m_color_rt.get(), m_width, m_height, float(delta) / 1000.0f);
+
 		render_fullscreen_triangle();
 
 		if (m_debug_mode)
@@ -103,6 +144,9 @@ protected:
 	void shutdown() override
 	{
 		dw::Mesh::unload(m_mesh);
+
+		// The models release their tables when they are destroyed, the cache has to let go of its own before.
+		BrunetonTableCache::instance().clear();
 	}
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
@@ -200,14 +244,40 @@ private:
 	void ui()
 	{
 		ImGui::InputFloat("Exposure", &m_exposure);
-		ImGui::SliderAngle("Sun Angle", &m_sun_angle, 0.0f, -180.0f);
 
-		const char* sky_models[] = { "Bruneton", "Preetham", "Hosek-Wilkie" };
+		// Adapts from scratch when switched back on, the scene may have changed completely in between.
+		if (ImGui::Checkbox("Auto Exposure", &m_auto_exposure_enabled) && m_auto_exposure_enabled)
+			m_auto_exposure.reset();
+
+		const char* tonemappers[] = { "Reinhard", "ACES", "AgX" };
+		ImGui::Combo("Tonemapper", &m_tonemapper, tonemappers, IM_ARRAYSIZE(tonemappers));
+
+		ImGui::Checkbox("Time of Day", &m_time_of_day);
+
+		if (m_time_of_day)
+		{
+			ImGui::InputInt3("Date (UTC)", m_date);
+			ImGui::SliderFloat("Time (UTC)", &m_hour, 0.0f, 24.0f, "%.2f h");
+			ImGui::SliderFloat("Latitude", &m_latitude, -90.0f, 90.0f);
+			ImGui::SliderFloat("Longitude", &m_longitude, -180.0f, 180.0f);
+			ImGui::Checkbox("Animate", &m_animate_time);
+			ImGui::SliderFloat("Hours per Second", &m_hours_per_second, 0.0f, 4.0f);
+		}
+		else
+			ImGui::SliderAngle("Sun Angle", &m_sun_angle, 0.0f, -180.0f);
+
+		const char* sky_models[] = { "Bruneton", "Preetham", "Hosek-Wilkie", "Bruneton 2017" };
 		ImGui::Combo("Sky Model", &m_sky_model, sky_models, IM_ARRAYSIZE(sky_models));
 
+		if (m_sky_model == 0 && !m_bruneton_model.is_ready())
+			ImGui::Text("Loading Bruneton tables, showing Hosek-Wilkie");
+
+		if (m_sky_model == 3 && !m_bruneton_2017_model.is_ready())
+			ImGui::Text("Precomputing Bruneton 2017 tables, showing Hosek-Wilkie");
+
 		float turbidity = 0.0f;
 
-		if (m_sky_model > 0)
+		if (m_sky_model == 1 || m_sky_model == 2)
 		{
 			if (m_sky_model == 1)
 				turbidity = m_preetham_model.turbidity();
@@ -222,11 +292,92 @@ private:
 				m_hosek_wilkie_model.set_turbidity(turbidity);
 		}
 
-		m_direction = glm::normalize(glm::vec3(0.0f, sin(m_sun_angle), cos(m_sun_angle)));
+		if (m_sky_model == 2)
+		{
+			// A missing dataset falls back to the built-in RGB one (nullptr).
+			const char* datasets[] = { "RGB", "CIE XYZ", "Spectral" };
+
+			if (ImGui::Combo("Dataset", &m_hosek_dataset, datasets, IM_ARRAYSIZE(datasets)))
+			{
+				m_hosek_wilkie_model.set_dataset(m_hosek_datasets[m_hosek_dataset].get());
+
+				// The time of day table only follows turbidity and albedo, its coefficients are still the old dataset's.
+				m_hosek_wilkie_time_of_day.invalidate();
+			}
+
+			if (m_hosek_dataset != HOSEK_DATASET_RGB && !m_hosek_datasets[m_hosek_dataset])
+				ImGui::Text("Dataset not found, showing RGB (see sky_models_hosek_convert)");
+		}
+
+		ImGui::SliderFloat("Roughness", &m_roughness, 0.0f, 1.0f);
+
+		if (!m_time_of_day)
+			m_direction = glm::normalize(glm::vec3(0.0f, sin(m_sun_angle), cos(m_sun_angle)));
 
 		ImGui::Text("Sun Direction = [ %f, %f, %f ]", m_direction.x, m_direction.y, m_direction.z);
 	}
 
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	// Keeps the Bruneton tables loading (whichever model is selected) and picks the model to render. Hosek-Wilkie
+	// stands in for Bruneton until its tables are on the GPU, so the first frames already show a plausible sky. The
+	// 2017 model may have to precompute its tables, which keeps a core busy for a while, so it only starts loading
+	// once it is selected.
+	void update_sky_model()
+	{
+		bool bruneton_ready = m_bruneton_model.update_loading(BRUNETON_UPLOAD_BUDGET_MS);
+
+		if (m_sky_model == 3 && m_bruneton_2017_model.load_status() == Bruneton2017SkyModel::LOAD_IDLE)
+			m_bruneton_2017_model.initialize_async();
+
+		bool bruneton_2017_ready = m_bruneton_2017_model.update_loading(BRUNETON_UPLOAD_BUDGET_MS);
+
+		int render_sky_model = m_sky_model;
+
+		if ((m_sky_model == 0 && !bruneton_ready) || (m_sky_model == 3 && !bruneton_2017_ready))
+			render_sky_model = 2;
+
+		// The models don't share units, the exposure jumps to the new one instead of adapting over seconds.
+		if (render_sky_model != m_render_sky_model)
+			m_auto_exposure.reset();
+
+		m_render_sky_model = render_sky_model;
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	// Follows the real sun for the date, time and location in the UI. The analytic models interpolate precomputed
+	// coefficients instead of updating.
+	void update_time_of_day(double delta)
+	{
+		if (m_animate_time)
+			m_hour = fmodf(m_hour + m_hours_per_second * float(delta) / 1000.0f, 24.0f);
+
+		double time = utc_time(m_date[0], m_date[1], m_date[2]) + double(m_hour) * 3600.0;
+
+		m_preetham_time_of_day.set_location(m_latitude, m_longitude);
+		m_hosek_wilkie_time_of_day.set_location(m_latitude, m_longitude);
+
+		glm::vec3 sun_dir = solar_direction(solar_position(m_latitude, m_longitude, time));
+
+		m_direction = -sun_dir;
+
+		if (m_render_sky_model == 0)
+		{
+			m_bruneton_model.set_direction(m_direction);
+			m_bruneton_model.update();
+		}
+		else if (m_render_sky_model == 1)
+			m_preetham_time_of_day.set_time(time);
+		else if (m_render_sky_model == 2)
+			m_hosek_wilkie_time_of_day.set_time(time);
+		else if (m_render_sky_model == 3)
+		{
+			m_bruneton_2017_model.set_direction(m_direction);
+			m_bruneton_2017_model.update();
+		}
+	}
+
 	// -----------------------------------------------------------------------------------------------------------------------------------
 	
 	bool create_shaders()
@@ -298,6 +449,7 @@ private:
 			}
 
 			m_sky_program->uniform_block_binding("u_GlobalUBO", 0);
+			set_sky_sampler_units(m_sky_program.get());
 		}
 
 		return true;
@@ -408,6 +560,18 @@ private:
 		m_global_ubo->bind_base(0);
 
 		m_mesh_program->set_uniform("direction", m_direction);
+		m_mesh_program->set_uniform("u_SunRadiance", active_sky_model()->state().sun_radiance());
+
+		static const char* sh_uniforms[] = { "u_SH[0]", "u_SH[1]", "u_SH[2]", "u_SH[3]", "u_SH[4]", "u_SH[5]", "u_SH[6]", "u_SH[7]", "u_SH[8]" };
+
+		for (int i = 0; i < IrradianceSH::NUM_COEFFICIENTS; i++)
+			m_mesh_program->set_uniform(sh_uniforms[i], m_irradiance_sh.coefficients()[i]);
+
+		m_mesh_program->set_uniform("u_Roughness", m_roughness);
+		m_mesh_program->set_uniform("u_MaxMip", float(m_environment_map.mip_count() - 1));
+
+		if (m_mesh_program->set_uniform("s_Prefiltered", 0))
+			m_environment_map.prefiltered()->bind(0);
 
 		// Draw meshes.
 		render_mesh(m_mesh);
@@ -415,6 +579,36 @@ private:
 
 	// -----------------------------------------------------------------------------------------------------------------------------------
 
+	SkyModel* active_sky_model()
+	{
+		if (m_render_sky_model == 0)
+			return &m_bruneton_model;
+		else if (m_render_sky_model == 1)
+			return &m_preetham_model;
+		else if (m_render_sky_model == 3)
+			return &m_bruneton_2017_model;
+		else
+			return &m_hosek_wilkie_model;
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
+	void update_sky_irradiance()
+	{
+		SkyModel* model = active_sky_model();
+
+		// Only reproject when the sky actually changed.
+		if (m_sh_sky_model == m_render_sky_model && m_sh_revision == model->revision())
+			return;
+
+		m_irradiance_sh.project(model);
+
+		m_sh_sky_model = m_render_sky_model;
+		m_sh_revision = model->revision();
+	}
+
+	// -----------------------------------------------------------------------------------------------------------------------------------
+
 	void render_cubemap()
 	{
 		glEnable(GL_DEPTH_TEST);
@@ -431,14 +625,9 @@ private:
 		/*m_cubemap_program->set_uniform("s_Skybox", 0);
 		m_cubemap->bind(0);*/
 
-		m_sky_program->set_uniform("sky_model", m_sky_model);
+		m_sky_program->set_uniform("sky_model", m_render_sky_model);
 
-		if (m_sky_model == 0)
-			m_bruneton_model.set_render_uniforms(m_sky_program.get());
-		else if (m_sky_model == 1)
-			m_preetham_model.set_render_uniforms(m_sky_program.get());
-		else if (m_sky_model == 2)
-			m_hosek_wilkie_model.set_render_uniforms(m_sky_program.get());
+		set_render_uniforms(m_sky_program.get(), active_sky_model());
 
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -461,6 +650,11 @@ private:
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		m_fullscreen_program->set_uniform("exposure", m_exposure);
+		m_fullscreen_program->set_uniform("u_AutoExposure", int(m_auto_exposure_enabled));
+		m_fullscreen_program->set_uniform("u_Tonemapper", m_tonemapper);
+
+		if (m_fullscreen_program->set_uniform("s_AdaptedLuminance", 1))
+			m_auto_exposure.adapted_luminance()->bind(1);
 
 		m_fullscreen_program->set_uniform("s_Texture", 0);
 		m_color_rt->bind(0);
@@ -584,13 +778,41 @@ private:
 	float m_camera_x = 0.0f;
 	float m_camera_y = 0.0f;
 	float m_exposure = 1.0f;
+	bool m_auto_exposure_enabled = true;
+	int m_tonemapper = 0;
 	float m_sun_angle = 0.0f;
 	int m_sky_model = 0;
+	// m_sky_model unless it's waiting for its tables, see update_sky_model().
+	int m_render_sky_model = 2;
 	glm::vec3 m_direction = glm::vec3(0.0f, 0.0f, 1.0f);
 
-	BrunetonSkyModel m_bruneton_model;
+	BrunetonSkyModelGL m_bruneton_model;
+	Bruneton2017SkyModelGL m_bruneton_2017_model;
 	PreethamSkyModel m_preetham_model;
+	// Declared first, the model points at the selected one.
+	std::unique_ptr<HosekDataset> m_hosek_datasets[3];
+	int m_hosek_dataset = HOSEK_DATASET_RGB;
 	HosekWilkieSkyModel m_hosek_wilkie_model;
+
+	// Time of day mode.
+	bool m_time_of_day = false;
+	bool m_animate_time = false;
+	int m_date[3] = { 2019, 6, 21 };
+	float m_hour = 12.0f;
+	float m_hours_per_second = 0.5f;
+	float m_latitude = 47.37f;
+	float m_longitude = 8.54f;
+	SkyTimeOfDay<PreethamSkyModel> m_preetham_time_of_day { &m_preetham_model };
+	SkyTimeOfDay<HosekWilkieSkyModel> m_hosek_wilkie_time_of_day { &m_hosek_wilkie_model };
+
+	// Ambient sky light for meshes.
+	IrradianceSH m_irradiance_sh;
+	SkyEnvironmentMap m_environment_map;
+
+	AutoExposure m_auto_exposure;
+	float m_roughness = 0.3f;
+	int m_sh_sky_model = -1;
+	uint32_t m_sh_revision = 0;
 };
 
 DW_DECLARE_MAIN(SkyModels)
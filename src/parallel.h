@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Splits [0, count) into contiguous ranges whose sizes are multiples of granularity and runs fn(begin, end) on up to
+// num_threads threads (0 uses the hardware concurrency). The calling thread processes the first range, so small
+// batches never spawn a thread.
+template <typename Fn>
+void parallel_for(size_t count, size_t granularity, int num_threads, Fn fn)
+{
+	if (count == 0)
+		return;
+
+	if (num_threads <= 0)
+		num_threads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+	size_t num_blocks = (count + granularity - 1) / granularity;
+	size_t num_ranges = std::min(size_t(num_threads), num_blocks);
+	size_t blocks_per_range = (num_blocks + num_ranges - 1) / num_ranges;
+	size_t range_size = blocks_per_range * granularity;
+
+	std::vector<std::thread> threads;
+
+	for (size_t begin = range_size; begin < count; begin += range_size)
+		threads.emplace_back(fn, begin, std::min(begin + range_size, count));
+
+	fn(size_t(0), std::min(range_size, count));
+
+	for (auto& thread : threads)
+		thread.join();
+}
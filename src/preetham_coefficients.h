@@ -0,0 +1,132 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+// Coefficient tables of A Practical Analytic Model for Daylight (Preetham, Shirley, Smits), appendix A.2. Channels
+// are x, y and Y.
+
+// Perez distribution coefficients A to E, linear in turbidity: turbidity * [param][0][channel] + [param][1][channel].
+constexpr float PREETHAM_PEREZ[5][2][3] = { { { -0.0193f, -0.0167f,  0.1787f }, { -0.2592f, -0.2608f, -1.4630f } },
+                                            { { -0.0665f, -0.0950f, -0.3554f }, {  0.0008f,  0.0092f,  0.4275f } },
+                                            { { -0.0004f, -0.0079f, -0.0227f }, {  0.2125f,  0.2102f,  5.3251f } },
+                                            { { -0.0641f, -0.0441f,  0.1206f }, { -0.8989f, -1.6537f, -2.5771f } },
+                                            { { -0.0033f, -0.0109f, -0.0670f }, {  0.0452f,  0.0529f,  0.3703f } } };
+
+// Zenith chromaticity: [turbidity^2, turbidity, 1] * table * [theta^3, theta^2, theta, 1].
+constexpr float PREETHAM_ZENITH_X[3][4] = { {  0.00166f, -0.00375f,  0.00209f, 0.0f     },
+                                            { -0.02903f,  0.06377f, -0.03202f, 0.00394f },
+                                            {  0.11693f, -0.21196f,  0.06052f, 0.25886f } };
+
+constexpr float PREETHAM_ZENITH_Y[3][4] = { {  0.00275f, -0.00610f,  0.00317f, 0.0f     },
+                                            { -0.04214f,  0.08970f, -0.04153f, 0.00516f },
+                                            {  0.15346f, -0.26756f,  0.06670f, 0.26688f } };
+
+// Zenith luminance in kcd/m^2: (t * [0][0] + [0][1]) * tan((t * [1][0] + [1][1]) * (pi - 2 theta)) + t * [2][0] + [2][1].
+constexpr float PREETHAM_ZENITH_LUMINANCE[3][2] = { { 4.0453f, -4.9710f }, { -1.0f / 120.0f, 4.0f / 9.0f }, { -0.2155f, 2.4192f } };
+
+// Everything in the model that depends on turbidity alone.
+template <typename T>
+struct PreethamCoefficients
+{
+	// Perez coefficients A to E as [param][channel].
+	T perez[5][3];
+
+	// Zenith chromaticity as cubics in the sun theta, highest power first.
+	T zenith_x[4];
+	T zenith_y[4];
+
+	// Zenith luminance factors, see PREETHAM_ZENITH_LUMINANCE.
+	T luminance[3];
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Branch free, so the same code is a SIMD kernel with T = vec8f (one turbidity per lane). With an arithmetic T this is
+// a constant expression, which lets fixed weather presets be evaluated entirely at compile time:
+// constexpr PreethamCoefficients<float> CLEAR_SKY = preetham_coefficients(2.0f);
+template <typename T>
+constexpr PreethamCoefficients<T> preetham_coefficients(T turbidity)
+{
+	PreethamCoefficients<T> c = {};
+
+	for (int p = 0; p < 5; p++)
+	{
+		for (int ch = 0; ch < 3; ch++)
+			c.perez[p][ch] = turbidity * PREETHAM_PEREZ[p][0][ch] + PREETHAM_PEREZ[p][1][ch];
+	}
+
+	T turbidity2 = turbidity * turbidity;
+
+	for (int i = 0; i < 4; i++)
+	{
+		c.zenith_x[i] = turbidity2 * PREETHAM_ZENITH_X[0][i] + turbidity * PREETHAM_ZENITH_X[1][i] + PREETHAM_ZENITH_X[2][i];
+		c.zenith_y[i] = turbidity2 * PREETHAM_ZENITH_Y[0][i] + turbidity * PREETHAM_ZENITH_Y[1][i] + PREETHAM_ZENITH_Y[2][i];
+	}
+
+	for (int i = 0; i < 3; i++)
+		c.luminance[i] = turbidity * PREETHAM_ZENITH_LUMINANCE[i][0] + PREETHAM_ZENITH_LUMINANCE[i][1];
+
+	return c;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Zenith xyY for a sun theta, pre-divided by the Perez distribution at the zenith (the p_Z uniform). A non-zero
+// normalized_sun_y replaces the luminance so that the sun itself has that luminance.
+template <typename T>
+void preetham_zenith(const PreethamCoefficients<T>& c, const T& theta, float normalized_sun_y, T* Z)
+{
+	T theta2 = theta * theta;
+	T theta3 = theta2 * theta;
+
+	Z[0] = c.zenith_x[0] * theta3 + c.zenith_x[1] * theta2 + c.zenith_x[2] * theta + c.zenith_x[3];
+	Z[1] = c.zenith_y[0] * theta3 + c.zenith_y[1] * theta2 + c.zenith_y[2] * theta + c.zenith_y[3];
+
+	T chi = c.luminance[1] * (float(M_PI) - 2.f * theta);
+	Z[2] = (c.luminance[0] * tan(chi) + c.luminance[2]) * 1000.f; // conversion from kcd/m^2 to cd/m^2
+
+	// Perez distribution at theta = 0, gamma = sun theta.
+	T cos_sun = cos(theta);
+
+	for (int ch = 0; ch < 3; ch++)
+		Z[ch] = Z[ch] / ((1.f + c.perez[0][ch] * exp(c.perez[1][ch] * (1.f / 1.01f))) * (1.f + c.perez[2][ch] * exp(c.perez[3][ch] * theta) + c.perez[4][ch] * cos_sun * cos_sun));
+
+	// Perez distribution towards the sun, theta = sun theta and gamma = 0.
+	if (normalized_sun_y)
+		Z[2] = normalized_sun_y / ((1.f + c.perez[0][2] * exp(c.perez[1][2] / (cos_sun + 0.01f))) * (1.f + c.perez[2][2] + c.perez[4][2]));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// White sun outside the atmosphere, in the normalized units the models use for low dynamic range (normalized_sun_y).
+// Pi, so a white Lambertian surface facing an unattenuated sun reflects a radiance of one.
+constexpr float PREETHAM_SUN_IRRADIANCE = float(M_PI);
+
+// A.1 Sunlight: spectral transmittance of the atmosphere towards a sun theta radians from the zenith, from Rayleigh
+// scattering, aerosols (Angstrom's formula with the turbidity) and ozone absorption, taken at the R, G and B
+// wavelengths of 680, 550 and 440 nm. The Rayleigh and aerosol columns thin out above altitude meters with their
+// scale heights, the ozone sits above anything a camera reaches. Zero below the horizon.
+inline void preetham_sun_transmittance(float theta, float turbidity, float altitude, float* rgb)
+{
+	const float lambda[3] = { 0.680f, 0.550f, 0.440f }; // micrometers
+	const float ozone[3] = { 0.050f, 0.089f, 0.003f };  // absorption per cm of ozone
+	const float ozone_column = 0.35f;                    // cm
+
+	if (theta >= float(M_PI) * 0.5f)
+	{
+		rgb[0] = rgb[1] = rgb[2] = 0.0f;
+		return;
+	}
+
+	// Relative optical mass, finite at the horizon.
+	float m = 1.0f / (cosf(theta) + 0.15f * powf(93.885f - theta * float(180.0 / M_PI), -1.253f));
+	float m_rayleigh = m * expf(-altitude / 8000.0f);
+	float m_aerosol = m * expf(-altitude / 1200.0f);
+	float beta = 0.04608365822050f * turbidity - 0.04586025928522f;
+
+	for (int ch = 0; ch < 3; ch++)
+		rgb[ch] = expf(-0.008735f * powf(lambda[ch], -4.08f) * m_rayleigh - beta * powf(lambda[ch], -1.3f) * m_aerosol - ozone[ch] * ozone_column * m);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -1,43 +1,68 @@
 #include "preetham_sky_model.h"
 
-#include <macros.h>
-#include <logger.h>
-#include <utility.h>
-
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtx/compatibility.hpp>
 
+#include <algorithm>
+#include <assert.h>
+
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include "simd.h"
+#include "parallel.h"
+
+// Fixed weather presets rely on the turbidity dependent part folding at compile time.
+static_assert(preetham_coefficients(2.0f).perez[0][2] == 2.0f * PREETHAM_PEREZ[0][0][2] + PREETHAM_PEREZ[0][1][2], "preetham_coefficients() must stay a constant expression");
+
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-float zenith_chromacity(const glm::vec4 & c0, const glm::vec4 & c1, const glm::vec4 & c2, float sunTheta, float turbidity)
+glm::vec3 perez(float cos_theta, float gamma, float cos_gamma, glm::vec3 A, glm::vec3 B, glm::vec3 C, glm::vec3 D, glm::vec3 E)
 {
-    glm::vec4 thetav = glm::vec4(sunTheta * sunTheta * sunTheta, sunTheta * sunTheta, sunTheta, 1);
-    return glm::dot(glm::vec3(turbidity * turbidity, turbidity, 1), glm::vec3(glm::dot(thetav, c0), glm::dot(thetav, c1), glm::dot(thetav, c2)));
+    return (1.f + A * glm::exp(B / (cos_theta + 0.01f))) * (1.f + C * glm::exp(D * gamma) + E * cos_gamma * cos_gamma);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-float zenith_luminance(float sunTheta, float turbidity)
+// Maps (x, y, 1) to RGB in the given working space, up to the Y / y scale: XYZ = (x, y, 1 - x - y) * Y / y is linear
+// in (x, y, 1), so the chromaticity expansion folds into the XYZ to RGB matrix.
+glm::mat3 xyY_to_rgb_matrix(ColorSpace space)
 {
-    float chi = (4.f / 9.f - turbidity / 120) * (M_PI - 2 * sunTheta);
-    return (4.0453 * turbidity - 4.9710) * tan(chi) - 0.2155 * turbidity + 2.4192;
+    const glm::mat3 xy1_to_xyz = glm::mat3(1.f, 0.f, -1.f,
+                                           0.f, 1.f, -1.f,
+                                           0.f, 0.f,  1.f);
+
+    return xyz_to_rgb_matrix(space) * xy1_to_xyz;
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-float perez(float theta, float gamma, float A, float B, float C, float D, float E)
+glm::vec3 xyY_to_rgb(const glm::mat3& xyY_to_rgb, glm::vec3 xyY)
 {
-    return (1.f + A * exp(B / (cos(theta) + 0.01))) * (1.f + C * exp(D * gamma) + E * cos(gamma) * cos(gamma));
+    return xyY_to_rgb * glm::vec3(xyY.x, xyY.y, 1.f) * (xyY.z / xyY.y);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-PreethamSkyModel::PreethamSkyModel()
+// update_parameters() for 8 states at once. out holds A, B, C, D, E and Z as [param * 3 + channel].
+static void preetham_coefficients_8(const vec8f& sun_y, const vec8f& turbidity, float normalized_sun_y, vec8f* out)
 {
+    PreethamCoefficients<vec8f> c = preetham_coefficients(turbidity);
 
+    for (int p = 0; p < 5; p++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+            out[p * 3 + ch] = c.perez[p][ch];
+    }
+
+    preetham_zenith(c, acos(clamp(sun_y, 0.f, 1.f)), normalized_sun_y, out + 15);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PreethamSkyModel::PreethamSkyModel()
+{
+    set_color_space(COLOR_SPACE_SRGB);
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
@@ -56,45 +81,184 @@ bool PreethamSkyModel::initialize()
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void PreethamSkyModel::update()
+void PreethamSkyModel::update_parameters()
 {
 	assert(m_turbidity >= 1);
 
     const float sunTheta = std::acos(glm::clamp(m_direction.y, 0.f, 1.f));
 
-    // A.2 Skylight Distribution Coefficients and Zenith Values: compute Perez distribution coefficients
-    A = glm::vec3(-0.0193, -0.0167,  0.1787) * m_turbidity + glm::vec3(-0.2592, -0.2608, -1.4630);
-    B = glm::vec3(-0.0665, -0.0950, -0.3554) * m_turbidity + glm::vec3( 0.0008,  0.0092,  0.4275);
-    C = glm::vec3(-0.0004, -0.0079, -0.0227) * m_turbidity + glm::vec3( 0.2125,  0.2102,  5.3251);
-    D = glm::vec3(-0.0641, -0.0441,  0.1206) * m_turbidity + glm::vec3(-0.8989, -1.6537, -2.5771);
-    E = glm::vec3(-0.0033, -0.0109, -0.0670) * m_turbidity + glm::vec3( 0.0452,  0.0529,  0.3703);
-    
-    // A.2 Skylight Distribution Coefficients and Zenith Values: compute zenith color
-    Z.x = zenith_chromacity(glm::vec4(0.00166, -0.00375, 0.00209, 0), glm::vec4(-0.02903, 0.06377, -0.03202, 0.00394), glm::vec4(0.11693, -0.21196, 0.06052, 0.25886), sunTheta, m_turbidity);
-    Z.y = zenith_chromacity(glm::vec4(0.00275, -0.00610, 0.00317, 0), glm::vec4(-0.04214, 0.08970, -0.04153, 0.00516), glm::vec4(0.15346, -0.26756, 0.06670, 0.26688), sunTheta, m_turbidity);
-    Z.z = zenith_luminance(sunTheta, m_turbidity);
-    Z.z *= 1000; // conversion from kcd/m^2 to cd/m^2
-    
-    // 3.2 Skylight Model: pre-divide zenith color by distribution denominator
-	Z.x /= perez(0, sunTheta, A.x, B.x, C.x, D.x, E.x);
-    Z.y /= perez(0, sunTheta, A.y, B.y, C.y, D.y, E.y);
-    Z.z /= perez(0, sunTheta, A.z, B.z, C.z, D.z, E.z);
-    
-    // For low dynamic range simulation, normalize luminance to have a fixed value for sun
-    if (m_normalized_sun_y) Z.z = m_normalized_sun_y / perez(sunTheta, 0, A.z, B.z, C.z, D.z, E.z);
+    uint64_t key = SkyStateCache<Parameters>::key(sunTheta, m_turbidity, m_albedo);
+
+    if (const Parameters* cached = m_cache.find(key))
+    {
+        A = cached->A;
+        B = cached->B;
+        C = cached->C;
+        D = cached->D;
+        E = cached->E;
+        Z = cached->Z;
+
+        return;
+    }
+
+    // A.2 Skylight Distribution Coefficients and Zenith Values. The turbidity dependent part only changes with the
+    // weather, so moving the sun reuses it.
+    if (m_turbidity != m_coefficients_turbidity)
+    {
+        m_coefficients = preetham_coefficients(m_turbidity);
+        m_coefficients_turbidity = m_turbidity;
+    }
+
+    glm::vec3* perez_coefficients[] = { &A, &B, &C, &D, &E };
+
+    for (int p = 0; p < 5; p++)
+        *perez_coefficients[p] = glm::vec3(m_coefficients.perez[p][0], m_coefficients.perez[p][1], m_coefficients.perez[p][2]);
+
+    // 3.2 Skylight Model: zenith color pre-divided by the distribution denominator, normalized to a fixed luminance
+    // for the sun for low dynamic range simulation.
+    preetham_zenith(m_coefficients, sunTheta, m_normalized_sun_y, &Z[0]);
+
+    m_cache.insert(key, { A, B, C, D, E, Z });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PreethamSkyModel::set_color_space(ColorSpace space)
+{
+    m_color_space = space;
+    m_xyY_to_rgb = xyY_to_rgb_matrix(space);
+
+    mark_dirty();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PreethamSkyModel::compute_coefficients(const SkyStateBatch& states, float* const* coefficients, int num_threads) const
+{
+    const float normalized_sun_y = m_normalized_sun_y;
+
+    parallel_for(states.count, 8, num_threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i += 8)
+        {
+            size_t n = std::min<size_t>(end - i, 8);
+
+            vec8f out[NUM_BATCH_COEFFICIENTS];
+            preetham_coefficients_8(load_partial(states.sun_y + i, n, 1.0f), load_partial(states.turbidity + i, n, 2.0f), normalized_sun_y, out);
+
+            for (int j = 0; j < NUM_BATCH_COEFFICIENTS; j++)
+            {
+                if (n == 8)
+                    store8(coefficients[j] + i, out[j]);
+                else
+                    store_partial(coefficients[j] + i, out[j], n);
+            }
+        }
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PreethamSkyModel::set_coefficients(const glm::vec3& dir, const float* coefficients)
+{
+    glm::vec3* parameters[] = { &A, &B, &C, &D, &E, &Z };
+
+    for (int p = 0; p < 6; p++)
+        *parameters[p] = glm::vec3(coefficients[p * 3], coefficients[p * 3 + 1], coefficients[p * 3 + 2]);
+
+    m_direction = -dir;
+
+    publish();
 }
 
 // -----------------------------------------------------------------------------------------------------------------------------------
 
-void PreethamSkyModel::set_render_uniforms(dw::Program* program)
+void PreethamSkyModel::write_uniforms(SkyUniforms& uniforms)
 {
-	program->set_uniform("u_Direction", m_direction);
-	program->set_uniform("p_A", A);
-	program->set_uniform("p_B", B);
-	program->set_uniform("p_C", C);
-	program->set_uniform("p_D", D);
-	program->set_uniform("p_E", E);
-	program->set_uniform("p_Z", Z);
+	uniforms.set("u_Direction", m_direction);
+	uniforms.set("p_A", A);
+	uniforms.set("p_B", B);
+	uniforms.set("p_C", C);
+	uniforms.set("p_D", D);
+	uniforms.set("p_E", E);
+	uniforms.set("p_Z", Z);
+	uniforms.set("u_PreethamToRGB", m_xyY_to_rgb);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 PreethamSkyModel::sun_radiance(float altitude) const
+{
+    glm::vec3 transmittance;
+    preetham_sun_transmittance(std::acos(glm::clamp(m_direction.y, -1.f, 1.f)), m_turbidity, altitude, &transmittance[0]);
+
+    // Sampled near the sRGB primaries, converted like the sky.
+    return srgb_to_rgb_matrix(m_color_space) * transmittance * PREETHAM_SUN_IRRADIANCE;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<const SkyState::Evaluator> PreethamSkyModel::create_evaluator() const
+{
+    return std::make_shared<PreethamSkyState>(m_direction, Parameters{ A, B, C, D, E, Z }, m_xyY_to_rgb);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+PreethamSkyState::PreethamSkyState(const glm::vec3& direction, const PreethamSkyModel::Parameters& parameters, const glm::mat3& xyY_to_rgb) :
+    m_direction(direction), m_parameters(parameters), m_xyY_to_rgb(xyY_to_rgb)
+{
+
 }
 
-// -----------------------------------------------------------------------------------------------------------------------------------
\ No newline at end of file
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 PreethamSkyState::radiance(const glm::vec3& dir) const
+{
+    const PreethamSkyModel::Parameters& p = m_parameters;
+
+    float cos_theta = glm::clamp(dir.y, 0.f, 1.f);
+    float cos_gamma = glm::clamp(glm::dot(dir, m_direction), -1.f, 1.f);
+    float gamma = std::acos(cos_gamma);
+
+    return xyY_to_rgb(m_xyY_to_rgb, p.Z * perez(cos_theta, gamma, cos_gamma, p.A, p.B, p.C, p.D, p.E));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void PreethamSkyState::radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const
+{
+    const glm::vec3& A = m_parameters.A;
+    const glm::vec3& B = m_parameters.B;
+    const glm::vec3& C = m_parameters.C;
+    const glm::vec3& D = m_parameters.D;
+    const glm::vec3& E = m_parameters.E;
+    const glm::vec3& Z = m_parameters.Z;
+    const glm::mat3& M = m_xyY_to_rgb;
+
+    float* out[3] = { r, g, b };
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        vec8f cos_theta = clamp(load8(y + i), 0.f, 1.f);
+        vec8f cos_gamma = clamp(load8(x + i) * m_direction.x + load8(y + i) * m_direction.y + load8(z + i) * m_direction.z, -1.f, 1.f);
+        vec8f gamma = acos(cos_gamma);
+        vec8f cos_gamma2 = cos_gamma * cos_gamma;
+        vec8f inv_cos_theta = 1.f / (cos_theta + 0.01f);
+
+        vec8f xyY[3];
+
+        for (int c = 0; c < 3; c++)
+            xyY[c] = Z[c] * (1.f + A[c] * exp(B[c] * inv_cos_theta)) * (1.f + C[c] * exp(D[c] * gamma) + E[c] * cos_gamma2);
+
+        vec8f Y_over_y = xyY[2] / xyY[1];
+
+        for (int c = 0; c < 3; c++)
+            store8(out[c] + i, (xyY[0] * M[0][c] + xyY[1] * M[1][c] + M[2][c]) * Y_over_y);
+    }
+
+    if (i < count)
+        SkyState::Evaluator::radiance(count - i, x + i, y + i, z + i, r + i, g + i, b + i);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "sky_model.h"
+#include "sky_state_cache.h"
+#include "color_space.h"
+#include "preetham_coefficients.h"
 
 // A Practical Analytic Model for Daylight (A. J. Preetham, Peter Shirley, Brian Smits)
 class PreethamSkyModel : public SkyModel
@@ -10,10 +13,66 @@ public:
 	~PreethamSkyModel();
 
 	bool initialize() override;
-	void update() override;
-	void set_render_uniforms(dw::Program* program) override;
+	void write_uniforms(SkyUniforms& uniforms) override;
+
+	// A white sun through the turbidity dependent transmittance of the paper's appendix (preetham_sun_transmittance()).
+	glm::vec3 sun_radiance(float altitude) const override;
+
+	// Computes the coefficients of many independent states without touching the model's own state or any GL
+	// resources. coefficients[param * 3 + channel] receives states.count floats for A, B, C, D, E and Z, in the
+	// same xyY form as the shader uniforms. Vectorized across states and split over num_threads (0 = all cores).
+	static const int NUM_BATCH_COEFFICIENTS = 18;
+	void compute_coefficients(const SkyStateBatch& states, float* const* coefficients, int num_threads = 0) const;
+
+	// Takes one set of coefficients, NUM_BATCH_COEFFICIENTS floats in the compute_coefficients() order, instead of
+	// computing them, e.g. interpolated from a precomputed table. dir is the light direction as in set_direction(). Publishes a new state and leaves the model clean; the current turbidity and albedo are
+	// assumed to match the coefficients.
+	void set_coefficients(const glm::vec3& dir, const float* coefficients);
+
+	// Optional LRU cache of recent coefficient sets, disabled (zero) by default.
+	inline void set_cache_capacity(size_t capacity) { m_cache.set_capacity(capacity); }
+
+	// Working space of radiance() and the shader output, linear sRGB by default. The xyY to RGB conversion is folded
+	// into one matrix (the u_PreethamToRGB uniform) whenever this changes.
+	void set_color_space(ColorSpace space);
+	inline ColorSpace color_space() { return m_color_space; }
+
+	// Derived coefficients of one state, in the xyY form of the shader uniforms.
+	struct Parameters
+	{
+		glm::vec3 A, B, C, D, E;
+		glm::vec3 Z;
+	};
+
+protected:
+	void update_parameters() override;
+	std::shared_ptr<const SkyState::Evaluator> create_evaluator() const override;
 
 private:
     glm::vec3 A, B, C, D, E;
     glm::vec3 Z;
-};
\ No newline at end of file
+
+	// Turbidity dependent part of the last update.
+	PreethamCoefficients<float> m_coefficients;
+	float m_coefficients_turbidity = -1.0f;
+
+	ColorSpace m_color_space = COLOR_SPACE_SRGB;
+	glm::mat3 m_xyY_to_rgb;
+
+	SkyStateCache<Parameters> m_cache;
+};
+
+// Const evaluation of one Preetham state, see SkyState.
+class PreethamSkyState : public SkyState::Evaluator
+{
+public:
+	PreethamSkyState(const glm::vec3& direction, const PreethamSkyModel::Parameters& parameters, const glm::mat3& xyY_to_rgb);
+
+	glm::vec3 radiance(const glm::vec3& dir) const override;
+	void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const override;
+
+private:
+	glm::vec3 m_direction;
+	PreethamSkyModel::Parameters m_parameters;
+	glm::mat3 m_xyY_to_rgb;
+};
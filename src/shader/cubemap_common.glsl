@@ -0,0 +1,28 @@
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Direction through texel coordinate uv ([0, 1]^2) of a cubemap face, following the GL face layout.
+vec3 cube_face_direction(int face, vec2 uv)
+{
+	uv = uv * 2.0 - 1.0;
+
+	vec3 dir;
+
+	if (face == 0)
+		dir = vec3(1.0, -uv.y, -uv.x);
+	else if (face == 1)
+		dir = vec3(-1.0, -uv.y, uv.x);
+	else if (face == 2)
+		dir = vec3(uv.x, 1.0, uv.y);
+	else if (face == 3)
+		dir = vec3(uv.x, -1.0, -uv.y);
+	else if (face == 4)
+		dir = vec3(uv.x, -uv.y, 1.0);
+	else
+		dir = vec3(-uv.x, -uv.y, -1.0);
+
+	return normalize(dir);
+}
+
+// ------------------------------------------------------------------
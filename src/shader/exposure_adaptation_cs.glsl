@@ -0,0 +1,83 @@
+// Second pass of AutoExposure, a single work group with one invocation per bin: averages the log luminance of the
+// histogram, moves the adapted luminance towards it and clears the histogram for the next frame.
+
+#define NUM_BINS 256
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout (local_size_x = NUM_BINS, local_size_y = 1, local_size_z = 1) in;
+
+layout (binding = 0, r32ui) uniform uimage2D i_Histogram;
+
+// ------------------------------------------------------------------
+// OUTPUT -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Zero until the first frame, which is taken without adapting.
+layout (binding = 1, r32f) uniform image2D i_AdaptedLuminance;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform float u_MinLogLuminance;
+uniform float u_LogLuminanceRange;
+uniform float u_DeltaTime;
+uniform float u_SpeedUp;
+uniform float u_SpeedDown;
+
+shared float g_Weighted[NUM_BINS];
+shared float g_Count[NUM_BINS];
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+	uint bin = gl_LocalInvocationIndex;
+	float count = float(imageLoad(i_Histogram, ivec2(bin, 0)).r);
+
+	imageStore(i_Histogram, ivec2(bin, 0), uvec4(0u));
+
+	// Black pixels (bin 0) are weighted by zero and not counted.
+	g_Weighted[bin] = count * float(bin);
+	g_Count[bin] = bin == 0u ? 0.0 : count;
+
+	memoryBarrierShared();
+	barrier();
+
+	for (uint stride = uint(NUM_BINS / 2); stride > 0u; stride >>= 1)
+	{
+		if (bin < stride)
+		{
+			g_Weighted[bin] += g_Weighted[bin + stride];
+			g_Count[bin] += g_Count[bin + stride];
+		}
+
+		memoryBarrierShared();
+		barrier();
+	}
+
+	if (bin != 0u)
+		return;
+
+	float previous = imageLoad(i_AdaptedLuminance, ivec2(0, 0)).r;
+
+	// An all black frame keeps the current exposure.
+	if (g_Count[0] == 0.0)
+		return;
+
+	// Mean bin back to log luminance, at the bin centers.
+	float mean_bin = g_Weighted[0] / g_Count[0];
+	float target = exp2(u_MinLogLuminance + (mean_bin - 0.5) / float(NUM_BINS - 2) * u_LogLuminanceRange);
+
+	float speed = target > previous ? u_SpeedUp : u_SpeedDown;
+	float adapted = previous > 0.0 ? previous + (target - previous) * (1.0 - exp(-u_DeltaTime * speed)) : target;
+
+	imageStore(i_AdaptedLuminance, ivec2(0, 0), vec4(adapted));
+}
+
+// ------------------------------------------------------------------
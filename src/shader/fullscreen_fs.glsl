@@ -6,14 +6,86 @@ in vec2 PS_IN_TexCoord;
 uniform sampler2D s_Texture;
 uniform float exposure;
 
+// With automatic exposure the scene is scaled to bring the adapted luminance (AutoExposure) to middle grey first,
+// exposure then works as a compensation.
+uniform int u_AutoExposure;
+uniform sampler2D s_AdaptedLuminance;
+
+// 0 Reinhard, 1 ACES, 2 AgX.
+uniform int u_Tonemapper;
+
+#define MIDDLE_GREY 0.18
+
 vec3 reinhard(vec3 L)
 {
-	L = L * exposure;
 	return L / (1 + L);
 }
 
+// Stephen Hill's fit of the ACES reference rendering and sRGB output transforms. The matrices go from linear sRGB to
+// the fit's working space and back, and are written row by row, which makes them right-multiplied here.
+const mat3 ACES_INPUT = mat3(0.59719, 0.35458, 0.04823,
+							 0.07600, 0.90834, 0.01566,
+							 0.02840, 0.13383, 0.83777);
+
+const mat3 ACES_OUTPUT = mat3( 1.60475, -0.53108, -0.07367,
+							  -0.10208,  1.10813, -0.00605,
+							  -0.00327, -0.07276,  1.07602);
+
+vec3 aces(vec3 L)
+{
+	vec3 v = L * ACES_INPUT;
+	vec3 a = v * (v + 0.0245786) - 0.000090537;
+	vec3 b = v * (0.983729 * v + 0.4329510) + 0.238081;
+
+	return clamp((a / b) * ACES_OUTPUT, 0.0, 1.0);
+}
+
+// Troy Sobotka's AgX with the default look, as the minimal polynomial fit by Benjamin Wrensch. Compresses 16.5 stops
+// around middle grey and desaturates towards white instead of skewing hues, which keeps the sun disc from turning
+// yellow or cyan.
+vec3 agx_contrast(vec3 x)
+{
+	vec3 x2 = x * x;
+	vec3 x4 = x2 * x2;
+
+	return 15.5 * x4 * x2 - 40.14 * x4 * x + 31.96 * x4 - 6.868 * x2 * x + 0.4298 * x2 + 0.1191 * x - 0.00232;
+}
+
+vec3 agx(vec3 L)
+{
+	const mat3 inset = mat3(0.842479062253094, 0.0423282422610123, 0.0423756549057051,
+							0.0784335999999992, 0.878468636469772, 0.0784336,
+							0.0792237451477643, 0.0791661274605434, 0.879142973793104);
+
+	const mat3 outset = mat3(1.19687900512017, -0.0528968517574562, -0.0529716355144438,
+							 -0.0980208811401368, 1.15190312990417, -0.0980434501171241,
+							 -0.0990297440797205, -0.0989611768448433, 1.15107367264116);
+
+	const float min_ev = -12.47393;
+	const float max_ev = 4.026069;
+
+	vec3 v = clamp(log2(max(inset * L, vec3(1e-10))), min_ev, max_ev);
+	v = agx_contrast((v - min_ev) / (max_ev - min_ev));
+
+	// The curve ends in display encoding, back to linear for the gamma below.
+	return pow(max(outset * v, vec3(0.0)), vec3(2.2));
+}
+
 void main()
 {
-	vec3 color = reinhard(texture(s_Texture, PS_IN_TexCoord).rgb);
+	vec3 L = texture(s_Texture, PS_IN_TexCoord).rgb * exposure;
+
+	if (u_AutoExposure != 0)
+		L *= MIDDLE_GREY / max(texelFetch(s_AdaptedLuminance, ivec2(0, 0), 0).r, 1e-6);
+
+	vec3 color;
+
+	if (u_Tonemapper == 1)
+		color = aces(L);
+	else if (u_Tonemapper == 2)
+		color = agx(L);
+	else
+		color = reinhard(L);
+
 	PS_OUT_Color = vec4(pow(color, vec3(1.0/2.2)), 1.0);
 }
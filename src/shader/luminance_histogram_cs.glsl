@@ -0,0 +1,77 @@
+// First pass of AutoExposure: log luminance histogram of the HDR color buffer. Every invocation takes one bilinear
+// tap at the center of a 4x4 block, the average of the 2x2 texels around it. Bins are counted in shared memory and
+// added to the histogram once per work group, so the global atomics don't grow with the resolution.
+
+#define NUM_BINS 256
+#define GROUP_SIZE 16
+#define DOWNSAMPLE 4
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUT -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout (binding = 0, r32ui) uniform uimage2D i_Histogram;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform sampler2D s_Color;
+uniform vec2 u_Size;
+uniform float u_MinLogLuminance;
+uniform float u_InvLogLuminanceRange;
+
+shared uint g_Bins[NUM_BINS];
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Bin 0 is black, which the average leaves out. The others split the log luminance range evenly.
+uint luminance_bin(vec3 color)
+{
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+
+	if (luminance < 1e-6)
+		return 0u;
+
+	float t = clamp((log2(luminance) - u_MinLogLuminance) * u_InvLogLuminanceRange, 0.0, 1.0);
+	return uint(t * float(NUM_BINS - 2) + 1.0);
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+	g_Bins[gl_LocalInvocationIndex] = 0u;
+
+	memoryBarrierShared();
+	barrier();
+
+	// Between texels 1 and 2 of the block on both axes.
+	ivec2 corner = ivec2(gl_GlobalInvocationID.xy) * DOWNSAMPLE + 2;
+
+	if (all(lessThan(vec2(corner), u_Size)))
+	{
+		vec3 color = textureLod(s_Color, vec2(corner) / u_Size, 0.0).rgb;
+		atomicAdd(g_Bins[luminance_bin(color)], 1u);
+	}
+
+	memoryBarrierShared();
+	barrier();
+
+	uint count = g_Bins[gl_LocalInvocationIndex];
+
+	if (count > 0u)
+		imageAtomicAdd(i_Histogram, ivec2(gl_LocalInvocationIndex, 0), count);
+}
+
+// ------------------------------------------------------------------
@@ -4,12 +4,58 @@ out vec4 PS_OUT_Color;
 in vec3 PS_IN_FragPos;
 in vec3 PS_IN_Normal;
 
+layout (std140) uniform u_GlobalUBO
+{ 
+    mat4 view;
+    mat4 projection;
+    mat4 inv_view;
+    mat4 inv_projection;
+    mat4 inv_view_projection;
+    vec4 view_pos;
+};
+
 uniform vec3 direction;
 
+// Sunlight reaching the ground, irradiance of a surface facing the sun in the sky's units. Computed once per sky
+// update on the CPU (SkyModel::sun_radiance()), so it reddens at sunset without a transmittance lookup per pixel.
+uniform vec3 u_SunRadiance;
+
+// L2 spherical harmonics irradiance of the sky, already convolved with the cosine lobe.
+uniform vec3 u_SH[9];
+
+// GGX prefiltered sky, one roughness level per mip.
+uniform samplerCube s_Prefiltered;
+uniform float u_Roughness;
+uniform float u_MaxMip;
+
+#define M_PI 3.14159265359
+
+vec3 sh_irradiance(vec3 n)
+{
+	return u_SH[0] * 0.282095 +
+		   u_SH[1] * 0.488603 * n.y +
+		   u_SH[2] * 0.488603 * n.z +
+		   u_SH[3] * 0.488603 * n.x +
+		   u_SH[4] * 1.092548 * n.x * n.y +
+		   u_SH[5] * 1.092548 * n.y * n.z +
+		   u_SH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+		   u_SH[7] * 1.092548 * n.x * n.z +
+		   u_SH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
 void main()
 {
+	vec3 n = normalize(PS_IN_Normal);
 	vec3 diffuse = vec3(0.5);
-	vec3 color = dot(PS_IN_Normal, -direction) * diffuse;
+	vec3 v = normalize(view_pos.xyz - PS_IN_FragPos);
+	vec3 r = reflect(-v, n);
+
+	// Schlick fresnel with a dielectric F0.
+	float F = 0.04 + 0.96 * pow(1.0 - max(dot(n, v), 0.0), 5.0);
+	vec3 specular = textureLod(s_Prefiltered, r, u_Roughness * u_MaxMip).rgb;
+
+	vec3 irradiance = max(dot(n, -direction), 0.0) * u_SunRadiance + max(sh_irradiance(n), vec3(0.0));
+	vec3 color = (1.0 - F) * irradiance / M_PI * diffuse + F * specular;
 
 	PS_OUT_Color = vec4(color, 1.0);
 }
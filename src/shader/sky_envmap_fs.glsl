@@ -0,0 +1,37 @@
+#include <sky_models/bruneton/atmosphere.glsl>
+#include <sky_models/bruneton_2017/atmosphere.glsl>
+#include <sky_models/preetham/atmosphere.glsl>
+#include <sky_models/hosek_wilkie/atmosphere.glsl>
+#include <cubemap_common.glsl>
+
+// Renders one face of the sky into a cubemap. Same as sky_fs.glsl minus the sun disc, which would only
+// turn into fireflies once the map is prefiltered.
+
+out vec4 PS_OUT_Color;
+
+in vec2 PS_IN_TexCoord;
+
+uniform vec3 u_Direction;
+uniform vec3 camera_pos;
+uniform int sky_model;
+uniform int u_Face;
+
+void main()
+{
+	vec3 dir = cube_face_direction(u_Face, PS_IN_TexCoord);
+
+	if (sky_model == 0)
+	{
+		vec3 extinction;
+		PS_OUT_Color = vec4(SkyRadiance(camera_pos, dir, extinction), 1.0);
+	}
+	else if (sky_model == 1)
+		PS_OUT_Color = vec4(preetham_sky_rgb(dir, u_Direction), 1.0);
+	else if (sky_model == 3)
+	{
+		vec3 transmittance;
+		PS_OUT_Color = vec4(b17_sky_luminance(camera_pos * 0.001, dir, transmittance), 1.0);
+	}
+	else
+		PS_OUT_Color = vec4(hosek_wilkie_sky_rgb(dir, u_Direction), 1.0);
+}
@@ -1,4 +1,5 @@
 #include <sky_models/bruneton/atmosphere.glsl>
+#include <sky_models/bruneton_2017/atmosphere.glsl>
 #include <sky_models/preetham/atmosphere.glsl>
 #include <sky_models/hosek_wilkie/atmosphere.glsl>
 
@@ -32,6 +33,14 @@ void main()
 
 		PS_OUT_Color = vec4(col, 1.0);
 	}
+	else if (sky_model == 3)
+	{
+		// camera_pos is in m like the 2008 model's.
+		vec3 transmittance;
+		vec3 col = b17_sky_luminance(camera_pos * 0.001, dir, transmittance);
+
+		PS_OUT_Color = vec4(col + b17_sun_luminance(dir, transmittance), 1.0);
+	}
 	else
 	{
 		vec3 col = hosek_wilkie_sky_rgb(dir, u_Direction);
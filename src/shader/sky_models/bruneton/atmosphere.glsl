@@ -30,9 +30,14 @@
 //  Author: Eric Bruneton
 //
 
+// On fixed texture units, distinct from the other model's (SkySamplerUnit in sky_model_gl.h).
 uniform sampler2D s_Transmittance;
 uniform sampler2D s_Irradiance;
 uniform sampler3D s_Inscatter;
+// RGB single Mie scattering, only bound when SINGLE_MIE_TABLE is 1 (BrunetonSkyModel::QUALITY_HIGH). Otherwise it
+// is reconstructed from the red channel in s_Inscatter.w by GetMie().
+uniform sampler3D s_SingleMie;
+uniform int SINGLE_MIE_TABLE;
 
 uniform vec3 EARTH_POS;
 uniform vec3 SUN_DIR;
@@ -87,6 +92,15 @@ vec3 GetMie(vec4 rayMie)
    	return rayMie.rgb * rayMie.w / max(rayMie.r, 1e-4) * (betaR.r / betaR);
 }
 
+// Single Mie scattering between two points, the table counterpart of GetMie() on an inscatter difference.
+vec3 SingleMieBetween(float r, float mu, float muS, float r1, float mu1, float muS1, float nu, vec3 extinction)
+{
+	vec3 mie0 = Texture4D(s_SingleMie, r, mu, muS, nu).rgb;
+	vec3 mie1 = Texture4D(s_SingleMie, r1, mu1, muS1, nu).rgb;
+
+	return max(mie0 - mie1 * extinction, 0.0);
+}
+
 float PhaseFunctionR(float mu) 
 {
 	// Rayleigh phase function
@@ -184,7 +198,7 @@ vec3 SkyRadiance(vec3 camera, vec3 viewdir, out vec3 extinction)
 
     if(r <= Rt) 
     {
-        vec3 inScatterM = GetMie(inScatter);
+        vec3 inScatterM = SINGLE_MIE_TABLE != 0 ? Texture4D(s_SingleMie, r, rMu / r, muS, nu).rgb : GetMie(inScatter);
         float phase = PhaseFunctionR(nu);
         float phaseM = PhaseFunctionM(nu);
         result = inScatter.rgb * phase + inScatterM * phaseM;
@@ -245,6 +259,7 @@ vec3 InScattering(vec3 camera, vec3 _point, out vec3 extinction, float shaftWidt
 		float muS = dot(camera, SUN_DIR) / r;
 
 		vec4 inScatter;
+		vec3 singleMie = vec3(0.0);
 
 		if (r < Rg + 600.0)
 		{
@@ -279,6 +294,7 @@ vec3 InScattering(vec3 camera, vec3 _point, out vec3 extinction, float shaftWidt
 			vec4 inScatter0 = Texture4D(s_Inscatter, r, mu, muS, nu);
 			vec4 inScatter1 = Texture4D(s_Inscatter, r1, mu1, muS1, nu);
 			vec4 inScatterA = max(inScatter0 - inScatter1 * extinction.rgbr, 0.0);
+			vec3 singleMieA = SINGLE_MIE_TABLE != 0 ? SingleMieBetween(r, mu, muS, r1, mu1, muS1, nu, extinction) : vec3(0.0);
 
 			mu = lim + EPS;
 			r1 = sqrt(r * r + d * d + 2.0 * r * d * mu);
@@ -287,20 +303,26 @@ vec3 InScattering(vec3 camera, vec3 _point, out vec3 extinction, float shaftWidt
 			inScatter0 = Texture4D(s_Inscatter, r, mu, muS, nu);
 			inScatter1 = Texture4D(s_Inscatter, r1, mu1, muS1, nu);
 			vec4 inScatterB = max(inScatter0 - inScatter1 * extinction.rgbr, 0.0);
+			vec3 singleMieB = SINGLE_MIE_TABLE != 0 ? SingleMieBetween(r, mu, muS, r1, mu1, muS1, nu, extinction) : vec3(0.0);
 
 			inScatter = mix(inScatterA, inScatterB, a);
+			singleMie = mix(singleMieA, singleMieB, a);
 		}
 		else
 		{
 			vec4 inScatter0 = Texture4D(s_Inscatter, r, mu, muS, nu);
 			vec4 inScatter1 = Texture4D(s_Inscatter, r1, mu1, muS1, nu);
 			inScatter = max(inScatter0 - inScatter1 * extinction.rgbr, 0.0);
+
+			if (SINGLE_MIE_TABLE != 0)
+				singleMie = SingleMieBetween(r, mu, muS, r1, mu1, muS1, nu, extinction);
 		}
 
 		// avoids imprecision problems in Mie scattering when sun is below horizon
 		inScatter.w *= smoothstep(0.00, 0.02, muS);
+		singleMie *= smoothstep(0.00, 0.02, muS);
 
-		vec3 inScatterM = GetMie(inScatter);
+		vec3 inScatterM = SINGLE_MIE_TABLE != 0 ? singleMie : GetMie(inScatter);
 		float phase = PhaseFunctionR(nu);
 		float phaseM = PhaseFunctionM(nu);
 		result = inScatter.rgb * phase + inScatterM * phaseM;
@@ -71,6 +71,7 @@ layout (local_size_x = NUM_THREADS, local_size_y = NUM_THREADS, local_size_z = 1
 // ------------------------------------------------------------------
 
 layout (binding = 0, rgba32f) uniform image3D i_DeltaSRWrite;
+layout (binding = 1, rgba32f) uniform image3D i_InscatterAccumulate;
 
 // ------------------------------------------------------------------
 // UNIFORMS ---------------------------------------------------------
@@ -126,7 +127,13 @@ void main()
     GetLayer(u_Layer, r, dhdH); 
     GetMuMuSNu(coords, r, dhdH, mu, muS, nu); 
 
-    imageStore(i_DeltaSRWrite, ivec3(gl_GlobalInvocationID.xy, u_Layer), vec4(Inscatter(r, mu, muS, nu), 0));
+    ivec3 idx = ivec3(gl_GlobalInvocationID.xy, u_Layer);
+    vec3 deltaS = Inscatter(r, mu, muS, nu);
+
+    imageStore(i_DeltaSRWrite, idx, vec4(deltaS, 0));
+
+    // adds deltaS into S (line 11 in algorithm 4.1) in place, every invocation owns its texel
+    imageStore(i_InscatterAccumulate, idx, imageLoad(i_InscatterAccumulate, idx) + vec4(deltaS / PhaseFunctionR(nu), 0.0));
 }
 
 // ------------------------------------------------------------------
\ No newline at end of file
@@ -71,6 +71,7 @@ layout (local_size_x = NUM_THREADS, local_size_y = NUM_THREADS, local_size_z = 1
 // ------------------------------------------------------------------
 
 layout (binding = 0, rgba32f) uniform image2D i_DeltaEWrite;
+layout (binding = 1, rgba32f) uniform image2D i_IrradianceAccumulate;
 
 // ------------------------------------------------------------------
 // UNIFORMS ---------------------------------------------------------
@@ -129,7 +130,12 @@ void main()
         } 
     } 
  
-    imageStore(i_DeltaEWrite, ivec2(gl_GlobalInvocationID.xy), vec4(result, 1.0)); 
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+
+    imageStore(i_DeltaEWrite, coord, vec4(result, 1.0)); 
+
+    // adds deltaE into E (line 10 in algorithm 4.1) in place, every invocation owns its texel
+    imageStore(i_IrradianceAccumulate, coord, imageLoad(i_IrradianceAccumulate, coord) + vec4(result, 1.0));
 }
 
 // ------------------------------------------------------------------
\ No newline at end of file
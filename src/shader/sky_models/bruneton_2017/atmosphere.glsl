@@ -0,0 +1,232 @@
+//
+//  Precomputed Atmospheric Scattering, 2017 revision
+//  Copyright (c) 2017 Eric Bruneton
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//  1. Redistributions of source code must retain the above copyright
+//     notice, this list of conditions and the following disclaimer.
+//  2. Redistributions in binary form must reproduce the above copyright
+//     notice, this list of conditions and the following disclaimer in the
+//     documentation and/or other materials provided with the distribution.
+//  3. Neither the name of the copyright holders nor the names of its
+//     contributors may be used to endorse or promote products derived from
+//     this software without specific prior written permission.
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+//  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+//  THE POSSIBILITY OF SUCH DAMAGE.
+//
+//  Author: Eric Bruneton
+//
+//  Rendering part only, the tables are precomputed on the CPU (Bruneton2017Precompute) and already luminance.
+//  Everything is prefixed with b17 so it can be included next to the 2008 model. Lengths are in km. Matches
+//  Bruneton2017Lookup.
+//
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+// On fixed texture units, distinct from the other model's (SkySamplerUnit in sky_model_gl.h).
+uniform sampler2D s_B17Transmittance;
+uniform sampler2D s_B17Irradiance;
+uniform sampler3D s_B17Scattering;
+uniform sampler3D s_B17SingleMieScattering;
+
+// Direction towards the sun.
+uniform vec3 b17_sun_direction;
+uniform vec3 b17_earth_position;
+uniform float b17_mie_g;
+uniform float b17_sun_angular_radius;
+uniform vec3 b17_solar_luminance;
+uniform vec3 b17_sky_radiance_to_luminance;
+
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+#define B17_PI 3.14159265
+#define B17_BOTTOM_RADIUS 6360.0
+#define B17_TOP_RADIUS 6420.0
+#define B17_MU_S_MIN -0.2079117
+
+#define B17_TRANSMITTANCE_W 256.0
+#define B17_TRANSMITTANCE_H 64.0
+#define B17_SCATTERING_R 32.0
+#define B17_SCATTERING_MU 128.0
+#define B17_SCATTERING_MU_S 32.0
+#define B17_SCATTERING_NU 8.0
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float b17_texture_coord_from_unit_range(float x, float size)
+{
+	return 0.5 / size + x * (1.0 - 1.0 / size);
+}
+
+// ------------------------------------------------------------------
+
+float b17_distance_to_top(float r, float mu)
+{
+	float discriminant = r * r * (mu * mu - 1.0) + B17_TOP_RADIUS * B17_TOP_RADIUS;
+	return max(-r * mu + sqrt(max(discriminant, 0.0)), 0.0);
+}
+
+// ------------------------------------------------------------------
+
+bool b17_intersects_ground(float r, float mu)
+{
+	return mu < 0.0 && r * r * (mu * mu - 1.0) + B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS >= 0.0;
+}
+
+// ------------------------------------------------------------------
+
+vec3 b17_transmittance_to_top(float r, float mu)
+{
+	float H = sqrt(B17_TOP_RADIUS * B17_TOP_RADIUS - B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS);
+	float rho = sqrt(max(r * r - B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS, 0.0));
+
+	float d = b17_distance_to_top(r, mu);
+	float d_min = B17_TOP_RADIUS - r;
+	float d_max = rho + H;
+
+	float x_mu = (d - d_min) / (d_max - d_min);
+	float x_r = rho / H;
+
+	vec2 uv = vec2(b17_texture_coord_from_unit_range(x_mu, B17_TRANSMITTANCE_W), b17_texture_coord_from_unit_range(x_r, B17_TRANSMITTANCE_H));
+
+	return texture(s_B17Transmittance, uv).rgb;
+}
+
+// ------------------------------------------------------------------
+
+vec4 b17_scattering_uvwz(float r, float mu, float mu_s, float nu, bool ray_r_mu_intersects_ground)
+{
+	float H = sqrt(B17_TOP_RADIUS * B17_TOP_RADIUS - B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS);
+	float rho = sqrt(max(r * r - B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS, 0.0));
+	float u_r = b17_texture_coord_from_unit_range(rho / H, B17_SCATTERING_R);
+
+	float r_mu = r * mu;
+	float discriminant = r_mu * r_mu - r * r + B17_BOTTOM_RADIUS * B17_BOTTOM_RADIUS;
+	float u_mu;
+
+	if (ray_r_mu_intersects_ground)
+	{
+		float d = -r_mu - sqrt(max(discriminant, 0.0));
+		float d_min = r - B17_BOTTOM_RADIUS;
+		float d_max = rho;
+
+		u_mu = 0.5 - 0.5 * b17_texture_coord_from_unit_range(d_max == d_min ? 0.0 : (d - d_min) / (d_max - d_min), B17_SCATTERING_MU / 2.0);
+	}
+	else
+	{
+		float d = -r_mu + sqrt(max(discriminant + H * H, 0.0));
+		float d_min = B17_TOP_RADIUS - r;
+		float d_max = rho + H;
+
+		u_mu = 0.5 + 0.5 * b17_texture_coord_from_unit_range((d - d_min) / (d_max - d_min), B17_SCATTERING_MU / 2.0);
+	}
+
+	float d = b17_distance_to_top(B17_BOTTOM_RADIUS, mu_s);
+	float d_min = B17_TOP_RADIUS - B17_BOTTOM_RADIUS;
+	float d_max = H;
+	float a = (d - d_min) / (d_max - d_min);
+	float A = (b17_distance_to_top(B17_BOTTOM_RADIUS, B17_MU_S_MIN) - d_min) / (d_max - d_min);
+	float u_mu_s = b17_texture_coord_from_unit_range(max(1.0 - a / A, 0.0) / (1.0 + a), B17_SCATTERING_MU_S);
+
+	return vec4((nu + 1.0) / 2.0, u_mu_s, u_mu, u_r);
+}
+
+// ------------------------------------------------------------------
+
+// The 4D table is two trilinear fetches from the neighbouring nu slices.
+vec3 b17_sample_scattering(sampler3D table, vec4 uvwz)
+{
+	float tex_coord_x = uvwz.x * (B17_SCATTERING_NU - 1.0);
+	float tex_x = floor(tex_coord_x);
+	float lerp = tex_coord_x - tex_x;
+
+	vec3 uvw0 = vec3((tex_x + uvwz.y) / B17_SCATTERING_NU, uvwz.z, uvwz.w);
+	vec3 uvw1 = vec3((tex_x + 1.0 + uvwz.y) / B17_SCATTERING_NU, uvwz.z, uvwz.w);
+
+	return texture(table, uvw0).rgb * (1.0 - lerp) + texture(table, uvw1).rgb * lerp;
+}
+
+// ------------------------------------------------------------------
+
+float b17_rayleigh_phase(float nu)
+{
+	return 3.0 / (16.0 * B17_PI) * (1.0 + nu * nu);
+}
+
+// ------------------------------------------------------------------
+
+float b17_mie_phase(float g, float nu)
+{
+	float k = 3.0 / (8.0 * B17_PI) * (1.0 - g * g) / (2.0 + g * g);
+	return k * (1.0 + nu * nu) / pow(1.0 + g * g - 2.0 * g * nu, 1.5);
+}
+
+// ------------------------------------------------------------------
+
+// Sky luminance seen from camera (km, relative to the earth position) along view_dir, without the sun disc, and the
+// transmittance to the top of the atmosphere (0 if the ray hits the ground).
+vec3 b17_sky_luminance(vec3 camera, vec3 view_dir, out vec3 transmittance)
+{
+	camera += b17_earth_position;
+
+	// Move the camera to the top of the atmosphere if it's in space.
+	float r = length(camera);
+	float rmu = dot(camera, view_dir);
+	float distance_to_top_atmosphere_boundary = -rmu - sqrt(rmu * rmu - r * r + B17_TOP_RADIUS * B17_TOP_RADIUS);
+
+	if (distance_to_top_atmosphere_boundary > 0.0)
+	{
+		camera = camera + view_dir * distance_to_top_atmosphere_boundary;
+		r = B17_TOP_RADIUS;
+		rmu += distance_to_top_atmosphere_boundary;
+	}
+	else if (r > B17_TOP_RADIUS)
+	{
+		// The ray doesn't hit the atmosphere.
+		transmittance = vec3(1.0);
+		return vec3(0.0);
+	}
+
+	float mu = rmu / r;
+	float mu_s = dot(camera, b17_sun_direction) / r;
+	float nu = dot(view_dir, b17_sun_direction);
+	bool ray_r_mu_intersects_ground = b17_intersects_ground(r, mu);
+
+	transmittance = ray_r_mu_intersects_ground ? vec3(0.0) : b17_transmittance_to_top(r, mu);
+
+	vec4 uvwz = b17_scattering_uvwz(r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+
+	vec3 scattering = b17_sample_scattering(s_B17Scattering, uvwz);
+	vec3 single_mie_scattering = b17_sample_scattering(s_B17SingleMieScattering, uvwz);
+
+	return (scattering * b17_rayleigh_phase(nu) + single_mie_scattering * b17_mie_phase(b17_mie_g, nu)) * b17_sky_radiance_to_luminance;
+}
+
+// ------------------------------------------------------------------
+
+// Luminance of the sun disc seen along view_dir through the given transmittance, 0 outside of it.
+vec3 b17_sun_luminance(vec3 view_dir, vec3 transmittance)
+{
+	return dot(view_dir, b17_sun_direction) > cos(b17_sun_angular_radius) ? transmittance * b17_solar_luminance : vec3(0.0);
+}
+
+// ------------------------------------------------------------------
@@ -4,6 +4,9 @@
 
 uniform vec3 A, B, C, D, E, F, G, H, I, Z;
 
+// Converts the channels of the active dataset (RGB or CIE XYZ) to the working space RGB.
+uniform mat3 u_HosekToRGB;
+
 // ------------------------------------------------------------------
 // FUNCTIONS --------------------------------------------------------
 // ------------------------------------------------------------------
@@ -22,7 +25,7 @@ vec3 hosek_wilkie_sky_rgb(vec3 v, vec3 sun_dir)
 	float cos_gamma = clamp(dot(v, sun_dir), 0, 1);
 	float gamma_ = acos(cos_gamma);
 
-	vec3 R = Z * hosek_wilkie(cos_theta, gamma_, cos_gamma);
+	vec3 R = u_HosekToRGB * (Z * hosek_wilkie(cos_theta, gamma_, cos_gamma));
     return R;
 }
 
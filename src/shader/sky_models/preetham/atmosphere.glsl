@@ -4,6 +4,9 @@
 
 uniform vec3 p_A, p_B, p_C, p_D, p_E, p_Z;
 
+// xyY to working space RGB with the chromaticity expansion folded in, see PreethamSkyModel::set_color_space().
+uniform mat3 u_PreethamToRGB;
+
 // ------------------------------------------------------------------
 // FUNCTIONS --------------------------------------------------------
 // ------------------------------------------------------------------
@@ -23,14 +26,8 @@ vec3 preetham_sky_rgb(vec3 v, vec3 sun_dir)
     
     vec3 R_xyY = p_Z * perez(cos_theta, gamma, cos_gamma, p_A, p_B, p_C, p_D, p_E);
     
-    vec3 R_XYZ = vec3(R_xyY.x, R_xyY.y, 1 - R_xyY.x - R_xyY.y) * R_xyY.z / R_xyY.y;
-    
     // Radiance
-    float r = dot(vec3( 3.240479, -1.537150, -0.498535), R_XYZ);
-    float g = dot(vec3(-0.969256,  1.875992,  0.041556), R_XYZ);
-    float b = dot(vec3( 0.055648, -0.204043,  1.057311), R_XYZ);
-
-    return vec3(r, g, b);
+    return u_PreethamToRGB * vec3(R_xyY.x, R_xyY.y, 1.0) * (R_xyY.z / R_xyY.y);
 }
 
 // ------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <cubemap_common.glsl>
+
+// GGX prefiltering of the sky cubemap for one face of one mip (Karis, Real Shading in Unreal Engine 4).
+// Samples are importance sampled from the GGX lobe and read from a mip of the source chosen by the
+// ratio of sample to texel solid angle (GPU Gems 3, ch. 20), which removes the aliasing of a plain
+// importance sampled sum at a fraction of the sample count.
+
+out vec4 PS_OUT_Color;
+
+in vec2 PS_IN_TexCoord;
+
+uniform samplerCube s_Source;
+uniform int u_Face;
+uniform float u_Roughness;
+uniform float u_SourceSize;
+
+#define SAMPLE_COUNT 64u
+#define M_PI 3.14159265359
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float radical_inverse_vdc(uint bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return float(bits) * 2.3283064365386963e-10;
+}
+
+// ------------------------------------------------------------------
+
+vec3 importance_sample_ggx(vec2 Xi, vec3 N, float roughness)
+{
+	float a = roughness * roughness;
+
+	float phi = 2.0 * M_PI * Xi.x;
+	float cos_theta = sqrt((1.0 - Xi.y) / (1.0 + (a * a - 1.0) * Xi.y));
+	float sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+
+	vec3 H = vec3(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta);
+
+	vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, N));
+	vec3 bitangent = cross(N, tangent);
+
+	return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+// ------------------------------------------------------------------
+
+float d_ggx(float NdotH, float roughness)
+{
+	float a = roughness * roughness;
+	float a2 = a * a;
+	float d = NdotH * NdotH * (a2 - 1.0) + 1.0;
+	return a2 / (M_PI * d * d);
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+	vec3 N = cube_face_direction(u_Face, PS_IN_TexCoord);
+
+	if (u_Roughness == 0.0)
+	{
+		PS_OUT_Color = vec4(textureLod(s_Source, N, 0.0).rgb, 1.0);
+		return;
+	}
+
+	// Assume V = R = N, as in the split sum approximation.
+	vec3 V = N;
+
+	float texel_solid_angle = 4.0 * M_PI / (6.0 * u_SourceSize * u_SourceSize);
+
+	vec3 color = vec3(0.0);
+	float total_weight = 0.0;
+
+	for (uint i = 0u; i < SAMPLE_COUNT; i++)
+	{
+		vec2 Xi = vec2(float(i) / float(SAMPLE_COUNT), radical_inverse_vdc(i));
+		vec3 H = importance_sample_ggx(Xi, N, u_Roughness);
+		vec3 L = normalize(2.0 * dot(V, H) * H - V);
+
+		float NdotL = dot(N, L);
+
+		if (NdotL > 0.0)
+		{
+			float NdotH = max(dot(N, H), 0.0);
+			float HdotV = max(dot(H, V), 0.0);
+
+			float pdf = d_ggx(NdotH, u_Roughness) * NdotH / (4.0 * HdotV) + 0.0001;
+			float sample_solid_angle = 1.0 / (float(SAMPLE_COUNT) * pdf);
+			float mip = 0.5 * log2(sample_solid_angle / texel_solid_angle) + 1.0;
+
+			color += textureLod(s_Source, L, max(mip, 0.0)).rgb * NdotL;
+			total_weight += NdotL;
+		}
+	}
+
+	PS_OUT_Color = vec4(color / max(total_weight, 0.0001), 1.0);
+}
+
+// ------------------------------------------------------------------
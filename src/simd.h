@@ -0,0 +1,482 @@
+#pragma once
+
+// Minimal 8-wide float/int vector types used by the CPU evaluators. Maps onto AVX2 when the
+// compiler targets it (-mavx2 -mfma or /arch:AVX2) and falls back to plain loops otherwise,
+// so the same kernels build everywhere (including Emscripten).
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define SKY_MODELS_AVX2 1
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+#if defined(SKY_MODELS_AVX2)
+
+struct vec8f
+{
+	__m256 v;
+
+	inline vec8f() {}
+	inline vec8f(__m256 x) : v(x) {}
+	inline vec8f(float x) : v(_mm256_set1_ps(x)) {}
+};
+
+struct vec8i
+{
+	__m256i v;
+
+	inline vec8i() {}
+	inline vec8i(__m256i x) : v(x) {}
+	inline vec8i(int32_t x) : v(_mm256_set1_epi32(x)) {}
+};
+
+struct vec8b
+{
+	__m256 v;
+
+	inline vec8b() {}
+	inline vec8b(__m256 x) : v(x) {}
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f load8(const float* p) { return _mm256_loadu_ps(p); }
+inline void  store8(float* p, const vec8f& a) { _mm256_storeu_ps(p, a.v); }
+inline vec8i load8(const int32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+inline void  store8(int32_t* p, const vec8i& a) { _mm256_storeu_si256((__m256i*)p, a.v); }
+// Zero extends 8 bytes.
+inline vec8i load8(const uint8_t* p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p)); }
+
+inline vec8f operator+(const vec8f& a, const vec8f& b) { return _mm256_add_ps(a.v, b.v); }
+inline vec8f operator-(const vec8f& a, const vec8f& b) { return _mm256_sub_ps(a.v, b.v); }
+inline vec8f operator*(const vec8f& a, const vec8f& b) { return _mm256_mul_ps(a.v, b.v); }
+inline vec8f operator/(const vec8f& a, const vec8f& b) { return _mm256_div_ps(a.v, b.v); }
+inline vec8f operator-(const vec8f& a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+inline vec8b operator<(const vec8f& a, const vec8f& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline vec8b operator<=(const vec8f& a, const vec8f& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline vec8b operator>(const vec8f& a, const vec8f& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline vec8b operator>=(const vec8f& a, const vec8f& b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline vec8b operator&(const vec8b& a, const vec8b& b) { return _mm256_and_ps(a.v, b.v); }
+inline vec8b operator|(const vec8b& a, const vec8b& b) { return _mm256_or_ps(a.v, b.v); }
+inline vec8b operator!(const vec8b& a) { return _mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+inline bool  any(const vec8b& a) { return _mm256_movemask_ps(a.v) != 0; }
+inline bool  all(const vec8b& a) { return _mm256_movemask_ps(a.v) == 0xFF; }
+
+inline vec8f select(const vec8b& m, const vec8f& a, const vec8f& b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+inline vec8f min(const vec8f& a, const vec8f& b) { return _mm256_min_ps(a.v, b.v); }
+inline vec8f max(const vec8f& a, const vec8f& b) { return _mm256_max_ps(a.v, b.v); }
+inline vec8f sqrt(const vec8f& a) { return _mm256_sqrt_ps(a.v); }
+inline vec8f floor(const vec8f& a) { return _mm256_floor_ps(a.v); }
+inline vec8f abs(const vec8f& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline vec8f fmadd(const vec8f& a, const vec8f& b, const vec8f& c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+
+inline vec8i operator+(const vec8i& a, const vec8i& b) { return _mm256_add_epi32(a.v, b.v); }
+inline vec8i operator-(const vec8i& a, const vec8i& b) { return _mm256_sub_epi32(a.v, b.v); }
+inline vec8i operator*(const vec8i& a, const vec8i& b) { return _mm256_mullo_epi32(a.v, b.v); }
+inline vec8i operator&(const vec8i& a, const vec8i& b) { return _mm256_and_si256(a.v, b.v); }
+inline vec8i operator|(const vec8i& a, const vec8i& b) { return _mm256_or_si256(a.v, b.v); }
+inline vec8i operator^(const vec8i& a, const vec8i& b) { return _mm256_xor_si256(a.v, b.v); }
+inline vec8i shift_left(const vec8i& a, int n) { return _mm256_slli_epi32(a.v, n); }
+inline vec8i shift_right(const vec8i& a, int n) { return _mm256_srli_epi32(a.v, n); }
+inline vec8i min(const vec8i& a, const vec8i& b) { return _mm256_min_epi32(a.v, b.v); }
+inline vec8i max(const vec8i& a, const vec8i& b) { return _mm256_max_epi32(a.v, b.v); }
+inline vec8b operator==(const vec8i& a, const vec8i& b) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v)); }
+
+// Truncating float -> int conversion.
+inline vec8i to_int(const vec8f& a) { return _mm256_cvttps_epi32(a.v); }
+inline vec8f to_float(const vec8i& a) { return _mm256_cvtepi32_ps(a.v); }
+inline vec8i as_int(const vec8f& a) { return _mm256_castps_si256(a.v); }
+inline vec8f as_float(const vec8i& a) { return _mm256_castsi256_ps(a.v); }
+
+inline vec8f gather(const float* base, const vec8i& idx) { return _mm256_i32gather_ps(base, idx.v, 4); }
+
+#else
+
+struct vec8f
+{
+	float v[8];
+
+	inline vec8f() {}
+	inline vec8f(float x)
+	{
+		for (int i = 0; i < 8; i++)
+			v[i] = x;
+	}
+};
+
+struct vec8i
+{
+	int32_t v[8];
+
+	inline vec8i() {}
+	inline vec8i(int32_t x)
+	{
+		for (int i = 0; i < 8; i++)
+			v[i] = x;
+	}
+};
+
+struct vec8b
+{
+	bool v[8];
+};
+
+#	define SKY_MODELS_VEC8_UNARY(T, R, name, expr) \
+		inline R name(const T& a)                   \
+		{                                           \
+			R r;                                    \
+			for (int i = 0; i < 8; i++)             \
+				r.v[i] = expr;                      \
+			return r;                               \
+		}
+
+#	define SKY_MODELS_VEC8_BINARY(T, R, name, expr) \
+		inline R name(const T& a, const T& b)        \
+		{                                            \
+			R r;                                     \
+			for (int i = 0; i < 8; i++)              \
+				r.v[i] = expr;                       \
+			return r;                                \
+		}
+
+inline vec8f load8(const float* p)
+{
+	vec8f r;
+	memcpy(r.v, p, sizeof(r.v));
+	return r;
+}
+
+inline void store8(float* p, const vec8f& a) { memcpy(p, a.v, sizeof(a.v)); }
+
+inline vec8i load8(const int32_t* p)
+{
+	vec8i r;
+	memcpy(r.v, p, sizeof(r.v));
+	return r;
+}
+
+inline void store8(int32_t* p, const vec8i& a) { memcpy(p, a.v, sizeof(a.v)); }
+
+inline vec8i load8(const uint8_t* p)
+{
+	vec8i r;
+	for (int i = 0; i < 8; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, operator+, a.v[i] + b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, operator-, a.v[i] - b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, operator*, a.v[i] * b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, operator/, a.v[i] / b.v[i])
+SKY_MODELS_VEC8_UNARY(vec8f, vec8f, operator-, -a.v[i])
+
+SKY_MODELS_VEC8_BINARY(vec8f, vec8b, operator<, a.v[i] < b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8b, operator<=, a.v[i] <= b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8b, operator>, a.v[i] > b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8b, operator>=, a.v[i] >= b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8b, vec8b, operator&, a.v[i] && b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8b, vec8b, operator|, a.v[i] || b.v[i])
+SKY_MODELS_VEC8_UNARY(vec8b, vec8b, operator!, !a.v[i])
+
+inline bool any(const vec8b& a)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		if (a.v[i])
+			return true;
+	}
+
+	return false;
+}
+
+inline bool all(const vec8b& a)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		if (!a.v[i])
+			return false;
+	}
+
+	return true;
+}
+
+inline vec8f select(const vec8b& m, const vec8f& a, const vec8f& b)
+{
+	vec8f r;
+	for (int i = 0; i < 8; i++)
+		r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8f, vec8f, max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+SKY_MODELS_VEC8_UNARY(vec8f, vec8f, sqrt, sqrtf(a.v[i]))
+SKY_MODELS_VEC8_UNARY(vec8f, vec8f, floor, floorf(a.v[i]))
+SKY_MODELS_VEC8_UNARY(vec8f, vec8f, abs, fabsf(a.v[i]))
+
+inline vec8f fmadd(const vec8f& a, const vec8f& b, const vec8f& c) { return a * b + c; }
+
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator+, a.v[i] + b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator-, a.v[i] - b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator*, a.v[i] * b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator&, a.v[i] & b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator|, a.v[i] | b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, operator^, a.v[i] ^ b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8i, max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+SKY_MODELS_VEC8_BINARY(vec8i, vec8b, operator==, a.v[i] == b.v[i])
+
+inline vec8i shift_left(const vec8i& a, int n)
+{
+	vec8i r;
+	for (int i = 0; i < 8; i++)
+		r.v[i] = (int32_t)((uint32_t)a.v[i] << n);
+	return r;
+}
+
+inline vec8i shift_right(const vec8i& a, int n)
+{
+	vec8i r;
+	for (int i = 0; i < 8; i++)
+		r.v[i] = (int32_t)((uint32_t)a.v[i] >> n);
+	return r;
+}
+
+SKY_MODELS_VEC8_UNARY(vec8f, vec8i, to_int, (int32_t)a.v[i])
+SKY_MODELS_VEC8_UNARY(vec8i, vec8f, to_float, (float)a.v[i])
+
+inline vec8i as_int(const vec8f& a)
+{
+	vec8i r;
+	memcpy(r.v, a.v, sizeof(r.v));
+	return r;
+}
+
+inline vec8f as_float(const vec8i& a)
+{
+	vec8f r;
+	memcpy(r.v, a.v, sizeof(r.v));
+	return r;
+}
+
+inline vec8f gather(const float* base, const vec8i& idx)
+{
+	vec8f r;
+	for (int i = 0; i < 8; i++)
+		r.v[i] = base[idx.v[i]];
+	return r;
+}
+
+#	undef SKY_MODELS_VEC8_UNARY
+#	undef SKY_MODELS_VEC8_BINARY
+
+#endif
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+// Backend independent helpers. Transcendentals are Cephes style polynomial approximations accurate to a couple
+// of ulp in the ranges the sky models use; they are not meant to handle denormals, infinities or NaNs.
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f clamp(const vec8f& x, const vec8f& lo, const vec8f& hi) { return min(max(x, lo), hi); }
+
+inline vec8f mix(const vec8f& a, const vec8f& b, const vec8f& t) { return a + (b - a) * t; }
+
+// Loads/stores the first n (<= 8) lanes, for the tails of batches. Unused lanes are filled with fill.
+inline vec8f load_partial(const float* p, size_t n, float fill)
+{
+	float lanes[8];
+
+	for (size_t i = 0; i < 8; i++)
+		lanes[i] = i < n ? p[i] : fill;
+
+	return load8(lanes);
+}
+
+inline void store_partial(float* p, const vec8f& a, size_t n)
+{
+	float lanes[8];
+	store8(lanes, a);
+
+	for (size_t i = 0; i < n; i++)
+		p[i] = lanes[i];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f exp(const vec8f& x_in)
+{
+	vec8f x = clamp(x_in, -87.3f, 88.3f);
+
+	// exp(x) = 2^n * exp(r), r in [-ln2/2, ln2/2]
+	vec8f n = floor(x * 1.44269504088896341f + 0.5f);
+	x       = x - n * 0.693359375f;
+	x       = x + n * 2.12194440e-4f;
+
+	vec8f p = 1.9875691500e-4f;
+	p       = fmadd(p, x, 1.3981999507e-3f);
+	p       = fmadd(p, x, 8.3334519073e-3f);
+	p       = fmadd(p, x, 4.1665795894e-2f);
+	p       = fmadd(p, x, 1.6666665459e-1f);
+	p       = fmadd(p, x, 5.0000001201e-1f);
+	p       = fmadd(p, x * x, x) + 1.0f;
+
+	return p * as_float(shift_left(to_int(n) + vec8i(127), 23));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f log(const vec8f& x_in)
+{
+	vec8f x = max(x_in, 1.17549435e-38f);
+
+	// Split into mantissa in [sqrt(0.5), sqrt(2)) and exponent.
+	vec8i bits = as_int(x);
+	vec8f e    = to_float(shift_right(bits, 23) - vec8i(126));
+	x          = as_float((bits & vec8i(0x007FFFFF)) | vec8i(0x3F000000));
+
+	vec8b small = x < 0.707106781186547524f;
+	e           = select(small, e - 1.0f, e);
+	x           = select(small, x + x - 1.0f, x - 1.0f);
+
+	vec8f z = x * x;
+	vec8f p = 7.0376836292e-2f;
+	p       = fmadd(p, x, -1.1514610310e-1f);
+	p       = fmadd(p, x, 1.1676998740e-1f);
+	p       = fmadd(p, x, -1.2420140846e-1f);
+	p       = fmadd(p, x, 1.4249322787e-1f);
+	p       = fmadd(p, x, -1.6668057665e-1f);
+	p       = fmadd(p, x, 2.0000714765e-1f);
+	p       = fmadd(p, x, -2.4999993993e-1f);
+	p       = fmadd(p, x, 3.3333331174e-1f);
+	p       = p * x * z;
+
+	p = fmadd(e, -2.12194440e-4f, p);
+	p = p - z * 0.5f;
+
+	return x + p + e * 0.693359375f;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Only valid for x > 0, which is all the sky models need.
+inline vec8f pow(const vec8f& x, const vec8f& y) { return exp(log(x) * y); }
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f atan(const vec8f& x_in)
+{
+	vec8f sign = select(x_in < 0.0f, vec8f(-1.0f), vec8f(1.0f));
+	vec8f x    = abs(x_in);
+
+	// Range reduction: atan(x) = pi/2 - atan(1/x) for x > tan(3pi/8), pi/4 + atan((x-1)/(x+1)) for x > tan(pi/8).
+	vec8b big    = x > 2.414213562373095f;
+	vec8b medium = (x > 0.4142135623730950f) & !big;
+
+	vec8f y = select(big, vec8f(1.57079632679489661923f), select(medium, vec8f(0.78539816339744830962f), vec8f(0.0f)));
+	x       = select(big, -1.0f / max(x, 1e-30f), select(medium, (x - 1.0f) / (x + 1.0f), x));
+
+	vec8f z = x * x;
+	vec8f p = 8.05374449538e-2f;
+	p       = fmadd(p, z, -1.38776856032e-1f);
+	p       = fmadd(p, z, 1.99777106478e-1f);
+	p       = fmadd(p, z, -3.33329491539e-1f);
+	p       = fmadd(p * z, x, x);
+
+	return (y + p) * sign;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f atan2(const vec8f& y, const vec8f& x)
+{
+	vec8f pi     = 3.14159265358979323846f;
+	vec8f base   = atan(y / select(abs(x) < 1e-30f, vec8f(1e-30f), x));
+	vec8f offset = select(x < 0.0f, select(y < 0.0f, -pi, pi), vec8f(0.0f));
+
+	return base + offset;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f asin(const vec8f& x_in)
+{
+	vec8f x = clamp(x_in, -1.0f, 1.0f);
+	return atan(x / max(sqrt(1.0f - x * x), 1e-30f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f acos(const vec8f& x_in)
+{
+	vec8f x = clamp(x_in, -1.0f, 1.0f);
+	return 1.57079632679489661923f - asin(x);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Computes sin and cos together, with range reduction to [-pi/4, pi/4] by quadrant.
+inline void sincos(const vec8f& x_in, vec8f& s, vec8f& c)
+{
+	vec8f q  = floor(x_in * 0.63661977236758134308f + 0.5f);
+	vec8f x  = x_in - q * 1.5703125f;
+	x        = x - q * 4.837512969970703125e-4f;
+	x        = x - q * 7.54978995489188216e-8f;
+	vec8i qi = to_int(q - floor(q * 0.25f) * 4.0f);
+
+	vec8f z = x * x;
+
+	vec8f ps = -1.9515295891e-4f;
+	ps       = fmadd(ps, z, 8.3321608736e-3f);
+	ps       = fmadd(ps, z, -1.6666654611e-1f);
+	ps       = fmadd(ps * z, x, x);
+
+	vec8f pc = 2.443315711809948e-5f;
+	pc       = fmadd(pc, z, -1.388731625493765e-3f);
+	pc       = fmadd(pc, z, 4.166664568298827e-2f);
+	pc       = fmadd(pc * z, z, 1.0f - z * 0.5f);
+
+	vec8b swap    = !((qi & vec8i(1)) == vec8i(0));
+	vec8b neg_sin = !((qi & vec8i(2)) == vec8i(0));
+	vec8b neg_cos = !(((qi + vec8i(1)) & vec8i(2)) == vec8i(0));
+
+	s = select(swap, pc, ps);
+	c = select(swap, ps, pc);
+	s = select(neg_sin, -s, s);
+	c = select(neg_cos, -c, c);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f sin(const vec8f& x)
+{
+	vec8f s, c;
+	sincos(x, s, c);
+	return s;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f cos(const vec8f& x)
+{
+	vec8f s, c;
+	sincos(x, s, c);
+	return c;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline vec8f tan(const vec8f& x)
+{
+	vec8f s, c;
+	sincos(x, s, c);
+	return s / c;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
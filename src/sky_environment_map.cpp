@@ -0,0 +1,155 @@
+#include "sky_environment_map.h"
+#include "sky_model_gl.h"
+
+#include <macros.h>
+#include <logger.h>
+#include <utility.h>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SkyEnvironmentMap::SkyEnvironmentMap()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SkyEnvironmentMap::~SkyEnvironmentMap()
+{
+
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool SkyEnvironmentMap::initialize(int size, int mip_count)
+{
+	m_size = size;
+	m_mip_count = mip_count;
+
+	m_fullscreen_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/fullscreen_vs.glsl"));
+	m_capture_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/sky_envmap_fs.glsl"));
+	m_prefilter_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/specular_prefilter_fs.glsl"));
+
+	if (!m_fullscreen_vs || !m_capture_fs || !m_prefilter_fs)
+	{
+		DW_LOG_FATAL("Failed to create Shaders");
+		return false;
+	}
+
+	dw::Shader* capture_shaders[] = { m_fullscreen_vs.get(), m_capture_fs.get() };
+	m_capture_program = std::make_unique<dw::Program>(2, capture_shaders);
+
+	dw::Shader* prefilter_shaders[] = { m_fullscreen_vs.get(), m_prefilter_fs.get() };
+	m_prefilter_program = std::make_unique<dw::Program>(2, prefilter_shaders);
+
+	if (!m_capture_program || !m_prefilter_program)
+	{
+		DW_LOG_FATAL("Failed to create Shader Program");
+		return false;
+	}
+
+	set_sky_sampler_units(m_capture_program.get());
+
+	// Full mip chain on the source so the prefilter can read filtered mips.
+	m_source = std::make_unique<dw::TextureCube>(m_size, m_size, 1, -1, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+	m_source->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
+	m_source->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+	m_prefiltered = std::make_unique<dw::TextureCube>(m_size, m_size, 1, m_mip_count, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+	m_prefiltered->set_min_filter(GL_LINEAR_MIPMAP_LINEAR);
+	m_prefiltered->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+	m_fbo = std::make_unique<dw::Framebuffer>();
+
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	m_task = IDLE;
+	m_valid = false;
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SkyEnvironmentMap::update(SkyModel* model, int sky_model)
+{
+	if (m_task == IDLE)
+	{
+		if (m_valid && m_source_sky_model == sky_model && m_source_revision == model->revision())
+			return;
+
+		m_task = 0;
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+
+	if (m_task == 0)
+	{
+		capture(model, sky_model);
+
+		m_source_sky_model = sky_model;
+		m_source_revision = model->revision();
+		m_valid = true;
+		m_task = 1;
+	}
+	else
+	{
+		int task = m_task - 1;
+
+		prefilter(task / 6, task % 6);
+
+		m_task++;
+
+		if (m_task > m_mip_count * 6)
+			m_task = IDLE;
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SkyEnvironmentMap::capture(SkyModel* model, int sky_model)
+{
+	m_capture_program->use();
+
+	set_render_uniforms(m_capture_program.get(), model);
+	m_capture_program->set_uniform("sky_model", sky_model);
+
+	for (int face = 0; face < 6; face++)
+	{
+		m_fbo->attach_render_target(0, m_source.get(), face, 0);
+		m_fbo->bind();
+		glViewport(0, 0, m_size, m_size);
+
+		m_capture_program->set_uniform("u_Face", face);
+
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+	m_source->generate_mipmaps();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SkyEnvironmentMap::prefilter(int mip, int face)
+{
+	int size = std::max(m_size >> mip, 1);
+
+	m_prefilter_program->use();
+
+	m_fbo->attach_render_target(0, m_prefiltered.get(), face, mip);
+	m_fbo->bind();
+	glViewport(0, 0, size, size);
+
+	m_prefilter_program->set_uniform("u_Face", face);
+	m_prefilter_program->set_uniform("u_Roughness", float(mip) / float(std::max(m_mip_count - 1, 1)));
+	m_prefilter_program->set_uniform("u_SourceSize", float(m_size));
+
+	if (m_prefilter_program->set_uniform("s_Source", 0))
+		m_source->bind(0);
+
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
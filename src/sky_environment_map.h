@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ogl.h>
+#include <memory>
+#include <stdint.h>
+
+class SkyModel;
+
+// Captures the active sky into a cubemap and prefilters it into a GGX mip chain for glossy reflections.
+// Work is amortized over frames: a refresh captures the source in one frame and then prefilters one face of one
+// mip per frame in a round-robin schedule. A refresh is started whenever the sky model's revision changes.
+class SkyEnvironmentMap
+{
+public:
+	SkyEnvironmentMap();
+	~SkyEnvironmentMap();
+
+	bool initialize(int size = 128, int mip_count = 5);
+
+	// Performs at most one step of the schedule. sky_model is the index passed on to the sky shaders.
+	void update(SkyModel* model, int sky_model);
+
+	// Forces a full refresh on the next update, e.g. after switching sky models.
+	inline void invalidate() { m_valid = false; }
+
+	inline dw::TextureCube* prefiltered() { return m_prefiltered.get(); }
+	inline int mip_count() { return m_mip_count; }
+
+private:
+	void capture(SkyModel* model, int sky_model);
+	void prefilter(int mip, int face);
+
+private:
+	const int IDLE = -1;
+
+	int m_size = 128;
+	int m_mip_count = 5;
+
+	// -1 when idle, 0 to capture the source, 1 + mip * 6 + face to prefilter.
+	int m_task = -1;
+	bool m_valid = false;
+	int m_source_sky_model = -1;
+	uint32_t m_source_revision = 0;
+
+	std::unique_ptr<dw::TextureCube> m_source;
+	std::unique_ptr<dw::TextureCube> m_prefiltered;
+	std::unique_ptr<dw::Framebuffer> m_fbo;
+
+	std::unique_ptr<dw::Shader> m_fullscreen_vs;
+	std::unique_ptr<dw::Shader> m_capture_fs;
+	std::unique_ptr<dw::Shader> m_prefilter_fs;
+	std::unique_ptr<dw::Program> m_capture_program;
+	std::unique_ptr<dw::Program> m_prefilter_program;
+};
@@ -1,23 +1,203 @@
 #pragma once
 
-#include <ogl.h>
+#include <glm.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+// A batch of independent sky states as structure-of-arrays, for the batch coefficient APIs. sun_y is the y component
+// of the normalized direction towards the sun, which is all of the direction the coefficients depend on.
+struct SkyStateBatch
+{
+	size_t       count;
+	const float* sun_y;
+	const float* turbidity;
+	const float* albedo;
+};
+
+// Receives the shader parameters of a sky model, so the models stay free of any graphics API. Each setter returns
+// false if the consumer doesn't use the parameter. sky_model_gl.h forwards these to a dw::Program.
+class SkyUniforms
+{
+public:
+	virtual ~SkyUniforms() {}
+
+	virtual bool set(const char* name, int value) = 0;
+	virtual bool set(const char* name, float value) = 0;
+	virtual bool set(const char* name, const glm::vec3& value) = 0;
+	virtual bool set(const char* name, const glm::mat3& value) = 0;
+};
+
+// Immutable snapshot of a sky model's derived parameters, produced by SkyModel::update(). Evaluation only reads the
+// snapshot, so any number of threads can shade with the same state (or copies of it) concurrently without locks.
+// Copies share the underlying data and stay valid after the model moves on to a new state. A default constructed
+// state evaluates to black.
+class SkyState
+{
+public:
+	// Implemented by every model on a private copy of its coefficients.
+	class Evaluator
+	{
+	public:
+		virtual ~Evaluator() {}
+
+		virtual glm::vec3 radiance(const glm::vec3& dir) const = 0;
+
+		virtual void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				glm::vec3 L = radiance(glm::vec3(x[i], y[i], z[i]));
+
+				r[i] = L.r;
+				g[i] = L.g;
+				b[i] = L.b;
+			}
+		}
+	};
+
+	SkyState() {}
+	SkyState(std::shared_ptr<const Evaluator> evaluator, const glm::vec3& sun_direction, const glm::vec3& sun_radiance, float turbidity, float albedo, uint32_t revision) :
+		m_evaluator(std::move(evaluator)), m_sun_direction(sun_direction), m_sun_radiance(sun_radiance), m_turbidity(turbidity), m_albedo(albedo), m_revision(revision) {}
+
+	// Sky radiance seen along dir (without the sun disc).
+	glm::vec3 radiance(const glm::vec3& dir) const
+	{
+		return m_evaluator ? m_evaluator->radiance(dir) : glm::vec3(0.0f);
+	}
+
+	// Batched version over structure-of-arrays directions.
+	void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b) const
+	{
+		if (m_evaluator)
+			m_evaluator->radiance(count, x, y, z, r, g, b);
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+				r[i] = g[i] = b[i] = 0.0f;
+		}
+	}
+
+	inline bool is_valid() const { return m_evaluator != nullptr; }
+
+	// Direction towards the sun.
+	inline glm::vec3 sun_direction() const { return m_sun_direction; }
+
+	// SkyModel::sun_radiance() at the ground, where radiance() is seen from.
+	inline glm::vec3 sun_radiance() const { return m_sun_radiance; }
+	inline float turbidity() const { return m_turbidity; }
+	inline float albedo() const { return m_albedo; }
+	inline uint32_t revision() const { return m_revision; }
+
+private:
+	std::shared_ptr<const Evaluator> m_evaluator;
+	glm::vec3 m_sun_direction = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 m_sun_radiance = glm::vec3(0.0f);
+	float m_turbidity = 0.0f;
+	float m_albedo = 0.0f;
+	uint32_t m_revision = 0;
+};
 
 class SkyModel
 {
 public:
+	virtual ~SkyModel() {}
+
 	virtual bool initialize() = 0;
-	virtual void update() = 0;
-	virtual void set_render_uniforms(dw::Program* program) = 0;
+	virtual void write_uniforms(SkyUniforms& uniforms) = 0;
+
+	// Recomputes the derived sky parameters, but only if the direction, turbidity or albedo changed since the last
+	// call (or mark_dirty() was called), and publishes them as a new state(). Returns true if anything was recomputed.
+	bool update()
+	{
+		if (!m_dirty)
+			return false;
+
+		update_parameters();
+		publish();
+
+		return true;
+	}
+
+	// Snapshot of the parameters computed by the last update(). Take it on the thread that calls update() and hand
+	// copies to the worker threads.
+	inline const SkyState& state() { return m_state; }
+
+	// CPU evaluation of the sky radiance seen along dir (without the sun disc) for the current state(), matching
+	// sky_fs.glsl.
+	inline glm::vec3 radiance(const glm::vec3& dir) { return m_state.radiance(dir); }
+
+	// Batched version over structure-of-arrays directions, vectorized by the models.
+	inline void radiance(size_t count, const float* x, const float* y, const float* z, float* r, float* g, float* b)
+	{
+		m_state.radiance(count, x, y, z, r, g, b);
+	}
+
+	// Light reaching altitude (meters above the ground) from the sun disc, for the current parameters: its radiance
+	// integrated over the disc, i.e. the irradiance of a surface facing the sun, in the units of radiance(). Reddens
+	// and dims towards the horizon and is zero once the sun has set. Each model uses its own atmosphere, update()
+	// evaluates it at the ground for state(), so shading never has to look it up per pixel.
+	virtual glm::vec3 sun_radiance(float altitude) const = 0;
 
 	inline glm::vec3 direction() { return m_direction; }
-	inline void set_direction(glm::vec3 dir) { m_direction = -dir; }
+	inline void set_direction(glm::vec3 dir)
+	{
+		if (-dir != m_direction)
+		{
+			m_direction = -dir;
+			m_dirty = true;
+		}
+	}
 
 	inline float turbidity() { return m_turbidity; }
-	inline void set_turbidity(float t) { m_turbidity = t; }
+	inline void set_turbidity(float t)
+	{
+		if (t != m_turbidity)
+		{
+			m_turbidity = t;
+			m_dirty = true;
+		}
+	}
+
+	inline float albedo() { return m_albedo; }
+	inline void set_albedo(float a)
+	{
+		if (a != m_albedo)
+		{
+			m_albedo = a;
+			m_dirty = true;
+		}
+	}
+
+	inline bool is_dirty() { return m_dirty; }
+	inline void mark_dirty() { m_dirty = true; }
+
+	// Incremented by update() whenever the derived sky parameters are recomputed. Consumers that cache
+	// data derived from the sky (environment maps, irradiance) compare against it to know when to refresh.
+	inline uint32_t revision() { return m_revision; }
+
+protected:
+	virtual void update_parameters() = 0;
+
+	// Copies the parameters computed by update_parameters() into an immutable evaluator for state().
+	virtual std::shared_ptr<const SkyState::Evaluator> create_evaluator() const = 0;
+
+	// Marks the current parameters as up to date and publishes them as a new state(). Models that accept externally
+	// computed parameters call this after taking them.
+	void publish()
+	{
+		m_dirty = false;
+		m_revision++;
+
+		m_state = SkyState(create_evaluator(), m_direction, sun_radiance(0.0f), m_turbidity, m_albedo, m_revision);
+	}
 
 protected:
-	glm::vec3 m_direction;
+	glm::vec3 m_direction = glm::vec3(0.0f);
+	bool m_dirty = true;
+	uint32_t m_revision = 0;
 	float m_normalized_sun_y = 1.15f;
     float m_albedo = 0.1f;
     float m_turbidity = 4.0f;
+	SkyState m_state;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ogl.h>
+#include "sky_model.h"
+
+// Thin GL adapter over the GL-free sky models: forwards their shader parameters to a dw::Program.
+class ProgramUniforms : public SkyUniforms
+{
+public:
+	ProgramUniforms(dw::Program* program) : m_program(program) {}
+
+	bool set(const char* name, int value) override { return m_program->set_uniform(name, value); }
+	bool set(const char* name, float value) override { return m_program->set_uniform(name, value); }
+	bool set(const char* name, const glm::vec3& value) override { return m_program->set_uniform(name, value); }
+	bool set(const char* name, const glm::mat3& value) override { return m_program->set_uniform(name, value); }
+
+private:
+	dw::Program* m_program;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Texture units of the samplers in sky_fs.glsl and sky_envmap_fs.glsl. Every sampler of both Bruneton models has its
+// own unit, so no unit is shared by samplers of different types whichever model renders (or before a model's tables
+// are ready), which strict drivers reject with GL_INVALID_OPERATION. The models only bind their textures to these.
+enum SkySamplerUnit
+{
+	SKY_UNIT_TRANSMITTANCE = 0,
+	SKY_UNIT_IRRADIANCE,
+	SKY_UNIT_INSCATTER,
+	SKY_UNIT_SINGLE_MIE,
+	SKY_UNIT_B17_TRANSMITTANCE,
+	SKY_UNIT_B17_IRRADIANCE,
+	SKY_UNIT_B17_SCATTERING,
+	SKY_UNIT_B17_SINGLE_MIE_SCATTERING
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Assigns the units above to a sky program, once after it's created.
+inline void set_sky_sampler_units(dw::Program* program)
+{
+	program->use();
+	program->set_uniform("s_Transmittance", int(SKY_UNIT_TRANSMITTANCE));
+	program->set_uniform("s_Irradiance", int(SKY_UNIT_IRRADIANCE));
+	program->set_uniform("s_Inscatter", int(SKY_UNIT_INSCATTER));
+	program->set_uniform("s_SingleMie", int(SKY_UNIT_SINGLE_MIE));
+	program->set_uniform("s_B17Transmittance", int(SKY_UNIT_B17_TRANSMITTANCE));
+	program->set_uniform("s_B17Irradiance", int(SKY_UNIT_B17_IRRADIANCE));
+	program->set_uniform("s_B17Scattering", int(SKY_UNIT_B17_SCATTERING));
+	program->set_uniform("s_B17SingleMieScattering", int(SKY_UNIT_B17_SINGLE_MIE_SCATTERING));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+inline void set_render_uniforms(dw::Program* program, SkyModel* model)
+{
+	ProgramUniforms uniforms(program);
+	model->write_uniforms(uniforms);
+}
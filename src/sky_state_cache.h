@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Small LRU cache of derived sky parameters, keyed on the quantized (sun theta, turbidity, albedo) state. States
+// that fall into the same bucket share one entry: theta is quantized to ~0.007 degrees, turbidity to 1/256 and
+// albedo to 1/4096, all well below what is visible in the sky. A capacity of zero disables the cache.
+template <typename T>
+class SkyStateCache
+{
+public:
+	static uint64_t key(float sun_theta, float turbidity, float albedo)
+	{
+		uint64_t theta_q = uint64_t(lroundf(sun_theta * 8192.0f)) & 0xFFFF;
+		uint64_t turbidity_q = uint64_t(lroundf(turbidity * 256.0f)) & 0xFFFF;
+		uint64_t albedo_q = uint64_t(lroundf(albedo * 4096.0f)) & 0xFFFF;
+
+		return (theta_q << 32) | (turbidity_q << 16) | albedo_q;
+	}
+
+	inline size_t capacity() { return m_capacity; }
+	inline size_t size() { return m_entries.size(); }
+
+	void set_capacity(size_t capacity)
+	{
+		m_capacity = capacity;
+
+		while (m_entries.size() > m_capacity)
+			evict();
+	}
+
+	void clear()
+	{
+		m_entries.clear();
+		m_index.clear();
+	}
+
+	// Returns nullptr on a miss. A hit becomes the most recently used entry.
+	const T* find(uint64_t key)
+	{
+		auto it = m_index.find(key);
+
+		if (it == m_index.end())
+			return nullptr;
+
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+		return &it->second->second;
+	}
+
+	void insert(uint64_t key, const T& value)
+	{
+		if (m_capacity == 0)
+			return;
+
+		auto it = m_index.find(key);
+
+		if (it != m_index.end())
+		{
+			it->second->second = value;
+			m_entries.splice(m_entries.begin(), m_entries, it->second);
+			return;
+		}
+
+		if (m_entries.size() == m_capacity)
+			evict();
+
+		m_entries.emplace_front(key, value);
+		m_index[key] = m_entries.begin();
+	}
+
+private:
+	void evict()
+	{
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+	}
+
+private:
+	size_t m_capacity = 0;
+	std::list<std::pair<uint64_t, T>> m_entries;
+	std::unordered_map<uint64_t, typename std::list<std::pair<uint64_t, T>>::iterator> m_index;
+};
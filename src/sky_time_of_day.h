@@ -0,0 +1,145 @@
+#pragma once
+
+#include "sky_model.h"
+#include "solar_position.h"
+
+#include <glm.hpp>
+#include <stddef.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+// Day cycle animation without per-frame coefficient updates. For a fixed turbidity and albedo the coefficients of the
+// analytic models only depend on the sun elevation, so they are precomputed with the batch API at num_elevations
+// elevations from the horizon to the zenith and interpolated linearly between the two neighbours at runtime. The
+// samples are spaced uniformly in the cube root of the elevation, the parameterization of the Hosek-Wilkie splines,
+// which puts them close together near the horizon where the coefficients change quickly. The sun
+// follows its real position for a location and UTC time. Model is PreethamSkyModel or HosekWilkieSkyModel.
+//
+// The table is rebuilt when the model's turbidity or albedo change. Anything else the coefficients depend on (the
+// Hosek-Wilkie dataset) needs an explicit invalidate(). The Bruneton model has no per-update cost to amortize and
+// just takes the sun direction. A table can also come from elsewhere, see set_table().
+template <typename Model>
+class SkyTimeOfDay
+{
+public:
+	static const int NUM_COEFFICIENTS = Model::NUM_BATCH_COEFFICIENTS;
+
+	SkyTimeOfDay(Model* model, int num_elevations = 64) : m_model(model), m_num_elevations(std::max(num_elevations, 2)) {}
+
+	inline void set_location(double latitude, double longitude)
+	{
+		m_latitude = latitude;
+		m_longitude = longitude;
+	}
+
+	inline double latitude() const { return m_latitude; }
+	inline double longitude() const { return m_longitude; }
+
+	// Moves the sun to its position at utc_time (seconds since 1970-01-01 UTC) and publishes the interpolated
+	// coefficients to the model.
+	void set_time(double utc_time)
+	{
+		m_position = solar_position(m_latitude, m_longitude, utc_time);
+		set_sun_direction(solar_direction(m_position));
+	}
+
+	// Same for an explicit direction towards the sun.
+	void set_sun_direction(const glm::vec3& sun_dir)
+	{
+		if (!m_external_table && (m_table.empty() || m_model->turbidity() != m_turbidity || m_model->albedo() != m_albedo))
+			precompute();
+
+		// Below the horizon the models clamp to the horizon coefficients.
+		float x = cbrtf(asinf(glm::clamp(sun_dir.y, 0.0f, 1.0f)) / HALF_PI) * float(m_table_elevations - 1);
+		int   i = std::min(int(x), m_table_elevations - 2);
+		float t = x - float(i);
+
+		const float* c0 = &m_table[size_t(i) * NUM_COEFFICIENTS];
+		const float* c1 = c0 + NUM_COEFFICIENTS;
+
+		float coefficients[NUM_COEFFICIENTS];
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+			coefficients[j] = c0[j] + (c1[j] - c0[j]) * t;
+
+		m_sun_direction = sun_dir;
+		m_model->set_coefficients(-sun_dir, coefficients);
+	}
+
+	inline void invalidate()
+	{
+		m_table.clear();
+		m_external_table = false;
+	}
+
+	// Uses table ([elevation][coefficient], at least two rows at the elevations described above) instead of computing
+	// one from the model, e.g. the HosekFit of a Bruneton model. The row count replaces num_elevations. The model's
+	// turbidity and albedo are ignored until invalidate().
+	void set_table(const std::vector<float>& table)
+	{
+		m_table = table;
+		m_table_elevations = int(table.size() / NUM_COEFFICIENTS);
+		m_external_table = true;
+	}
+
+	// Direction towards the sun and its position after the last set_time().
+	inline glm::vec3 sun_direction() const { return m_sun_direction; }
+	inline const SolarPosition& position() const { return m_position; }
+
+private:
+	void precompute()
+	{
+		m_turbidity = m_model->turbidity();
+		m_albedo = m_model->albedo();
+		m_table_elevations = m_num_elevations;
+
+		std::vector<float> sun_y(m_num_elevations);
+		std::vector<float> turbidity(m_num_elevations, m_turbidity);
+		std::vector<float> albedo(m_num_elevations, m_albedo);
+
+		for (int i = 0; i < m_num_elevations; i++)
+		{
+			float u = float(i) / float(m_num_elevations - 1);
+			sun_y[i] = sinf(u * u * u * HALF_PI);
+		}
+
+		// compute_coefficients() writes one array per coefficient, the table is one row per elevation.
+		std::vector<float> columns(size_t(NUM_COEFFICIENTS) * m_num_elevations);
+		float* outputs[NUM_COEFFICIENTS];
+
+		for (int j = 0; j < NUM_COEFFICIENTS; j++)
+			outputs[j] = &columns[size_t(j) * m_num_elevations];
+
+		SkyStateBatch states = { size_t(m_num_elevations), sun_y.data(), turbidity.data(), albedo.data() };
+		m_model->compute_coefficients(states, outputs, 1);
+
+		m_table.resize(columns.size());
+
+		for (int i = 0; i < m_num_elevations; i++)
+		{
+			for (int j = 0; j < NUM_COEFFICIENTS; j++)
+				m_table[size_t(i) * NUM_COEFFICIENTS + j] = outputs[j][i];
+		}
+	}
+
+private:
+	static constexpr float HALF_PI = 1.57079632679f;
+
+	Model* m_model;
+	int m_num_elevations;
+
+	double m_latitude = 0.0;
+	double m_longitude = 0.0;
+	SolarPosition m_position = { HALF_PI, 0.0f };
+	glm::vec3 m_sun_direction = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	// Turbidity and albedo the table was computed for.
+	float m_turbidity = 0.0f;
+	float m_albedo = 0.0f;
+
+	// [elevation][coefficient]
+	std::vector<float> m_table;
+	int m_table_elevations = 0;
+	bool m_external_table = false;
+};
@@ -0,0 +1,183 @@
+#include "solar_position.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <algorithm>
+
+#include "simd.h"
+#include "parallel.h"
+
+static const double SECONDS_PER_DAY = 86400.0;
+
+// Julian date of the Unix epoch and of J2000.0 (2000-01-01 12:00 TT, taken as UT here).
+static const double JULIAN_DATE_UNIX_EPOCH = 2440587.5;
+static const double JULIAN_DATE_J2000 = 2451545.0;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static double wrap_degrees(double x)
+{
+	x = fmod(x, 360.0);
+	return x < 0.0 ? x + 360.0 : x;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant's days_from_civil).
+static long days_from_civil(long y, int m, int d)
+{
+	y -= m <= 2;
+
+	long era = (y >= 0 ? y : y - 399) / 400;
+	long yoe = y - era * 400;
+	long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+double utc_time(int year, int month, int day, int hour, int minute, double second)
+{
+	return double(days_from_civil(year, month, day)) * SECONDS_PER_DAY + hour * 3600.0 + minute * 60.0 + second;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+SolarPosition solar_position(double latitude, double longitude, double utc_time)
+{
+	const double to_radians = M_PI / 180.0;
+
+	// Days since J2000.0.
+	double n = utc_time / SECONDS_PER_DAY + JULIAN_DATE_UNIX_EPOCH - JULIAN_DATE_J2000;
+
+	// Ecliptic coordinates: mean longitude, mean anomaly, ecliptic longitude and obliquity.
+	double L = wrap_degrees(280.460 + 0.9856474 * n);
+	double g = wrap_degrees(357.528 + 0.9856003 * n) * to_radians;
+	double lambda = (L + 1.915 * sin(g) + 0.020 * sin(2.0 * g)) * to_radians;
+	double epsilon = (23.439 - 0.0000004 * n) * to_radians;
+
+	// Equatorial coordinates.
+	double right_ascension = atan2(cos(epsilon) * sin(lambda), cos(lambda));
+	double declination = asin(sin(epsilon) * sin(lambda));
+
+	// Local hour angle from the Greenwich mean sidereal time.
+	double gmst = wrap_degrees(280.46061837 + 360.98564736629 * n);
+	double hour_angle = (gmst + longitude) * to_radians - right_ascension;
+
+	double phi = latitude * to_radians;
+
+	double sin_elevation = sin(phi) * sin(declination) + cos(phi) * cos(declination) * cos(hour_angle);
+	double azimuth = atan2(-sin(hour_angle), tan(declination) * cos(phi) - sin(phi) * cos(hour_angle));
+
+	SolarPosition position;
+
+	position.elevation = float(asin(fmin(fmax(sin_elevation, -1.0), 1.0)));
+	position.azimuth = float(azimuth < 0.0 ? azimuth + 2.0 * M_PI : azimuth);
+
+	return position;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static vec8f wrap_degrees(const vec8f& x)
+{
+	return x - floor(x * (1.0f / 360.0f)) * 360.0f;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// solar_position() for 8 samples. n = day + fraction days since J2000.0 and day_360 = day mod 360. Every term linear
+// in n is split as rate * n = (day mod 360) - (1 - rate) * day + rate * fraction (for GMST 360 + rate), so the large
+// whole turns cancel exactly and single precision keeps the phases accurate for any date in the valid range.
+static void solar_position_8(float sin_phi, float cos_phi, float longitude, const vec8f& day, const vec8f& day_360, const vec8f& fraction, vec8f& elevation, vec8f& azimuth, vec8f& sin_elevation)
+{
+	const float to_radians = float(M_PI / 180.0);
+
+	vec8f L = wrap_degrees(280.460f + day_360 - 0.0143526f * day + 0.9856474f * fraction);
+	vec8f g = wrap_degrees(357.528f + day_360 - 0.0143997f * day + 0.9856003f * fraction) * to_radians;
+
+	vec8f sin_g, cos_g;
+	sincos(g, sin_g, cos_g);
+
+	// sin(2g) = 2 sin(g) cos(g)
+	vec8f lambda = (L + 1.915f * sin_g + 0.040f * sin_g * cos_g) * to_radians;
+	vec8f epsilon = (23.439f - 0.0000004f * (day + fraction)) * to_radians;
+
+	vec8f sin_lambda, cos_lambda, sin_epsilon, cos_epsilon;
+	sincos(lambda, sin_lambda, cos_lambda);
+	sincos(epsilon, sin_epsilon, cos_epsilon);
+
+	vec8f right_ascension = atan2(cos_epsilon * sin_lambda, cos_lambda);
+	vec8f sin_declination = sin_epsilon * sin_lambda;
+	vec8f cos_declination = sqrt(max(1.0f - sin_declination * sin_declination, 0.0f));
+
+	vec8f gmst = wrap_degrees(280.46061837f + day_360 - 0.01435263371f * day + 360.98564736629f * fraction);
+	vec8f hour_angle = (gmst + longitude) * to_radians - right_ascension;
+
+	vec8f sin_hour_angle, cos_hour_angle;
+	sincos(hour_angle, sin_hour_angle, cos_hour_angle);
+
+	sin_elevation = clamp(sin_phi * sin_declination + cos_phi * cos_declination * cos_hour_angle, -1.0f, 1.0f);
+	elevation = asin(sin_elevation);
+
+	// tan(declination) * cos(phi) - sin(phi) * cos(H), scaled by cos(declination) which is always positive.
+	azimuth = atan2(-sin_hour_angle * cos_declination, sin_declination * cos_phi - sin_phi * cos_hour_angle * cos_declination);
+	azimuth = select(azimuth < 0.0f, azimuth + float(2.0 * M_PI), azimuth);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void solar_positions(double latitude, double longitude, size_t count, const double* utc_times, float* elevation, float* azimuth, float* sun_y, int num_threads)
+{
+	const float sin_phi = float(sin(latitude * M_PI / 180.0));
+	const float cos_phi = float(cos(latitude * M_PI / 180.0));
+
+	parallel_for(count, 8, num_threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i += 8)
+		{
+			size_t n = std::min<size_t>(end - i, 8);
+
+			// The split needs double precision, Unix times do not fit a float.
+			float day[8], day_360[8], fraction[8];
+
+			for (size_t j = 0; j < 8; j++)
+			{
+				double days = (j < n ? utc_times[i + j] : utc_times[i]) / SECONDS_PER_DAY + JULIAN_DATE_UNIX_EPOCH - JULIAN_DATE_J2000;
+				double whole = floor(days);
+
+				day[j] = float(whole);
+				day_360[j] = float(whole - floor(whole / 360.0) * 360.0);
+				fraction[j] = float(days - whole);
+			}
+
+			vec8f out[3];
+			solar_position_8(sin_phi, cos_phi, float(longitude), load8(day), load8(day_360), load8(fraction), out[0], out[1], out[2]);
+
+			float* outputs[3] = { elevation, azimuth, sun_y };
+
+			for (int k = 0; k < 3; k++)
+			{
+				if (!outputs[k])
+					continue;
+
+				if (n == 8)
+					store8(outputs[k] + i, out[k]);
+				else
+					store_partial(outputs[k] + i, out[k], n);
+			}
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 solar_direction(const SolarPosition& position)
+{
+	float cos_elevation = cosf(position.elevation);
+
+	return glm::vec3(cos_elevation * sinf(position.azimuth), sinf(position.elevation), -cos_elevation * cosf(position.azimuth));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm.hpp>
+#include <stddef.h>
+
+// Apparent position of the sun from the low precision formulas of the Astronomical Almanac (Michalsky 1988), accurate
+// to about 0.01 degrees between 1950 and 2050. Atmospheric refraction is ignored. Angles are in radians, latitude is
+// positive north and longitude positive east. Times are UTC seconds since 1970-01-01 (Unix time without leap seconds).
+struct SolarPosition
+{
+	float elevation;
+	// Clockwise from north.
+	float azimuth;
+};
+
+// UTC seconds since 1970-01-01 of a calendar date and time.
+double utc_time(int year, int month, int day, int hour = 0, int minute = 0, double second = 0.0);
+
+SolarPosition solar_position(double latitude, double longitude, double utc_time);
+
+// solar_position() for count UTC times at one location, for analytics over long time series (a year at minute
+// resolution is half a million samples). Runs 8 samples per SIMD batch on up to num_threads threads (0 uses the
+// hardware concurrency). Any of the outputs may be null. sun_y is sin(elevation), the y of solar_direction() and the
+// sun input of SkyStateBatch. The batch path is single precision with the day number split into whole days and a
+// fraction. Measured against solar_position() over 1950 to 2050 at latitudes 80 S to 80 N, it agrees to 2e-4 degrees
+// in elevation and 1e-3 in azimuth while the sun is within 80 degrees of the horizon. Towards the zenith and nadir,
+// where asin() and the azimuth are ill-conditioned, the differences grow to 0.008 and 0.12 degrees.
+void solar_positions(double latitude, double longitude, size_t count, const double* utc_times, float* elevation, float* azimuth, float* sun_y, int num_threads = 0);
+
+// Unit vector towards the sun in the scene convention: y up, -z north, +x east.
+glm::vec3 solar_direction(const SolarPosition& position);
@@ -0,0 +1,426 @@
+#include "table_codec.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+// LZ parameters. Offsets are stored in 16 bits, lengths in a nibble of the sequence token plus extension bytes.
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 14;
+
+static const size_t HEADER_SIZE = 4 + 4 + 8 + 8 + 4;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline uint32_t read_u32(const uint8_t* p)
+{
+	return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline uint64_t read_u64(const uint8_t* p)
+{
+	return uint64_t(read_u32(p)) | uint64_t(read_u32(p + 4)) << 32;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline void write_u32(std::vector<uint8_t>& out, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back(uint8_t(v >> (i * 8)));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline void write_u64(std::vector<uint8_t>& out, uint64_t v)
+{
+	write_u32(out, uint32_t(v));
+	write_u32(out, uint32_t(v >> 32));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static inline uint32_t float_bits(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Lengths of 15 and above continue in extension bytes, each 255 meaning another byte follows.
+static void write_length(std::vector<uint8_t>& out, size_t length)
+{
+	for (length -= 15; length >= 255; length -= 255)
+		out.push_back(255);
+
+	out.push_back(uint8_t(length));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool read_length(const uint8_t*& ip, const uint8_t* end, size_t& length)
+{
+	uint8_t b;
+
+	do
+	{
+		if (ip == end)
+			return false;
+
+		b = *ip++;
+		length += b;
+	} while (b == 255);
+
+	return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// A sequence is a token (literal length << 4 | match length - MIN_MATCH), the literals, and unless it is the last
+// sequence of the chunk a 16 bit offset back into the output.
+static void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t num_literals, size_t offset, size_t match_length)
+{
+	size_t match_code = offset ? match_length - MIN_MATCH : 0;
+
+	out.push_back(uint8_t((num_literals < 15 ? num_literals : 15) << 4 | (match_code < 15 ? match_code : 15)));
+
+	if (num_literals >= 15)
+		write_length(out, num_literals);
+
+	out.insert(out.end(), literals, literals + num_literals);
+
+	if (!offset)
+		return;
+
+	out.push_back(uint8_t(offset));
+	out.push_back(uint8_t(offset >> 8));
+
+	if (match_code >= 15)
+		write_length(out, match_code);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Greedy parse with a single entry hash table of the last position each 4 byte sequence was seen at.
+static void lz_compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+{
+	std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+
+	size_t anchor = 0;
+	size_t i = 0;
+
+	while (i + MIN_MATCH <= size)
+	{
+		uint32_t sequence = read_u32(src + i);
+		uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+
+		// Positions are stored + 1 so that 0 means empty.
+		size_t candidate = table[hash];
+		table[hash] = uint32_t(i + 1);
+
+		if (candidate && i - (candidate - 1) <= MAX_OFFSET && read_u32(src + candidate - 1) == sequence)
+		{
+			size_t ref = candidate - 1;
+			size_t length = MIN_MATCH;
+
+			while (i + length < size && src[ref + length] == src[i + length])
+				length++;
+
+			write_sequence(out, src + anchor, i - anchor, i - ref, length);
+
+			i += length;
+			anchor = i;
+		}
+		else
+			i++;
+	}
+
+	write_sequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool lz_decompress(const uint8_t* ip, size_t size, uint8_t* out, size_t out_size)
+{
+	const uint8_t* ip_end = ip + size;
+	uint8_t* op = out;
+	uint8_t* op_end = out + out_size;
+
+	while (true)
+	{
+		if (ip == ip_end)
+			return false;
+
+		uint8_t token = *ip++;
+		size_t num_literals = token >> 4;
+
+		if (num_literals == 15 && !read_length(ip, ip_end, num_literals))
+			return false;
+
+		if (size_t(ip_end - ip) < num_literals || size_t(op_end - op) < num_literals)
+			return false;
+
+		memcpy(op, ip, num_literals);
+		ip += num_literals;
+		op += num_literals;
+
+		// Only the last sequence has no match.
+		if (op == op_end)
+			return ip == ip_end;
+
+		if (ip_end - ip < 2)
+			return false;
+
+		size_t offset = size_t(ip[0]) | size_t(ip[1]) << 8;
+		ip += 2;
+
+		size_t length = token & 15;
+
+		if (length == 15 && !read_length(ip, ip_end, length))
+			return false;
+
+		length += MIN_MATCH;
+
+		if (offset == 0 || offset > size_t(op - out) || size_t(op_end - op) < length)
+			return false;
+
+		const uint8_t* match = op - offset;
+
+		// Overlapping matches repeat the last offset bytes, offset 1 being a run.
+		if (offset >= length)
+			memcpy(op, match, length);
+		else if (offset == 1)
+			memset(op, *match, length);
+		else
+		{
+			for (size_t j = 0; j < length; j++)
+				op[j] = match[j];
+		}
+
+		op += length;
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Delta + zigzag + byte planes: planes[b * count + i] is byte b of the zigzag delta of float i.
+static void shuffle(const float* data, size_t count, int channels, uint8_t* planes)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t prev = i >= size_t(channels) ? float_bits(data[i - channels]) : 0;
+		uint32_t delta = float_bits(data[i]) - prev;
+		uint32_t zigzag = (delta << 1) ^ uint32_t(int32_t(delta) >> 31);
+
+		for (int b = 0; b < 4; b++)
+			planes[b * count + i] = uint8_t(zigzag >> (b * 8));
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Two passes: reassembling the bytes has no dependencies and runs 8 floats at a time with AVX2, the prefix sum over
+// texels only depends on the texel before.
+static void unshuffle(const uint8_t* planes, size_t count, int channels, float* data)
+{
+	uint32_t* bits = (uint32_t*)data;
+	size_t i = 0;
+
+#if defined(SKY_MODELS_AVX2)
+	for (size_t vector_count = count / 8 * 8; i < vector_count; i += 8)
+	{
+		vec8i zigzag = load8(planes + i) | shift_left(load8(planes + count + i), 8) | shift_left(load8(planes + 2 * count + i), 16) | shift_left(load8(planes + 3 * count + i), 24);
+		store8((int32_t*)bits + i, shift_right(zigzag, 1) ^ (vec8i(0) - (zigzag & vec8i(1))));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		uint32_t zigzag = uint32_t(planes[i]) | uint32_t(planes[count + i]) << 8 | uint32_t(planes[2 * count + i]) << 16 | uint32_t(planes[3 * count + i]) << 24;
+		bits[i] = (zigzag >> 1) ^ (0u - (zigzag & 1));
+	}
+
+	// The common RGBA case keeps the running sums in registers.
+	if (channels == 4 && count % 4 == 0)
+	{
+		uint32_t sum[4] = { 0, 0, 0, 0 };
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				sum[c] += bits[i + c];
+				bits[i + c] = sum[c];
+			}
+		}
+
+		return;
+	}
+
+	for (size_t i = channels; i < count; i++)
+		bits[i] += bits[i - channels];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void table_encode(const float* data, size_t count, int channels, size_t chunk_size, std::vector<uint8_t>& encoded)
+{
+	chunk_size = (std::max(chunk_size, size_t(channels)) + channels - 1) / channels * channels;
+	size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+
+	encoded.clear();
+
+	write_u32(encoded, TABLE_CODEC_MAGIC);
+	write_u32(encoded, uint32_t(channels));
+	write_u64(encoded, count);
+	write_u64(encoded, chunk_size);
+	write_u32(encoded, uint32_t(num_chunks));
+
+	// Sizes are patched in once the chunk is compressed.
+	size_t sizes = encoded.size();
+	encoded.resize(sizes + num_chunks * 4);
+
+	std::vector<uint8_t> planes(chunk_size * 4);
+	std::vector<uint8_t> compressed;
+
+	for (size_t c = 0; c < num_chunks; c++)
+	{
+		size_t begin = c * chunk_size;
+		size_t n = std::min(chunk_size, count - begin);
+
+		shuffle(data + begin, n, channels, planes.data());
+
+		compressed.clear();
+		lz_compress(planes.data(), n * 4, compressed);
+
+		for (int i = 0; i < 4; i++)
+			encoded[sizes + c * 4 + i] = uint8_t(compressed.size() >> (i * 8));
+
+		encoded.insert(encoded.end(), compressed.begin(), compressed.end());
+	}
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool table_decode(const uint8_t* encoded, size_t size, float* data, size_t count, int num_threads)
+{
+	if (size < HEADER_SIZE || !is_table_encoded(encoded, size))
+		return false;
+
+	int channels = int(read_u32(encoded + 4));
+	uint64_t encoded_count = read_u64(encoded + 8);
+	uint64_t chunk_size = read_u64(encoded + 16);
+	size_t num_chunks = read_u32(encoded + 24);
+
+	if (encoded_count != count || channels <= 0 || chunk_size == 0 || chunk_size % channels != 0 || num_chunks != (count ? (count - 1) / chunk_size + 1 : 0))
+		return false;
+
+	if ((size - HEADER_SIZE) / 4 < num_chunks)
+		return false;
+
+	// Chunk offsets from the sizes, so the chunks can be decoded in any order.
+	std::vector<size_t> offsets(num_chunks + 1);
+	offsets[0] = HEADER_SIZE + num_chunks * 4;
+
+	for (size_t c = 0; c < num_chunks; c++)
+	{
+		offsets[c + 1] = offsets[c] + read_u32(encoded + HEADER_SIZE + c * 4);
+
+		if (offsets[c + 1] > size)
+			return false;
+	}
+
+	if (offsets[num_chunks] != size)
+		return false;
+
+	std::atomic<bool> ok(true);
+
+	parallel_for(num_chunks, 1, num_threads, [&](size_t begin, size_t end) {
+		std::vector<uint8_t> planes(std::min(size_t(chunk_size), count) * 4);
+
+		for (size_t c = begin; c < end && ok; c++)
+		{
+			size_t first = c * size_t(chunk_size);
+			size_t n = std::min(size_t(chunk_size), count - first);
+
+			if (!lz_decompress(encoded + offsets[c], offsets[c + 1] - offsets[c], planes.data(), n * 4))
+			{
+				ok = false;
+				return;
+			}
+
+			unshuffle(planes.data(), n, channels, data + first);
+		}
+	});
+
+	return ok;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool table_read_file(const std::string& path, float* data, size_t count)
+{
+	FILE* f = fopen(path.c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (size <= 0)
+	{
+		fclose(f);
+		return false;
+	}
+
+	// Raw tables are read straight into place, compressed ones are detected by their magic.
+	if (size_t(size) == count * sizeof(float))
+	{
+		size_t read = fread(data, sizeof(float), count, f);
+		fclose(f);
+
+		return read == count;
+	}
+
+	std::vector<uint8_t> encoded(size);
+	size_t read = fread(encoded.data(), 1, encoded.size(), f);
+	fclose(f);
+
+	return read == encoded.size() && table_decode(encoded.data(), encoded.size(), data, count);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool table_write_file(const std::string& path, const float* data, size_t count, int channels, size_t chunk_size, bool compressed)
+{
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	bool written;
+
+	if (compressed)
+	{
+		std::vector<uint8_t> encoded;
+		table_encode(data, count, channels, chunk_size, encoded);
+
+		written = fwrite(encoded.data(), 1, encoded.size(), f) == encoded.size();
+	}
+	else
+		written = fwrite(data, sizeof(float), count, f) == count;
+
+	return fclose(f) == 0 && written;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Lossless codec for the precomputed float tables. The table is split into chunks that are coded independently, so
+// they decode in parallel. Within a chunk the float bit patterns are delta coded against the same channel of the
+// previous texel and zigzag mapped (small steps either way give small integers), split into byte planes so the
+// mostly constant high bytes end up next to each other, and compressed with a byte oriented LZ77 in the style of LZ4.
+// Encoding is a one-off when the tables are precomputed, decoding is what the loaders pay for.
+//
+// Layout, little endian: the magic, channels, count (floats), chunk size (floats), chunk count, one compressed size
+// per chunk, then the chunks back to back.
+
+static const uint32_t TABLE_CODEC_MAGIC = 0x315a4b53; // "SKZ1"
+
+// chunk_size is rounded up to a multiple of channels.
+void table_encode(const float* data, size_t count, int channels, size_t chunk_size, std::vector<uint8_t>& encoded);
+
+// Decodes into data, which has to hold exactly count floats. Returns false if the stream is corrupt, truncated or of
+// a different size. num_threads = 0 uses the hardware concurrency.
+bool table_decode(const uint8_t* encoded, size_t size, float* data, size_t count, int num_threads = 0);
+
+inline bool is_table_encoded(const uint8_t* data, size_t size)
+{
+	return size >= 4 && (uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24) == TABLE_CODEC_MAGIC;
+}
+
+// Reads count floats from a table file, raw or encoded (told apart by the file size). Returns false if the file is
+// missing, truncated or holds a different number of floats.
+bool table_read_file(const std::string& path, float* data, size_t count);
+
+// Writes count floats raw or encoded with the given chunk size.
+bool table_write_file(const std::string& path, const float* data, size_t count, int channels, size_t chunk_size, bool compressed);
@@ -0,0 +1,260 @@
+#include "tonemap.h"
+
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "simd.h"
+#include "parallel.h"
+
+// Pixels per partial sum of log_average_luminance(), so the result doesn't depend on the number of threads.
+static const size_t LUMINANCE_CHUNK = 65536;
+
+static const float MIDDLE_GREY = 0.18f;
+
+// Darker pixels count as black, both for the average and before taking logarithms.
+static const float MIN_LUMINANCE = 1e-6f;
+
+// Row major, applied as M * rgb. Stephen Hill's fit of the ACES reference rendering and sRGB output transforms.
+static const float ACES_INPUT[3][3] = { { 0.59719f, 0.35458f, 0.04823f },
+										{ 0.07600f, 0.90834f, 0.01566f },
+										{ 0.02840f, 0.13383f, 0.83777f } };
+
+static const float ACES_OUTPUT[3][3] = { {  1.60475f, -0.53108f, -0.07367f },
+										 { -0.10208f,  1.10813f, -0.00605f },
+										 { -0.00327f, -0.07276f,  1.07602f } };
+
+// AgX in and out of its log encoding, the transposes of the column major matrices in fullscreen_fs.glsl.
+static const float AGX_INSET[3][3] = { { 0.842479062253094f,  0.0784335999999992f, 0.0792237451477643f },
+									   { 0.0423282422610123f, 0.878468636469772f,  0.0791661274605434f },
+									   { 0.0423756549057051f, 0.0784336f,          0.879142973793104f } };
+
+static const float AGX_OUTSET[3][3] = { {  1.19687900512017f,   -0.0980208811401368f, -0.0990297440797205f },
+										{ -0.0528968517574562f,  1.15190312990417f,   -0.0989611768448433f },
+										{ -0.0529716355144438f, -0.0980434501171241f,  1.15107367264116f } };
+
+static const float AGX_MIN_EV = -12.47393f;
+static const float AGX_MAX_EV = 4.026069f;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Scalar counterparts of the simd.h functions, so the operators below are written once for T = float and T = vec8f.
+static inline float min(float a, float b) { return a < b ? a : b; }
+static inline float max(float a, float b) { return a > b ? a : b; }
+static inline float clamp(float x, float lo, float hi) { return min(max(x, lo), hi); }
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+struct Color
+{
+	T r, g, b;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline T luminance(const T& r, const T& g, const T& b)
+{
+	return T(0.2126f) * r + T(0.7152f) * g + T(0.0722f) * b;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline Color<T> transform(const float m[3][3], const Color<T>& c)
+{
+	return { m[0][0] * c.r + m[0][1] * c.g + m[0][2] * c.b,
+			 m[1][0] * c.r + m[1][1] * c.g + m[1][2] * c.b,
+			 m[2][0] * c.r + m[2][1] * c.g + m[2][2] * c.b };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline T reinhard(const T& x)
+{
+	return x / (T(1.0f) + x);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline T aces_curve(const T& v)
+{
+	T a = v * (v + T(0.0245786f)) - T(0.000090537f);
+	T b = v * (T(0.983729f) * v + T(0.4329510f)) + T(0.238081f);
+
+	return a / b;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+static inline T agx_curve(const T& v)
+{
+	// Minimal polynomial fit of the default AgX contrast (Benjamin Wrensch) on the encoded log value.
+	T x = (clamp(log(max(v, T(1e-10f))) * T(1.0f / logf(2.0f)), T(AGX_MIN_EV), T(AGX_MAX_EV)) - T(AGX_MIN_EV)) * T(1.0f / (AGX_MAX_EV - AGX_MIN_EV));
+	T x2 = x * x;
+	T x4 = x2 * x2;
+
+	return T(15.5f) * x4 * x2 - T(40.14f) * x4 * x + T(31.96f) * x4 - T(6.868f) * x2 * x + T(0.4298f) * x2 + T(0.1191f) * x - T(0.00232f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Exposed linear radiance to display values in [0, 1], the body of fullscreen_fs.glsl.
+template <typename T>
+static Color<T> tonemap_color(Color<T> c, Tonemapper tonemapper, float inv_gamma)
+{
+	if (tonemapper == TONEMAPPER_ACES)
+	{
+		c = transform(ACES_INPUT, c);
+		c = transform(ACES_OUTPUT, Color<T>{ aces_curve(c.r), aces_curve(c.g), aces_curve(c.b) });
+	}
+	else if (tonemapper == TONEMAPPER_AGX)
+	{
+		c = transform(AGX_INSET, c);
+		c = transform(AGX_OUTSET, Color<T>{ agx_curve(c.r), agx_curve(c.g), agx_curve(c.b) });
+
+		// The curve ends in display encoding, back to linear for the gamma below.
+		c = { pow(max(c.r, T(1e-10f)), T(2.2f)), pow(max(c.g, T(1e-10f)), T(2.2f)), pow(max(c.b, T(1e-10f)), T(2.2f)) };
+	}
+	else
+		c = { reinhard(c.r), reinhard(c.g), reinhard(c.b) };
+
+	// Clamped away from zero for the SIMD pow(), which doesn't take it. 1e-10 still rounds to black.
+	return { pow(clamp(c.r, T(1e-10f), T(1.0f)), T(inv_gamma)),
+			 pow(clamp(c.g, T(1e-10f), T(1.0f)), T(inv_gamma)),
+			 pow(clamp(c.b, T(1e-10f), T(1.0f)), T(inv_gamma)) };
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float log_average_luminance(size_t count, const float* r, const float* g, const float* b, int num_threads)
+{
+	size_t num_chunks = (count + LUMINANCE_CHUNK - 1) / LUMINANCE_CHUNK;
+
+	std::vector<double> log_sums(num_chunks, 0.0);
+	std::vector<size_t> counts(num_chunks, 0);
+
+	parallel_for(num_chunks, 1, num_threads, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t first = chunk * LUMINANCE_CHUNK;
+			size_t last = std::min(first + LUMINANCE_CHUNK, count);
+
+			// A chunk holds few enough pixels for single precision sums.
+			vec8f sum(0.0f);
+			vec8f n(0.0f);
+			size_t i = first;
+
+			for (; i + 8 <= last; i += 8)
+			{
+				vec8f L = luminance(load8(r + i), load8(g + i), load8(b + i));
+				vec8b lit = L >= vec8f(MIN_LUMINANCE);
+
+				sum = sum + select(lit, log(max(L, vec8f(MIN_LUMINANCE))), vec8f(0.0f));
+				n = n + select(lit, vec8f(1.0f), vec8f(0.0f));
+			}
+
+			for (; i < last; i++)
+			{
+				float L = luminance(r[i], g[i], b[i]);
+
+				if (L >= MIN_LUMINANCE)
+				{
+					log_sums[chunk] += log(double(L));
+					counts[chunk]++;
+				}
+			}
+
+			float sum_lanes[8];
+			float n_lanes[8];
+
+			store8(sum_lanes, sum);
+			store8(n_lanes, n);
+
+			for (int j = 0; j < 8; j++)
+			{
+				log_sums[chunk] += double(sum_lanes[j]);
+				counts[chunk] += size_t(n_lanes[j]);
+			}
+		}
+	});
+
+	double log_sum = 0.0;
+	size_t lit = 0;
+
+	for (size_t chunk = 0; chunk < num_chunks; chunk++)
+	{
+		log_sum += log_sums[chunk];
+		lit += counts[chunk];
+	}
+
+	return lit > 0 ? float(exp(log_sum / double(lit))) : 0.0f;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 tonemap(const glm::vec3& radiance, Tonemapper tonemapper, float exposure, float gamma)
+{
+	Color<float> c = tonemap_color(Color<float>{ radiance.r * exposure, radiance.g * exposure, radiance.b * exposure }, tonemapper, 1.0f / gamma);
+	return glm::vec3(c.r, c.g, c.b);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void tonemap(const TonemapSettings& settings, size_t count, const float* r, const float* g, const float* b, uint8_t* rgb, int num_threads)
+{
+	float exposure = settings.exposure;
+
+	if (settings.auto_exposure)
+	{
+		float average = log_average_luminance(count, r, g, b, num_threads);
+
+		if (average > 0.0f)
+			exposure *= MIDDLE_GREY / average;
+	}
+
+	const float inv_gamma = 1.0f / settings.gamma;
+
+	const vec8f exposure8(exposure);
+
+	// Ranges are whole multiples of 8 pixels apart from the very last, whose tail takes the scalar path.
+	parallel_for(count, 8, num_threads, [&](size_t begin, size_t end) {
+		size_t i = begin;
+
+		for (; i + 8 <= end; i += 8)
+		{
+			Color<vec8f> c = { load8(r + i) * exposure8, load8(g + i) * exposure8, load8(b + i) * exposure8 };
+			c = tonemap_color(c, settings.tonemapper, inv_gamma);
+
+			// Round to nearest, the display values are already clamped to [0, 1].
+			int32_t q[3][8];
+			store8(q[0], to_int(fmadd(c.r, vec8f(255.0f), vec8f(0.5f))));
+			store8(q[1], to_int(fmadd(c.g, vec8f(255.0f), vec8f(0.5f))));
+			store8(q[2], to_int(fmadd(c.b, vec8f(255.0f), vec8f(0.5f))));
+
+			uint8_t* out = rgb + i * 3;
+
+			for (int j = 0; j < 8; j++)
+			{
+				out[j * 3 + 0] = uint8_t(q[0][j]);
+				out[j * 3 + 1] = uint8_t(q[1][j]);
+				out[j * 3 + 2] = uint8_t(q[2][j]);
+			}
+		}
+
+		for (; i < end; i++)
+		{
+			Color<float> c = tonemap_color(Color<float>{ r[i] * exposure, g[i] * exposure, b[i] * exposure }, settings.tonemapper, inv_gamma);
+
+			rgb[i * 3 + 0] = uint8_t(c.r * 255.0f + 0.5f);
+			rgb[i * 3 + 1] = uint8_t(c.g * 255.0f + 0.5f);
+			rgb[i * 3 + 2] = uint8_t(c.b * 255.0f + 0.5f);
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+// Operators of fullscreen_fs.glsl, in the same order as its u_Tonemapper.
+enum Tonemapper
+{
+	TONEMAPPER_REINHARD,
+	TONEMAPPER_ACES,
+	TONEMAPPER_AGX
+};
+
+// Everything fullscreen_fs.glsl does to the HDR frame, for skies rendered on the CPU (baked previews, thumbnails).
+// auto_exposure takes the place of AutoExposure: the log average luminance of the image itself, i.e. what the GPU
+// adaptation settles on for a still frame, is brought to middle grey before exposure is applied.
+struct TonemapSettings
+{
+	Tonemapper tonemapper = TONEMAPPER_REINHARD;
+	float      exposure = 1.0f;
+	bool       auto_exposure = false;
+	float      gamma = 2.2f;
+};
+
+// Geometric mean of the luminance of count pixels, leaving out black ones (zero if all are black).
+float log_average_luminance(size_t count, const float* r, const float* g, const float* b, int num_threads = 0);
+
+// One pixel of linear radiance to display values in [0, 1], before quantization. exposure is the final scale,
+// including any automatic exposure. This is the reference the batched version is checked against.
+glm::vec3 tonemap(const glm::vec3& radiance, Tonemapper tonemapper, float exposure, float gamma);
+
+// Tonemaps count pixels of structure-of-arrays radiance (what SkyState::radiance() produces for a batch of
+// directions) to interleaved 8 bit RGB, rounded to nearest like an UNORM render target. Vectorized 8 pixels at a
+// time, with the gamma as a SIMD pow instead of a scalar one per channel, and split over num_threads (0 = all cores).
+void tonemap(const TonemapSettings& settings, size_t count, const float* r, const float* g, const float* b, uint8_t* rgb, int num_threads = 0);